@@ -0,0 +1,137 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include "benchmark/benchmark.h"
+#include "ConfigManager.h"
+#include "ConfigSetup.h"
+#include "ConfigSnapshot.h"
+#include "ConfigurationLayout.h"
+
+using duplitrace::common::ConfigManager;
+using duplitrace::common::ConfigSetup;
+using duplitrace::indexer::CONFIGURATION_LAYOUT_MAP;
+using duplitrace::indexer::CRAWLER_SCAN_PATHS;
+using duplitrace::indexer::CRAWLER_SECTION;
+using duplitrace::indexer::IO_QUEUE_DEPTH;
+using duplitrace::indexer::IO_SECTION;
+
+// A typical indexer configuration, items not given take their defaults.
+const char CONFIG_BENCHMARK_FILE[] =
+    "[logging]\n"
+    "log_level=INFO\n"
+    "log_to_console=YES\n"
+    "log_filename=/var/log/duplitrace/indexer.log\n"
+    "max_file_size=1048576\n"
+    "max_file_count=4\n"
+    "[crawler]\n"
+    "thread_count=8\n"
+    "scan_paths=/srv/photos,/srv/music,/srv/video,/home\n"
+    "scan_schedule=0 0 2 * * ?\n"
+    "[detection]\n"
+    "hash_algorithm=XXH3\n"
+    "verify_contents=NO\n"
+    "[io]\n"
+    "backend=AUTOMATIC\n"
+    "queue_depth=32\n"
+    "[index]\n"
+    "directory=/var/lib/duplitrace\n"
+    "[watch]\n"
+    "backend=AUTOMATIC\n";
+
+static std::string WriteBenchmarkConfig() {
+    std::string filename = (std::filesystem::temp_directory_path() /
+                            "duplitrace_benchmark.cfg").string();
+
+    std::FILE* file = std::fopen(filename.c_str(), "wb");
+    if (file) {
+        std::fputs(CONFIG_BENCHMARK_FILE, file);
+        std::fclose(file);
+    }
+
+    return filename;
+}
+
+// Read and validate every item of the indexer's configuration layout.
+static void BM_ConfigProcess(benchmark::State& state) {
+    std::string filename = WriteBenchmarkConfig();
+    ConfigSetup layout(CONFIGURATION_LAYOUT_MAP);
+
+    for (auto _ : state) {
+        ConfigManager configManager;
+        configManager.Configure(&layout, filename, true);
+
+        if (!configManager.processConfig()) {
+            state.SkipWithError("Configuration was rejected");
+            break;
+        }
+    }
+
+    std::remove(filename.c_str());
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ConfigProcess);
+
+// Reads through the configuration manager's nested maps.
+static void BM_ConfigGetEntry(benchmark::State& state) {
+    std::string filename = WriteBenchmarkConfig();
+    ConfigSetup layout(CONFIGURATION_LAYOUT_MAP);
+    ConfigManager configManager;
+    configManager.Configure(&layout, filename, true);
+
+    if (!configManager.processConfig()) {
+        state.SkipWithError("Configuration was rejected");
+    }
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(
+            configManager.GetStringEntry("crawler", "scan_paths"));
+        benchmark::DoNotOptimize(
+            configManager.GetIntEntry("io", "queue_depth"));
+    }
+
+    std::remove(filename.c_str());
+    state.SetItemsProcessed(state.iterations() * 2);
+}
+BENCHMARK(BM_ConfigGetEntry);
+
+// The same reads through the snapshot, as the indexer's settings are read.
+static void BM_ConfigSnapshotGet(benchmark::State& state) {
+    std::string filename = WriteBenchmarkConfig();
+    ConfigSetup layout(CONFIGURATION_LAYOUT_MAP);
+    ConfigManager configManager;
+    configManager.Configure(&layout, filename, true);
+
+    if (!configManager.processConfig()) {
+        state.SkipWithError("Configuration was rejected");
+    }
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(configManager.Current().String(
+            CONFIG_KEY(CRAWLER_SECTION, CRAWLER_SCAN_PATHS)));
+        benchmark::DoNotOptimize(configManager.Current().Int(
+            CONFIG_KEY(IO_SECTION, IO_QUEUE_DEPTH)));
+    }
+
+    std::remove(filename.c_str());
+    state.SetItemsProcessed(state.iterations() * 2);
+}
+BENCHMARK(BM_ConfigSnapshotGet);
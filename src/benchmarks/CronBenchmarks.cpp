@@ -0,0 +1,181 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#include <ctime>
+#include "benchmark/benchmark.h"
+#include "Utilities.h"
+#include "../cron_parser/CompiledCronExpression.h"
+#include "../cron_parser/CronExpressionCache.h"
+#include "../cron_parser/CronParser.h"
+
+using duplitrace::cronparser::CompiledCronExpression;
+using duplitrace::cronparser::CronExpression;
+using duplitrace::cronparser::CronExpressionCache;
+using duplitrace::cronparser::CronTimeZone;
+
+// 2024-01-01 00:00:00 UTC, fixed so that runs are comparable.
+const std::time_t CRON_BENCHMARK_START_TIME = 1704067200;
+
+// From dense (fires every second) to sparse (fires once every 4 years), the
+// sparser a schedule the further getNextTriggerTime() has to search.
+const char* const CRON_BENCHMARK_EXPRESSIONS[] = {
+    "* * * * * *",
+    "0 */15 * * * *",
+    "0,30 */15 8-18/2 ? JAN-NOV MON-FRI",
+    "0 0 3 1 * ?",
+    "0 0 0 29 2 ?"
+};
+
+// Parsing a schedule splits each of its fields on ',', '-' and '/'.
+static void BM_CronExpressionParse(benchmark::State& state) {
+    const char* text = CRON_BENCHMARK_EXPRESSIONS[state.range(0)];
+    state.SetLabel(text);
+
+    for (auto _ : state) {
+        CronExpression expression(text);
+        benchmark::DoNotOptimize(expression);
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CronExpressionParse)->DenseRange(0, 4);
+
+// Looking up an expression that has been seen before, as happens for all but
+// the first of the schedules sharing it.
+static void BM_CronExpressionCacheFind(benchmark::State& state) {
+    const char* text = CRON_BENCHMARK_EXPRESSIONS[state.range(0)];
+    state.SetLabel(text);
+
+    CronExpressionCache cache;
+    cache.Find(text);
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(cache.Find(text));
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CronExpressionCacheFind)->DenseRange(0, 4);
+
+static void BM_CronNextTriggerTime(benchmark::State& state) {
+    const char* text = CRON_BENCHMARK_EXPRESSIONS[state.range(0)];
+    state.SetLabel(text);
+
+    CronExpression expression(text);
+    std::tm start;
+    duplitrace::common::StdTimeToStdTm(&CRON_BENCHMARK_START_TIME, &start);
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(expression.getNextTriggerTime(start));
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CronNextTriggerTime)->DenseRange(0, 4);
+
+static void BM_CronExpressionCompile(benchmark::State& state) {
+    const char* text = CRON_BENCHMARK_EXPRESSIONS[state.range(0)];
+    state.SetLabel(text);
+
+    CronExpression expression(text);
+
+    for (auto _ : state) {
+        CompiledCronExpression compiled(expression);
+        benchmark::DoNotOptimize(compiled);
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CronExpressionCompile)->DenseRange(0, 4);
+
+// The compiled form finds each field with a bit scan rather than a search.
+static void BM_CompiledCronNextTriggerTime(benchmark::State& state) {
+    const char* text = CRON_BENCHMARK_EXPRESSIONS[state.range(0)];
+    state.SetLabel(text);
+
+    CompiledCronExpression expression{ CronExpression(text) };
+    std::tm start;
+    duplitrace::common::StdTimeToStdTm(&CRON_BENCHMARK_START_TIME, &start);
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(expression.getNextTriggerTime(start));
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CompiledCronNextTriggerTime)->DenseRange(0, 4);
+
+// A day of trigger times, each carrying on from the last rather than being
+// searched for again from the previous one.
+static void BM_CronTriggerTimesBetween(benchmark::State& state) {
+    const char* text = CRON_BENCHMARK_EXPRESSIONS[state.range(0)];
+    state.SetLabel(text);
+
+    CompiledCronExpression expression{ CronExpression(text) };
+    const std::time_t endTime = CRON_BENCHMARK_START_TIME + 86400;
+    std::tm start;
+    std::tm end;
+    duplitrace::common::StdTimeToStdTm(&CRON_BENCHMARK_START_TIME, &start);
+    duplitrace::common::StdTimeToStdTm(&endTime, &end);
+    int64_t triggers = 0;
+
+    for (auto _ : state) {
+        for (const std::tm& trigger :
+             expression.getTriggerTimesBetween(start, end)) {
+            benchmark::DoNotOptimize(trigger);
+            triggers++;
+        }
+    }
+
+    state.SetItemsProcessed(triggers);
+}
+BENCHMARK(BM_CronTriggerTimesBetween)->DenseRange(0, 4);
+
+// The scheduler's fire time calculation in local time, through localtime_r()
+// and mktime(), which share the C library's time zone lock.
+static void BM_CronNextFireTimeLocal(benchmark::State& state) {
+    CompiledCronExpression expression{
+        CronExpression(CRON_BENCHMARK_EXPRESSIONS[2]) };
+    std::time_t after = CRON_BENCHMARK_START_TIME;
+
+    for (auto _ : state) {
+        std::tm afterTime;
+        duplitrace::common::StdTimeToStdTm(&after, &afterTime);
+        std::tm nextTime = expression.getNextTriggerTime(afterTime);
+        benchmark::DoNotOptimize(duplitrace::common::StdTmToStdTime(nextTime));
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CronNextFireTimeLocal)->ThreadRange(1, 8);
+
+// The same calculation in an explicit time zone.
+static void BM_CronNextFireTimeInZone(benchmark::State& state) {
+    CompiledCronExpression expression{
+        CronExpression(CRON_BENCHMARK_EXPRESSIONS[2]) };
+    auto timeZone = CronTimeZone::Find("Europe/London");
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(expression.getNextTriggerTime(
+            CRON_BENCHMARK_START_TIME, *timeZone));
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CronNextFireTimeInZone)->ThreadRange(1, 8);
@@ -0,0 +1,81 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "benchmark/benchmark.h"
+#include "hashing/Hasher.h"
+
+using duplitrace::common::hashing::CreateHasher;
+using duplitrace::common::hashing::HashAlgorithm;
+using duplitrace::common::hashing::HashAlgorithmName;
+using duplitrace::common::hashing::HashKernel;
+using duplitrace::common::hashing::HashKernelName;
+using duplitrace::common::hashing::HashKernelSupported;
+
+// Fed in pieces the size of the duplicate pipeline's read buffer.
+const size_t HASH_UPDATE_SIZE = 256 * 1024;
+
+/*
+Throughput of hashing a buffer with one algorithm and kernel. The input is
+small enough to stay in cache, so this measures the kernel rather than
+memory bandwidth.
+*/
+static void BM_Hash(benchmark::State& state) {
+    auto algorithm = static_cast<HashAlgorithm>(state.range(0));
+    auto kernel = static_cast<HashKernel>(state.range(1));
+    const size_t length = static_cast<size_t>(state.range(2));
+
+    if (!HashKernelSupported(kernel)) {
+        state.SkipWithError("Kernel is not supported by this CPU");
+        return;
+    }
+
+    std::vector<uint8_t> input(length);
+    for (size_t i = 0; i < length; i++) {
+        input[i] = static_cast<uint8_t>(i * 31);
+    }
+
+    auto hasher = CreateHasher(algorithm, kernel);
+    state.SetLabel(HashAlgorithmName(algorithm) + "/" +
+                   HashKernelName(hasher->Kernel()));
+
+    for (auto _ : state) {
+        hasher->Reset();
+        for (size_t offset = 0; offset < length;
+             offset += HASH_UPDATE_SIZE) {
+            hasher->Update(input.data() + offset,
+                           std::min(HASH_UPDATE_SIZE, length - offset));
+        }
+        benchmark::DoNotOptimize(hasher->Finalise());
+    }
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                            static_cast<int64_t>(length));
+}
+BENCHMARK(BM_Hash)
+    ->ArgsProduct({
+        { static_cast<int64_t>(HashAlgorithm::XXH3),
+          static_cast<int64_t>(HashAlgorithm::BLAKE3) },
+        { static_cast<int64_t>(HashKernel::SCALAR),
+          static_cast<int64_t>(HashKernel::NEON),
+          static_cast<int64_t>(HashKernel::AVX2),
+          static_cast<int64_t>(HashKernel::AVX512) },
+        { 4096, 1024 * 1024 } });
@@ -0,0 +1,161 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#include <atomic>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <string>
+#include <system_error>
+#include "benchmark/benchmark.h"
+#include "CorpusGenerator.h"
+#include "Crawler.h"
+#include "DuplicatePipeline.h"
+#include "PathStore.h"
+
+using duplitrace::common::CorpusGenerator;
+using duplitrace::common::CorpusSettings;
+using duplitrace::common::CorpusSizeDistribution;
+using duplitrace::common::PathStore;
+using duplitrace::indexer::Crawler;
+using duplitrace::indexer::CrawlerFileEntry;
+using duplitrace::indexer::DuplicatePipeline;
+using duplitrace::indexer::DuplicatePipelineSettings;
+
+const size_t SCAN_BENCHMARK_FILES_PER_DIRECTORY = 100;
+const size_t SCAN_BENCHMARK_CRAWLER_THREADS = 4;
+const size_t SCAN_BENCHMARK_MAX_OPEN_DIRECTORIES = 256;
+
+/*
+Generated tree of small files in the temporary directory, 100 to a
+directory. Half the files are copies of an earlier one, and the rest are
+spread over a few KiB of sizes so that detection has to read them. The tree
+is removed when the benchmarks finish.
+*/
+class ScanBenchmarkTree {
+ public:
+    explicit ScanBenchmarkTree(size_t fileCount) {
+        root_ = (std::filesystem::temp_directory_path() /
+                 ("duplitrace_benchmark_" + std::to_string(fileCount)))
+                    .string();
+        std::filesystem::remove_all(root_);
+
+        CorpusSettings settings;
+        settings.depth = 1;
+        settings.fan_out = fileCount / SCAN_BENCHMARK_FILES_PER_DIRECTORY ?
+            fileCount / SCAN_BENCHMARK_FILES_PER_DIRECTORY - 1 : 0;
+        settings.files_per_directory = SCAN_BENCHMARK_FILES_PER_DIRECTORY;
+        settings.size_distribution = CorpusSizeDistribution::UNIFORM;
+        settings.min_size = 512;
+        settings.max_size = 4608;
+        settings.duplicate_ratio = 0.5;
+        settings.hard_link_ratio = 0.0;
+
+        CorpusGenerator generator(settings);
+        generator.Generate(root_);
+        bytes_ = generator.Statistics().bytes;
+        groups_ = generator.DuplicateGroups().size();
+    }
+
+    ~ScanBenchmarkTree() {
+        std::error_code error;
+        std::filesystem::remove_all(root_, error);
+    }
+
+    const std::string& Root() const { return root_; }
+
+    uint64_t Bytes() const { return bytes_; }
+
+    size_t Groups() const { return groups_; }
+
+    // Trees are built the first time a size is asked for and then reused.
+    static const ScanBenchmarkTree& Get(size_t fileCount) {
+        static std::map<size_t, std::unique_ptr<ScanBenchmarkTree>> trees;
+
+        auto& tree = trees[fileCount];
+        if (!tree) {
+            tree = std::make_unique<ScanBenchmarkTree>(fileCount);
+        }
+
+        return *tree;
+    }
+
+ private:
+    std::string root_;
+    uint64_t bytes_;
+    size_t groups_;
+};
+
+// Files found a second by the crawler, with the tree in the page cache. The
+// crawl runs on its own threads, so rates are worked out from real time.
+static void BM_Crawl(benchmark::State& state) {
+    const ScanBenchmarkTree& tree =
+        ScanBenchmarkTree::Get(static_cast<size_t>(state.range(0)));
+
+    for (auto _ : state) {
+        PathStore paths;
+        Crawler crawler(SCAN_BENCHMARK_CRAWLER_THREADS,
+                        SCAN_BENCHMARK_MAX_OPEN_DIRECTORIES, &paths);
+        std::atomic<uint64_t> files(0);
+
+        crawler.Crawl({ tree.Root() },
+                      [&files](const CrawlerFileEntry&) { files++; });
+        benchmark::DoNotOptimize(files.load());
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Crawl)->Arg(1000)->Arg(10000)
+    ->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// A whole scan, crawling the tree and finding its duplicates.
+static void BM_CrawlAndDetect(benchmark::State& state) {
+    const ScanBenchmarkTree& tree =
+        ScanBenchmarkTree::Get(static_cast<size_t>(state.range(0)));
+    size_t groups = 0;
+
+    for (auto _ : state) {
+        PathStore paths;
+        DuplicatePipelineSettings settings;
+        settings.paths = &paths;
+        DuplicatePipeline pipeline(settings);
+        Crawler crawler(SCAN_BENCHMARK_CRAWLER_THREADS,
+                        SCAN_BENCHMARK_MAX_OPEN_DIRECTORIES, &paths);
+
+        crawler.Crawl({ tree.Root() },
+                      [&pipeline](const CrawlerFileEntry& file) {
+                          pipeline.AddFile({ file.directory, file.name,
+                                             file.size, file.device,
+                                             file.inode,
+                                             file.modified_time_ns,
+                                             file.changed_time_ns, 0 });
+                      });
+        groups = pipeline.Run().size();
+    }
+
+    if (groups != tree.Groups()) {
+        state.SkipWithError("Wrong number of duplicate groups found");
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.SetBytesProcessed(state.iterations() *
+                            static_cast<int64_t>(tree.Bytes()));
+}
+BENCHMARK(BM_CrawlAndDetect)->Arg(1000)->Arg(10000)
+    ->Unit(benchmark::kMillisecond)->UseRealTime();
@@ -0,0 +1,119 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#include <ctime>
+#include <string>
+#include "benchmark/benchmark.h"
+#include "WorkerPool.h"
+#include "../cron_parser/CronExpressionCache.h"
+#include "../cron_parser/CronParser.h"
+#include "../scheduler/Scheduler.h"
+
+using duplitrace::common::WorkerPool;
+using duplitrace::cronparser::CronExpression;
+using duplitrace::cronparser::CronExpressionCache;
+using duplitrace::scheduler::Scheduler;
+
+// 2024-01-01 00:00:00 UTC, fixed so that runs are comparable.
+const std::time_t BENCHMARK_START_TIME = 1704067200;
+
+const int SECONDS_PER_DAY = 86400;
+
+// Prime step used to spread the jobs over the seconds of a day, as it shares
+// no factors with 86400 every job gets a distinct fire time.
+const int JOB_SPREAD_STEP = 7919;
+
+/*
+Cost of firing a single job with N daily schedules registered. Each job is
+given a distinct second of the day, so every RunPending() call fires exactly
+one job and the reported complexity is the cost per fire.
+*/
+static void BM_SchedulerFireNextJob(benchmark::State& state) {
+    WorkerPool pool(1);
+    Scheduler scheduler(&pool);
+    const int jobCount = static_cast<int>(state.range(0));
+
+    for (int i = 0; i < jobCount; i++) {
+        int slot = static_cast<int>(
+            (static_cast<int64_t>(i) * JOB_SPREAD_STEP) % SECONDS_PER_DAY);
+        std::string expression =
+            std::to_string(slot % 60) + " " +
+            std::to_string((slot / 60) % 60) + " " +
+            std::to_string(slot / 3600) + " * * *";
+
+        scheduler.AddJob(CronExpression(expression), [] {},
+                         BENCHMARK_START_TIME);
+    }
+
+    for (auto _ : state) {
+        auto deadline = scheduler.NextDeadline();
+        benchmark::DoNotOptimize(scheduler.RunPending(*deadline));
+    }
+
+    state.SetComplexityN(state.range(0));
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SchedulerFireNextJob)
+    ->Arg(10)->Arg(100)->Arg(1000)->Arg(10000)
+    ->Complexity(benchmark::oLogN);
+
+// Per-volume schedules, which mostly repeat the same few expressions.
+const char* const SCHEDULER_VOLUME_SCHEDULES[] = {
+    "0 0 3 * * *",
+    "0 0 3  *  *  *",
+    "0 30 2 * * SUN",
+    "0 30 2 * * sun",
+    "0 0 */6 * * *"
+};
+
+const int SCHEDULER_VOLUME_JOBS = 100000;
+
+/*
+Loading 100k jobs from a handful of distinct expressions, either parsing and
+compiling each job's expression (0) or sharing them through a cache (1).
+*/
+static void BM_SchedulerLoadJobs(benchmark::State& state) {
+    const bool useCache = state.range(0) != 0;
+    state.SetLabel(useCache ? "cached" : "parsed");
+
+    for (auto _ : state) {
+        WorkerPool pool(1);
+        Scheduler scheduler(&pool);
+        CronExpressionCache cache;
+
+        for (int i = 0; i < SCHEDULER_VOLUME_JOBS; i++) {
+            const char* text = SCHEDULER_VOLUME_SCHEDULES[
+                i % (sizeof(SCHEDULER_VOLUME_SCHEDULES) /
+                     sizeof(SCHEDULER_VOLUME_SCHEDULES[0]))];
+
+            if (useCache) {
+                scheduler.AddJob(cache.Find(text), [] {},
+                                 BENCHMARK_START_TIME);
+            } else {
+                scheduler.AddJob(CronExpression(text), [] {},
+                                 BENCHMARK_START_TIME);
+            }
+        }
+
+        benchmark::DoNotOptimize(scheduler.JobCount());
+    }
+
+    state.SetItemsProcessed(state.iterations() * SCHEDULER_VOLUME_JOBS);
+}
+BENCHMARK(BM_SchedulerLoadJobs)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
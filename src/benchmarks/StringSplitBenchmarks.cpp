@@ -0,0 +1,74 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "benchmark/benchmark.h"
+#include "Utilities.h"
+
+using duplitrace::common::StringSplitter;
+
+// A typical scan_paths value, the longest list the service splits.
+const char SPLIT_BENCHMARK_PATHS[] =
+    "/srv/photos,/srv/music,/srv/video,/home/alice,/home/bob,/mnt/nas/backup,"
+    "/mnt/nas/archive,/var/lib/data";
+
+// The stream based splitter StringSplitter replaced, kept as the baseline.
+static std::vector<std::string> StreamStringSplit(std::string_view text,
+                                                  char delimiter) {
+    std::vector<std::string> tokens;
+    std::string token;
+    std::istringstream tokenStream { std::string(text) };
+
+    while (std::getline(tokenStream, token, delimiter)) {
+        tokens.push_back(token);
+    }
+
+    return tokens;
+}
+
+static void BM_StreamStringSplit(benchmark::State& state) {
+    for (auto _ : state) {
+        size_t length = 0;
+        for (const auto& token : StreamStringSplit(SPLIT_BENCHMARK_PATHS,
+                                                   ',')) {
+            length += token.size();
+        }
+        benchmark::DoNotOptimize(length);
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_StreamStringSplit);
+
+static void BM_StringSplitter(benchmark::State& state) {
+    for (auto _ : state) {
+        size_t length = 0;
+        for (std::string_view token : StringSplitter(SPLIT_BENCHMARK_PATHS,
+                                                     ',')) {
+            length += token.size();
+        }
+        benchmark::DoNotOptimize(length);
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_StringSplitter);
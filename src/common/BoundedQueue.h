@@ -0,0 +1,120 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#ifndef BOUNDEDQUEUE_H_
+#define BOUNDEDQUEUE_H_
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+namespace duplitrace { namespace common {
+
+/*
+Fixed capacity, multi-producer/multi-consumer queue. Producers block while
+the queue is full which provides back-pressure between pipeline stages. Once
+closed no more items are accepted and consumers drain what is left.
+*/
+template <typename T>
+class BoundedQueue {
+ public:
+    explicit BoundedQueue(size_t capacity) :
+        capacity_(capacity ? capacity : 1),
+        closed_(false) {
+    }
+
+    // Returns false if the queue has been closed.
+    bool Push(T item) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_full_.wait(lock, [this] {
+            return closed_ || items_.size() < capacity_;
+        });
+
+        if (closed_) {
+            return false;
+        }
+
+        items_.push_back(std::move(item));
+        lock.unlock();
+        not_empty_.notify_one();
+        return true;
+    }
+
+    // Returns no value once the queue is closed and empty.
+    std::optional<T> Pop() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_empty_.wait(lock, [this] {
+            return closed_ || !items_.empty();
+        });
+
+        if (items_.empty()) {
+            return std::nullopt;
+        }
+
+        T item = std::move(items_.front());
+        items_.pop_front();
+        lock.unlock();
+        not_full_.notify_one();
+        return item;
+    }
+
+    // Returns no value if the queue is empty, without waiting.
+    std::optional<T> TryPop() {
+        std::unique_lock<std::mutex> lock(mutex_);
+
+        if (items_.empty()) {
+            return std::nullopt;
+        }
+
+        T item = std::move(items_.front());
+        items_.pop_front();
+        lock.unlock();
+        not_full_.notify_one();
+        return item;
+    }
+
+    void Close() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            closed_ = true;
+        }
+
+        not_full_.notify_all();
+        not_empty_.notify_all();
+    }
+
+    size_t Size() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return items_.size();
+    }
+
+ private:
+    size_t capacity_;
+    bool closed_;
+    std::deque<T> items_;
+    std::mutex mutex_;
+    std::condition_variable not_full_;
+    std::condition_variable not_empty_;
+};
+
+}   // namespace common
+}   // namespace duplitrace
+
+#endif  // BOUNDEDQUEUE_H_
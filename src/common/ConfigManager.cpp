@@ -18,7 +18,10 @@ Copyright 2024 DupliTrace Development Team
     along with this program.If not, see < https://www.gnu.org/licenses/>.
 */
 #include <algorithm>
+#include <atomic>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <string>
 #include "ConfigManager.h"
 #include "Platform.h"
@@ -27,13 +30,20 @@ Copyright 2024 DupliTrace Development Team
 
 namespace duplitrace { namespace common {
 
+// Last version published by any configuration manager.
+static std::atomic<uint64_t> config_manager_version(0);
+
 // Constructor for the configuration manager class.
 ConfigManager::ConfigManager() :
     config_file_(""),
     has_config_file_(false),
     config_file_required_(false),
     layout_(nullptr),
-    config_reader_(nullptr) {
+    config_reader_(nullptr),
+    processed_(false),
+    // Reads before the configuration is processed find nothing.
+    snapshot_(std::make_shared<ConfigSnapshot>()),
+    version_(++config_manager_version) {
 }
 
 void ConfigManager::Configure(ConfigSetup* layout, std::string configFile,
@@ -43,31 +53,113 @@ void ConfigManager::Configure(ConfigSetup* layout, std::string configFile,
     layout_ = layout;
 }
 
-bool ConfigManager::processConfig() {
+bool ConfigManager::processConfig(const ConfigValidator& validate) {
     if (!config_file_.empty()) {
-        config_reader_ = new INIReader(config_file_);
+        auto reader = std::make_unique<INIReader>(config_file_);
 
-        if (config_reader_->ParseError() != 0) {
+        if (reader->ParseError() != 0) {
             std::cerr << "Unable to load config file '"
                 << config_file_ << "'" << std::endl;
             return false;
         }
 
+        config_reader_ = std::move(reader);
         has_config_file_ = true;
     }
 
-    return ReadConfiguration();
+    ConfigItemMap items;
+    auto snapshot = std::make_unique<ConfigSnapshot>();
+
+    if (!ReadConfiguration(&items) ||
+        !RestartItemsUnchanged(items) ||
+        !BuildSnapshot(items, snapshot.get()) ||
+        (validate && !validate(*snapshot))) {
+        return false;
+    }
+
+    config_items_ = std::move(items);
+    processed_ = true;
+    Publish(std::move(snapshot));
+
+    return true;
+}
+
+// Take a thread's own copy of the published snapshot.
+const ConfigSnapshot& ConfigManager::Refresh(
+        ConfigSnapshotCache* cache) const {
+    std::lock_guard<std::mutex> lock(snapshot_mutex_);
+
+    cache->snapshot = snapshot_;
+    cache->version = version_.load(std::memory_order_relaxed);
+
+    return *cache->snapshot;
+}
+
+/*
+Replace the published snapshot. Readers notice the new version on their
+next read, until then they carry on with the copy they hold.
+*/
+void ConfigManager::Publish(std::shared_ptr<const ConfigSnapshot> snapshot) {
+    {
+        std::lock_guard<std::mutex> lock(snapshot_mutex_);
+
+        snapshot_.swap(snapshot);
+        version_.store(++config_manager_version, std::memory_order_release);
+    }
+
+    // The previous snapshot, if no reader still holds it, is freed here
+    // rather than whilst the lock is held.
+    snapshot.reset();
+}
+
+/*
+Check a reloaded configuration against the one first read, for the items
+that are only read when starting.
+
+returns:
+    False if an item that needs a restart has changed.
+*/
+bool ConfigManager::RestartItemsUnchanged(const ConfigItemMap& items) {
+    if (!processed_) {
+        return true;
+    }
+
+    bool unchanged = true;
+
+    for (const auto& sectionName : layout_->Sections()) {
+        for (auto& sectionItem : layout_->Section(sectionName)) {
+            if (!sectionItem.second.IsRestartRequired()) {
+                continue;
+            }
+
+            const ConfigItemValue& current =
+                config_items_.at(sectionName).at(sectionItem.first);
+            const ConfigItemValue& reloaded =
+                items.at(sectionName).at(sectionItem.first);
+
+            if (current.GetIntValue() != reloaded.GetIntValue() ||
+                current.GetStringValue() != reloaded.GetStringValue()) {
+                std::cerr << "Config item " << sectionName << "::"
+                    << sectionItem.first << " cannot be changed without a "
+                    << "restart" << std::endl;
+                unchanged = false;
+            }
+        }
+    }
+
+    return unchanged;
 }
 
 // Get a configuration entry item value from a section.
-int ConfigManager::GetIntEntry(std::string sectionName, std::string itemName) {
+int ConfigManager::GetIntEntry(const std::string& sectionName,
+                               const std::string& itemName) const {
     auto section = config_items_.find(sectionName);
     if (section == config_items_.end()) {
         throw std::invalid_argument("Invalid section");
     }
 
-    auto item = config_items_[section->first].find(itemName);
-    if (item == config_items_[section->first].end()) {
+    auto item = section->second.find(itemName);
+    if (item == section->second.end()) {
         std::string exception = "Invalid config item "
             + sectionName
             + "::" + itemName;
@@ -78,15 +170,15 @@ int ConfigManager::GetIntEntry(std::string sectionName, std::string itemName) {
 }
 
 // Get a configuration entry item value from a section.
-std::string ConfigManager::GetStringEntry(std::string sectionName,
-                                          std::string itemName) {
+std::string ConfigManager::GetStringEntry(const std::string& sectionName,
+                                          const std::string& itemName) const {
     auto section = config_items_.find(sectionName);
     if (section == config_items_.end()) {
         throw std::invalid_argument("Invalid section");
     }
 
-    auto item = config_items_[section->first].find(itemName);
-    if (item == config_items_[section->first].end()) {
+    auto item = section->second.find(itemName);
+    if (item == section->second.end()) {
         std::string exception = "Invalid config item "
             + sectionName
             + "::" + itemName;
@@ -96,7 +188,7 @@ std::string ConfigManager::GetStringEntry(std::string sectionName,
     return item->second.GetStringValue();
 }
 
-bool ConfigManager::ReadConfiguration() {
+bool ConfigManager::ReadConfiguration(ConfigItemMap* items) {
     auto sections = layout_->Sections();
 
     for (auto sectionName = sections.begin(); sectionName != sections.end();
@@ -125,11 +217,11 @@ bool ConfigManager::ReadConfiguration() {
                     return false;
                 }
 
-                if (config_items_.find(*sectionName) == config_items_.end()) {
-                    config_items_.insert({ *sectionName, {} });
+                if (items->find(*sectionName) == items->end()) {
+                    items->insert({ *sectionName, {} });
                 }
 
-                config_items_[*sectionName].insert(
+                (*items)[*sectionName].insert(
                      { sectionItem->second.ItemName(),
                        itemDataValue });
                 break;
@@ -149,11 +241,11 @@ bool ConfigManager::ReadConfiguration() {
                     return false;
                 }
 
-                if (config_items_.find(*sectionName) == config_items_.end()) {
-                    config_items_.insert({ *sectionName, {} });
+                if (items->find(*sectionName) == items->end()) {
+                    items->insert({ *sectionName, {} });
                 }
 
-                config_items_[*sectionName].insert(
+                (*items)[*sectionName].insert(
                     { sectionItem->second.ItemName(),
                     itemDataValue });
                 break;
@@ -165,6 +257,30 @@ bool ConfigManager::ReadConfiguration() {
     return true;
 }
 
+// Copy every item that was read into a snapshot.
+bool ConfigManager::BuildSnapshot(const ConfigItemMap& items,
+                                  ConfigSnapshot* snapshot) {
+    for (const auto& section : items) {
+        for (const auto& item : section.second) {
+            bool added = item.second.GetItemType() ==
+                         CONFIG_ITEM_TYPE_INTEGER ?
+                snapshot->AddInt(section.first, item.first,
+                                 item.second.GetIntValue()) :
+                snapshot->AddString(section.first, item.first,
+                                    item.second.GetStringValue());
+
+            if (!added) {
+                std::cerr << "Config item " << section.first << "::"
+                    << item.first << " has the same key as another item"
+                    << std::endl;
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
 /*
 Read a configuration option of type int, firstly it will check for
 an enviroment variable (format is section_option), otherise try the
@@ -19,10 +19,16 @@ Copyright 2024 DupliTrace Development Team
 */
 #ifndef CONFIGMANAGER_H_
 #define CONFIGMANAGER_H_
+#include <atomic>
+#include <cstdint>
+#include <functional>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <string>
 #include "iniReader.h"
 #include "ConfigSetup.h"
+#include "ConfigSnapshot.h"
 
 namespace duplitrace { namespace common {
 
@@ -31,13 +37,13 @@ class ConfigItemValue {
     ConfigItemValue() : int_value_(0), str_value_("") {
     }
 
-    ConfigItemDataType GetItemType() { return item_type_; }
+    ConfigItemDataType GetItemType() const { return item_type_; }
     void SetItemType(ConfigItemDataType dataType) { item_type_ = dataType; }
 
-    int GetIntValue() { return int_value_; }
+    int GetIntValue() const { return int_value_; }
     void SetIntValue(int value) { int_value_ = value; }
 
-    std::string GetStringValue() { return str_value_; }
+    const std::string& GetStringValue() const { return str_value_; }
     void SetStringValue(std::string value) { str_value_ = value; }
 
  private:
@@ -49,6 +55,9 @@ class ConfigItemValue {
 using ConfigItemValueItem = std::map<std::string, ConfigItemValue>;
 using ConfigItemMap = std::map<std::string, ConfigItemValueItem>;
 
+// Check of a newly read configuration, before it replaces the current one.
+using ConfigValidator = std::function<bool(const ConfigSnapshot&)>;
+
 class ConfigManager {
  public:
     ConfigManager();
@@ -56,21 +65,94 @@ class ConfigManager {
     void Configure(ConfigSetup* layout, std::string configFile = "",
                    bool fileRequired = false);
 
-    bool processConfig();
-
-    int GetIntEntry(std::string sectionName, std::string itemName);
+    /*
+    Read the configuration, it may be read again to reload it. The current
+    configuration is only replaced if every item is valid, no item that
+    needs a restart has changed since it was first read, and the validator,
+    if given, accepts it. processConfig and the Get*Entry calls are for the
+    one thread that manages the configuration.
+
+    returns:
+        False if the configuration was not replaced.
+    */
+    bool processConfig(const ConfigValidator& validate = nullptr);
+
+    int GetIntEntry(const std::string& sectionName,
+                    const std::string& itemName) const;
+
+    std::string GetStringEntry(const std::string& sectionName,
+                               const std::string& itemName) const;
+
+    /*
+    Current configuration, for reads from any thread that need to be cheap.
+    Each thread keeps the snapshot it last read and checks a version number
+    to see whether it is still current, so a read is one atomic load with no
+    lock and no reference count. A thread only takes a lock on its first
+    read after a reload, when it lets go of the snapshot it held before.
+
+    returns:
+        Current snapshot, it and the strings read from it stay valid until
+        the thread reads the configuration again after a reload.
+    */
+    const ConfigSnapshot& Current() const {
+        ConfigSnapshotCache& cache = ThreadCache();
+
+        if (cache.version != version_.load(std::memory_order_acquire)) {
+            return Refresh(&cache);
+        }
+
+        return *cache.snapshot;
+    }
 
-    std::string GetStringEntry(std::string sectionName, std::string itemName);
+    /*
+    Copy of the current configuration for a reader that needs its settings
+    to stay the same across reloads, e.g. for the whole of a scan. The
+    snapshot is freed once the last copy of it is released.
+
+    returns:
+        Current snapshot.
+    */
+    std::shared_ptr<const ConfigSnapshot> Snapshot() const {
+        Current();
+        return ThreadCache().snapshot;
+    }
 
  private:
+    // Snapshot a thread last read and the version it was published as.
+    struct ConfigSnapshotCache {
+        uint64_t version = 0;
+        std::shared_ptr<const ConfigSnapshot> snapshot;
+    };
+
     std::string config_file_;
     bool has_config_file_;
     bool config_file_required_;
     ConfigSetup* layout_;
     ConfigItemMap config_items_;
-    INIReader* config_reader_;
+    std::unique_ptr<INIReader> config_reader_;
+    bool processed_;
+
+    // Published snapshot, replaced under the mutex. Versions are unique
+    // across every manager, so a thread's cached snapshot is never mistaken
+    // for another manager's.
+    mutable std::mutex snapshot_mutex_;
+    std::shared_ptr<const ConfigSnapshot> snapshot_;
+    std::atomic<uint64_t> version_;
+
+    static ConfigSnapshotCache& ThreadCache() {
+        thread_local ConfigSnapshotCache cache;
+        return cache;
+    }
+
+    const ConfigSnapshot& Refresh(ConfigSnapshotCache* cache) const;
+
+    void Publish(std::shared_ptr<const ConfigSnapshot> snapshot);
+
+    bool RestartItemsUnchanged(const ConfigItemMap& items);
+
+    bool ReadConfiguration(ConfigItemMap* items);
 
-    bool ReadConfiguration();
+    bool BuildSnapshot(const ConfigItemMap& items, ConfigSnapshot* snapshot);
 
     int* ReadInt(std::string section, ConfigSetupItem fmt);
 
@@ -25,6 +25,7 @@ ConfigSetupItem::ConfigSetupItem(
     std::string itemName,
     ConfigItemDataType dataType) : item_name_(itemName),
                                    is_required_(false),
+                                   is_restart_required_(false),
                                    item_type_(dataType),
                                    is_unset_(true),
                                    default_value_int_(0),
@@ -47,6 +48,10 @@ bool ConfigSetupItem::IsRequired() {
     return is_required_;
 }
 
+bool ConfigSetupItem::IsRestartRequired() {
+    return is_restart_required_;
+}
+
 int ConfigSetupItem::DefaultIntValue() {
     return default_value_int_;
 }
@@ -68,6 +73,11 @@ ConfigSetupItem &ConfigSetupItem::IsRequired(bool state) {
     return *this;
 }
 
+ConfigSetupItem &ConfigSetupItem::RestartRequired(bool state) {
+    is_restart_required_ = state;
+    return *this;
+}
+
 ConfigSetupItem &ConfigSetupItem::DefaultValue(int defaultValue) {
     default_value_int_ = defaultValue;
     is_unset_ = false;
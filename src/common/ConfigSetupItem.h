@@ -46,6 +46,8 @@ class ConfigSetupItem {
 
     bool IsRequired();
 
+    bool IsRestartRequired();
+
     int DefaultIntValue();
 
     std::string DefaultStringValue();
@@ -56,6 +58,9 @@ class ConfigSetupItem {
 
     ConfigSetupItem &IsRequired(bool state);
 
+    // The item is only read when starting, a reload cannot change it.
+    ConfigSetupItem &RestartRequired(bool state);
+
     ConfigSetupItem &DefaultValue(int defaultValue);
     ConfigSetupItem &DefaultValue(std::string defaultValue);
 
@@ -65,6 +70,7 @@ class ConfigSetupItem {
  private:
     std::string item_name_;
     bool is_required_;
+    bool is_restart_required_;
     ConfigItemDataType item_type_;
     bool is_unset_;
 
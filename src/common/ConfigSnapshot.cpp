@@ -0,0 +1,136 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#include <stdexcept>
+#include "ConfigSnapshot.h"
+
+namespace duplitrace { namespace common {
+
+// Slots in the table when it is first built, always a power of two.
+const size_t CONFIG_SNAPSHOT_MIN_SLOTS = 64;
+
+ConfigSnapshot::ConfigSnapshot() : slots_(CONFIG_SNAPSHOT_MIN_SLOTS, 0) {
+}
+
+bool ConfigSnapshot::AddInt(std::string_view section, std::string_view item,
+                            int value) {
+    return Add({ ConfigKeyHash(section, item), CONFIG_ITEM_TYPE_INTEGER,
+                 value, 0, 0 });
+}
+
+bool ConfigSnapshot::AddString(std::string_view section,
+                               std::string_view item,
+                               std::string_view value) {
+    if (Contains({ ConfigKeyHash(section, item) })) {
+        return false;
+    }
+
+    uint32_t offset = static_cast<uint32_t>(strings_.size());
+    strings_.append(value);
+
+    return Add({ ConfigKeyHash(section, item), CONFIG_ITEM_TYPE_STRING, 0,
+                 offset, static_cast<uint32_t>(value.size()) });
+}
+
+int ConfigSnapshot::Int(ConfigKey key) const {
+    return Get(key, CONFIG_ITEM_TYPE_INTEGER).int_value;
+}
+
+std::string_view ConfigSnapshot::String(ConfigKey key) const {
+    const Entry& entry = Get(key, CONFIG_ITEM_TYPE_STRING);
+    return std::string_view(strings_).substr(entry.offset, entry.length);
+}
+
+bool ConfigSnapshot::SameValue(const ConfigSnapshot& other,
+                               ConfigKey key) const {
+    const Entry* entry = Find(key);
+    const Entry* otherEntry = other.Find(key);
+
+    if (!entry || !otherEntry) {
+        return entry == otherEntry;
+    }
+
+    if (entry->type != otherEntry->type) {
+        return false;
+    }
+
+    return entry->type == CONFIG_ITEM_TYPE_INTEGER ?
+        entry->int_value == otherEntry->int_value :
+        String(key) == other.String(key);
+}
+
+bool ConfigSnapshot::Add(const Entry& entry) {
+    if (Contains({ entry.hash })) {
+        return false;
+    }
+
+    entries_.push_back(entry);
+
+    // Keep the table at most half full so probes stay short, placing every
+    // entry again when it grows.
+    size_t first = entries_.size() - 1;
+    if (entries_.size() * 2 > slots_.size()) {
+        slots_.assign(slots_.size() * 2, 0);
+        first = 0;
+    }
+
+    size_t mask = slots_.size() - 1;
+
+    for (size_t i = first; i < entries_.size(); i++) {
+        size_t slot = entries_[i].hash & mask;
+        while (slots_[slot]) {
+            slot = (slot + 1) & mask;
+        }
+        slots_[slot] = static_cast<uint32_t>(i + 1);
+    }
+
+    return true;
+}
+
+const ConfigSnapshot::Entry* ConfigSnapshot::Find(ConfigKey key) const {
+    size_t mask = slots_.size() - 1;
+
+    for (size_t slot = key.hash & mask; slots_[slot];
+         slot = (slot + 1) & mask) {
+        const Entry& entry = entries_[slots_[slot] - 1];
+        if (entry.hash == key.hash) {
+            return &entry;
+        }
+    }
+
+    return nullptr;
+}
+
+const ConfigSnapshot::Entry& ConfigSnapshot::Get(
+        ConfigKey key, ConfigItemDataType type) const {
+    const Entry* entry = Find(key);
+
+    if (!entry) {
+        throw std::invalid_argument("Invalid config key");
+    }
+
+    if (entry->type != type) {
+        throw std::invalid_argument("Config item is of another type");
+    }
+
+    return *entry;
+}
+
+}   // namespace common
+}   // namespace duplitrace
@@ -0,0 +1,130 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#ifndef CONFIGSNAPSHOT_H_
+#define CONFIGSNAPSHOT_H_
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#include "ConfigSetupItem.h"
+
+namespace duplitrace { namespace common {
+
+// Compact id of a configuration item, the hash of its section and name.
+struct ConfigKey {
+    uint64_t hash;
+};
+
+/*
+Hash a configuration item's section and name (64-bit FNV-1a, with a zero
+byte between them), so that keys can be worked out when compiling.
+
+returns:
+    Hash of the item.
+*/
+constexpr uint64_t ConfigKeyHash(std::string_view section,
+                                 std::string_view item) {
+    uint64_t hash = 0xCBF29CE484222325ULL;
+
+    for (char c : section) {
+        hash = (hash ^ static_cast<uint8_t>(c)) * 0x100000001B3ULL;
+    }
+    hash *= 0x100000001B3ULL;
+    for (char c : item) {
+        hash = (hash ^ static_cast<uint8_t>(c)) * 0x100000001B3ULL;
+    }
+
+    return hash;
+}
+
+// Key of an item whose section and name are constant, hashed when compiling.
+#define CONFIG_KEY(section, item) duplitrace::common::ConfigKey { \
+    std::integral_constant<uint64_t, \
+        duplitrace::common::ConfigKeyHash(section, item)>::value }
+
+/*
+Flat table of configuration values by key, built once the configuration has
+been read. Reads are a hash table probe with no allocation, so settings can
+be read as often as needed from any thread once it is built.
+*/
+class ConfigSnapshot {
+ public:
+    ConfigSnapshot();
+
+    /*
+    Add an item to the snapshot, only whilst it is being built.
+
+    returns:
+        False if the item, or another with the same key, is already in it.
+    */
+    bool AddInt(std::string_view section, std::string_view item, int value);
+    bool AddString(std::string_view section, std::string_view item,
+                   std::string_view value);
+
+    bool Contains(ConfigKey key) const { return Find(key) != nullptr; }
+
+    size_t Size() const { return entries_.size(); }
+
+    /*
+    Get an item's value. An std::invalid_argument exception is thrown if the
+    item is not in the snapshot or is of another type.
+
+    returns:
+        Value of the item, strings stay valid for as long as the snapshot.
+    */
+    int Int(ConfigKey key) const;
+    std::string_view String(ConfigKey key) const;
+
+    /*
+    Compare an item with the same item in another snapshot, e.g. to find
+    which items a reload changed.
+
+    returns:
+        True if the item has the same type and value in both, or is in
+        neither.
+    */
+    bool SameValue(const ConfigSnapshot& other, ConfigKey key) const;
+
+ private:
+    struct Entry {
+        uint64_t hash;
+        ConfigItemDataType type;
+        int int_value;
+        uint32_t offset;
+        uint32_t length;
+    };
+
+    std::vector<Entry> entries_;
+    // Index + 1 of the entry in each slot, 0 for an empty slot.
+    std::vector<uint32_t> slots_;
+    std::string strings_;
+
+    bool Add(const Entry& entry);
+
+    const Entry* Find(ConfigKey key) const;
+
+    const Entry& Get(ConfigKey key, ConfigItemDataType type) const;
+};
+
+}   // namespace common
+}   // namespace duplitrace
+
+#endif  // CONFIGSNAPSHOT_H_
@@ -0,0 +1,362 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+#include "CorpusGenerator.h"
+
+namespace duplitrace { namespace common {
+
+// Data written at each end of a sparse file, the rest is a hole.
+const uint64_t CORPUS_SPARSE_DATA_SIZE = 4096;
+const uint64_t CORPUS_SPARSE_MINIMUM_SIZE = 64 * 1024;
+
+// Size of the buffer contents are generated into as they are written.
+const size_t CORPUS_WRITE_BUFFER_SIZE = 64 * 1024;
+
+const uint64_t CORPUS_GOLDEN_RATIO = 0x9E3779B97F4A7C15ULL;
+
+// SplitMix64, defined exactly so the tree does not depend on the standard
+// library's distributions, which differ between implementations.
+static uint64_t SplitMix64(uint64_t* state) {
+    uint64_t value = (*state += CORPUS_GOLDEN_RATIO);
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+    return value ^ (value >> 31);
+}
+
+// Generates a content's bytes, each content is its own stream.
+class ContentStream {
+ public:
+    ContentStream(uint64_t seed, uint64_t content) :
+        state_(seed ^ ((content + 1) * CORPUS_GOLDEN_RATIO)) {
+    }
+
+    void Fill(uint8_t* buffer, size_t length) {
+        for (size_t offset = 0; offset < length; offset += sizeof(uint64_t)) {
+            uint64_t value = SplitMix64(&state_);
+            std::memcpy(buffer + offset, &value,
+                        std::min(sizeof(value), length - offset));
+        }
+    }
+
+ private:
+    uint64_t state_;
+};
+
+// Position of the highest bit set, 0 for 0 and 1.
+static size_t TopBit(uint64_t value) {
+    size_t bit = 0;
+    while (value >>= 1) {
+        bit++;
+    }
+    return bit;
+}
+
+CorpusGenerator::CorpusGenerator(const CorpusSettings& settings) :
+    settings_(settings),
+    random_state_(settings.seed) {
+    settings_.min_size = std::min(settings_.min_size, settings_.max_size);
+}
+
+/*
+Write the tree under the root, which is created if needed and must be empty
+so that nothing is mixed in with the generated files.
+
+returns:
+    False if the root is not empty or anything could not be written.
+*/
+bool CorpusGenerator::Generate(const std::string& root) {
+    std::error_code error;
+    std::filesystem::create_directories(root, error);
+
+    if (error || !std::filesystem::is_empty(root, error) || error ||
+        !files_.empty()) {
+        return false;
+    }
+
+    root_ = root;
+    statistics_.directories = 1;
+
+    return GenerateDirectory("", 0);
+}
+
+/*
+Get the groups of files with the same contents, in the order the contents
+were first written.
+*/
+std::vector<CorpusDuplicateGroup> CorpusGenerator::DuplicateGroups() const {
+    std::vector<std::vector<std::string>> paths(contents_.size());
+
+    for (const auto& file : files_) {
+        paths[file.content].push_back(file.path);
+    }
+
+    std::vector<CorpusDuplicateGroup> groups;
+
+    for (size_t content = 0; content < contents_.size(); content++) {
+        if (paths[content].size() > 1 && contents_[content].size) {
+            groups.push_back({ contents_[content].size,
+                               std::move(paths[content]) });
+        }
+    }
+
+    return groups;
+}
+
+// Get the paths of each file that has more than one link, first link first.
+std::vector<std::vector<std::string>> CorpusGenerator::HardLinkGroups()
+        const {
+    std::vector<std::vector<std::string>> groups;
+
+    for (const auto& links : hard_links_) {
+        groups.push_back({ files_[links.first].path });
+        groups.back().insert(groups.back().end(), links.second.begin(),
+                             links.second.end());
+    }
+
+    return groups;
+}
+
+/*
+Write what was generated, one tab separated line per group:
+    duplicate <size> <path> <path>...
+    hardlink <path> <path>...
+*/
+bool CorpusGenerator::WriteManifest(const std::string& filename) const {
+    std::FILE* file = std::fopen(filename.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+
+    bool ok = std::fprintf(file, "# DupliTrace corpus, seed %llu\n",
+                           static_cast<unsigned long long>(
+                               settings_.seed)) > 0;
+
+    for (const auto& group : DuplicateGroups()) {
+        ok = ok && std::fprintf(file, "duplicate\t%llu",
+                                static_cast<unsigned long long>(
+                                    group.size)) > 0;
+        for (const auto& path : group.paths) {
+            ok = ok && std::fprintf(file, "\t%s", path.c_str()) > 0;
+        }
+        ok = ok && std::fputc('\n', file) != EOF;
+    }
+
+    for (const auto& group : HardLinkGroups()) {
+        ok = ok && std::fputs("hardlink", file) != EOF;
+        for (const auto& path : group) {
+            ok = ok && std::fprintf(file, "\t%s", path.c_str()) > 0;
+        }
+        ok = ok && std::fputc('\n', file) != EOF;
+    }
+
+    return std::fclose(file) == 0 && ok;
+}
+
+uint64_t CorpusGenerator::NextRandom() {
+    return SplitMix64(&random_state_);
+}
+
+uint64_t CorpusGenerator::RandomBelow(uint64_t limit) {
+    return limit ? NextRandom() % limit : 0;
+}
+
+double CorpusGenerator::RandomFraction() {
+    return static_cast<double>(NextRandom() >> 11) * 0x1.0p-53;
+}
+
+uint64_t CorpusGenerator::RandomSize() {
+    uint64_t minSize = settings_.min_size;
+    uint64_t maxSize = settings_.max_size;
+
+    switch (settings_.size_distribution) {
+    case CorpusSizeDistribution::FIXED:
+        return maxSize;
+
+    case CorpusSizeDistribution::UNIFORM:
+        return minSize + RandomBelow(maxSize - minSize + 1);
+
+    default: {
+        // Pick a power of two, then a size within it.
+        size_t low = TopBit(std::max<uint64_t>(minSize, 1));
+        size_t bit = low + static_cast<size_t>(
+                               RandomBelow(TopBit(maxSize) - low + 1));
+        uint64_t start = uint64_t(1) << bit;
+
+        return std::clamp(start + RandomBelow(start), minSize, maxSize);
+    }
+    }
+}
+
+bool CorpusGenerator::GenerateDirectory(const std::string& path,
+                                        size_t level) {
+    for (size_t i = 0; i < settings_.files_per_directory; i++) {
+        if (!GenerateFile(path + "f" + std::to_string(i) + ".bin")) {
+            return false;
+        }
+    }
+
+    if (level == settings_.depth) {
+        return true;
+    }
+
+    for (size_t i = 0; i < settings_.fan_out; i++) {
+        std::string directory = path + "d" + std::to_string(i) + "/";
+        std::error_code error;
+
+        if (!std::filesystem::create_directory(root_ + "/" + directory,
+                                               error)) {
+            return false;
+        }
+        statistics_.directories++;
+
+        if (!GenerateDirectory(directory, level + 1)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*
+Add a file, as a hard link to an earlier file, a copy of an earlier file's
+contents or new contents. The same random numbers are drawn whichever it
+is, so the choices made for one file do not shift the rest of the tree.
+*/
+bool CorpusGenerator::GenerateFile(const std::string& path) {
+    double kind = RandomFraction();
+    uint64_t earlier = NextRandom();
+    uint64_t size = RandomSize();
+    bool sparse = RandomFraction() < settings_.sparse_ratio;
+
+    statistics_.files++;
+
+    if (kind < settings_.hard_link_ratio && !files_.empty()) {
+        size_t target = static_cast<size_t>(earlier % files_.size());
+        std::error_code error;
+
+        std::filesystem::create_hard_link(root_ + "/" + files_[target].path,
+                                          root_ + "/" + path, error);
+        if (error) {
+            return false;
+        }
+
+        hard_links_[target].push_back(path);
+        statistics_.hard_links++;
+        return true;
+    }
+
+    uint64_t content;
+
+    if (kind < settings_.hard_link_ratio + settings_.duplicate_ratio &&
+        !contents_.empty()) {
+        content = earlier % contents_.size();
+        statistics_.duplicates++;
+    } else {
+        content = contents_.size();
+        contents_.push_back({ size,
+                              sparse && size >= CORPUS_SPARSE_MINIMUM_SIZE });
+    }
+
+    files_.push_back({ path, content });
+    statistics_.bytes += contents_[content].size;
+    if (contents_[content].sparse) {
+        statistics_.sparse_files++;
+    }
+
+    return WriteContent(root_ + "/" + path, content);
+}
+
+bool CorpusGenerator::WriteContent(const std::string& path,
+                                   uint64_t content) const {
+    const Content& details = contents_[content];
+    ContentStream stream(settings_.seed, content);
+    std::vector<uint8_t> buffer(CORPUS_WRITE_BUFFER_SIZE);
+
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+
+    bool ok = true;
+
+    if (details.sparse) {
+        // Data, then a hole up to where the tail's data starts.
+        stream.Fill(buffer.data(), CORPUS_SPARSE_DATA_SIZE);
+        ok = std::fwrite(buffer.data(), 1, CORPUS_SPARSE_DATA_SIZE,
+                         file) == CORPUS_SPARSE_DATA_SIZE;
+        ok = std::fclose(file) == 0 && ok;
+
+        std::error_code error;
+        std::filesystem::resize_file(
+            path, details.size - CORPUS_SPARSE_DATA_SIZE, error);
+
+        file = ok && !error ? std::fopen(path.c_str(), "ab") : nullptr;
+        if (!file) {
+            return false;
+        }
+
+        stream.Fill(buffer.data(), CORPUS_SPARSE_DATA_SIZE);
+        ok = std::fwrite(buffer.data(), 1, CORPUS_SPARSE_DATA_SIZE,
+                         file) == CORPUS_SPARSE_DATA_SIZE;
+    } else {
+        for (uint64_t written = 0; written < details.size && ok;) {
+            size_t length = static_cast<size_t>(std::min<uint64_t>(
+                buffer.size(), details.size - written));
+
+            stream.Fill(buffer.data(), length);
+            ok = std::fwrite(buffer.data(), 1, length, file) == length;
+            written += length;
+        }
+    }
+
+    return std::fclose(file) == 0 && ok;
+}
+
+std::string CorpusSizeDistributionName(CorpusSizeDistribution distribution) {
+    switch (distribution) {
+    case CorpusSizeDistribution::FIXED:
+        return "FIXED";
+    case CorpusSizeDistribution::UNIFORM:
+        return "UNIFORM";
+    default:
+        return "LOG_UNIFORM";
+    }
+}
+
+bool CorpusSizeDistributionFromName(const std::string& name,
+                                    CorpusSizeDistribution* distribution) {
+    for (CorpusSizeDistribution candidate :
+         { CorpusSizeDistribution::FIXED, CorpusSizeDistribution::UNIFORM,
+           CorpusSizeDistribution::LOG_UNIFORM }) {
+        if (CorpusSizeDistributionName(candidate) == name) {
+            *distribution = candidate;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+}   // namespace common
+}   // namespace duplitrace
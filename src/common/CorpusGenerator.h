@@ -0,0 +1,151 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#ifndef CORPUSGENERATOR_H_
+#define CORPUSGENERATOR_H_
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace duplitrace { namespace common {
+
+enum class CorpusSizeDistribution {
+    // Every file is the maximum size.
+    FIXED,
+
+    // Any size from the minimum to the maximum is as likely.
+    UNIFORM,
+
+    // Each power of two from the minimum to the maximum is as likely, so
+    // there are many small files and a few large ones, as on most disks.
+    LOG_UNIFORM
+};
+
+struct CorpusSettings {
+    uint64_t seed = 1;
+
+    // Levels of directories below the root, and the subdirectories and files
+    // in each directory.
+    size_t depth = 3;
+    size_t fan_out = 4;
+    size_t files_per_directory = 32;
+
+    CorpusSizeDistribution size_distribution =
+        CorpusSizeDistribution::LOG_UNIFORM;
+    uint64_t min_size = 1;
+    uint64_t max_size = 1024 * 1024;
+
+    // Chance of each file being a copy of an earlier file's contents, or a
+    // hard link to an earlier file.
+    double duplicate_ratio = 0.2;
+    double hard_link_ratio = 0.02;
+
+    // Chance of a new file of at least 64KiB being sparse, only its first
+    // and last 4KiB hold data.
+    double sparse_ratio = 0.0;
+};
+
+struct CorpusStatistics {
+    uint64_t directories = 0;
+    uint64_t files = 0;
+    uint64_t duplicates = 0;
+    uint64_t hard_links = 0;
+    uint64_t sparse_files = 0;
+
+    // Apparent size of every file, counting each hard linked file once.
+    uint64_t bytes = 0;
+};
+
+// Files with the same contents, by the first path to each.
+struct CorpusDuplicateGroup {
+    uint64_t size;
+    std::vector<std::string> paths;
+};
+
+/*
+Generates a directory tree from a seed, the same settings always give the
+same tree, names and contents, on any platform. Every path it reports is
+relative to the root. The tree is written wherever the root is, e.g. on a
+tmpfs or a loopback image to keep it off real disks.
+
+As it is written, the generator records which files are really duplicates
+and which are hard links, so that detection can be checked against it.
+Empty files are never duplicates, as the indexer ignores them.
+*/
+class CorpusGenerator {
+ public:
+    explicit CorpusGenerator(const CorpusSettings& settings);
+
+    bool Generate(const std::string& root);
+
+    const CorpusStatistics& Statistics() const { return statistics_; }
+
+    std::vector<CorpusDuplicateGroup> DuplicateGroups() const;
+
+    std::vector<std::vector<std::string>> HardLinkGroups() const;
+
+    bool WriteManifest(const std::string& filename) const;
+
+ private:
+    struct Content {
+        uint64_t size;
+        bool sparse;
+    };
+
+    struct File {
+        std::string path;
+        uint64_t content;
+    };
+
+    CorpusSettings settings_;
+    uint64_t random_state_;
+    std::string root_;
+    std::vector<Content> contents_;
+    std::vector<File> files_;
+
+    // Further links to files, by the file's index.
+    std::map<size_t, std::vector<std::string>> hard_links_;
+
+    CorpusStatistics statistics_;
+
+    uint64_t NextRandom();
+
+    uint64_t RandomBelow(uint64_t limit);
+
+    double RandomFraction();
+
+    uint64_t RandomSize();
+
+    bool GenerateDirectory(const std::string& path, size_t level);
+
+    bool GenerateFile(const std::string& path);
+
+    bool WriteContent(const std::string& path, uint64_t content) const;
+};
+
+std::string CorpusSizeDistributionName(CorpusSizeDistribution distribution);
+
+bool CorpusSizeDistributionFromName(const std::string& name,
+                                    CorpusSizeDistribution* distribution);
+
+}   // namespace common
+}   // namespace duplitrace
+
+#endif  // CORPUSGENERATOR_H_
@@ -0,0 +1,277 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#include <algorithm>
+#include <chrono>
+#include <utility>
+#include "EventLoop.h"
+
+#if DUPLITRACE_PLATFORM == DUPLITRACE_PLATFORM_LINUX
+#include <errno.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#endif
+
+namespace duplitrace { namespace common {
+
+#if DUPLITRACE_PLATFORM == DUPLITRACE_PLATFORM_LINUX
+
+// Maximum number of events collected from a single epoll_wait() call.
+const int EVENTLOOP_MAX_EVENTS = 16;
+
+EventLoop::EventLoop() : epoll_fd_(-1),
+                         wake_fd_(-1),
+                         timer_fd_(-1),
+                         signal_fd_(-1) {
+}
+
+EventLoop::~EventLoop() {
+    for (int fd : { signal_fd_, timer_fd_, wake_fd_, epoll_fd_ }) {
+        if (fd != -1) {
+            close(fd);
+        }
+    }
+}
+
+bool EventLoop::Initialise() {
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    timer_fd_ = timerfd_create(CLOCK_REALTIME, TFD_NONBLOCK | TFD_CLOEXEC);
+
+    if (epoll_fd_ == -1 || wake_fd_ == -1 || timer_fd_ == -1) {
+        return false;
+    }
+
+    return WatchFileDescriptor(wake_fd_) && WatchFileDescriptor(timer_fd_);
+}
+
+/*
+Route a signal through the event loop instead of an asynchronous handler.
+The signal is blocked for the calling thread, so this needs to be called
+before any other threads are started for them to inherit the mask.
+*/
+bool EventLoop::AddSignalHandler(int signalNumber, SignalCallback callback) {
+    sigset_t mask;
+    sigemptyset(&mask);
+
+    signal_handlers_[signalNumber] = std::move(callback);
+    for (auto& handler : signal_handlers_) {
+        sigaddset(&mask, handler.first);
+    }
+
+    if (pthread_sigmask(SIG_BLOCK, &mask, nullptr) != 0) {
+        return false;
+    }
+
+    // Passing an existing signalfd updates its mask rather than creating a
+    // new descriptor.
+    bool isNew = signal_fd_ == -1;
+    signal_fd_ = signalfd(signal_fd_, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (signal_fd_ == -1) {
+        return false;
+    }
+
+    return isNew ? WatchFileDescriptor(signal_fd_) : true;
+}
+
+bool EventLoop::AddFileDescriptor(int fd, EventCallback callback,
+                                  FileDescriptorEvent event) {
+    if (!WatchFileDescriptor(fd, event)) {
+        return false;
+    }
+
+    fd_handlers_[fd] = std::move(callback);
+    return true;
+}
+
+bool EventLoop::RemoveFileDescriptor(int fd) {
+    fd_handlers_.erase(fd);
+    return epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr) == 0;
+}
+
+void EventLoop::SetTimerCallback(EventCallback callback) {
+    timer_callback_ = std::move(callback);
+}
+
+/*
+Arm the timer for an absolute wall clock time, or disarm it if no deadline is
+given. The timer is cancelled if the system clock is changed so that the
+owner gets a chance to recalculate its deadline.
+*/
+void EventLoop::SetDeadline(std::optional<std::time_t> deadline) {
+    struct itimerspec timerSpec = {};
+
+    if (deadline) {
+        // A zero it_value would disarm the timer, so an overdue deadline is
+        // clamped to fire immediately.
+        timerSpec.it_value.tv_sec = *deadline > 0 ? *deadline : 1;
+    }
+
+    timerfd_settime(timer_fd_,
+                    TFD_TIMER_ABSTIME | TFD_TIMER_CANCEL_ON_SET,
+                    &timerSpec, nullptr);
+}
+
+// Wake the event loop, safe to call from any thread.
+void EventLoop::Wake() {
+    uint64_t increment = 1;
+    ssize_t written = write(wake_fd_, &increment, sizeof(increment));
+    (void)written;
+}
+
+// Block until at least one event has arrived and dispatch it.
+void EventLoop::WaitForEvents() {
+    struct epoll_event events[EVENTLOOP_MAX_EVENTS];
+
+    int count = epoll_wait(epoll_fd_, events, EVENTLOOP_MAX_EVENTS, -1);
+
+    for (int i = 0; i < count; i++) {
+        int fd = events[i].data.fd;
+
+        if (fd == wake_fd_) {
+            uint64_t counter;
+            ssize_t bytesRead = read(wake_fd_, &counter, sizeof(counter));
+            (void)bytesRead;
+        } else if (fd == timer_fd_) {
+            DispatchTimer();
+        } else if (fd == signal_fd_) {
+            DispatchSignals();
+        } else {
+            // The callback is copied as it may remove its own descriptor.
+            auto handler = fd_handlers_.find(fd);
+            if (handler != fd_handlers_.end()) {
+                EventCallback callback = handler->second;
+                callback();
+            }
+        }
+    }
+}
+
+bool EventLoop::WatchFileDescriptor(int fd, FileDescriptorEvent event) {
+    struct epoll_event epollEvent = {};
+    epollEvent.events = event == FileDescriptorEvent::WRITABLE ? EPOLLOUT :
+                                                                 EPOLLIN;
+    epollEvent.data.fd = fd;
+
+    return epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &epollEvent) == 0;
+}
+
+void EventLoop::DispatchSignals() {
+    struct signalfd_siginfo info;
+
+    while (read(signal_fd_, &info, sizeof(info)) == sizeof(info)) {
+        auto handler = signal_handlers_.find(static_cast<int>(info.ssi_signo));
+        if (handler != signal_handlers_.end()) {
+            handler->second(handler->first);
+        }
+    }
+}
+
+void EventLoop::DispatchTimer() {
+    uint64_t expirations;
+
+    // ECANCELED means the clock was changed rather than the timer expiring,
+    // the callback still runs so the deadline gets re-evaluated.
+    ssize_t bytesRead = read(timer_fd_, &expirations, sizeof(expirations));
+    if (bytesRead == -1 && errno == EAGAIN) {
+        return;
+    }
+
+    if (timer_callback_) {
+        timer_callback_();
+    }
+}
+
+#else
+
+EventLoop::EventLoop() : woken_(false) {
+}
+
+EventLoop::~EventLoop() {
+}
+
+bool EventLoop::Initialise() {
+    return true;
+}
+
+bool EventLoop::AddSignalHandler(int signalNumber, SignalCallback callback) {
+    (void)signalNumber;
+    (void)callback;
+    return false;
+}
+
+bool EventLoop::AddFileDescriptor(int fd, EventCallback callback,
+                                  FileDescriptorEvent event) {
+    (void)fd;
+    (void)callback;
+    (void)event;
+    return false;
+}
+
+bool EventLoop::RemoveFileDescriptor(int fd) {
+    (void)fd;
+    return false;
+}
+
+void EventLoop::SetTimerCallback(EventCallback callback) {
+    timer_callback_ = std::move(callback);
+}
+
+void EventLoop::SetDeadline(std::optional<std::time_t> deadline) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    deadline_ = deadline;
+}
+
+void EventLoop::Wake() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        woken_ = true;
+    }
+
+    wake_condition_.notify_one();
+}
+
+void EventLoop::WaitForEvents() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    bool timerExpired = false;
+
+    if (deadline_) {
+        auto deadline = std::chrono::system_clock::from_time_t(*deadline_);
+        timerExpired = !wake_condition_.wait_until(lock, deadline,
+                                                   [this] { return woken_; });
+    } else {
+        wake_condition_.wait(lock, [this] { return woken_; });
+    }
+
+    woken_ = false;
+    lock.unlock();
+
+    if (timerExpired && timer_callback_) {
+        timer_callback_();
+    }
+}
+
+#endif
+
+}   // namespace common
+}   // namespace duplitrace
@@ -0,0 +1,106 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#ifndef EVENTLOOP_H_
+#define EVENTLOOP_H_
+#include <ctime>
+#include <functional>
+#include <map>
+#include <optional>
+#include "Platform.h"
+
+#if DUPLITRACE_PLATFORM != DUPLITRACE_PLATFORM_LINUX
+#include <condition_variable>
+#include <mutex>
+#endif
+
+namespace duplitrace { namespace common {
+
+using EventCallback = std::function<void()>;
+using SignalCallback = std::function<void(int signalNumber)>;
+
+// What a file descriptor's callback waits for.
+enum class FileDescriptorEvent {
+    READABLE,
+    WRITABLE
+};
+
+/*
+Blocking event loop, the calling thread sleeps until there is something to do
+so an idle service uses no CPU. On Linux it is built on epoll with an eventfd
+for cross-thread wake ups, a signalfd for signals and a timerfd for the
+(wall clock) deadline. Other platforms fall back to a condition variable and
+do not support signals or file descriptors.
+*/
+class EventLoop {
+ public:
+    EventLoop();
+
+    ~EventLoop();
+
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+
+    bool Initialise();
+
+    bool AddSignalHandler(int signalNumber, SignalCallback callback);
+
+    bool AddFileDescriptor(int fd, EventCallback callback,
+                           FileDescriptorEvent event =
+                               FileDescriptorEvent::READABLE);
+
+    bool RemoveFileDescriptor(int fd);
+
+    void SetTimerCallback(EventCallback callback);
+
+    void SetDeadline(std::optional<std::time_t> deadline);
+
+    void Wake();
+
+    void WaitForEvents();
+
+ private:
+    EventCallback timer_callback_;
+    std::map<int, SignalCallback> signal_handlers_;
+    std::map<int, EventCallback> fd_handlers_;
+
+#if DUPLITRACE_PLATFORM == DUPLITRACE_PLATFORM_LINUX
+    int epoll_fd_;
+    int wake_fd_;
+    int timer_fd_;
+    int signal_fd_;
+
+    bool WatchFileDescriptor(int fd, FileDescriptorEvent event =
+                                         FileDescriptorEvent::READABLE);
+
+    void DispatchSignals();
+
+    void DispatchTimer();
+#else
+    std::mutex mutex_;
+    std::condition_variable wake_condition_;
+    std::optional<std::time_t> deadline_;
+    bool woken_;
+#endif
+};
+
+}   // namespace common
+}   // namespace duplitrace
+
+#endif  // EVENTLOOP_H_
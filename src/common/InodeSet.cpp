@@ -0,0 +1,152 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#include "InodeSet.h"
+
+namespace duplitrace { namespace common {
+
+// Slots in each shard's table before it first grows, a power of two.
+const size_t INODE_SET_INITIAL_SLOTS = 256;
+
+InodeSet::InodeSet() {
+    for (auto& shard : shards_) {
+        shard = std::make_unique<Shard>();
+    }
+}
+
+/*
+Add an inode, safe to call from multiple threads.
+
+returns:
+    True if the inode was not already in the set.
+*/
+bool InodeSet::Insert(uint64_t device, uint64_t inode) {
+    if (inode == 0) {
+        return false;
+    }
+
+    uint64_t hash = Hash(device, inode);
+    Shard& shard = *shards_[hash % shards_.size()];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    // Keep the table at most three quarters full so probes stay short.
+    if ((shard.count + 1) * 4 > shard.slots.size() * 3) {
+        Grow(&shard);
+    }
+
+    size_t mask = shard.slots.size() - 1;
+
+    for (size_t slot = (hash >> 6) & mask;; slot = (slot + 1) & mask) {
+        Entry& entry = shard.slots[slot];
+
+        if (entry.inode == 0) {
+            entry = { device, inode };
+            shard.count++;
+            return true;
+        }
+
+        if (entry.inode == inode && entry.device == device) {
+            return false;
+        }
+    }
+}
+
+bool InodeSet::Contains(uint64_t device, uint64_t inode) const {
+    uint64_t hash = Hash(device, inode);
+    const Shard& shard = *shards_[hash % shards_.size()];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    if (inode == 0 || shard.slots.empty()) {
+        return false;
+    }
+
+    size_t mask = shard.slots.size() - 1;
+
+    for (size_t slot = (hash >> 6) & mask;; slot = (slot + 1) & mask) {
+        const Entry& entry = shard.slots[slot];
+
+        if (entry.inode == 0) {
+            return false;
+        }
+
+        if (entry.inode == inode && entry.device == device) {
+            return true;
+        }
+    }
+}
+
+uint64_t InodeSet::Size() const {
+    uint64_t size = 0;
+
+    for (const auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        size += shard->count;
+    }
+
+    return size;
+}
+
+uint64_t InodeSet::MemoryUsage() const {
+    uint64_t bytes = sizeof(*this);
+
+    for (const auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        bytes += sizeof(Shard) + shard->slots.capacity() * sizeof(Entry);
+    }
+
+    return bytes;
+}
+
+// Mix both halves of the key, inode numbers are often sequential.
+uint64_t InodeSet::Hash(uint64_t device, uint64_t inode) {
+    uint64_t hash = inode ^ (device * 0x9E3779B97F4A7C15ULL);
+
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDULL;
+    hash ^= hash >> 33;
+    hash *= 0xC4CEB9FE1A85EC53ULL;
+    hash ^= hash >> 33;
+
+    return hash;
+}
+
+// Double a shard's table, or create it, and put its entries back in.
+void InodeSet::Grow(Shard* shard) {
+    std::vector<Entry> slots(shard->slots.empty() ?
+                             INODE_SET_INITIAL_SLOTS :
+                             shard->slots.size() * 2, Entry { 0, 0 });
+    size_t mask = slots.size() - 1;
+
+    for (const Entry& entry : shard->slots) {
+        if (entry.inode == 0) {
+            continue;
+        }
+
+        size_t slot = (Hash(entry.device, entry.inode) >> 6) & mask;
+        while (slots[slot].inode != 0) {
+            slot = (slot + 1) & mask;
+        }
+        slots[slot] = entry;
+    }
+
+    shard->slots.swap(slots);
+}
+
+}   // namespace common
+}   // namespace duplitrace
@@ -0,0 +1,74 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#ifndef INODESET_H_
+#define INODESET_H_
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace duplitrace { namespace common {
+
+/*
+Set of (device, inode) pairs, used to spot the second and later links to a
+file. Entries are kept in open addressing tables of 16 bytes a slot, spread
+over shards by hash so that threads adding at the same time rarely share a
+lock. Inode 0 is never a real inode, so it marks an empty slot and cannot be
+added.
+*/
+class InodeSet {
+ public:
+    InodeSet();
+
+    InodeSet(const InodeSet&) = delete;
+    InodeSet& operator=(const InodeSet&) = delete;
+
+    bool Insert(uint64_t device, uint64_t inode);
+
+    bool Contains(uint64_t device, uint64_t inode) const;
+
+    uint64_t Size() const;
+
+    uint64_t MemoryUsage() const;
+
+ private:
+    struct Entry {
+        uint64_t device;
+        uint64_t inode;
+    };
+
+    struct Shard {
+        mutable std::mutex mutex;
+        std::vector<Entry> slots;
+        size_t count = 0;
+    };
+
+    std::array<std::unique_ptr<Shard>, 64> shards_;
+
+    static uint64_t Hash(uint64_t device, uint64_t inode);
+
+    static void Grow(Shard* shard);
+};
+
+}   // namespace common
+}   // namespace duplitrace
+
+#endif  // INODESET_H_
@@ -19,12 +19,157 @@ Copyright 2024 DupliTrace Development Team
 */
 #ifndef LOGGER_H_
 #define LOGGER_H_
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
 #include "spdlog/spdlog.h"
 #include "spdlog/async.h"
 #include "spdlog/sinks/basic_file_sink.h"
 #include "spdlog/sinks/rotating_file_sink.h"
 #include "spdlog/sinks/stdout_color_sinks.h"
 
-#define LOGGER spdlog::get ("logger")
+namespace duplitrace { namespace common {
+
+/*
+Logger behind the LOGGER macros. It is handed over once at start-up and log
+calls only load a pointer to it, where spdlog::get() would take spdlog's
+registry mutex and look the logger up by name on every call. Until a logger
+is set spdlog's default (console) logger is used.
+*/
+class LoggerHandle {
+ public:
+    static spdlog::logger* Get() {
+        spdlog::logger* logger = current_.load(std::memory_order_acquire);
+        return logger ? logger : spdlog::default_logger_raw();
+    }
+
+    // Safe to call while other threads log. Every logger handed over is
+    // kept until the process exits, as a thread may still be logging to the
+    // one it replaced, so it is only meant to be called a few times.
+    static void Set(std::shared_ptr<spdlog::logger> logger) {
+        std::lock_guard<std::mutex> lock(owners_mutex_);
+
+        current_.store(logger.get(), std::memory_order_release);
+        owners_.push_back(std::move(logger));
+    }
+
+ private:
+    static inline std::atomic<spdlog::logger*> current_ { nullptr };
+    static inline std::mutex owners_mutex_;
+    static inline std::vector<std::shared_ptr<spdlog::logger>> owners_;
+};
+
+// What a log call does when the async queue is full.
+enum class LogOverflowPolicy {
+    // Wait for room, which holds up the thread that is logging.
+    BLOCK,
+
+    // Make room by dropping the oldest queued message.
+    OVERRUN_OLDEST,
+
+    // Drop the new message.
+    DISCARD
+};
+
+struct LogQueueStatistics {
+    // Messages that had to wait for room in the queue.
+    uint64_t blocked = 0;
+
+    // Queued messages that were dropped to make room.
+    uint64_t overrun = 0;
+
+    // New messages that were dropped because the queue was full.
+    uint64_t discarded = 0;
+};
+
+/*
+Async logger that counts what its overflow policy did, so that lost or
+delayed messages can be reported. spdlog's async logger cannot be extended
+and has no policy to drop new messages, so this checks for room itself and
+passes each message on to an async logger writing to the same sinks. Under
+DISCARD that one overruns the oldest message if the queue fills in between.
+
+The check for room and the enqueue are not one step, so with several threads
+logging the counts are approximate: under BLOCK a message may be counted as
+blocked when room was made just after the check, or not counted when the
+queue filled just after it. Under DISCARD every lost message is counted, as
+either discarded or overrun.
+*/
+class CountingAsyncLogger : public spdlog::logger {
+ public:
+    template <typename It>
+    CountingAsyncLogger(std::string name, It begin, It end,
+                        std::shared_ptr<spdlog::details::thread_pool> pool,
+                        size_t queueSize, LogOverflowPolicy policy) :
+        spdlog::logger(name, begin, end),
+        queue_(std::make_shared<spdlog::async_logger>(
+            name, begin, end, pool,
+            policy == LogOverflowPolicy::BLOCK ?
+                spdlog::async_overflow_policy::block :
+                spdlog::async_overflow_policy::overrun_oldest)),
+        pool_(pool),
+        queue_size_(queueSize),
+        policy_(policy),
+        blocked_(0),
+        discarded_(0) {
+        // Levels are checked here, before anything is queued.
+        queue_->set_level(spdlog::level::trace);
+    }
+
+    LogQueueStatistics Statistics() const {
+        LogQueueStatistics statistics;
+
+        statistics.blocked = blocked_;
+        statistics.overrun = pool_->overrun_counter();
+        statistics.discarded = discarded_;
+
+        return statistics;
+    }
+
+ protected:
+    void sink_it_(const spdlog::details::log_msg& message) override {
+        if (policy_ != LogOverflowPolicy::OVERRUN_OLDEST &&
+            pool_->queue_size() >= queue_size_) {
+            if (policy_ == LogOverflowPolicy::DISCARD) {
+                discarded_++;
+                return;
+            }
+            blocked_++;
+        }
+
+        queue_->log(message.time, message.source, message.level,
+                    message.payload);
+
+        if (should_flush_(message)) {
+            flush_();
+        }
+    }
+
+    void flush_() override {
+        queue_->flush();
+    }
+
+ private:
+    std::shared_ptr<spdlog::async_logger> queue_;
+    std::shared_ptr<spdlog::details::thread_pool> pool_;
+    size_t queue_size_;
+    LogOverflowPolicy policy_;
+    std::atomic<uint64_t> blocked_;
+    std::atomic<uint64_t> discarded_;
+};
+
+}   // namespace common
+}   // namespace duplitrace
+
+#define LOGGER duplitrace::common::LoggerHandle::Get()
+
+// Calls below SPDLOG_ACTIVE_LEVEL (info unless the build sets it lower) are
+// compiled out, arguments and all, so they are free in hot loops.
+#define LOGGER_TRACE(...) SPDLOG_LOGGER_TRACE(LOGGER, __VA_ARGS__)
+#define LOGGER_DEBUG(...) SPDLOG_LOGGER_DEBUG(LOGGER, __VA_ARGS__)
 
 #endif  // LOGGER_H_
@@ -25,27 +25,42 @@ Copyright 2024 DupliTrace Development Team
 
 namespace duplitrace {
 
-const char LOGGING_SECTION[] = "logging";
+constexpr char LOGGING_SECTION[] = "logging";
 
-const char LOGGING_LOG_LEVEL[] = "log_level";
-const char LOGGING_LOG_LEVEL_DEBUG[] = "DEBUG";
-const char LOGGING_LOG_LEVEL_INfO[] = "INFO";
+constexpr char LOGGING_LOG_LEVEL[] = "log_level";
+constexpr char LOGGING_LOG_LEVEL_DEBUG[] = "DEBUG";
+constexpr char LOGGING_LOG_LEVEL_INfO[] = "INFO";
 
-const char LOGGING_LOG_TO_CONSOLE[] = "log_to_console";
-const char LOGGING_LOG_TO_CONSOLE_YES[] = "YES";
-const char LOGGING_LOG_TO_CONSOLE_NO[] = "NO";
+constexpr char LOGGING_LOG_TO_CONSOLE[] = "log_to_console";
+constexpr char LOGGING_LOG_TO_CONSOLE_YES[] = "YES";
+constexpr char LOGGING_LOG_TO_CONSOLE_NO[] = "NO";
 
-const char LOGGING_LOG_FILENAME[] = "log_filename";
+constexpr char LOGGING_LOG_FILENAME[] = "log_filename";
 
-const char LOGGING_MAX_FILE_SIZE[] = "max_file_size";
+constexpr char LOGGING_MAX_FILE_SIZE[] = "max_file_size";
 
-const char LOGGING_MAX_FILE_COUNT[] = "max_file_count";
+constexpr char LOGGING_MAX_FILE_COUNT[] = "max_file_count";
 
-const char LOGGING_LOG_FORMAT[] = "log_format";
-const char LOGGING_LOG_FORMAT_DEFAULT[] = "%Y-%m-%d %H:%M:%S %^%l%$ [%n] %v";
+constexpr char LOGGING_LOG_FORMAT[] = "log_format";
+constexpr char LOGGING_LOG_FORMAT_DEFAULT[] =
+    "%Y-%m-%d %H:%M:%S %^%l%$ [%n] %v";
 const int LOGGING_MAX_FILE_SIZE_DEFAULT = 1024;
 const int LOGGING_MAX_FILE_ROTATE_COUNT_DEFAULT = 2;
 
+// Messages waiting for the logging threads to write them out.
+constexpr char LOGGING_QUEUE_SIZE[] = "queue_size";
+const int LOGGING_QUEUE_SIZE_DEFAULT = 8192;
+
+constexpr char LOGGING_THREAD_COUNT[] = "thread_count";
+const int LOGGING_THREAD_COUNT_DEFAULT = 1;
+
+// What happens to a message logged while the queue is full, only BLOCK can
+// slow down the threads doing the logging.
+constexpr char LOGGING_OVERFLOW_POLICY[] = "overflow_policy";
+constexpr char LOGGING_OVERFLOW_POLICY_BLOCK[] = "BLOCK";
+constexpr char LOGGING_OVERFLOW_POLICY_OVERRUN_OLDEST[] = "OVERRUN_OLDEST";
+constexpr char LOGGING_OVERFLOW_POLICY_DISCARD[] = "DISCARD";
+
 const common::SectionList LoggerSettings = {
     {
         LOGGING_LOG_LEVEL,
@@ -59,6 +74,7 @@ const common::SectionList LoggerSettings = {
         LOGGING_LOG_TO_CONSOLE,
         common::ConfigSetupItem(LOGGING_LOG_TO_CONSOLE,
                                 common::CONFIG_ITEM_TYPE_STRING)
+                .RestartRequired(true)
                 .DefaultValue(LOGGING_LOG_TO_CONSOLE_NO)
                 .ValidValues(common::StringList{ LOGGING_LOG_TO_CONSOLE_YES,
                                                  LOGGING_LOG_TO_CONSOLE_NO })
@@ -67,18 +83,21 @@ const common::SectionList LoggerSettings = {
         LOGGING_LOG_FILENAME,
         common::ConfigSetupItem(LOGGING_LOG_FILENAME,
                                 common::CONFIG_ITEM_TYPE_STRING)
+                .RestartRequired(true)
                 .DefaultValue("")
     },
     {
         LOGGING_MAX_FILE_SIZE,
         common::ConfigSetupItem(LOGGING_MAX_FILE_SIZE,
                                 common::CONFIG_ITEM_TYPE_INTEGER)
+                .RestartRequired(true)
                 .DefaultValue(LOGGING_MAX_FILE_SIZE_DEFAULT)
     },
     {
         LOGGING_MAX_FILE_COUNT,
         common::ConfigSetupItem(LOGGING_MAX_FILE_COUNT,
                                 common::CONFIG_ITEM_TYPE_INTEGER)
+                .RestartRequired(true)
                 .DefaultValue(LOGGING_MAX_FILE_ROTATE_COUNT_DEFAULT)
     },
     {
@@ -86,23 +105,60 @@ const common::SectionList LoggerSettings = {
         common::ConfigSetupItem(LOGGING_LOG_FORMAT,
                                 common::CONFIG_ITEM_TYPE_STRING)
                 .DefaultValue(LOGGING_LOG_FORMAT_DEFAULT)
+    },
+    {
+        LOGGING_QUEUE_SIZE,
+        common::ConfigSetupItem(LOGGING_QUEUE_SIZE,
+                                common::CONFIG_ITEM_TYPE_INTEGER)
+                .RestartRequired(true)
+                .DefaultValue(LOGGING_QUEUE_SIZE_DEFAULT)
+    },
+    {
+        LOGGING_THREAD_COUNT,
+        common::ConfigSetupItem(LOGGING_THREAD_COUNT,
+                                common::CONFIG_ITEM_TYPE_INTEGER)
+                .RestartRequired(true)
+                .DefaultValue(LOGGING_THREAD_COUNT_DEFAULT)
+    },
+    {
+        LOGGING_OVERFLOW_POLICY,
+        common::ConfigSetupItem(LOGGING_OVERFLOW_POLICY,
+                                common::CONFIG_ITEM_TYPE_STRING)
+                .RestartRequired(true)
+                .DefaultValue(LOGGING_OVERFLOW_POLICY_DISCARD)
+                .ValidValues(common::StringList{
+                    LOGGING_OVERFLOW_POLICY_BLOCK,
+                    LOGGING_OVERFLOW_POLICY_OVERRUN_OLDEST,
+                    LOGGING_OVERFLOW_POLICY_DISCARD })
     }
 };
 
-#define GET_LOGGING_LOG_TO_CONSOLE config_manager_.GetStringEntry(\
-            LOGGING_SECTION, LOGGING_LOG_TO_CONSOLE)
+#define GET_LOGGING_LOG_LEVEL config_manager_.Current().String(\
+            CONFIG_KEY(LOGGING_SECTION, LOGGING_LOG_LEVEL))
+
+#define GET_LOGGING_LOG_TO_CONSOLE config_manager_.Current().String(\
+            CONFIG_KEY(LOGGING_SECTION, LOGGING_LOG_TO_CONSOLE))
+
+#define GET_LOGGING_LOG_FILENAME config_manager_.Current().String(\
+            CONFIG_KEY(LOGGING_SECTION, LOGGING_LOG_FILENAME))
+
+#define GET_LOGGING_MAX_FILE_SIZE config_manager_.Current().Int(\
+            CONFIG_KEY(LOGGING_SECTION, LOGGING_MAX_FILE_SIZE))
+
+#define GET_LOGGING_MAX_FILE_COUNT config_manager_.Current().Int(\
+            CONFIG_KEY(LOGGING_SECTION, LOGGING_MAX_FILE_COUNT))
 
-#define GET_LOGGING_LOG_FILENAME config_manager_.GetStringEntry(\
-            LOGGING_SECTION, LOGGING_LOG_FILENAME)
+#define GET_LOGGING_LOG_FORMAT config_manager_.Current().String(\
+            CONFIG_KEY(LOGGING_SECTION, LOGGING_LOG_FORMAT))
 
-#define GET_LOGGING_MAX_FILE_SIZE config_manager_.GetIntEntry(\
-            LOGGING_SECTION, LOGGING_MAX_FILE_SIZE)
+#define GET_LOGGING_QUEUE_SIZE config_manager_.Current().Int(\
+            CONFIG_KEY(LOGGING_SECTION, LOGGING_QUEUE_SIZE))
 
-#define GET_LOGGING_MAX_FILE_COUNT config_manager_.GetIntEntry(\
-            LOGGING_SECTION, LOGGING_MAX_FILE_COUNT)
+#define GET_LOGGING_THREAD_COUNT config_manager_.Current().Int(\
+            CONFIG_KEY(LOGGING_SECTION, LOGGING_THREAD_COUNT))
 
-#define GET_LOGGING_LOG_FORMAT config_manager_.GetStringEntry(\
-            LOGGING_SECTION, LOGGING_LOG_FORMAT)
+#define GET_LOGGING_OVERFLOW_POLICY config_manager_.Current().String(\
+            CONFIG_KEY(LOGGING_SECTION, LOGGING_OVERFLOW_POLICY))
 
 const int ONE_MEGABYTE = 1048576;
 
@@ -0,0 +1,292 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <utility>
+#include "Metrics.h"
+
+namespace duplitrace { namespace common {
+
+// Quantiles each histogram is summarised by.
+const double METRICS_QUANTILES[] = { 0.5, 0.9, 0.99, 0.999 };
+
+static const char* MetricTypeName(MetricType type) {
+    switch (type) {
+    case MetricType::COUNTER:
+        return "counter";
+    case MetricType::GAUGE:
+        return "gauge";
+    default:
+        return "summary";
+    }
+}
+
+static void AppendValue(std::string* text, double value) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.15g", value);
+    *text += buffer;
+}
+
+/*
+Append a sample line, the labels are the series' own with any extra label
+after them.
+*/
+static void AppendSample(std::string* text, const std::string& name,
+                         const std::string& labels, const std::string& extra,
+                         double value) {
+    *text += name;
+
+    if (!labels.empty() || !extra.empty()) {
+        *text += '{';
+        *text += labels;
+        if (!labels.empty() && !extra.empty()) {
+            *text += ',';
+        }
+        *text += extra;
+        *text += '}';
+    }
+
+    *text += ' ';
+    AppendValue(text, value);
+    *text += '\n';
+}
+
+uint64_t MetricCounter::Value() const {
+    uint64_t total = 0;
+
+    for (const auto& cell : cells_) {
+        total += cell.value.load(std::memory_order_relaxed);
+    }
+
+    return total;
+}
+
+/*
+Get the value at a quantile, as the highest value in its bucket.
+
+returns:
+    Value, or 0 if nothing has been recorded.
+*/
+uint64_t MetricHistogramSnapshot::Quantile(double quantile) const {
+    if (count == 0) {
+        return 0;
+    }
+
+    uint64_t rank = static_cast<uint64_t>(
+        std::ceil(quantile * static_cast<double>(count)));
+    rank = std::max<uint64_t>(std::min(rank, count), 1);
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets.size(); i++) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            return MetricHistogram::BucketUpperBound(i);
+        }
+    }
+
+    return MetricHistogram::BucketUpperBound(buckets.size() - 1);
+}
+
+MetricHistogram::MetricHistogram() {
+    for (auto& shard : shards_) {
+        shard = std::make_unique<Shard>();
+
+        for (auto& bucket : shard->buckets) {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+/*
+Add up the shards, the count is the total of the buckets. Values recorded
+while the snapshot is taken may be in the buckets and not yet the sum.
+*/
+MetricHistogramSnapshot MetricHistogram::Snapshot() const {
+    MetricHistogramSnapshot snapshot;
+    snapshot.buckets.resize(METRICS_HISTOGRAM_BUCKETS, 0);
+
+    for (const auto& shard : shards_) {
+        snapshot.sum += shard->sum.load(std::memory_order_relaxed);
+
+        for (size_t i = 0; i < METRICS_HISTOGRAM_BUCKETS; i++) {
+            uint64_t count = shard->buckets[i].load(std::memory_order_relaxed);
+
+            snapshot.buckets[i] += count;
+            snapshot.count += count;
+        }
+    }
+
+    return snapshot;
+}
+
+uint64_t MetricHistogram::BucketUpperBound(size_t index) {
+    if (index < METRICS_HISTOGRAM_SUB_BUCKETS) {
+        return index;
+    }
+
+    size_t shift = index / METRICS_HISTOGRAM_SUB_BUCKETS - 1;
+    uint64_t sub = index % METRICS_HISTOGRAM_SUB_BUCKETS;
+    uint64_t lower = (METRICS_HISTOGRAM_SUB_BUCKETS + sub) << shift;
+
+    return lower + ((uint64_t(1) << shift) - 1);
+}
+
+MetricCounter* MetricsRegistry::AddCounter(const std::string& name,
+                                           const std::string& help,
+                                           const std::string& labels) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Series& series = AddSeries(name, help, MetricType::COUNTER, labels);
+
+    series.counter = std::make_unique<MetricCounter>();
+    return series.counter.get();
+}
+
+MetricGauge* MetricsRegistry::AddGauge(const std::string& name,
+                                       const std::string& help,
+                                       const std::string& labels) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Series& series = AddSeries(name, help, MetricType::GAUGE, labels);
+
+    series.gauge = std::make_unique<MetricGauge>();
+    return series.gauge.get();
+}
+
+/*
+Add a histogram, 'unit' converts the values it records to the unit it is
+exported in, e.g. 1e-9 for nanoseconds exported as seconds.
+*/
+MetricHistogram* MetricsRegistry::AddHistogram(const std::string& name,
+                                               const std::string& help,
+                                               double unit,
+                                               const std::string& labels) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Series& series = AddSeries(name, help, MetricType::SUMMARY, labels);
+
+    series.histogram = std::make_unique<MetricHistogram>();
+    series.unit = unit;
+    return series.histogram.get();
+}
+
+// Add a counter or gauge whose value is read from elsewhere when exported.
+void MetricsRegistry::AddCallback(const std::string& name,
+                                  const std::string& help, MetricType type,
+                                  MetricCallback callback,
+                                  const std::string& labels) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Series& series = AddSeries(name, help, type, labels);
+
+    series.callback = std::move(callback);
+}
+
+std::string MetricsRegistry::PrometheusText() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::string text;
+
+    for (const auto& family : families_) {
+        const std::string& name = family.first;
+
+        text += "# HELP " + name + " " + family.second.help + "\n";
+        text += "# TYPE " + name + " " +
+                MetricTypeName(family.second.type) + "\n";
+
+        for (const auto& series : family.second.series) {
+            if (series.callback) {
+                AppendSample(&text, name, series.labels, "",
+                             series.callback());
+            } else if (series.counter) {
+                AppendSample(&text, name, series.labels, "",
+                             static_cast<double>(series.counter->Value()));
+            } else if (series.gauge) {
+                AppendSample(&text, name, series.labels, "",
+                             static_cast<double>(series.gauge->Value()));
+            } else if (series.histogram) {
+                MetricHistogramSnapshot snapshot =
+                    series.histogram->Snapshot();
+
+                for (double quantile : METRICS_QUANTILES) {
+                    std::string label = "quantile=\"";
+                    AppendValue(&label, quantile);
+                    label += "\"";
+
+                    AppendSample(&text, name, series.labels, label,
+                                 static_cast<double>(
+                                     snapshot.Quantile(quantile)) *
+                                 series.unit);
+                }
+
+                AppendSample(&text, name + "_sum", series.labels, "",
+                             static_cast<double>(snapshot.sum) *
+                             series.unit);
+                AppendSample(&text, name + "_count", series.labels, "",
+                             static_cast<double>(snapshot.count));
+            }
+        }
+    }
+
+    return text;
+}
+
+/*
+Write the metrics to a file, e.g. for node_exporter's textfile collector.
+The file is written under a temporary name and renamed, so it is never seen
+partly written.
+*/
+bool MetricsRegistry::WriteTextFile(const std::string& filename) const {
+    std::string text = PrometheusText();
+
+    std::string temporaryName = filename + ".tmp";
+    std::FILE* file = std::fopen(temporaryName.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+
+    bool ok = std::fwrite(text.data(), 1, text.size(), file) == text.size();
+    ok = std::fclose(file) == 0 && ok;
+
+    std::error_code error;
+    if (ok) {
+        std::filesystem::rename(temporaryName, filename, error);
+    }
+
+    if (!ok || error) {
+        std::remove(temporaryName.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+MetricsRegistry::Series& MetricsRegistry::AddSeries(
+        const std::string& name, const std::string& help, MetricType type,
+        const std::string& labels) {
+    auto family = families_.find(name);
+
+    if (family == families_.end()) {
+        family = families_.emplace(name, Family{ type, help, {} }).first;
+    }
+
+    family->second.series.emplace_back();
+    family->second.series.back().labels = labels;
+    return family->second.series.back();
+}
+
+}   // namespace common
+}   // namespace duplitrace
@@ -0,0 +1,225 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#ifndef METRICS_H_
+#define METRICS_H_
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace duplitrace { namespace common {
+
+// Counters and histograms are spread over this many cache line aligned
+// shards, threads are given a shard each in turn.
+const size_t METRICS_SHARD_COUNT = 16;
+
+// Histogram buckets per power of two, so a recorded value is within 1/8th
+// (12.5%) of the value it is reported as.
+const size_t METRICS_HISTOGRAM_SUB_BUCKETS = 8;
+const size_t METRICS_HISTOGRAM_BUCKETS = 62 * METRICS_HISTOGRAM_SUB_BUCKETS;
+
+// Shard used by the calling thread.
+inline size_t MetricsThreadShard() {
+    static std::atomic<size_t> nextShard(0);
+    thread_local size_t shard = nextShard++ % METRICS_SHARD_COUNT;
+    return shard;
+}
+
+// Count that only goes up, e.g. files crawled.
+class MetricCounter {
+ public:
+    void Add(uint64_t count = 1) {
+        cells_[MetricsThreadShard()].value.fetch_add(
+            count, std::memory_order_relaxed);
+    }
+
+    uint64_t Value() const;
+
+ private:
+    struct alignas(64) Cell {
+        std::atomic<uint64_t> value{ 0 };
+    };
+
+    std::array<Cell, METRICS_SHARD_COUNT> cells_;
+};
+
+// Value that goes up and down, e.g. a queue depth.
+class MetricGauge {
+ public:
+    void Set(int64_t value) {
+        value_.store(value, std::memory_order_relaxed);
+    }
+
+    void Add(int64_t change) {
+        value_.fetch_add(change, std::memory_order_relaxed);
+    }
+
+    int64_t Value() const {
+        return value_.load(std::memory_order_relaxed);
+    }
+
+ private:
+    std::atomic<int64_t> value_{ 0 };
+};
+
+struct MetricHistogramSnapshot {
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    std::vector<uint64_t> buckets;
+
+    uint64_t Quantile(double quantile) const;
+};
+
+/*
+Distribution of values, e.g. latencies in nanoseconds. Buckets are log-linear
+like an HDR histogram, values below 8 have a bucket each and every power of
+two above is split into 8 buckets, so any value from 0 to 2^64 - 1 can be
+recorded with a fixed relative error.
+*/
+class MetricHistogram {
+ public:
+    MetricHistogram();
+
+    MetricHistogram(const MetricHistogram&) = delete;
+    MetricHistogram& operator=(const MetricHistogram&) = delete;
+
+    void Record(uint64_t value) {
+        Shard& shard = *shards_[MetricsThreadShard()];
+
+        shard.buckets[BucketIndex(value)].fetch_add(
+            1, std::memory_order_relaxed);
+        shard.sum.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    MetricHistogramSnapshot Snapshot() const;
+
+    static size_t BucketIndex(uint64_t value) {
+        if (value < METRICS_HISTOGRAM_SUB_BUCKETS) {
+            return static_cast<size_t>(value);
+        }
+
+        // Position of the top bit (3 or more), the 3 bits below it pick the
+        // sub-bucket.
+#if defined(_MSC_VER)
+        unsigned long top;
+        _BitScanReverse64(&top, value);
+#else
+        size_t top = 63 - static_cast<size_t>(__builtin_clzll(value));
+#endif
+        size_t sub = static_cast<size_t>(value >> (top - 3)) &
+                     (METRICS_HISTOGRAM_SUB_BUCKETS - 1);
+
+        return (top - 2) * METRICS_HISTOGRAM_SUB_BUCKETS + sub;
+    }
+
+    static uint64_t BucketUpperBound(size_t index);
+
+ private:
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> sum{ 0 };
+        std::array<std::atomic<uint64_t>, METRICS_HISTOGRAM_BUCKETS> buckets;
+    };
+
+    std::array<std::unique_ptr<Shard>, METRICS_SHARD_COUNT> shards_;
+};
+
+enum class MetricType {
+    COUNTER,
+    GAUGE,
+    SUMMARY
+};
+
+// Read when the metrics are exported, for values that are already kept
+// elsewhere.
+using MetricCallback = std::function<double()>;
+
+/*
+Named metrics, exported in the Prometheus text format. Metrics are added
+once, at start up, and then live as long as the registry, so recording one
+is just a relaxed atomic add on the calling thread's shard with no lock or
+lookup. Rates (e.g. files crawled a second) are left to Prometheus, which
+works them out from the counters. Histograms are exported as summaries of
+their quantiles, scaled by the unit they were recorded in.
+
+Labels are given in the exposition format, e.g. stage="hash", and metrics
+that only differ by their labels share a name.
+*/
+class MetricsRegistry {
+ public:
+    MetricsRegistry() = default;
+
+    MetricsRegistry(const MetricsRegistry&) = delete;
+    MetricsRegistry& operator=(const MetricsRegistry&) = delete;
+
+    MetricCounter* AddCounter(const std::string& name,
+                              const std::string& help,
+                              const std::string& labels = "");
+
+    MetricGauge* AddGauge(const std::string& name, const std::string& help,
+                          const std::string& labels = "");
+
+    MetricHistogram* AddHistogram(const std::string& name,
+                                  const std::string& help, double unit,
+                                  const std::string& labels = "");
+
+    void AddCallback(const std::string& name, const std::string& help,
+                     MetricType type, MetricCallback callback,
+                     const std::string& labels = "");
+
+    std::string PrometheusText() const;
+
+    bool WriteTextFile(const std::string& filename) const;
+
+ private:
+    struct Series {
+        std::string labels;
+        std::unique_ptr<MetricCounter> counter;
+        std::unique_ptr<MetricGauge> gauge;
+        std::unique_ptr<MetricHistogram> histogram;
+        double unit = 1.0;
+        MetricCallback callback;
+    };
+
+    struct Family {
+        MetricType type;
+        std::string help;
+        std::vector<Series> series;
+    };
+
+    mutable std::mutex mutex_;
+    std::map<std::string, Family> families_;
+
+    Series& AddSeries(const std::string& name, const std::string& help,
+                      MetricType type, const std::string& labels);
+};
+
+}   // namespace common
+}   // namespace duplitrace
+
+#endif  // METRICS_H_
@@ -0,0 +1,200 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#include <utility>
+#include "MetricsEndpoint.h"
+#include "Platform.h"
+
+#if DUPLITRACE_PLATFORM == DUPLITRACE_PLATFORM_LINUX
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cstring>
+#endif
+
+namespace duplitrace { namespace common {
+
+// Most connections served at once, more are closed straight away.
+const size_t METRICS_ENDPOINT_MAX_CLIENTS = 16;
+
+// A client that has not read all of the text after this long is dropped.
+const auto METRICS_ENDPOINT_CLIENT_TIMEOUT = std::chrono::seconds(10);
+
+MetricsEndpoint::MetricsEndpoint(const MetricsRegistry* registry,
+                                 EventLoop* eventLoop) :
+    registry_(registry),
+    event_loop_(eventLoop),
+    fd_(-1) {
+}
+
+MetricsEndpoint::~MetricsEndpoint() {
+#if DUPLITRACE_PLATFORM == DUPLITRACE_PLATFORM_LINUX
+    while (!clients_.empty()) {
+        CloseClient(clients_.begin()->first);
+    }
+
+    if (fd_ >= 0) {
+        event_loop_->RemoveFileDescriptor(fd_);
+        close(fd_);
+        unlink(path_.c_str());
+    }
+#endif
+}
+
+/*
+Create the socket, listen on it and start accepting connections from the
+event loop. A socket left behind at the path (e.g. by a crash) is replaced,
+anything else there is not.
+
+returns:
+    False if the socket cannot be created.
+*/
+bool MetricsEndpoint::Listen(const std::string& path) {
+#if DUPLITRACE_PLATFORM == DUPLITRACE_PLATFORM_LINUX
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+
+    if (fd_ >= 0 || path.empty() || path.size() >= sizeof(address.sun_path)) {
+        return false;
+    }
+    std::memcpy(address.sun_path, path.data(), path.size());
+
+    struct stat status;
+    if (lstat(path.c_str(), &status) == 0 && S_ISSOCK(status.st_mode)) {
+        unlink(path.c_str());
+    }
+
+    fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd_ < 0) {
+        return false;
+    }
+
+    if (bind(fd_, reinterpret_cast<sockaddr*>(&address),
+             sizeof(address)) != 0 ||
+        listen(fd_, SOMAXCONN) != 0) {
+        close(fd_);
+        fd_ = -1;
+        return false;
+    }
+
+    if (!event_loop_->AddFileDescriptor(fd_, [this] { Accept(); })) {
+        close(fd_);
+        unlink(path.c_str());
+        fd_ = -1;
+        return false;
+    }
+
+    path_ = path;
+    return true;
+#else
+    (void)path;
+    return false;
+#endif
+}
+
+#if DUPLITRACE_PLATFORM == DUPLITRACE_PLATFORM_LINUX
+
+// Accept the waiting connections and start sending them the metrics.
+void MetricsEndpoint::Accept() {
+    int fd;
+
+    while ((fd = accept4(fd_, nullptr, nullptr,
+                         SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+        DropStalledClients();
+
+        if (clients_.size() >= METRICS_ENDPOINT_MAX_CLIENTS) {
+            close(fd);
+            continue;
+        }
+
+        Client client { registry_->PrometheusText(), 0,
+                        std::chrono::steady_clock::now() };
+
+        if (!Send(fd, &client)) {
+            close(fd);
+            continue;
+        }
+
+        // The rest is sent as the client reads what it has been sent.
+        if (!event_loop_->AddFileDescriptor(fd, [this, fd] { Continue(fd); },
+                                            FileDescriptorEvent::WRITABLE)) {
+            close(fd);
+            continue;
+        }
+        clients_.emplace(fd, std::move(client));
+    }
+}
+
+/*
+Send a client as much of the rest of the text as its socket takes.
+
+returns:
+    True if there is more to send once the socket is writable again, false
+    once it has all been sent or the client has gone.
+*/
+bool MetricsEndpoint::Send(int fd, Client* client) {
+    while (client->sent < client->text.size()) {
+        ssize_t written = send(fd, client->text.data() + client->sent,
+                               client->text.size() - client->sent,
+                               MSG_NOSIGNAL);
+        if (written < 0) {
+            return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+        }
+        client->sent += static_cast<size_t>(written);
+    }
+
+    return false;
+}
+
+void MetricsEndpoint::Continue(int fd) {
+    auto client = clients_.find(fd);
+
+    if (client != clients_.end() && !Send(fd, &client->second)) {
+        CloseClient(fd);
+    }
+}
+
+void MetricsEndpoint::DropStalledClients() {
+    auto now = std::chrono::steady_clock::now();
+
+    for (auto client = clients_.begin(); client != clients_.end();) {
+        int fd = client->first;
+        bool stalled =
+            now - client->second.connected > METRICS_ENDPOINT_CLIENT_TIMEOUT;
+
+        ++client;
+        if (stalled) {
+            CloseClient(fd);
+        }
+    }
+}
+
+void MetricsEndpoint::CloseClient(int fd) {
+    event_loop_->RemoveFileDescriptor(fd);
+    close(fd);
+    clients_.erase(fd);
+}
+
+#endif
+
+}   // namespace common
+}   // namespace duplitrace
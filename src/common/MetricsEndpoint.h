@@ -0,0 +1,77 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#ifndef METRICSENDPOINT_H_
+#define METRICSENDPOINT_H_
+#include <chrono>
+#include <map>
+#include <string>
+#include "EventLoop.h"
+#include "Metrics.h"
+
+namespace duplitrace { namespace common {
+
+/*
+Unix domain socket that hands out the metrics, each connection is sent the
+Prometheus text and then closed, e.g. for 'socat - UNIX-CONNECT:<path>'.
+Connections are served from the event loop without ever blocking it: a
+client is sent as much of the text as its socket takes and the rest as the
+socket becomes writable. Only a few clients are served at once, and one that
+stops reading is dropped. Only supported on Linux.
+*/
+class MetricsEndpoint {
+ public:
+    MetricsEndpoint(const MetricsRegistry* registry, EventLoop* eventLoop);
+
+    ~MetricsEndpoint();
+
+    MetricsEndpoint(const MetricsEndpoint&) = delete;
+    MetricsEndpoint& operator=(const MetricsEndpoint&) = delete;
+
+    bool Listen(const std::string& path);
+
+ private:
+    // A connection still being sent its copy of the text.
+    struct Client {
+        std::string text;
+        size_t sent;
+        std::chrono::steady_clock::time_point connected;
+    };
+
+    const MetricsRegistry* registry_;
+    EventLoop* event_loop_;
+    std::string path_;
+    int fd_;
+    std::map<int, Client> clients_;
+
+    void Accept();
+
+    bool Send(int fd, Client* client);
+
+    void Continue(int fd);
+
+    void DropStalledClients();
+
+    void CloseClient(int fd);
+};
+
+}   // namespace common
+}   // namespace duplitrace
+
+#endif  // METRICSENDPOINT_H_
@@ -0,0 +1,162 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#include <cstring>
+#include <functional>
+#include "PathStore.h"
+
+namespace duplitrace { namespace common {
+
+// Size of the arena blocks names are copied into, longer names get a block
+// of their own.
+const size_t PATH_STORE_ARENA_BLOCK_SIZE = 64 * 1024;
+
+PathStore::PathStore() :
+    name_count_(0),
+    directory_count_(0),
+    name_bytes_(0) {
+    for (auto& shard : name_shards_) {
+        shard = std::make_unique<NameShard>();
+    }
+}
+
+/*
+Get the id of a name, storing the name if it has not been seen before.
+
+returns:
+    Id of the name, the same for every call with the same name.
+*/
+uint32_t PathStore::InternName(std::string_view name) {
+    size_t hash = std::hash<std::string_view>()(name);
+    NameShard& shard = *name_shards_[hash % name_shards_.size()];
+
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto found = shard.ids.find(name);
+    if (found != shard.ids.end()) {
+        return found->second;
+    }
+
+    std::string_view stored(Allocate(&shard, name), name.size());
+    uint32_t id = name_count_++;
+
+    names_[id] = stored;
+    shard.ids.emplace(stored, id);
+    name_bytes_ += name.size();
+
+    return id;
+}
+
+/*
+Add a directory, pass PATH_STORE_NO_DIRECTORY as the parent of a root
+directory, whose name is its full path.
+
+returns:
+    Id of the new directory.
+*/
+uint32_t PathStore::AddDirectory(uint32_t parent, std::string_view name) {
+    uint32_t nameId = InternName(name);
+    uint32_t id = directory_count_++;
+
+    directories_[id] = { parent, nameId };
+    return id;
+}
+
+// Rebuild the full path of a directory from its chain of parents.
+std::string PathStore::DirectoryPath(uint32_t directory) const {
+    std::vector<std::string_view> names;
+    size_t length = 0;
+
+    for (; directory != PATH_STORE_NO_DIRECTORY;
+         directory = directories_[directory].parent) {
+        names.push_back(names_[directories_[directory].name]);
+        length += names.back().size() + 1;
+    }
+
+    std::string path;
+    path.reserve(length);
+
+    for (auto name = names.rbegin(); name != names.rend(); ++name) {
+        if (!path.empty() && path.back() != '/') {
+            path += '/';
+        }
+        path += *name;
+    }
+
+    return path;
+}
+
+std::string PathStore::FilePath(uint32_t directory, uint32_t name) const {
+    std::string path = DirectoryPath(directory);
+
+    if (!path.empty() && path.back() != '/') {
+        path += '/';
+    }
+    path += names_[name];
+
+    return path;
+}
+
+// Approximate memory used by the names and directories, including the
+// lookup tables.
+uint64_t PathStore::MemoryUsage() const {
+    uint64_t bytes = static_cast<uint64_t>(name_count_) *
+                     (sizeof(std::string_view) * 2 + sizeof(uint32_t) +
+                      2 * sizeof(void*)) +
+                     static_cast<uint64_t>(directory_count_) *
+                     sizeof(Directory);
+
+    for (const auto& shard : name_shards_) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        bytes += shard->arena_bytes;
+    }
+
+    return bytes;
+}
+
+// Copy a name into the shard's arena, with a terminating null so that it can
+// be passed to system calls as-is.
+const char* PathStore::Allocate(NameShard* shard, std::string_view name) {
+    size_t length = name.size() + 1;
+    char* text;
+
+    if (length > PATH_STORE_ARENA_BLOCK_SIZE / 4) {
+        shard->large_names.push_back(std::make_unique<char[]>(length));
+        shard->arena_bytes += length;
+        text = shard->large_names.back().get();
+    } else {
+        if (shard->blocks.empty() ||
+            shard->block_used + length > PATH_STORE_ARENA_BLOCK_SIZE) {
+            shard->blocks.push_back(
+                std::make_unique<char[]>(PATH_STORE_ARENA_BLOCK_SIZE));
+            shard->block_used = 0;
+            shard->arena_bytes += PATH_STORE_ARENA_BLOCK_SIZE;
+        }
+
+        text = shard->blocks.back().get() + shard->block_used;
+        shard->block_used += length;
+    }
+
+    std::memcpy(text, name.data(), name.size());
+    text[name.size()] = '\0';
+
+    return text;
+}
+
+}   // namespace common
+}   // namespace duplitrace
@@ -0,0 +1,158 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#ifndef PATHSTORE_H_
+#define PATHSTORE_H_
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace duplitrace { namespace common {
+
+// Parent of a root directory.
+const uint32_t PATH_STORE_NO_DIRECTORY = 0xFFFFFFFF;
+
+/*
+Array that grows in fixed-size blocks which are never moved, so an element
+can be read while other threads are appending. Ids are handed out by the
+owner, an element must be written before its id is shared.
+*/
+template <typename T>
+class StableArray {
+ public:
+    static const size_t BLOCK_SIZE = 1 << 16;
+    static const size_t MAXIMUM_BLOCKS = 1 << 16;
+
+    StableArray() : blocks_(new std::atomic<T*>[MAXIMUM_BLOCKS]()) {}
+
+    ~StableArray() {
+        for (size_t i = 0; i < MAXIMUM_BLOCKS; i++) {
+            delete[] blocks_[i].load();
+        }
+    }
+
+    StableArray(const StableArray&) = delete;
+    StableArray& operator=(const StableArray&) = delete;
+
+    T& operator[](size_t index) {
+        std::atomic<T*>& slot = blocks_[index / BLOCK_SIZE];
+        T* block = slot.load(std::memory_order_acquire);
+
+        if (!block) {
+            T* created = new T[BLOCK_SIZE]();
+            if (slot.compare_exchange_strong(block, created,
+                                             std::memory_order_acq_rel)) {
+                block = created;
+            } else {
+                delete[] created;
+            }
+        }
+
+        return block[index % BLOCK_SIZE];
+    }
+
+    const T& operator[](size_t index) const {
+        return blocks_[index / BLOCK_SIZE].load(
+            std::memory_order_acquire)[index % BLOCK_SIZE];
+    }
+
+ private:
+    std::unique_ptr<std::atomic<T*>[]> blocks_;
+};
+
+/*
+Interned storage for the paths found by a scan. Each distinct file or
+directory name is stored once, in large arena blocks, and a directory is a
+(parent, name) pair, so deep trees share every common prefix. A file is
+represented by its directory id and name id, and full paths are only built
+when they are asked for.
+
+Ids are dense, starting from 0, so they can index columns directly. Safe to
+add to and read from multiple threads at once.
+*/
+class PathStore {
+ public:
+    PathStore();
+
+    PathStore(const PathStore&) = delete;
+    PathStore& operator=(const PathStore&) = delete;
+
+    uint32_t InternName(std::string_view name);
+
+    std::string_view Name(uint32_t id) const { return names_[id]; }
+
+    uint32_t AddDirectory(uint32_t parent, std::string_view name);
+
+    uint32_t DirectoryParent(uint32_t directory) const {
+        return directories_[directory].parent;
+    }
+
+    uint32_t DirectoryName(uint32_t directory) const {
+        return directories_[directory].name;
+    }
+
+    std::string DirectoryPath(uint32_t directory) const;
+
+    std::string FilePath(uint32_t directory, uint32_t name) const;
+
+    uint32_t NameCount() const { return name_count_; }
+
+    uint32_t DirectoryCount() const { return directory_count_; }
+
+    uint64_t NameBytes() const { return name_bytes_; }
+
+    uint64_t MemoryUsage() const;
+
+ private:
+    struct Directory {
+        uint32_t parent;
+        uint32_t name;
+    };
+
+    // Names are spread over shards by hash, each with its own lock, lookup
+    // table and arena. Names too long to pack well get their own allocation.
+    struct NameShard {
+        std::mutex mutex;
+        std::unordered_map<std::string_view, uint32_t> ids;
+        std::vector<std::unique_ptr<char[]>> blocks;
+        std::vector<std::unique_ptr<char[]>> large_names;
+        size_t block_used = 0;
+        uint64_t arena_bytes = 0;
+    };
+
+    std::array<std::unique_ptr<NameShard>, 64> name_shards_;
+    StableArray<std::string_view> names_;
+    StableArray<Directory> directories_;
+    std::atomic<uint32_t> name_count_;
+    std::atomic<uint32_t> directory_count_;
+    std::atomic<uint64_t> name_bytes_;
+
+    const char* Allocate(NameShard* shard, std::string_view name);
+};
+
+}   // namespace common
+}   // namespace duplitrace
+
+#endif  // PATHSTORE_H_
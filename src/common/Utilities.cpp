@@ -18,29 +18,32 @@ Copyright 2024 DupliTrace Development Team
     along with this program.If not, see < https://www.gnu.org/licenses/>.
 */
 #include <algorithm>
-#include <sstream>
 #include <string>
 #include "Utilities.h"
 #include "Platform.h"
 
 namespace duplitrace { namespace common {
 
-
 bool StringContains(std::string_view str, char const ch) noexcept {
     return std::string_view::npos != str.find_first_of(ch);
 }
 
-std::vector<std::string> StringSplit(std::string_view text,
-                                     char const delimiter) {
-    std::vector<std::string> tokens;
-    std::string token;
-    std::istringstream tokenStream (text.data());
-
-    while (std::getline (tokenStream, token, delimiter)) {
-        tokens.push_back (token);
+// Move on to the next token, or to the end if this was the last.
+void StringSplitter::Iterator::Advance() {
+    if (next_ == std::string_view::npos) {
+        token_ = std::string_view();
+        return;
     }
 
-    return tokens;
+    size_t found = text_.find(delimiter_, next_);
+
+    if (found == std::string_view::npos) {
+        token_ = text_.substr(next_);
+        next_ = std::string_view::npos;
+    } else {
+        token_ = text_.substr(next_, found - next_);
+        next_ = found + 1;
+    }
 }
 
 std::string ToUpper(std::string str) {
@@ -62,7 +65,7 @@ std::tm* StdTimeToStdTm (std::time_t const* date, std::tm* const out) {
 #endif
 }
 
-inline std::time_t StdTmToStdTime(std::tm& date) {
+std::time_t StdTmToStdTime(std::tm& date) {
     return std::mktime (&date);
 }
 
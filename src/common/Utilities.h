@@ -19,15 +19,123 @@ Copyright 2024 DupliTrace Development Team
 */
 #ifndef UTILITIES_H_
 #define UTILITIES_H_
+#include <array>
+#include <cstddef>
 #include <ctime>
-#include <vector>
+#include <iterator>
+#include <string>
+#include <string_view>
 
 namespace duplitrace { namespace common {
 
 bool StringContains(std::string_view str, char const ch) noexcept;
 
-std::vector<std::string> StringSplit(std::string_view text,
-                                     char const delimiter);
+/*
+Splits text on a delimiter lazily, each token is a view into the text so
+nothing is copied or allocated, and the text must outlive the tokens. Every
+delimiter separates two tokens, so "a,,b" gives "a", "" and "b" and "a," gives
+"a" and "". Empty text has no tokens.
+
+    for (std::string_view path : StringSplitter(paths, ',')) { ... }
+*/
+class StringSplitter {
+ public:
+    class Iterator {
+     public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::string_view;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const std::string_view*;
+        using reference = const std::string_view&;
+
+        reference operator*() const { return token_; }
+
+        pointer operator->() const { return &token_; }
+
+        Iterator& operator++() {
+            Advance();
+            return *this;
+        }
+
+        Iterator operator++(int) {
+            Iterator previous = *this;
+            Advance();
+            return previous;
+        }
+
+        bool operator==(const Iterator& other) const {
+            return next_ == other.next_ &&
+                   token_.data() == other.token_.data();
+        }
+
+        bool operator!=(const Iterator& other) const {
+            return !(*this == other);
+        }
+
+     private:
+        friend class StringSplitter;
+
+        Iterator(std::string_view text, char delimiter, size_t next) :
+            text_(text), delimiter_(delimiter), next_(next) {
+        }
+
+        std::string_view text_;
+        char delimiter_;
+
+        // Start of the token after this one, npos once this is the last.
+        size_t next_;
+
+        // Default (null) at the end.
+        std::string_view token_;
+
+        void Advance();
+    };
+
+    StringSplitter(std::string_view text, char delimiter) :
+        text_(text), delimiter_(delimiter) {
+    }
+
+    Iterator begin() const {
+        if (text_.empty()) {
+            return end();
+        }
+
+        Iterator first(text_, delimiter_, 0);
+        first.Advance();
+        return first;
+    }
+
+    Iterator end() const {
+        return Iterator(text_, delimiter_, std::string_view::npos);
+    }
+
+ private:
+    std::string_view text_;
+    char delimiter_;
+};
+
+/*
+Split text into a fixed number of views, for when the number of tokens is
+known up front, e.g. the two ends of a range. Tokens past the capacity are
+counted but not stored.
+
+returns:
+    Number of tokens in the text, which may be more than were stored.
+*/
+template <size_t CAPACITY>
+size_t StringSplitInto(std::string_view text, char delimiter,
+                       std::array<std::string_view, CAPACITY>* tokens) {
+    size_t count = 0;
+
+    for (std::string_view token : StringSplitter(text, delimiter)) {
+        if (count < CAPACITY) {
+            (*tokens)[count] = token;
+        }
+        count++;
+    }
+
+    return count;
+}
 
 std::string ToUpper(std::string str);
 
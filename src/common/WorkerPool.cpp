@@ -0,0 +1,199 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+#include "Logger.h"
+#include "WorkerPool.h"
+
+namespace duplitrace { namespace common {
+
+/*
+Create the pool and start its threads. The optional task completed callback
+is run on the worker thread after each task finishes, e.g. to wake up an
+event loop.
+*/
+WorkerPool::WorkerPool(size_t threadCount, WorkerTask taskCompleted) :
+    task_completed_(std::move(taskCompleted)),
+    active_tasks_(0),
+    running_threads_(0),
+    stopping_(false),
+    stop_requested_(false) {
+    if (threadCount == 0) {
+        threadCount = 1;
+    }
+
+    running_threads_ = threadCount;
+
+    for (size_t i = 0; i < threadCount; i++) {
+        threads_.emplace_back(&WorkerPool::WorkerThread, this);
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    Shutdown();
+}
+
+/*
+Queue a task to be run on one of the worker threads.
+
+returns:
+    False if the pool is shutting down and the task was rejected.
+*/
+bool WorkerPool::Submit(WorkerTask task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        if (stopping_) {
+            return false;
+        }
+
+        tasks_.push_back(std::move(task));
+    }
+
+    task_available_.notify_one();
+    return true;
+}
+
+/*
+Stop accepting new tasks, let the worker threads drain the queue and then
+wait for them to finish.
+*/
+void WorkerPool::Shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+
+    task_available_.notify_all();
+    JoinThreads();
+}
+
+/*
+Stop accepting new tasks and give the queued and running tasks up to the
+drain timeout to finish. When the timeout expires any tasks that have not
+started are discarded and StopRequested() is raised, long running tasks are
+expected to poll it and return early. A warning is logged if tasks are still
+running after the stop timeout as well, but the threads are always joined:
+tasks use what their owner holds, so the pool never returns while one of
+them is still running.
+
+returns:
+    True if all of the work was drained within the timeout.
+*/
+bool WorkerPool::Shutdown(std::chrono::milliseconds drainTimeout,
+                          std::chrono::milliseconds stopTimeout) {
+    bool drained;
+    size_t stuckThreads = 0;
+
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        stopping_ = true;
+        task_available_.notify_all();
+
+        drained = pool_idle_.wait_for(lock, drainTimeout, [this] {
+            return tasks_.empty() && active_tasks_ == 0;
+        });
+
+        if (!drained) {
+            tasks_.clear();
+            stop_requested_ = true;
+            task_available_.notify_all();
+
+            if (!thread_exited_.wait_for(lock, stopTimeout, [this] {
+                    return running_threads_ == 0;
+                })) {
+                stuckThreads = running_threads_;
+            }
+        }
+    }
+
+    if (stuckThreads != 0) {
+        LOGGER->warn("{0} worker thread(s) did not stop in time, waiting "
+                     "for their tasks to return", stuckThreads);
+    }
+
+    JoinThreads();
+    return drained;
+}
+
+size_t WorkerPool::PendingTasks() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return tasks_.size() + active_tasks_;
+}
+
+void WorkerPool::JoinThreads() {
+    for (auto& thread : threads_) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+}
+
+void WorkerPool::WorkerThread() {
+    while (true) {
+        WorkerTask task;
+
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            task_available_.wait(lock, [this] {
+                return stopping_ || !tasks_.empty();
+            });
+
+            if (tasks_.empty()) {
+                running_threads_--;
+                thread_exited_.notify_all();
+                return;
+            }
+
+            task = std::move(tasks_.front());
+            tasks_.pop_front();
+            active_tasks_++;
+        }
+
+        // An escaping exception would terminate the whole process, so it is
+        // reported and the worker carries on with the next task.
+        try {
+            task();
+        }
+        catch (const std::exception& ex) {
+            LOGGER->error("Worker task failed: {0}", ex.what());
+        }
+        catch (...) {
+            LOGGER->error("Worker task failed with an unknown exception");
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            active_tasks_--;
+
+            if (tasks_.empty() && active_tasks_ == 0) {
+                pool_idle_.notify_all();
+            }
+        }
+
+        if (task_completed_) {
+            task_completed_();
+        }
+    }
+}
+
+}   // namespace common
+}   // namespace duplitrace
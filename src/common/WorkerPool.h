@@ -0,0 +1,89 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#ifndef WORKERPOOL_H_
+#define WORKERPOOL_H_
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace duplitrace { namespace common {
+
+using WorkerTask = std::function<void()>;
+
+/*
+Time running tasks are given to notice StopRequested() and return, once a
+timed shutdown has run out of time to drain the pool, before a warning is
+logged about those that have not.
+*/
+const std::chrono::milliseconds WORKER_POOL_DEFAULT_STOP_TIMEOUT =
+    std::chrono::seconds(5);
+
+// Fixed size pool of threads that run submitted tasks in FIFO order.
+class WorkerPool {
+ public:
+    explicit WorkerPool(size_t threadCount,
+                        WorkerTask taskCompleted = nullptr);
+
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    bool Submit(WorkerTask task);
+
+    void Shutdown();
+
+    bool Shutdown(std::chrono::milliseconds drainTimeout,
+                  std::chrono::milliseconds stopTimeout =
+                      WORKER_POOL_DEFAULT_STOP_TIMEOUT);
+
+    bool StopRequested() const { return stop_requested_; }
+
+    size_t ThreadCount() const { return threads_.size(); }
+
+    size_t PendingTasks();
+
+ private:
+    std::deque<WorkerTask> tasks_;
+    std::mutex mutex_;
+    std::condition_variable task_available_;
+    std::condition_variable pool_idle_;
+    std::condition_variable thread_exited_;
+    WorkerTask task_completed_;
+    size_t active_tasks_;
+    size_t running_threads_;
+    bool stopping_;
+    std::atomic<bool> stop_requested_;
+    std::vector<std::thread> threads_;
+
+    void JoinThreads();
+
+    void WorkerThread();
+};
+
+}   // namespace common
+}   // namespace duplitrace
+
+#endif  // WORKERPOOL_H_
@@ -0,0 +1,322 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#include <algorithm>
+#include <cstring>
+#include <utility>
+#include "Blake3Hasher.h"
+
+namespace duplitrace { namespace common { namespace hashing {
+
+static inline uint32_t RotateRight32(uint32_t value, int bits) {
+    return (value >> bits) | (value << (32 - bits));
+}
+
+static inline void Blake3Mix(uint32_t state[16], size_t a, size_t b,
+                             size_t c, size_t d, uint32_t x, uint32_t y) {
+    state[a] = state[a] + state[b] + x;
+    state[d] = RotateRight32(state[d] ^ state[a], 16);
+    state[c] = state[c] + state[d];
+    state[b] = RotateRight32(state[b] ^ state[c], 12);
+    state[a] = state[a] + state[b] + y;
+    state[d] = RotateRight32(state[d] ^ state[a], 8);
+    state[c] = state[c] + state[d];
+    state[b] = RotateRight32(state[b] ^ state[c], 7);
+}
+
+/*
+Portable BLAKE3 compression function, the chaining value is replaced by the
+first half of the output. Blocks shorter than 64 bytes must be zero padded.
+*/
+void Blake3Compress(uint32_t chainingValue[8],
+                    const uint8_t block[BLAKE3_BLOCK_LENGTH],
+                    uint8_t blockLength, uint64_t counter, uint8_t flags) {
+    uint32_t message[16];
+    std::memcpy(message, block, sizeof(message));
+
+    uint32_t state[16] = {
+        chainingValue[0], chainingValue[1], chainingValue[2],
+        chainingValue[3], chainingValue[4], chainingValue[5],
+        chainingValue[6], chainingValue[7],
+        BLAKE3_IV[0], BLAKE3_IV[1], BLAKE3_IV[2], BLAKE3_IV[3],
+        static_cast<uint32_t>(counter),
+        static_cast<uint32_t>(counter >> 32),
+        blockLength, flags
+    };
+
+    for (size_t round = 0; round < BLAKE3_ROUNDS; round++) {
+        const uint8_t* schedule = BLAKE3_MESSAGE_SCHEDULE[round];
+
+        Blake3Mix(state, 0, 4, 8, 12, message[schedule[0]],
+                  message[schedule[1]]);
+        Blake3Mix(state, 1, 5, 9, 13, message[schedule[2]],
+                  message[schedule[3]]);
+        Blake3Mix(state, 2, 6, 10, 14, message[schedule[4]],
+                  message[schedule[5]]);
+        Blake3Mix(state, 3, 7, 11, 15, message[schedule[6]],
+                  message[schedule[7]]);
+
+        Blake3Mix(state, 0, 5, 10, 15, message[schedule[8]],
+                  message[schedule[9]]);
+        Blake3Mix(state, 1, 6, 11, 12, message[schedule[10]],
+                  message[schedule[11]]);
+        Blake3Mix(state, 2, 7, 8, 13, message[schedule[12]],
+                  message[schedule[13]]);
+        Blake3Mix(state, 3, 4, 9, 14, message[schedule[14]],
+                  message[schedule[15]]);
+    }
+
+    for (size_t i = 0; i < 8; i++) {
+        chainingValue[i] = state[i] ^ state[i + 8];
+    }
+}
+
+void Blake3HashManyScalar(const uint8_t* input, size_t inputCount,
+                          size_t blockCount, const uint32_t key[8],
+                          uint64_t counter, bool incrementCounter,
+                          uint8_t flags, uint8_t startFlags,
+                          uint8_t endFlags, uint32_t* output) {
+    for (size_t i = 0; i < inputCount; i++) {
+        uint32_t* chainingValue = output + i * 8;
+        std::memcpy(chainingValue, key, 8 * sizeof(uint32_t));
+
+        for (size_t block = 0; block < blockCount; block++) {
+            uint8_t blockFlags = flags;
+
+            if (block == 0) {
+                blockFlags |= startFlags;
+            }
+            if (block == blockCount - 1) {
+                blockFlags |= endFlags;
+            }
+
+            Blake3Compress(chainingValue, input + block * BLAKE3_BLOCK_LENGTH,
+                           BLAKE3_BLOCK_LENGTH, counter, blockFlags);
+        }
+
+        input += blockCount * BLAKE3_BLOCK_LENGTH;
+        if (incrementCounter) {
+            counter++;
+        }
+    }
+}
+
+Blake3Hasher::Blake3Hasher(HashKernel kernel) :
+    kernel_(HashKernel::SCALAR),
+    hash_many_(Blake3HashManyScalar) {
+#if defined(HASHING_X86_KERNELS)
+    if (kernel == HashKernel::AVX512 && HashKernelSupported(kernel)) {
+        kernel_ = kernel;
+        hash_many_ = Blake3HashManyAvx512;
+    } else if (kernel >= HashKernel::AVX2 &&
+               HashKernelSupported(HashKernel::AVX2)) {
+        kernel_ = HashKernel::AVX2;
+        hash_many_ = Blake3HashManyAvx2;
+    }
+#elif defined(HASHING_NEON_KERNELS)
+    if (kernel == HashKernel::NEON && HashKernelSupported(kernel)) {
+        kernel_ = kernel;
+        hash_many_ = Blake3HashManyNeon;
+    }
+#else
+    (void)kernel;
+#endif
+
+    Reset();
+}
+
+void Blake3Hasher::Reset() {
+    chaining_value_stack_size_ = 0;
+    StartChunk(0);
+}
+
+void Blake3Hasher::StartChunk(uint64_t chunkCounter) {
+    std::memcpy(chunk_chaining_value_, BLAKE3_IV, sizeof(BLAKE3_IV));
+    std::memset(block_, 0, sizeof(block_));
+    block_length_ = 0;
+    blocks_compressed_ = 0;
+    chunk_counter_ = chunkCounter;
+}
+
+void Blake3Hasher::UpdateChunk(const uint8_t* input, size_t length) {
+    while (length > 0) {
+        // A full block is only compressed once more input arrives, as the
+        // last block of the chunk needs the CHUNK_END flag.
+        if (block_length_ == BLAKE3_BLOCK_LENGTH) {
+            Blake3Compress(chunk_chaining_value_, block_, BLAKE3_BLOCK_LENGTH,
+                           chunk_counter_, ChunkStartFlag());
+            blocks_compressed_++;
+            block_length_ = 0;
+            std::memset(block_, 0, sizeof(block_));
+        }
+
+        size_t take = std::min(BLAKE3_BLOCK_LENGTH - block_length_, length);
+        std::memcpy(block_ + block_length_, input, take);
+        block_length_ += take;
+        input += take;
+        length -= take;
+    }
+}
+
+/*
+Add the chaining value of a completed chunk or subtree to the tree. Each
+larger subtree it completes is merged into its parent straight away,
+'totalSubtrees' (chunks so far, in units of the subtree's size) has a
+trailing zero bit for each merge.
+*/
+void Blake3Hasher::PushChainingValue(const uint32_t chainingValue[8],
+                                     uint64_t totalSubtrees) {
+    uint32_t value[8];
+    std::memcpy(value, chainingValue, sizeof(value));
+
+    while ((totalSubtrees & 1) == 0) {
+        uint8_t block[BLAKE3_BLOCK_LENGTH];
+
+        chaining_value_stack_size_--;
+        std::memcpy(block, chaining_value_stack_[chaining_value_stack_size_],
+                    BLAKE3_OUTPUT_LENGTH);
+        std::memcpy(block + BLAKE3_OUTPUT_LENGTH, value, BLAKE3_OUTPUT_LENGTH);
+
+        std::memcpy(value, BLAKE3_IV, sizeof(value));
+        Blake3Compress(value, block, BLAKE3_BLOCK_LENGTH, 0, BLAKE3_PARENT);
+        totalSubtrees >>= 1;
+    }
+
+    std::memcpy(chaining_value_stack_[chaining_value_stack_size_], value,
+                sizeof(value));
+    chaining_value_stack_size_++;
+}
+
+/*
+Hash a run of whole chunks with the SIMD kernel. The run is split into the
+largest complete subtrees it contains (a power of two chunks, starting on a
+multiple of their size) and the parent nodes of each are hashed with the
+kernel as well, a level at a time, rather than one by one.
+*/
+void Blake3Hasher::HashChunks(const uint8_t* input, size_t chunkCount) {
+    uint32_t chainingValues[BLAKE3_BATCH_CHUNKS][8];
+    uint32_t parents[BLAKE3_BATCH_CHUNKS / 2][8];
+
+    hash_many_(input, chunkCount, BLAKE3_BLOCKS_PER_CHUNK, BLAKE3_IV,
+               chunk_counter_, true, 0, BLAKE3_CHUNK_START, BLAKE3_CHUNK_END,
+               chainingValues[0]);
+
+    size_t done = 0;
+    while (done < chunkCount) {
+        uint64_t position = chunk_counter_ + done;
+        size_t subtreeSize = 1;
+
+        while (position % (subtreeSize * 2) == 0 &&
+               done + subtreeSize * 2 <= chunkCount) {
+            subtreeSize *= 2;
+        }
+
+        // Each level is written to the buffer the previous level was not.
+        uint32_t* children = chainingValues[done];
+        uint32_t* nodes = parents[0];
+
+        for (size_t count = subtreeSize / 2; count > 0; count /= 2) {
+            hash_many_(reinterpret_cast<const uint8_t*>(children), count, 1,
+                       BLAKE3_IV, 0, false, BLAKE3_PARENT, 0, 0, nodes);
+            std::swap(children, nodes);
+        }
+
+        PushChainingValue(children, (position + subtreeSize) / subtreeSize);
+        done += subtreeSize;
+    }
+
+    StartChunk(chunk_counter_ + chunkCount);
+}
+
+void Blake3Hasher::Update(const void* data, size_t length) {
+    const uint8_t* input = static_cast<const uint8_t*>(data);
+
+    while (length > 0) {
+        // The current chunk is full and more input follows, so it can't be
+        // the root and is finished as an ordinary chunk.
+        if (ChunkLength() == BLAKE3_CHUNK_LENGTH) {
+            uint32_t chainingValue[8];
+            std::memcpy(chainingValue, chunk_chaining_value_,
+                        sizeof(chainingValue));
+            Blake3Compress(chainingValue, block_, BLAKE3_BLOCK_LENGTH,
+                           chunk_counter_, BLAKE3_CHUNK_END);
+            PushChainingValue(chainingValue, chunk_counter_ + 1);
+            StartChunk(chunk_counter_ + 1);
+        }
+
+        // On a chunk boundary whole chunks go to the SIMD kernel, always
+        // leaving at least one byte behind for the final chunk.
+        if (ChunkLength() == 0 && length > BLAKE3_CHUNK_LENGTH) {
+            size_t chunkCount = std::min((length - 1) / BLAKE3_CHUNK_LENGTH,
+                                         BLAKE3_BATCH_CHUNKS);
+            HashChunks(input, chunkCount);
+            input += chunkCount * BLAKE3_CHUNK_LENGTH;
+            length -= chunkCount * BLAKE3_CHUNK_LENGTH;
+            continue;
+        }
+
+        size_t take = std::min(BLAKE3_CHUNK_LENGTH - ChunkLength(), length);
+        UpdateChunk(input, take);
+        input += take;
+        length -= take;
+    }
+}
+
+/*
+Finish the hash, folding the current chunk and then each stacked subtree
+into its parent until only the root node is left.
+
+returns:
+    32 byte digest.
+*/
+HashDigest Blake3Hasher::Finalise() {
+    uint32_t chainingValue[8];
+    uint8_t block[BLAKE3_BLOCK_LENGTH];
+    uint8_t blockLength = static_cast<uint8_t>(block_length_);
+    uint64_t counter = chunk_counter_;
+    uint8_t flags = ChunkStartFlag() | BLAKE3_CHUNK_END;
+
+    std::memcpy(chainingValue, chunk_chaining_value_, sizeof(chainingValue));
+    std::memcpy(block, block_, sizeof(block));
+
+    for (size_t i = chaining_value_stack_size_; i > 0; i--) {
+        Blake3Compress(chainingValue, block, blockLength, counter, flags);
+
+        std::memcpy(block, chaining_value_stack_[i - 1],
+                    BLAKE3_OUTPUT_LENGTH);
+        std::memcpy(block + BLAKE3_OUTPUT_LENGTH, chainingValue,
+                    BLAKE3_OUTPUT_LENGTH);
+        std::memcpy(chainingValue, BLAKE3_IV, sizeof(chainingValue));
+        blockLength = BLAKE3_BLOCK_LENGTH;
+        counter = 0;
+        flags = BLAKE3_PARENT;
+    }
+
+    Blake3Compress(chainingValue, block, blockLength, counter,
+                   flags | BLAKE3_ROOT);
+
+    HashDigest digest;
+    digest.size = BLAKE3_OUTPUT_LENGTH;
+    std::memcpy(digest.bytes.data(), chainingValue, BLAKE3_OUTPUT_LENGTH);
+    return digest;
+}
+
+}   // namespace hashing
+}   // namespace common
+}   // namespace duplitrace
@@ -0,0 +1,86 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#ifndef BLAKE3HASHER_H_
+#define BLAKE3HASHER_H_
+#include "Blake3Kernels.h"
+#include "Hasher.h"
+
+namespace duplitrace { namespace common { namespace hashing {
+
+// Most chunks handed to the SIMD kernel at a time.
+const size_t BLAKE3_BATCH_CHUNKS = 64;
+
+// Enough chaining values for 2^54 chunks, i.e. a 2^64 byte input.
+const size_t BLAKE3_MAXIMUM_TREE_DEPTH = 54;
+
+// Streaming BLAKE3 (unkeyed, 32 byte output). Runs of whole chunks, and the
+// parent nodes above them, are hashed several at a time by the SIMD kernel.
+class Blake3Hasher : public Hasher {
+ public:
+    explicit Blake3Hasher(HashKernel kernel = BestHashKernel());
+
+    HashAlgorithm Algorithm() const override { return HashAlgorithm::BLAKE3; }
+
+    HashKernel Kernel() const override { return kernel_; }
+
+    void Reset() override;
+
+    void Update(const void* data, size_t length) override;
+
+    HashDigest Finalise() override;
+
+ private:
+    // State of the chunk currently being filled.
+    uint32_t chunk_chaining_value_[8];
+    uint8_t block_[BLAKE3_BLOCK_LENGTH];
+    size_t block_length_;
+    size_t blocks_compressed_;
+    uint64_t chunk_counter_;
+
+    // Chaining values of the completed subtrees, largest first.
+    uint32_t chaining_value_stack_[BLAKE3_MAXIMUM_TREE_DEPTH][8];
+    size_t chaining_value_stack_size_;
+
+    HashKernel kernel_;
+    Blake3HashManyFunction hash_many_;
+
+    size_t ChunkLength() const {
+        return blocks_compressed_ * BLAKE3_BLOCK_LENGTH + block_length_;
+    }
+
+    uint8_t ChunkStartFlag() const {
+        return blocks_compressed_ == 0 ? BLAKE3_CHUNK_START : 0;
+    }
+
+    void StartChunk(uint64_t chunkCounter);
+
+    void UpdateChunk(const uint8_t* input, size_t length);
+
+    void HashChunks(const uint8_t* input, size_t chunkCount);
+
+    void PushChainingValue(const uint32_t chainingValue[8],
+                           uint64_t totalSubtrees);
+};
+
+}   // namespace hashing
+}   // namespace common
+}   // namespace duplitrace
+
+#endif  // BLAKE3HASHER_H_
@@ -0,0 +1,109 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#ifndef BLAKE3KERNELS_H_
+#define BLAKE3KERNELS_H_
+#include <cstddef>
+#include <cstdint>
+#include "HashKernel.h"
+
+namespace duplitrace { namespace common { namespace hashing {
+
+const size_t BLAKE3_BLOCK_LENGTH = 64;
+const size_t BLAKE3_CHUNK_LENGTH = 1024;
+const size_t BLAKE3_BLOCKS_PER_CHUNK = BLAKE3_CHUNK_LENGTH /
+                                       BLAKE3_BLOCK_LENGTH;
+const size_t BLAKE3_OUTPUT_LENGTH = 32;
+const size_t BLAKE3_ROUNDS = 7;
+
+
+const uint8_t BLAKE3_CHUNK_START = 1 << 0;
+const uint8_t BLAKE3_CHUNK_END = 1 << 1;
+const uint8_t BLAKE3_PARENT = 1 << 2;
+const uint8_t BLAKE3_ROOT = 1 << 3;
+
+const uint32_t BLAKE3_IV[8] = {
+    0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A,
+    0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19
+};
+
+// Message word order for each round, the permutation applied repeatedly.
+const uint8_t BLAKE3_MESSAGE_SCHEDULE[BLAKE3_ROUNDS][16] = {
+    { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 },
+    { 2, 6, 3, 10, 7, 0, 4, 13, 1, 11, 12, 5, 9, 14, 15, 8 },
+    { 3, 4, 10, 12, 13, 2, 7, 14, 6, 5, 9, 0, 11, 15, 8, 1 },
+    { 10, 7, 12, 9, 14, 3, 13, 15, 4, 0, 11, 2, 5, 8, 1, 6 },
+    { 12, 13, 9, 11, 15, 10, 14, 8, 7, 2, 5, 3, 0, 1, 6, 4 },
+    { 9, 14, 11, 5, 8, 12, 15, 1, 13, 3, 0, 10, 2, 6, 4, 7 },
+    { 11, 15, 5, 0, 1, 9, 8, 6, 14, 10, 2, 12, 3, 4, 7, 13 },
+};
+
+// Hashes 'inputCount' consecutive inputs of 'blockCount' blocks each in
+// parallel, writing the 8 word chaining value of each input to 'output'.
+// Input i uses counter 'counter + i' if 'incrementCounter' is set, the first
+// and last blocks of each input also get 'startFlags' and 'endFlags'. Used
+// for both whole chunks and rows of parent nodes (a single block each).
+using Blake3HashManyFunction = void (*)(const uint8_t* input,
+                                        size_t inputCount,
+                                        size_t blockCount,
+                                        const uint32_t key[8],
+                                        uint64_t counter,
+                                        bool incrementCounter,
+                                        uint8_t flags,
+                                        uint8_t startFlags,
+                                        uint8_t endFlags,
+                                        uint32_t* output);
+
+void Blake3Compress(uint32_t chainingValue[8],
+                    const uint8_t block[BLAKE3_BLOCK_LENGTH],
+                    uint8_t blockLength, uint64_t counter, uint8_t flags);
+
+void Blake3HashManyScalar(const uint8_t* input, size_t inputCount,
+                          size_t blockCount, const uint32_t key[8],
+                          uint64_t counter, bool incrementCounter,
+                          uint8_t flags, uint8_t startFlags,
+                          uint8_t endFlags, uint32_t* output);
+
+#if defined(HASHING_X86_KERNELS)
+void Blake3HashManyAvx2(const uint8_t* input, size_t inputCount,
+                        size_t blockCount, const uint32_t key[8],
+                        uint64_t counter, bool incrementCounter,
+                        uint8_t flags, uint8_t startFlags,
+                        uint8_t endFlags, uint32_t* output);
+
+void Blake3HashManyAvx512(const uint8_t* input, size_t inputCount,
+                          size_t blockCount, const uint32_t key[8],
+                          uint64_t counter, bool incrementCounter,
+                          uint8_t flags, uint8_t startFlags,
+                          uint8_t endFlags, uint32_t* output);
+#endif
+
+#if defined(HASHING_NEON_KERNELS)
+void Blake3HashManyNeon(const uint8_t* input, size_t inputCount,
+                        size_t blockCount, const uint32_t key[8],
+                        uint64_t counter, bool incrementCounter,
+                        uint8_t flags, uint8_t startFlags,
+                        uint8_t endFlags, uint32_t* output);
+#endif
+
+}   // namespace hashing
+}   // namespace common
+}   // namespace duplitrace
+
+#endif  // BLAKE3KERNELS_H_
@@ -0,0 +1,175 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#include "Blake3Kernels.h"
+
+#if defined(HASHING_NEON_KERNELS)
+#include <arm_neon.h>
+
+namespace duplitrace { namespace common { namespace hashing {
+
+// NEON - 4 inputs at a time, one vector per state word with one input in
+// each lane.
+
+template <int BITS>
+static inline uint32x4_t RotateRightNeon(uint32x4_t value) {
+    return vsriq_n_u32(vshlq_n_u32(value, 32 - BITS), value, BITS);
+}
+
+static inline void MixNeon(uint32x4_t* state, size_t a, size_t b, size_t c,
+                           size_t d, uint32x4_t x, uint32x4_t y) {
+    state[a] = vaddq_u32(vaddq_u32(state[a], state[b]), x);
+    state[d] = RotateRightNeon<16>(veorq_u32(state[d], state[a]));
+    state[c] = vaddq_u32(state[c], state[d]);
+    state[b] = RotateRightNeon<12>(veorq_u32(state[b], state[c]));
+    state[a] = vaddq_u32(vaddq_u32(state[a], state[b]), y);
+    state[d] = RotateRightNeon<8>(veorq_u32(state[d], state[a]));
+    state[c] = vaddq_u32(state[c], state[d]);
+    state[b] = RotateRightNeon<7>(veorq_u32(state[b], state[c]));
+}
+
+// Transpose the 4x4 block of words held in 'vectors'.
+static inline void Transpose4x4Neon(uint32x4_t* vectors) {
+    uint32x4x2_t rows01 = vtrnq_u32(vectors[0], vectors[1]);
+    uint32x4x2_t rows23 = vtrnq_u32(vectors[2], vectors[3]);
+
+    vectors[0] = vcombine_u32(vget_low_u32(rows01.val[0]),
+                              vget_low_u32(rows23.val[0]));
+    vectors[1] = vcombine_u32(vget_low_u32(rows01.val[1]),
+                              vget_low_u32(rows23.val[1]));
+    vectors[2] = vcombine_u32(vget_high_u32(rows01.val[0]),
+                              vget_high_u32(rows23.val[0]));
+    vectors[3] = vcombine_u32(vget_high_u32(rows01.val[1]),
+                              vget_high_u32(rows23.val[1]));
+}
+
+static void HashFourNeon(const uint8_t* input, size_t blockCount,
+                         const uint32_t key[8], uint64_t counter,
+                         bool incrementCounter, uint8_t flags,
+                         uint8_t startFlags, uint8_t endFlags,
+                         uint32_t* output) {
+    uint32x4_t chainingValue[8];
+    for (size_t i = 0; i < 8; i++) {
+        chainingValue[i] = vdupq_n_u32(key[i]);
+    }
+
+    uint32_t counterLow[4];
+    uint32_t counterHigh[4];
+    for (size_t lane = 0; lane < 4; lane++) {
+        uint64_t laneCounter = incrementCounter ? counter + lane : counter;
+        counterLow[lane] = static_cast<uint32_t>(laneCounter);
+        counterHigh[lane] = static_cast<uint32_t>(laneCounter >> 32);
+    }
+
+    for (size_t block = 0; block < blockCount; block++) {
+        // message[4 * quarter + lane] is loaded as words 4 * quarter ..
+        // 4 * quarter + 3 of an input, then transposed per quarter.
+        uint32x4_t message[16];
+        for (size_t lane = 0; lane < 4; lane++) {
+            const uint8_t* data = input +
+                (lane * blockCount + block) * BLAKE3_BLOCK_LENGTH;
+            for (size_t quarter = 0; quarter < 4; quarter++) {
+                message[4 * quarter + lane] = vreinterpretq_u32_u8(
+                    vld1q_u8(data + 16 * quarter));
+            }
+        }
+        for (size_t quarter = 0; quarter < 4; quarter++) {
+            Transpose4x4Neon(message + 4 * quarter);
+        }
+
+        uint8_t blockFlags = flags;
+        if (block == 0) {
+            blockFlags |= startFlags;
+        }
+        if (block == blockCount - 1) {
+            blockFlags |= endFlags;
+        }
+
+        uint32x4_t state[16] = {
+            chainingValue[0], chainingValue[1], chainingValue[2],
+            chainingValue[3], chainingValue[4], chainingValue[5],
+            chainingValue[6], chainingValue[7],
+            vdupq_n_u32(BLAKE3_IV[0]), vdupq_n_u32(BLAKE3_IV[1]),
+            vdupq_n_u32(BLAKE3_IV[2]), vdupq_n_u32(BLAKE3_IV[3]),
+            vld1q_u32(counterLow), vld1q_u32(counterHigh),
+            vdupq_n_u32(BLAKE3_BLOCK_LENGTH), vdupq_n_u32(blockFlags)
+        };
+
+        for (size_t round = 0; round < BLAKE3_ROUNDS; round++) {
+            const uint8_t* schedule = BLAKE3_MESSAGE_SCHEDULE[round];
+
+            MixNeon(state, 0, 4, 8, 12, message[schedule[0]],
+                    message[schedule[1]]);
+            MixNeon(state, 1, 5, 9, 13, message[schedule[2]],
+                    message[schedule[3]]);
+            MixNeon(state, 2, 6, 10, 14, message[schedule[4]],
+                    message[schedule[5]]);
+            MixNeon(state, 3, 7, 11, 15, message[schedule[6]],
+                    message[schedule[7]]);
+            MixNeon(state, 0, 5, 10, 15, message[schedule[8]],
+                    message[schedule[9]]);
+            MixNeon(state, 1, 6, 11, 12, message[schedule[10]],
+                    message[schedule[11]]);
+            MixNeon(state, 2, 7, 8, 13, message[schedule[12]],
+                    message[schedule[13]]);
+            MixNeon(state, 3, 4, 9, 14, message[schedule[14]],
+                    message[schedule[15]]);
+        }
+
+        for (size_t i = 0; i < 8; i++) {
+            chainingValue[i] = veorq_u32(state[i], state[i + 8]);
+        }
+    }
+
+    // Back from one vector per word to one vector per input.
+    Transpose4x4Neon(chainingValue);
+    Transpose4x4Neon(chainingValue + 4);
+    for (size_t lane = 0; lane < 4; lane++) {
+        vst1q_u32(output + lane * 8, chainingValue[lane]);
+        vst1q_u32(output + lane * 8 + 4, chainingValue[4 + lane]);
+    }
+}
+
+void Blake3HashManyNeon(const uint8_t* input, size_t inputCount,
+                        size_t blockCount, const uint32_t key[8],
+                        uint64_t counter, bool incrementCounter,
+                        uint8_t flags, uint8_t startFlags,
+                        uint8_t endFlags, uint32_t* output) {
+    size_t stride = blockCount * BLAKE3_BLOCK_LENGTH;
+
+    while (inputCount >= 4) {
+        HashFourNeon(input, blockCount, key, counter, incrementCounter, flags,
+                     startFlags, endFlags, output);
+        input += 4 * stride;
+        inputCount -= 4;
+        if (incrementCounter) {
+            counter += 4;
+        }
+        output += 4 * 8;
+    }
+
+    Blake3HashManyScalar(input, inputCount, blockCount, key, counter,
+                         incrementCounter, flags, startFlags, endFlags, output);
+}
+
+}   // namespace hashing
+}   // namespace common
+}   // namespace duplitrace
+
+#endif  // HASHING_NEON_KERNELS
@@ -0,0 +1,420 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#include <cstring>
+#include "Blake3Kernels.h"
+
+#if defined(HASHING_X86_KERNELS)
+#include <immintrin.h>
+
+namespace duplitrace { namespace common { namespace hashing {
+
+// Both kernels keep one vector per state word, with one input in each lane,
+// so the message blocks are transposed on load. A partial group that would
+// fill more than half of the lanes is copied to a scratch buffer and hashed
+// at full width, which beats falling back to a narrower kernel.
+
+// ---------------------------------------------------------------------------
+// AVX2 - 8 inputs at a time.
+// ---------------------------------------------------------------------------
+
+HASHING_TARGET_AVX2
+static inline __m256i RotateRight16Avx2(__m256i value) {
+    return _mm256_shuffle_epi8(value, _mm256_set_epi8(
+        13, 12, 15, 14, 9, 8, 11, 10, 5, 4, 7, 6, 1, 0, 3, 2,
+        13, 12, 15, 14, 9, 8, 11, 10, 5, 4, 7, 6, 1, 0, 3, 2));
+}
+
+HASHING_TARGET_AVX2
+static inline __m256i RotateRight12Avx2(__m256i value) {
+    return _mm256_or_si256(_mm256_srli_epi32(value, 12),
+                           _mm256_slli_epi32(value, 20));
+}
+
+HASHING_TARGET_AVX2
+static inline __m256i RotateRight8Avx2(__m256i value) {
+    return _mm256_shuffle_epi8(value, _mm256_set_epi8(
+        12, 15, 14, 13, 8, 11, 10, 9, 4, 7, 6, 5, 0, 3, 2, 1,
+        12, 15, 14, 13, 8, 11, 10, 9, 4, 7, 6, 5, 0, 3, 2, 1));
+}
+
+HASHING_TARGET_AVX2
+static inline __m256i RotateRight7Avx2(__m256i value) {
+    return _mm256_or_si256(_mm256_srli_epi32(value, 7),
+                           _mm256_slli_epi32(value, 25));
+}
+
+HASHING_TARGET_AVX2
+static inline void MixAvx2(__m256i* state, size_t a, size_t b, size_t c,
+                           size_t d, __m256i x, __m256i y) {
+    state[a] = _mm256_add_epi32(_mm256_add_epi32(state[a], state[b]), x);
+    state[d] = RotateRight16Avx2(_mm256_xor_si256(state[d], state[a]));
+    state[c] = _mm256_add_epi32(state[c], state[d]);
+    state[b] = RotateRight12Avx2(_mm256_xor_si256(state[b], state[c]));
+    state[a] = _mm256_add_epi32(_mm256_add_epi32(state[a], state[b]), y);
+    state[d] = RotateRight8Avx2(_mm256_xor_si256(state[d], state[a]));
+    state[c] = _mm256_add_epi32(state[c], state[d]);
+    state[b] = RotateRight7Avx2(_mm256_xor_si256(state[b], state[c]));
+}
+
+HASHING_TARGET_AVX2
+static inline void Transpose8x8Avx2(__m256i* vectors) {
+    __m256i ab0145 = _mm256_unpacklo_epi32(vectors[0], vectors[1]);
+    __m256i ab2367 = _mm256_unpackhi_epi32(vectors[0], vectors[1]);
+    __m256i cd0145 = _mm256_unpacklo_epi32(vectors[2], vectors[3]);
+    __m256i cd2367 = _mm256_unpackhi_epi32(vectors[2], vectors[3]);
+    __m256i ef0145 = _mm256_unpacklo_epi32(vectors[4], vectors[5]);
+    __m256i ef2367 = _mm256_unpackhi_epi32(vectors[4], vectors[5]);
+    __m256i gh0145 = _mm256_unpacklo_epi32(vectors[6], vectors[7]);
+    __m256i gh2367 = _mm256_unpackhi_epi32(vectors[6], vectors[7]);
+
+    __m256i abcd04 = _mm256_unpacklo_epi64(ab0145, cd0145);
+    __m256i abcd15 = _mm256_unpackhi_epi64(ab0145, cd0145);
+    __m256i abcd26 = _mm256_unpacklo_epi64(ab2367, cd2367);
+    __m256i abcd37 = _mm256_unpackhi_epi64(ab2367, cd2367);
+    __m256i efgh04 = _mm256_unpacklo_epi64(ef0145, gh0145);
+    __m256i efgh15 = _mm256_unpackhi_epi64(ef0145, gh0145);
+    __m256i efgh26 = _mm256_unpacklo_epi64(ef2367, gh2367);
+    __m256i efgh37 = _mm256_unpackhi_epi64(ef2367, gh2367);
+
+    vectors[0] = _mm256_permute2x128_si256(abcd04, efgh04, 0x20);
+    vectors[1] = _mm256_permute2x128_si256(abcd15, efgh15, 0x20);
+    vectors[2] = _mm256_permute2x128_si256(abcd26, efgh26, 0x20);
+    vectors[3] = _mm256_permute2x128_si256(abcd37, efgh37, 0x20);
+    vectors[4] = _mm256_permute2x128_si256(abcd04, efgh04, 0x31);
+    vectors[5] = _mm256_permute2x128_si256(abcd15, efgh15, 0x31);
+    vectors[6] = _mm256_permute2x128_si256(abcd26, efgh26, 0x31);
+    vectors[7] = _mm256_permute2x128_si256(abcd37, efgh37, 0x31);
+}
+
+HASHING_TARGET_AVX2
+static void HashEightAvx2(const uint8_t* input, size_t blockCount,
+                          const uint32_t key[8], uint64_t counter,
+                          bool incrementCounter, uint8_t flags,
+                          uint8_t startFlags, uint8_t endFlags,
+                          uint32_t* output) {
+    __m256i chainingValue[8];
+    for (size_t i = 0; i < 8; i++) {
+        chainingValue[i] = _mm256_set1_epi32(static_cast<int>(key[i]));
+    }
+
+    alignas(32) uint32_t counterLow[8];
+    alignas(32) uint32_t counterHigh[8];
+    for (size_t lane = 0; lane < 8; lane++) {
+        uint64_t laneCounter = incrementCounter ? counter + lane : counter;
+        counterLow[lane] = static_cast<uint32_t>(laneCounter);
+        counterHigh[lane] = static_cast<uint32_t>(laneCounter >> 32);
+    }
+
+    for (size_t block = 0; block < blockCount; block++) {
+        __m256i message[16];
+        for (size_t lane = 0; lane < 8; lane++) {
+            const uint8_t* data = input +
+                (lane * blockCount + block) * BLAKE3_BLOCK_LENGTH;
+            message[lane] = _mm256_loadu_si256(
+                reinterpret_cast<const __m256i*>(data));
+            message[lane + 8] = _mm256_loadu_si256(
+                reinterpret_cast<const __m256i*>(data + 32));
+        }
+        Transpose8x8Avx2(message);
+        Transpose8x8Avx2(message + 8);
+
+        uint8_t blockFlags = flags;
+        if (block == 0) {
+            blockFlags |= startFlags;
+        }
+        if (block == blockCount - 1) {
+            blockFlags |= endFlags;
+        }
+
+        __m256i state[16] = {
+            chainingValue[0], chainingValue[1], chainingValue[2],
+            chainingValue[3], chainingValue[4], chainingValue[5],
+            chainingValue[6], chainingValue[7],
+            _mm256_set1_epi32(static_cast<int>(BLAKE3_IV[0])),
+            _mm256_set1_epi32(static_cast<int>(BLAKE3_IV[1])),
+            _mm256_set1_epi32(static_cast<int>(BLAKE3_IV[2])),
+            _mm256_set1_epi32(static_cast<int>(BLAKE3_IV[3])),
+            _mm256_load_si256(reinterpret_cast<const __m256i*>(counterLow)),
+            _mm256_load_si256(reinterpret_cast<const __m256i*>(counterHigh)),
+            _mm256_set1_epi32(static_cast<int>(BLAKE3_BLOCK_LENGTH)),
+            _mm256_set1_epi32(blockFlags)
+        };
+
+        for (size_t round = 0; round < BLAKE3_ROUNDS; round++) {
+            const uint8_t* schedule = BLAKE3_MESSAGE_SCHEDULE[round];
+
+            MixAvx2(state, 0, 4, 8, 12, message[schedule[0]],
+                    message[schedule[1]]);
+            MixAvx2(state, 1, 5, 9, 13, message[schedule[2]],
+                    message[schedule[3]]);
+            MixAvx2(state, 2, 6, 10, 14, message[schedule[4]],
+                    message[schedule[5]]);
+            MixAvx2(state, 3, 7, 11, 15, message[schedule[6]],
+                    message[schedule[7]]);
+            MixAvx2(state, 0, 5, 10, 15, message[schedule[8]],
+                    message[schedule[9]]);
+            MixAvx2(state, 1, 6, 11, 12, message[schedule[10]],
+                    message[schedule[11]]);
+            MixAvx2(state, 2, 7, 8, 13, message[schedule[12]],
+                    message[schedule[13]]);
+            MixAvx2(state, 3, 4, 9, 14, message[schedule[14]],
+                    message[schedule[15]]);
+        }
+
+        for (size_t i = 0; i < 8; i++) {
+            chainingValue[i] = _mm256_xor_si256(state[i], state[i + 8]);
+        }
+    }
+
+    // Back from one vector per word to one vector per input.
+    Transpose8x8Avx2(chainingValue);
+    for (size_t lane = 0; lane < 8; lane++) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(output + lane * 8),
+                            chainingValue[lane]);
+    }
+}
+
+void Blake3HashManyAvx2(const uint8_t* input, size_t inputCount,
+                        size_t blockCount, const uint32_t key[8],
+                        uint64_t counter, bool incrementCounter,
+                        uint8_t flags, uint8_t startFlags,
+                        uint8_t endFlags, uint32_t* output) {
+    size_t stride = blockCount * BLAKE3_BLOCK_LENGTH;
+
+    while (inputCount >= 8) {
+        HashEightAvx2(input, blockCount, key, counter, incrementCounter,
+                      flags, startFlags, endFlags, output);
+        input += 8 * stride;
+        inputCount -= 8;
+        if (incrementCounter) {
+            counter += 8;
+        }
+        output += 8 * 8;
+    }
+
+    if (inputCount > 4) {
+        alignas(32) uint8_t scratch[8 * BLAKE3_CHUNK_LENGTH] = {};
+        uint32_t chainingValues[8 * 8];
+
+        std::memcpy(scratch, input, inputCount * stride);
+        HashEightAvx2(scratch, blockCount, key, counter, incrementCounter,
+                      flags, startFlags, endFlags, chainingValues);
+        std::memcpy(output, chainingValues,
+                    inputCount * 8 * sizeof(uint32_t));
+        return;
+    }
+
+    Blake3HashManyScalar(input, inputCount, blockCount, key, counter,
+                         incrementCounter, flags, startFlags, endFlags, output);
+}
+
+// ---------------------------------------------------------------------------
+// AVX-512 - 16 inputs at a time.
+// ---------------------------------------------------------------------------
+
+// GCC 12 reports the deliberately undefined pass-through operand of the
+// AVX-512 intrinsics as uninitialised.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+HASHING_TARGET_AVX512
+static inline void MixAvx512(__m512i* state, size_t a, size_t b, size_t c,
+                             size_t d, __m512i x, __m512i y) {
+    state[a] = _mm512_add_epi32(_mm512_add_epi32(state[a], state[b]), x);
+    state[d] = _mm512_ror_epi32(_mm512_xor_si512(state[d], state[a]), 16);
+    state[c] = _mm512_add_epi32(state[c], state[d]);
+    state[b] = _mm512_ror_epi32(_mm512_xor_si512(state[b], state[c]), 12);
+    state[a] = _mm512_add_epi32(_mm512_add_epi32(state[a], state[b]), y);
+    state[d] = _mm512_ror_epi32(_mm512_xor_si512(state[d], state[a]), 8);
+    state[c] = _mm512_add_epi32(state[c], state[d]);
+    state[b] = _mm512_ror_epi32(_mm512_xor_si512(state[b], state[c]), 7);
+}
+
+// Transpose a 16x16 matrix of 32 bit words: interleave words, then pairs of
+// words, then swap 128 bit lanes twice.
+HASHING_TARGET_AVX512
+static inline void Transpose16x16Avx512(__m512i* vectors) {
+    __m512i pairs[16];
+    for (size_t i = 0; i < 16; i += 2) {
+        pairs[i] = _mm512_unpacklo_epi32(vectors[i], vectors[i + 1]);
+        pairs[i + 1] = _mm512_unpackhi_epi32(vectors[i], vectors[i + 1]);
+    }
+
+    // quads[4 * group + j] holds word (4 * lane128 + j) of rows
+    // 4 * group .. 4 * group + 3 in each 128 bit lane.
+    __m512i quads[16];
+    for (size_t group = 0; group < 4; group++) {
+        const __m512i* source = pairs + 4 * group;
+        quads[4 * group + 0] = _mm512_unpacklo_epi64(source[0], source[2]);
+        quads[4 * group + 1] = _mm512_unpackhi_epi64(source[0], source[2]);
+        quads[4 * group + 2] = _mm512_unpacklo_epi64(source[1], source[3]);
+        quads[4 * group + 3] = _mm512_unpackhi_epi64(source[1], source[3]);
+    }
+
+    for (size_t j = 0; j < 4; j++) {
+        __m512i low01 = _mm512_shuffle_i32x4(quads[j], quads[4 + j], 0x44);
+        __m512i high01 = _mm512_shuffle_i32x4(quads[j], quads[4 + j], 0xEE);
+        __m512i low23 = _mm512_shuffle_i32x4(quads[8 + j], quads[12 + j],
+                                             0x44);
+        __m512i high23 = _mm512_shuffle_i32x4(quads[8 + j], quads[12 + j],
+                                              0xEE);
+
+        vectors[j] = _mm512_shuffle_i32x4(low01, low23, 0x88);
+        vectors[4 + j] = _mm512_shuffle_i32x4(low01, low23, 0xDD);
+        vectors[8 + j] = _mm512_shuffle_i32x4(high01, high23, 0x88);
+        vectors[12 + j] = _mm512_shuffle_i32x4(high01, high23, 0xDD);
+    }
+}
+
+HASHING_TARGET_AVX512
+static void HashSixteenAvx512(const uint8_t* input, size_t blockCount,
+                              const uint32_t key[8], uint64_t counter,
+                              bool incrementCounter, uint8_t flags,
+                              uint8_t startFlags, uint8_t endFlags,
+                              uint32_t* output) {
+    __m512i chainingValue[8];
+    for (size_t i = 0; i < 8; i++) {
+        chainingValue[i] = _mm512_set1_epi32(static_cast<int>(key[i]));
+    }
+
+    alignas(64) uint32_t counterLow[16];
+    alignas(64) uint32_t counterHigh[16];
+    for (size_t lane = 0; lane < 16; lane++) {
+        uint64_t laneCounter = incrementCounter ? counter + lane : counter;
+        counterLow[lane] = static_cast<uint32_t>(laneCounter);
+        counterHigh[lane] = static_cast<uint32_t>(laneCounter >> 32);
+    }
+
+    for (size_t block = 0; block < blockCount; block++) {
+        __m512i message[16];
+        for (size_t lane = 0; lane < 16; lane++) {
+            message[lane] = _mm512_loadu_si512(
+                input + (lane * blockCount + block) * BLAKE3_BLOCK_LENGTH);
+        }
+        Transpose16x16Avx512(message);
+
+        uint8_t blockFlags = flags;
+        if (block == 0) {
+            blockFlags |= startFlags;
+        }
+        if (block == blockCount - 1) {
+            blockFlags |= endFlags;
+        }
+
+        __m512i state[16] = {
+            chainingValue[0], chainingValue[1], chainingValue[2],
+            chainingValue[3], chainingValue[4], chainingValue[5],
+            chainingValue[6], chainingValue[7],
+            _mm512_set1_epi32(static_cast<int>(BLAKE3_IV[0])),
+            _mm512_set1_epi32(static_cast<int>(BLAKE3_IV[1])),
+            _mm512_set1_epi32(static_cast<int>(BLAKE3_IV[2])),
+            _mm512_set1_epi32(static_cast<int>(BLAKE3_IV[3])),
+            _mm512_load_si512(counterLow),
+            _mm512_load_si512(counterHigh),
+            _mm512_set1_epi32(static_cast<int>(BLAKE3_BLOCK_LENGTH)),
+            _mm512_set1_epi32(blockFlags)
+        };
+
+        for (size_t round = 0; round < BLAKE3_ROUNDS; round++) {
+            const uint8_t* schedule = BLAKE3_MESSAGE_SCHEDULE[round];
+
+            MixAvx512(state, 0, 4, 8, 12, message[schedule[0]],
+                      message[schedule[1]]);
+            MixAvx512(state, 1, 5, 9, 13, message[schedule[2]],
+                      message[schedule[3]]);
+            MixAvx512(state, 2, 6, 10, 14, message[schedule[4]],
+                      message[schedule[5]]);
+            MixAvx512(state, 3, 7, 11, 15, message[schedule[6]],
+                      message[schedule[7]]);
+            MixAvx512(state, 0, 5, 10, 15, message[schedule[8]],
+                      message[schedule[9]]);
+            MixAvx512(state, 1, 6, 11, 12, message[schedule[10]],
+                      message[schedule[11]]);
+            MixAvx512(state, 2, 7, 8, 13, message[schedule[12]],
+                      message[schedule[13]]);
+            MixAvx512(state, 3, 4, 9, 14, message[schedule[14]],
+                      message[schedule[15]]);
+        }
+
+        for (size_t i = 0; i < 8; i++) {
+            chainingValue[i] = _mm512_xor_si512(state[i], state[i + 8]);
+        }
+    }
+
+    // Only 8 words per input, so the output is written out word by word.
+    alignas(64) uint32_t words[8][16];
+    for (size_t i = 0; i < 8; i++) {
+        _mm512_store_si512(words[i], chainingValue[i]);
+    }
+    for (size_t lane = 0; lane < 16; lane++) {
+        for (size_t i = 0; i < 8; i++) {
+            output[lane * 8 + i] = words[i][lane];
+        }
+    }
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+void Blake3HashManyAvx512(const uint8_t* input, size_t inputCount,
+                          size_t blockCount, const uint32_t key[8],
+                          uint64_t counter, bool incrementCounter,
+                          uint8_t flags, uint8_t startFlags,
+                          uint8_t endFlags, uint32_t* output) {
+    size_t stride = blockCount * BLAKE3_BLOCK_LENGTH;
+
+    while (inputCount >= 16) {
+        HashSixteenAvx512(input, blockCount, key, counter,
+                          incrementCounter, flags, startFlags, endFlags,
+                          output);
+        input += 16 * stride;
+        inputCount -= 16;
+        if (incrementCounter) {
+            counter += 16;
+        }
+        output += 16 * 8;
+    }
+
+    if (inputCount > 8) {
+        alignas(64) uint8_t scratch[16 * BLAKE3_CHUNK_LENGTH] = {};
+        uint32_t chainingValues[16 * 8];
+
+        std::memcpy(scratch, input, inputCount * stride);
+        HashSixteenAvx512(scratch, blockCount, key, counter,
+                          incrementCounter, flags, startFlags, endFlags,
+                          chainingValues);
+        std::memcpy(output, chainingValues,
+                    inputCount * 8 * sizeof(uint32_t));
+        return;
+    }
+
+    Blake3HashManyAvx2(input, inputCount, blockCount, key, counter,
+                       incrementCounter, flags, startFlags, endFlags, output);
+}
+
+}   // namespace hashing
+}   // namespace common
+}   // namespace duplitrace
+
+#endif  // HASHING_X86_KERNELS
@@ -0,0 +1,143 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#include "HashKernel.h"
+
+#if defined(HASHING_X86_KERNELS) && defined(_MSC_VER)
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
+namespace duplitrace { namespace common { namespace hashing {
+
+struct CpuFeatures {
+    bool avx2 = false;
+    bool avx512 = false;
+    bool neon = false;
+};
+
+static CpuFeatures DetectCpuFeatures() {
+    CpuFeatures features;
+
+#if defined(HASHING_X86_KERNELS)
+#if defined(_MSC_VER)
+    int registers[4];
+
+    __cpuid(registers, 0);
+    int maximumLeaf = registers[0];
+
+    __cpuid(registers, 1);
+    bool osxsave = (registers[2] & (1 << 27)) != 0;
+
+    if (maximumLeaf >= 7 && osxsave) {
+        // The OS must save the YMM (and for AVX-512 the ZMM/opmask) state
+        // on a context switch, otherwise the instructions fault.
+        unsigned __int64 xcr0 = _xgetbv(0);
+        bool ymmState = (xcr0 & 0x6) == 0x6;
+        bool zmmState = (xcr0 & 0xE6) == 0xE6;
+
+        __cpuidex(registers, 7, 0);
+        features.avx2 = ymmState && (registers[1] & (1 << 5)) != 0;
+        features.avx512 = zmmState && (registers[1] & (1 << 16)) != 0 &&
+                          (registers[1] & (1 << 31)) != 0;
+    }
+#else
+    // Also checks that the OS has enabled the extended register state.
+    __builtin_cpu_init();
+    features.avx2 = __builtin_cpu_supports("avx2");
+    features.avx512 = __builtin_cpu_supports("avx512f") &&
+                      __builtin_cpu_supports("avx512vl");
+#endif
+#endif
+
+#if defined(HASHING_NEON_KERNELS)
+    // Advanced SIMD is mandatory on AArch64.
+    features.neon = true;
+#endif
+
+    return features;
+}
+
+static const CpuFeatures& GetCpuFeatures() {
+    static const CpuFeatures features = DetectCpuFeatures();
+    return features;
+}
+
+bool HashKernelSupported(HashKernel kernel) {
+    const CpuFeatures& features = GetCpuFeatures();
+
+    switch (kernel) {
+        case HashKernel::SCALAR:
+            return true;
+
+        case HashKernel::NEON:
+            return features.neon;
+
+        case HashKernel::AVX2:
+            return features.avx2;
+
+        case HashKernel::AVX512:
+            return features.avx512;
+    }
+
+    return false;
+}
+
+/*
+Get the fastest kernel supported by this machine, the CPU is only queried on
+first use.
+
+returns:
+    Fastest supported kernel, SCALAR if no vector extensions are available.
+*/
+HashKernel BestHashKernel() {
+    static const HashKernel best = [] {
+        for (HashKernel kernel : { HashKernel::AVX512, HashKernel::AVX2,
+                                   HashKernel::NEON }) {
+            if (HashKernelSupported(kernel)) {
+                return kernel;
+            }
+        }
+        return HashKernel::SCALAR;
+    }();
+
+    return best;
+}
+
+std::string HashKernelName(HashKernel kernel) {
+    switch (kernel) {
+        case HashKernel::SCALAR:
+            return "scalar";
+
+        case HashKernel::NEON:
+            return "neon";
+
+        case HashKernel::AVX2:
+            return "avx2";
+
+        case HashKernel::AVX512:
+            return "avx512";
+    }
+
+    return "unknown";
+}
+
+}   // namespace hashing
+}   // namespace common
+}   // namespace duplitrace
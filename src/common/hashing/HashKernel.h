@@ -0,0 +1,63 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#ifndef HASHKERNEL_H_
+#define HASHKERNEL_H_
+#include <string>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#  define HASHING_X86_KERNELS 1
+#endif
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+#  define HASHING_NEON_KERNELS 1
+#endif
+
+// GCC and Clang only allow vector intrinsics inside functions that are
+// compiled for the matching instruction set, so each SIMD kernel is tagged
+// with its target rather than building the whole project with -mavx2.
+#if defined(__GNUC__) || defined(__clang__)
+#  define HASHING_TARGET_AVX2 __attribute__((target("avx2")))
+#  define HASHING_TARGET_AVX512 __attribute__((target("avx512f,avx512vl")))
+#else
+#  define HASHING_TARGET_AVX2
+#  define HASHING_TARGET_AVX512
+#endif
+
+namespace duplitrace { namespace common { namespace hashing {
+
+// Instruction set used by the hash back-ends, in order of preference.
+enum class HashKernel {
+    SCALAR,
+    NEON,
+    AVX2,
+    AVX512
+};
+
+bool HashKernelSupported(HashKernel kernel);
+
+HashKernel BestHashKernel();
+
+std::string HashKernelName(HashKernel kernel);
+
+}   // namespace hashing
+}   // namespace common
+}   // namespace duplitrace
+
+#endif  // HASHKERNEL_H_
@@ -0,0 +1,108 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#include "Hasher.h"
+#include "Blake3Hasher.h"
+#include "Xxh3Hasher.h"
+
+namespace duplitrace { namespace common { namespace hashing {
+
+std::string HashDigest::ToHexString() const {
+    static const char HEX_DIGITS[] = "0123456789abcdef";
+    std::string hex;
+
+    hex.reserve(size * 2);
+    for (size_t i = 0; i < size; i++) {
+        hex += HEX_DIGITS[bytes[i] >> 4];
+        hex += HEX_DIGITS[bytes[i] & 0x0F];
+    }
+
+    return hex;
+}
+
+/*
+Create a hasher for an algorithm. If the requested kernel is not supported
+by this machine the hasher falls back to the best kernel that is.
+
+returns:
+    New hasher, ready to accept data.
+*/
+std::unique_ptr<Hasher> CreateHasher(HashAlgorithm algorithm,
+                                     HashKernel kernel) {
+    if (!HashKernelSupported(kernel)) {
+        kernel = BestHashKernel();
+    }
+
+    switch (algorithm) {
+        case HashAlgorithm::XXH3:
+            return std::make_unique<Xxh3Hasher>(kernel);
+
+        case HashAlgorithm::BLAKE3:
+            return std::make_unique<Blake3Hasher>(kernel);
+    }
+
+    return nullptr;
+}
+
+std::string HashAlgorithmName(HashAlgorithm algorithm) {
+    switch (algorithm) {
+        case HashAlgorithm::XXH3:
+            return "XXH3";
+
+        case HashAlgorithm::BLAKE3:
+            return "BLAKE3";
+    }
+
+    return "unknown";
+}
+
+/*
+Look up an algorithm by its name, as used in the configuration file.
+
+returns:
+    True if the name is a known algorithm.
+*/
+bool HashAlgorithmFromName(std::string_view name, HashAlgorithm* algorithm) {
+    for (HashAlgorithm candidate : { HashAlgorithm::XXH3,
+                                     HashAlgorithm::BLAKE3 }) {
+        if (HashAlgorithmName(candidate) == name) {
+            *algorithm = candidate;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Number of bytes in a digest produced by an algorithm.
+size_t HashDigestSize(HashAlgorithm algorithm) {
+    switch (algorithm) {
+        case HashAlgorithm::XXH3:
+            return sizeof(uint64_t);
+
+        case HashAlgorithm::BLAKE3:
+            return BLAKE3_OUTPUT_LENGTH;
+    }
+
+    return 0;
+}
+
+}   // namespace hashing
+}   // namespace common
+}   // namespace duplitrace
@@ -0,0 +1,99 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#ifndef HASHER_H_
+#define HASHER_H_
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include "HashKernel.h"
+
+namespace duplitrace { namespace common { namespace hashing {
+
+enum class HashAlgorithm {
+    // 64 bit non-cryptographic hash.
+    XXH3,
+
+    // 256 bit cryptographic hash.
+    BLAKE3
+};
+
+const size_t HASH_DIGEST_MAXIMUM_SIZE = 32;
+
+// Digest of any of the supported algorithms, the unused tail is zeroed so
+// digests can be compared and hashed without knowing the algorithm.
+struct HashDigest {
+    std::array<uint8_t, HASH_DIGEST_MAXIMUM_SIZE> bytes{};
+    size_t size = 0;
+
+    bool operator==(const HashDigest& other) const {
+        return size == other.size && bytes == other.bytes;
+    }
+
+    bool operator!=(const HashDigest& other) const {
+        return !(*this == other);
+    }
+
+    std::string ToHexString() const;
+};
+
+// Allows a HashDigest to be used as an unordered container key, digests are
+// already uniformly distributed so the leading bytes are used as-is.
+struct HashDigestHasher {
+    size_t operator()(const HashDigest& digest) const {
+        size_t value;
+        std::memcpy(&value, digest.bytes.data(), sizeof(value));
+        return value;
+    }
+};
+
+// Streaming hash, Update() may be called any number of times before
+// Finalise(). Call Reset() to reuse the hasher for another input.
+class Hasher {
+ public:
+    virtual ~Hasher() = default;
+
+    virtual HashAlgorithm Algorithm() const = 0;
+
+    virtual HashKernel Kernel() const = 0;
+
+    virtual void Reset() = 0;
+
+    virtual void Update(const void* data, size_t length) = 0;
+
+    virtual HashDigest Finalise() = 0;
+};
+
+std::unique_ptr<Hasher> CreateHasher(HashAlgorithm algorithm,
+                                     HashKernel kernel = BestHashKernel());
+
+std::string HashAlgorithmName(HashAlgorithm algorithm);
+
+bool HashAlgorithmFromName(std::string_view name, HashAlgorithm* algorithm);
+
+size_t HashDigestSize(HashAlgorithm algorithm);
+
+}   // namespace hashing
+}   // namespace common
+}   // namespace duplitrace
+
+#endif  // HASHER_H_
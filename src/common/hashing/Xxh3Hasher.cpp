@@ -0,0 +1,561 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#include <algorithm>
+#include <cstring>
+#include "Xxh3Hasher.h"
+
+#if defined(HASHING_X86_KERNELS)
+#include <immintrin.h>
+#endif
+
+#if defined(_MSC_VER) && defined(HASHING_X86_KERNELS)
+#include <intrin.h>
+#endif
+
+namespace duplitrace { namespace common { namespace hashing {
+
+const uint32_t XXH_PRIME32_1 = 0x9E3779B1U;
+const uint32_t XXH_PRIME32_2 = 0x85EBCA77U;
+const uint32_t XXH_PRIME32_3 = 0xC2B2AE3DU;
+
+const uint64_t XXH_PRIME64_1 = 0x9E3779B185EBCA87ULL;
+const uint64_t XXH_PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+const uint64_t XXH_PRIME64_3 = 0x165667B19E3779F9ULL;
+const uint64_t XXH_PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+const uint64_t XXH_PRIME64_5 = 0x27D4EB2F165667C5ULL;
+
+const uint64_t XXH_PRIME_MX1 = 0x165667919E3779F9ULL;
+const uint64_t XXH_PRIME_MX2 = 0x9FB21C651E98DF25ULL;
+
+const size_t XXH3_SECRET_CONSUME_RATE = 8;
+const size_t XXH3_MIDSIZE_MAXIMUM = 240;
+const size_t XXH3_MIDSIZE_START_OFFSET = 3;
+const size_t XXH3_MIDSIZE_LAST_OFFSET = 17;
+const size_t XXH3_SECRET_SIZE_MINIMUM = 136;
+const size_t XXH3_SECRET_LAST_ACCUMULATE_START = 7;
+const size_t XXH3_SECRET_MERGE_ACCUMULATORS_START = 11;
+const size_t XXH3_BUFFER_STRIPES = XXH3_BUFFER_SIZE / XXH3_STRIPE_LENGTH;
+const size_t XXH3_SECRET_LIMIT = XXH3_SECRET_SIZE - XXH3_STRIPE_LENGTH;
+const size_t XXH3_STRIPES_PER_BLOCK = XXH3_SECRET_LIMIT /
+                                      XXH3_SECRET_CONSUME_RATE;
+
+alignas(64) static const uint8_t XXH3_DEFAULT_SECRET[XXH3_SECRET_SIZE] = {
+    0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe,
+    0x7c, 0x01, 0x81, 0x2c, 0xf7, 0x21, 0xad, 0x1c,
+    0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb,
+    0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f,
+    0xcb, 0x79, 0xe6, 0x4e, 0xcc, 0xc0, 0xe5, 0x78,
+    0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+    0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e,
+    0xe0, 0x35, 0x90, 0xe6, 0x81, 0x3a, 0x26, 0x4c,
+    0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb,
+    0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3,
+    0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e,
+    0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+    0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f,
+    0xf9, 0xdc, 0xbb, 0xc7, 0xc7, 0x0b, 0x4f, 0x1d,
+    0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31,
+    0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64,
+    0xea, 0xc5, 0xac, 0x83, 0x34, 0xd3, 0xeb, 0xc3,
+    0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+    0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49,
+    0xd3, 0x16, 0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e,
+    0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc,
+    0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce,
+    0x45, 0xcb, 0x3a, 0x8f, 0x95, 0x16, 0x04, 0x28,
+    0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+};
+
+// The hash is defined on little endian words, every supported target is
+// little endian so plain unaligned loads are used.
+static inline uint32_t ReadLE32(const uint8_t* data) {
+    uint32_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+static inline uint64_t ReadLE64(const uint8_t* data) {
+    uint64_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+static inline uint64_t RotateLeft64(uint64_t value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+static inline uint32_t ByteSwap32(uint32_t value) {
+    return ((value << 24) & 0xFF000000U) | ((value << 8) & 0x00FF0000U) |
+           ((value >> 8) & 0x0000FF00U) | ((value >> 24) & 0x000000FFU);
+}
+
+static inline uint64_t ByteSwap64(uint64_t value) {
+    return (static_cast<uint64_t>(ByteSwap32(static_cast<uint32_t>(value)))
+                << 32) |
+           ByteSwap32(static_cast<uint32_t>(value >> 32));
+}
+
+// Multiply two 64 bit values and fold the 128 bit product by XORing its
+// high and low halves.
+static inline uint64_t Multiply128Fold64(uint64_t left, uint64_t right) {
+#if defined(__SIZEOF_INT128__)
+    unsigned __int128 product = static_cast<unsigned __int128>(left) * right;
+    return static_cast<uint64_t>(product) ^
+           static_cast<uint64_t>(product >> 64);
+#elif defined(_MSC_VER) && defined(HASHING_X86_KERNELS)
+    uint64_t high;
+    uint64_t low = _umul128(left, right, &high);
+    return low ^ high;
+#else
+    uint64_t leftLow = left & 0xFFFFFFFF;
+    uint64_t leftHigh = left >> 32;
+    uint64_t rightLow = right & 0xFFFFFFFF;
+    uint64_t rightHigh = right >> 32;
+    uint64_t lowLow = leftLow * rightLow;
+    uint64_t highLow = leftHigh * rightLow;
+    uint64_t lowHigh = leftLow * rightHigh;
+    uint64_t highHigh = leftHigh * rightHigh;
+    uint64_t cross = (lowLow >> 32) + (highLow & 0xFFFFFFFF) + lowHigh;
+    uint64_t upper = (highLow >> 32) + (cross >> 32) + highHigh;
+    uint64_t lower = (cross << 32) | (lowLow & 0xFFFFFFFF);
+    return lower ^ upper;
+#endif
+}
+
+static inline uint64_t Xxh64Avalanche(uint64_t hash) {
+    hash ^= hash >> 33;
+    hash *= XXH_PRIME64_2;
+    hash ^= hash >> 29;
+    hash *= XXH_PRIME64_3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+static inline uint64_t Xxh3Avalanche(uint64_t hash) {
+    hash ^= hash >> 37;
+    hash *= XXH_PRIME_MX1;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+static inline uint64_t Xxh3RotateMixRotateMix(uint64_t hash,
+                                              uint64_t length) {
+    hash ^= RotateLeft64(hash, 49) ^ RotateLeft64(hash, 24);
+    hash *= XXH_PRIME_MX2;
+    hash ^= (hash >> 35) + length;
+    hash *= XXH_PRIME_MX2;
+    return hash ^ (hash >> 28);
+}
+
+static inline uint64_t Xxh3Mix16Bytes(const uint8_t* input,
+                                      const uint8_t* secret) {
+    return Multiply128Fold64(ReadLE64(input) ^ ReadLE64(secret),
+                             ReadLE64(input + 8) ^ ReadLE64(secret + 8));
+}
+
+static uint64_t Xxh3HashShort(const uint8_t* input, size_t length) {
+    const uint8_t* secret = XXH3_DEFAULT_SECRET;
+
+    if (length > 8) {
+        uint64_t inputLow = ReadLE64(input) ^
+                            (ReadLE64(secret + 24) ^ ReadLE64(secret + 32));
+        uint64_t inputHigh = ReadLE64(input + length - 8) ^
+                             (ReadLE64(secret + 40) ^ ReadLE64(secret + 48));
+        uint64_t accumulator = length + ByteSwap64(inputLow) + inputHigh +
+                               Multiply128Fold64(inputLow, inputHigh);
+        return Xxh3Avalanche(accumulator);
+    }
+
+    if (length >= 4) {
+        uint64_t input64 = ReadLE32(input + length - 4) +
+                           (static_cast<uint64_t>(ReadLE32(input)) << 32);
+        uint64_t bitflip = ReadLE64(secret + 8) ^ ReadLE64(secret + 16);
+        return Xxh3RotateMixRotateMix(input64 ^ bitflip, length);
+    }
+
+    if (length > 0) {
+        uint32_t combined = (static_cast<uint32_t>(input[0]) << 16) |
+                            (static_cast<uint32_t>(input[length >> 1]) << 24) |
+                            static_cast<uint32_t>(input[length - 1]) |
+                            (static_cast<uint32_t>(length) << 8);
+        uint64_t bitflip = ReadLE32(secret) ^ ReadLE32(secret + 4);
+        return Xxh64Avalanche(combined ^ bitflip);
+    }
+
+    return Xxh64Avalanche(ReadLE64(secret + 56) ^ ReadLE64(secret + 64));
+}
+
+static uint64_t Xxh3HashMedium(const uint8_t* input, size_t length) {
+    const uint8_t* secret = XXH3_DEFAULT_SECRET;
+    uint64_t accumulator = length * XXH_PRIME64_1;
+
+    if (length <= 128) {
+        size_t rounds = (length - 1) / 32;
+
+        for (size_t i = 0; i <= rounds; i++) {
+            accumulator += Xxh3Mix16Bytes(input + 16 * i, secret + 32 * i);
+            accumulator += Xxh3Mix16Bytes(input + length - 16 * (i + 1),
+                                          secret + 32 * i + 16);
+        }
+
+        return Xxh3Avalanche(accumulator);
+    }
+
+    size_t rounds = length / 16;
+
+    for (size_t i = 0; i < 8; i++) {
+        accumulator += Xxh3Mix16Bytes(input + 16 * i, secret + 16 * i);
+    }
+
+    uint64_t accumulatorEnd = Xxh3Mix16Bytes(
+        input + length - 16,
+        secret + XXH3_SECRET_SIZE_MINIMUM - XXH3_MIDSIZE_LAST_OFFSET);
+    accumulator = Xxh3Avalanche(accumulator);
+
+    for (size_t i = 8; i < rounds; i++) {
+        accumulatorEnd += Xxh3Mix16Bytes(
+            input + 16 * i,
+            secret + 16 * (i - 8) + XXH3_MIDSIZE_START_OFFSET);
+    }
+
+    return Xxh3Avalanche(accumulator + accumulatorEnd);
+}
+
+static uint64_t Xxh3MergeAccumulators(const uint64_t* accumulators,
+                                      const uint8_t* secret,
+                                      uint64_t start) {
+    uint64_t result = start;
+
+    for (size_t i = 0; i < 4; i++) {
+        result += Multiply128Fold64(
+            accumulators[2 * i] ^ ReadLE64(secret + 16 * i),
+            accumulators[2 * i + 1] ^ ReadLE64(secret + 16 * i + 8));
+    }
+
+    return Xxh3Avalanche(result);
+}
+
+static void Xxh3AccumulateScalar(uint64_t* accumulators, const uint8_t* input,
+                                 const uint8_t* secret, size_t stripeCount) {
+    for (size_t stripe = 0; stripe < stripeCount; stripe++) {
+        const uint8_t* data = input + stripe * XXH3_STRIPE_LENGTH;
+        const uint8_t* key = secret + stripe * XXH3_SECRET_CONSUME_RATE;
+
+        for (size_t lane = 0; lane < XXH3_ACCUMULATOR_COUNT; lane++) {
+            uint64_t dataValue = ReadLE64(data + lane * 8);
+            uint64_t dataKey = dataValue ^ ReadLE64(key + lane * 8);
+
+            // Adjacent lanes are swapped so every input bit reaches two
+            // accumulators.
+            accumulators[lane ^ 1] += dataValue;
+            accumulators[lane] += (dataKey & 0xFFFFFFFF) * (dataKey >> 32);
+        }
+    }
+}
+
+static void Xxh3ScrambleScalar(uint64_t* accumulators, const uint8_t* secret) {
+    for (size_t lane = 0; lane < XXH3_ACCUMULATOR_COUNT; lane++) {
+        uint64_t accumulator = accumulators[lane];
+        accumulator ^= accumulator >> 47;
+        accumulator ^= ReadLE64(secret + lane * 8);
+        accumulator *= XXH_PRIME32_1;
+        accumulators[lane] = accumulator;
+    }
+}
+
+#if defined(HASHING_X86_KERNELS)
+HASHING_TARGET_AVX2
+static void Xxh3AccumulateAvx2(uint64_t* accumulators, const uint8_t* input,
+                               const uint8_t* secret, size_t stripeCount) {
+    __m256i* vectors = reinterpret_cast<__m256i*>(accumulators);
+    __m256i accumulatorLow = _mm256_load_si256(vectors);
+    __m256i accumulatorHigh = _mm256_load_si256(vectors + 1);
+
+    for (size_t stripe = 0; stripe < stripeCount; stripe++) {
+        const __m256i* data = reinterpret_cast<const __m256i*>(
+            input + stripe * XXH3_STRIPE_LENGTH);
+        const __m256i* key = reinterpret_cast<const __m256i*>(
+            secret + stripe * XXH3_SECRET_CONSUME_RATE);
+
+        __m256i dataLow = _mm256_loadu_si256(data);
+        __m256i dataHigh = _mm256_loadu_si256(data + 1);
+        __m256i dataKeyLow = _mm256_xor_si256(dataLow,
+                                              _mm256_loadu_si256(key));
+        __m256i dataKeyHigh = _mm256_xor_si256(dataHigh,
+                                               _mm256_loadu_si256(key + 1));
+
+        __m256i productLow = _mm256_mul_epu32(
+            dataKeyLow, _mm256_srli_epi64(dataKeyLow, 32));
+        __m256i productHigh = _mm256_mul_epu32(
+            dataKeyHigh, _mm256_srli_epi64(dataKeyHigh, 32));
+
+        accumulatorLow = _mm256_add_epi64(accumulatorLow, _mm256_add_epi64(
+            productLow, _mm256_shuffle_epi32(dataLow, 0x4E)));
+        accumulatorHigh = _mm256_add_epi64(accumulatorHigh, _mm256_add_epi64(
+            productHigh, _mm256_shuffle_epi32(dataHigh, 0x4E)));
+    }
+
+    _mm256_store_si256(vectors, accumulatorLow);
+    _mm256_store_si256(vectors + 1, accumulatorHigh);
+}
+
+HASHING_TARGET_AVX2
+static void Xxh3ScrambleAvx2(uint64_t* accumulators, const uint8_t* secret) {
+    __m256i* vectors = reinterpret_cast<__m256i*>(accumulators);
+    const __m256i* key = reinterpret_cast<const __m256i*>(secret);
+    const __m256i prime = _mm256_set1_epi32(static_cast<int>(XXH_PRIME32_1));
+
+    for (size_t i = 0; i < 2; i++) {
+        __m256i accumulator = _mm256_load_si256(vectors + i);
+        accumulator = _mm256_xor_si256(accumulator,
+                                       _mm256_srli_epi64(accumulator, 47));
+        accumulator = _mm256_xor_si256(accumulator,
+                                       _mm256_loadu_si256(key + i));
+
+        // 64 x 32 bit multiply, split into two 32 x 32 bit multiplies.
+        __m256i productLow = _mm256_mul_epu32(accumulator, prime);
+        __m256i productHigh = _mm256_mul_epu32(
+            _mm256_srli_epi64(accumulator, 32), prime);
+        _mm256_store_si256(vectors + i, _mm256_add_epi64(
+            productLow, _mm256_slli_epi64(productHigh, 32)));
+    }
+}
+
+// GCC 12 reports the deliberately undefined pass-through operand of the
+// AVX-512 intrinsics as uninitialised.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+HASHING_TARGET_AVX512
+static void Xxh3AccumulateAvx512(uint64_t* accumulators, const uint8_t* input,
+                                 const uint8_t* secret, size_t stripeCount) {
+    __m512i accumulator = _mm512_load_si512(accumulators);
+
+    for (size_t stripe = 0; stripe < stripeCount; stripe++) {
+        __m512i data = _mm512_loadu_si512(input +
+                                          stripe * XXH3_STRIPE_LENGTH);
+        __m512i dataKey = _mm512_xor_si512(data, _mm512_loadu_si512(
+            secret + stripe * XXH3_SECRET_CONSUME_RATE));
+        __m512i product = _mm512_mul_epu32(dataKey,
+                                           _mm512_srli_epi64(dataKey, 32));
+        accumulator = _mm512_add_epi64(accumulator, _mm512_add_epi64(
+            product, _mm512_shuffle_epi32(data, _MM_PERM_BADC)));
+    }
+
+    _mm512_store_si512(accumulators, accumulator);
+}
+
+HASHING_TARGET_AVX512
+static void Xxh3ScrambleAvx512(uint64_t* accumulators,
+                               const uint8_t* secret) {
+    const __m512i prime = _mm512_set1_epi32(static_cast<int>(XXH_PRIME32_1));
+    __m512i accumulator = _mm512_load_si512(accumulators);
+
+    accumulator = _mm512_xor_si512(accumulator,
+                                   _mm512_srli_epi64(accumulator, 47));
+    accumulator = _mm512_xor_si512(accumulator, _mm512_loadu_si512(secret));
+
+    __m512i productLow = _mm512_mul_epu32(accumulator, prime);
+    __m512i productHigh = _mm512_mul_epu32(_mm512_srli_epi64(accumulator, 32),
+                                           prime);
+    _mm512_store_si512(accumulators, _mm512_add_epi64(
+        productLow, _mm512_slli_epi64(productHigh, 32)));
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+#endif
+
+Xxh3Hasher::Xxh3Hasher(HashKernel kernel) :
+    kernel_(HashKernel::SCALAR),
+    accumulate_(Xxh3AccumulateScalar),
+    scramble_(Xxh3ScrambleScalar) {
+#if defined(HASHING_X86_KERNELS)
+    if (kernel == HashKernel::AVX512 && HashKernelSupported(kernel)) {
+        kernel_ = kernel;
+        accumulate_ = Xxh3AccumulateAvx512;
+        scramble_ = Xxh3ScrambleAvx512;
+    } else if (kernel >= HashKernel::AVX2 &&
+               HashKernelSupported(HashKernel::AVX2)) {
+        kernel_ = HashKernel::AVX2;
+        accumulate_ = Xxh3AccumulateAvx2;
+        scramble_ = Xxh3ScrambleAvx2;
+    }
+#else
+    // The scalar loop auto-vectorises well on AArch64.
+    (void)kernel;
+#endif
+
+    Reset();
+}
+
+void Xxh3Hasher::Reset() {
+    accumulators_[0] = XXH_PRIME32_3;
+    accumulators_[1] = XXH_PRIME64_1;
+    accumulators_[2] = XXH_PRIME64_2;
+    accumulators_[3] = XXH_PRIME64_3;
+    accumulators_[4] = XXH_PRIME64_4;
+    accumulators_[5] = XXH_PRIME32_2;
+    accumulators_[6] = XXH_PRIME64_5;
+    accumulators_[7] = XXH_PRIME32_1;
+    buffered_size_ = 0;
+    stripes_in_block_ = 0;
+    total_length_ = 0;
+}
+
+/*
+Accumulate whole stripes, scrambling the accumulators each time a block's
+worth of secret has been consumed. 'stripesInBlock' carries the position in
+the current block between calls.
+*/
+void Xxh3Hasher::ConsumeStripes(uint64_t* accumulators,
+                                size_t* stripesInBlock,
+                                const uint8_t* input,
+                                size_t stripeCount) const {
+    while (stripeCount > 0) {
+        size_t stripes = std::min(stripeCount,
+                                  XXH3_STRIPES_PER_BLOCK - *stripesInBlock);
+
+        accumulate_(accumulators, input,
+                    XXH3_DEFAULT_SECRET +
+                        *stripesInBlock * XXH3_SECRET_CONSUME_RATE,
+                    stripes);
+        input += stripes * XXH3_STRIPE_LENGTH;
+        stripeCount -= stripes;
+        *stripesInBlock += stripes;
+
+        if (*stripesInBlock == XXH3_STRIPES_PER_BLOCK) {
+            scramble_(accumulators, XXH3_DEFAULT_SECRET + XXH3_SECRET_LIMIT);
+            *stripesInBlock = 0;
+        }
+    }
+}
+
+void Xxh3Hasher::Update(const void* data, size_t length) {
+    const uint8_t* input = static_cast<const uint8_t*>(data);
+    const uint8_t* end = input + length;
+
+    total_length_ += length;
+
+    if (length <= XXH3_BUFFER_SIZE - buffered_size_) {
+        std::memcpy(buffer_ + buffered_size_, input, length);
+        buffered_size_ += length;
+        return;
+    }
+
+    // The last stripe is always kept back in the buffer, as it is hashed
+    // differently once the total length is known.
+    if (buffered_size_) {
+        size_t loadSize = XXH3_BUFFER_SIZE - buffered_size_;
+        std::memcpy(buffer_ + buffered_size_, input, loadSize);
+        input += loadSize;
+        ConsumeStripes(accumulators_, &stripes_in_block_, buffer_,
+                       XXH3_BUFFER_STRIPES);
+        buffered_size_ = 0;
+    }
+
+    if (static_cast<size_t>(end - input) > XXH3_BUFFER_SIZE) {
+        size_t stripeCount = static_cast<size_t>(end - 1 - input) /
+                             XXH3_STRIPE_LENGTH;
+        ConsumeStripes(accumulators_, &stripes_in_block_, input,
+                       stripeCount);
+        input += stripeCount * XXH3_STRIPE_LENGTH;
+
+        // Keep the previous stripe, Digest64() may need it to build the
+        // last stripe if fewer than 64 bytes remain buffered.
+        std::memcpy(buffer_ + XXH3_BUFFER_SIZE - XXH3_STRIPE_LENGTH,
+                    input - XXH3_STRIPE_LENGTH, XXH3_STRIPE_LENGTH);
+    }
+
+    buffered_size_ = static_cast<size_t>(end - input);
+    std::memcpy(buffer_, input, buffered_size_);
+}
+
+uint64_t Xxh3Hasher::Digest64() const {
+    if (total_length_ <= 16) {
+        return Xxh3HashShort(buffer_, buffered_size_);
+    }
+
+    if (total_length_ <= XXH3_MIDSIZE_MAXIMUM) {
+        return Xxh3HashMedium(buffer_, buffered_size_);
+    }
+
+    alignas(64) uint64_t accumulators[XXH3_ACCUMULATOR_COUNT];
+    uint8_t lastStripe[XXH3_STRIPE_LENGTH];
+    const uint8_t* lastStripePointer;
+
+    std::memcpy(accumulators, accumulators_, sizeof(accumulators));
+
+    if (buffered_size_ >= XXH3_STRIPE_LENGTH) {
+        size_t stripesInBlock = stripes_in_block_;
+        ConsumeStripes(accumulators, &stripesInBlock, buffer_,
+                       (buffered_size_ - 1) / XXH3_STRIPE_LENGTH);
+        lastStripePointer = buffer_ + buffered_size_ - XXH3_STRIPE_LENGTH;
+    } else {
+        size_t catchUpSize = XXH3_STRIPE_LENGTH - buffered_size_;
+        std::memcpy(lastStripe, buffer_ + XXH3_BUFFER_SIZE - catchUpSize,
+                    catchUpSize);
+        std::memcpy(lastStripe + catchUpSize, buffer_, buffered_size_);
+        lastStripePointer = lastStripe;
+    }
+
+    accumulate_(accumulators, lastStripePointer,
+                XXH3_DEFAULT_SECRET + XXH3_SECRET_LIMIT -
+                    XXH3_SECRET_LAST_ACCUMULATE_START,
+                1);
+
+    return Xxh3MergeAccumulators(
+        accumulators,
+        XXH3_DEFAULT_SECRET + XXH3_SECRET_MERGE_ACCUMULATORS_START,
+        total_length_ * XXH_PRIME64_1);
+}
+
+/*
+Finish the hash. The digest is stored big endian, matching the canonical
+representation used by the xxHash command line tools.
+
+returns:
+    8 byte digest.
+*/
+HashDigest Xxh3Hasher::Finalise() {
+    uint64_t value = Digest64();
+    HashDigest digest;
+
+    digest.size = sizeof(value);
+    for (size_t i = 0; i < digest.size; i++) {
+        digest.bytes[i] = static_cast<uint8_t>(value >> (56 - 8 * i));
+    }
+
+    return digest;
+}
+
+uint64_t Xxh3Hasher::Hash64(const void* data, size_t length) {
+    Xxh3Hasher hasher;
+    hasher.Update(data, length);
+    return hasher.Digest64();
+}
+
+}   // namespace hashing
+}   // namespace common
+}   // namespace duplitrace
@@ -0,0 +1,79 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#ifndef XXH3HASHER_H_
+#define XXH3HASHER_H_
+#include "Hasher.h"
+
+namespace duplitrace { namespace common { namespace hashing {
+
+const size_t XXH3_STRIPE_LENGTH = 64;
+const size_t XXH3_ACCUMULATOR_COUNT = 8;
+const size_t XXH3_SECRET_SIZE = 192;
+const size_t XXH3_BUFFER_SIZE = 256;
+
+// Accumulates whole 64 byte stripes, each consuming 8 more bytes of secret.
+using Xxh3AccumulateFunction = void (*)(uint64_t* accumulators,
+                                        const uint8_t* input,
+                                        const uint8_t* secret,
+                                        size_t stripeCount);
+
+using Xxh3ScrambleFunction = void (*)(uint64_t* accumulators,
+                                      const uint8_t* secret);
+
+// Streaming XXH3 64 bit hash (default secret, seed 0), producing the same
+// values as the reference XXH3_64bits(). Inputs longer than 240 bytes are
+// hashed by a SIMD kernel where the CPU supports one.
+class Xxh3Hasher : public Hasher {
+ public:
+    explicit Xxh3Hasher(HashKernel kernel = BestHashKernel());
+
+    HashAlgorithm Algorithm() const override { return HashAlgorithm::XXH3; }
+
+    HashKernel Kernel() const override { return kernel_; }
+
+    void Reset() override;
+
+    void Update(const void* data, size_t length) override;
+
+    HashDigest Finalise() override;
+
+    uint64_t Digest64() const;
+
+    static uint64_t Hash64(const void* data, size_t length);
+
+ private:
+    alignas(64) uint64_t accumulators_[XXH3_ACCUMULATOR_COUNT];
+    alignas(64) uint8_t buffer_[XXH3_BUFFER_SIZE];
+    size_t buffered_size_;
+    size_t stripes_in_block_;
+    uint64_t total_length_;
+    HashKernel kernel_;
+    Xxh3AccumulateFunction accumulate_;
+    Xxh3ScrambleFunction scramble_;
+
+    void ConsumeStripes(uint64_t* accumulators, size_t* stripesInBlock,
+                        const uint8_t* input, size_t stripeCount) const;
+};
+
+}   // namespace hashing
+}   // namespace common
+}   // namespace duplitrace
+
+#endif  // XXH3HASHER_H_
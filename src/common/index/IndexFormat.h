@@ -0,0 +1,151 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#ifndef INDEXFORMAT_H_
+#define INDEXFORMAT_H_
+#include <cstdint>
+
+namespace duplitrace { namespace common { namespace index {
+
+/*
+Layout of an index file. All values are little-endian and every section
+starts on an INDEX_SECTION_ALIGNMENT boundary, so a mapped file can be read
+in place:
+
+    IndexHeader
+    IndexSectionEntry x section_count
+    sections...
+
+Each section is a fixed-width array, a column of one value per directory,
+file or duplicate group. Readers skip sections they do not know, so new
+columns can be added without a version change. The version only changes
+when an existing section changes meaning.
+
+A section may be followed by unused space up to the start of the next one,
+or the end of the file, so an update can add rows in place. An update never
+renumbers rows: a file that has gone is marked as removed, as is a group
+that has been found again, and new rows are added after the existing ones.
+INDEX_FLAG_UPDATING is set while an update is being written, an index with
+it set was not completely updated and should not be used.
+*/
+
+const char INDEX_MAGIC[8] = { 'D', 'T', 'I', 'N', 'D', 'E', 'X', '\0' };
+const uint32_t INDEX_VERSION = 1;
+const uint64_t INDEX_SECTION_ALIGNMENT = 64;
+
+// Parent of a root directory, and directory of a file that has none.
+const uint32_t INDEX_NO_DIRECTORY = 0xFFFFFFFF;
+
+// Directory of a file that was removed by an update.
+const uint32_t INDEX_REMOVED_FILE = 0xFFFFFFFE;
+
+// Header flags.
+const uint32_t INDEX_FLAG_UPDATING = 0x1;
+
+enum class IndexSection : uint32_t {
+    // Interned path segments: the bytes of every string back to back, and
+    // the offset of each string (plus a final end offset) into them.
+    STRING_DATA = 1,
+    STRING_OFFSETS = 2,
+
+    // Per directory: parent directory id and name string id.
+    DIRECTORY_PARENTS = 3,
+    DIRECTORY_NAMES = 4,
+
+    // Per file.
+    FILE_DIRECTORIES = 5,
+    FILE_NAMES = 6,
+    FILE_SIZES = 7,
+    FILE_MODIFIED_TIMES = 8,
+    FILE_DEVICES = 9,
+    FILE_INODES = 10,
+    FILE_DIGESTS = 11,
+
+    // Per duplicate group: file size, and the offset of its first member
+    // (plus a final end offset) into the list of members. A group that was
+    // removed by an update has a size of 0, empty files are never grouped.
+    GROUP_SIZES = 12,
+    GROUP_MEMBER_OFFSETS = 13,
+    GROUP_MEMBERS = 14,
+
+    // Per file, optional: inode change time, used to carry a file over to
+    // an incrementally updated index without reading it again.
+    FILE_CHANGED_TIMES = 15,
+
+    // Per link group, optional: IndexLinkKind, and the offset of its first
+    // member (plus a final end offset) into the list of members.
+    LINK_GROUP_KINDS = 16,
+    LINK_GROUP_MEMBER_OFFSETS = 17,
+    LINK_GROUP_MEMBERS = 18
+};
+
+// How the files of a link group share their contents, only one of them was
+// read to hash the group.
+enum class IndexLinkKind : uint8_t {
+    // The group was removed by an update.
+    REMOVED = 0,
+
+    // Hard links to the same inode.
+    HARD_LINK = 1,
+
+    // Separate inodes whose data is in the same shared (reflinked) extents.
+    SHARED_EXTENTS = 2
+};
+
+struct IndexHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t section_count;
+
+    // Size of each entry in FILE_DIGESTS, files that were never fully
+    // hashed have an all zero digest.
+    uint32_t digest_size;
+    uint32_t hash_algorithm;
+    int64_t created_time;
+    uint32_t flags;
+    uint8_t reserved[28];
+};
+
+struct IndexSectionEntry {
+    uint32_t id;
+    uint32_t element_size;
+    uint64_t count;
+    uint64_t offset;
+};
+
+inline uint64_t AlignIndexSection(uint64_t offset) {
+    return (offset + INDEX_SECTION_ALIGNMENT - 1) /
+           INDEX_SECTION_ALIGNMENT * INDEX_SECTION_ALIGNMENT;
+}
+
+// Rows of unused space left after a section when it is written, so that
+// updates can add rows to it without rewriting the file.
+inline uint64_t IndexSpareRows(uint64_t count) {
+    return count / 16 + 64;
+}
+
+static_assert(sizeof(IndexHeader) == 64, "unexpected index header size");
+static_assert(sizeof(IndexSectionEntry) == 24,
+              "unexpected index section entry size");
+
+}   // namespace index
+}   // namespace common
+}   // namespace duplitrace
+
+#endif  // INDEXFORMAT_H_
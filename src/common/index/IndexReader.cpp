@@ -0,0 +1,421 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#include <cstring>
+#include "IndexReader.h"
+#include "../Platform.h"
+
+#if DUPLITRACE_PLATFORM == DUPLITRACE_PLATFORM_LINUX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <windows.h>
+#endif
+
+namespace duplitrace { namespace common { namespace index {
+
+template <typename T>
+static bool SetColumn(const IndexSectionEntry& section, const uint8_t* start,
+                      IndexColumn<T>* column) {
+    if (section.element_size != sizeof(T)) {
+        return false;
+    }
+
+    *column = IndexColumn<T>(reinterpret_cast<const T*>(start),
+                             section.count);
+    return true;
+}
+
+// A list of offsets has an end offset after the last row's, and may be left
+// out altogether when there are no rows.
+static bool OffsetsMatch(const IndexColumn<uint64_t>& offsets, uint64_t rows) {
+    return offsets.Size() == rows + 1 || (rows == 0 && offsets.Size() == 0);
+}
+
+// Longest chain of parent directories followed when building a path, which
+// stops a corrupt index with a loop in it from hanging the reader.
+const size_t INDEX_MAXIMUM_DIRECTORY_DEPTH = 4096;
+
+IndexReader::IndexReader() :
+    data_(nullptr),
+    size_(0),
+    mapping_(nullptr) {
+}
+
+IndexReader::~IndexReader() {
+    Close();
+}
+
+/*
+Map an index file and locate its sections.
+
+returns:
+    False if the file cannot be mapped, is not an index, has a version this
+    reader does not understand, was not completely updated or has a section
+    that runs past its end.
+*/
+bool IndexReader::Open(const std::string& filename) {
+    Close();
+
+    if (!Map(filename) || !ReadSections()) {
+        Close();
+        return false;
+    }
+
+    return true;
+}
+
+void IndexReader::Close() {
+    if (data_) {
+#if DUPLITRACE_PLATFORM == DUPLITRACE_PLATFORM_LINUX
+        munmap(const_cast<uint8_t*>(data_), size_);
+#else
+        UnmapViewOfFile(data_);
+        CloseHandle(mapping_);
+#endif
+    }
+
+    data_ = nullptr;
+    size_ = 0;
+    mapping_ = nullptr;
+    columns_ = Columns();
+}
+
+int64_t IndexReader::CreatedTime() const {
+    return Header().created_time;
+}
+
+hashing::HashAlgorithm IndexReader::Algorithm() const {
+    return static_cast<hashing::HashAlgorithm>(Header().hash_algorithm);
+}
+
+std::string_view IndexReader::String(uint32_t id) const {
+    if (id + 1ULL >= columns_.string_offsets.Size()) {
+        return std::string_view();
+    }
+
+    uint64_t start = columns_.string_offsets[id];
+    uint64_t end = columns_.string_offsets[id + 1];
+
+    if (start > end || end > columns_.string_data.Size()) {
+        return std::string_view();
+    }
+
+    return std::string_view(columns_.string_data.begin() + start,
+                            static_cast<size_t>(end - start));
+}
+
+// Rebuild the full path of a directory from its chain of parents.
+std::string IndexReader::DirectoryPath(uint32_t directory) const {
+    std::vector<std::string_view> names;
+
+    while (directory < columns_.directory_parents.Size() &&
+           names.size() < INDEX_MAXIMUM_DIRECTORY_DEPTH) {
+        names.push_back(String(columns_.directory_names[directory]));
+        directory = columns_.directory_parents[directory];
+    }
+
+    std::string path;
+    for (auto name = names.rbegin(); name != names.rend(); ++name) {
+        if (!path.empty() && path.back() != '/') {
+            path += '/';
+        }
+        path += *name;
+    }
+
+    return path;
+}
+
+std::string IndexReader::FilePath(uint64_t file) const {
+    return DirectoryPath(columns_.file_directories[file]) + "/" +
+           std::string(String(columns_.file_names[file]));
+}
+
+hashing::HashDigest IndexReader::FileDigest(uint64_t file) const {
+    hashing::HashDigest digest;
+
+    digest.size = columns_.digest_size;
+    std::memcpy(digest.bytes.data(), columns_.file_digests.begin() +
+                file * columns_.digest_size, columns_.digest_size);
+
+    return digest;
+}
+
+IndexDuplicateGroup IndexReader::Group(uint64_t group) const {
+    uint64_t start = columns_.group_member_offsets[group];
+    uint64_t end = columns_.group_member_offsets[group + 1];
+
+    if (start > end || end > columns_.group_members.Size()) {
+        return { columns_.group_sizes[group], IndexColumn<uint64_t>() };
+    }
+
+    return { columns_.group_sizes[group],
+             IndexColumn<uint64_t>(columns_.group_members.begin() + start,
+                                   end - start) };
+}
+
+// Find the duplicate groups whose files are at least a given size, groups
+// removed by an update are left out.
+std::vector<uint64_t> IndexReader::GroupsOfAtLeast(
+        uint64_t minimumSize) const {
+    std::vector<uint64_t> groups;
+
+    for (uint64_t group = 0; group < columns_.group_sizes.Size(); group++) {
+        uint64_t size = columns_.group_sizes[group];
+
+        if (size && size >= minimumSize) {
+            groups.push_back(group);
+        }
+    }
+
+    return groups;
+}
+
+IndexLinkGroup IndexReader::LinkGroup(uint64_t group) const {
+    auto kind = static_cast<IndexLinkKind>(columns_.link_group_kinds[group]);
+    uint64_t start = columns_.link_group_member_offsets[group];
+    uint64_t end = columns_.link_group_member_offsets[group + 1];
+
+    if (start > end || end > columns_.link_group_members.Size()) {
+        return { kind, IndexColumn<uint64_t>() };
+    }
+
+    return { kind,
+             IndexColumn<uint64_t>(columns_.link_group_members.begin() + start,
+                                   end - start) };
+}
+
+#if DUPLITRACE_PLATFORM == DUPLITRACE_PLATFORM_LINUX
+
+bool IndexReader::Map(const std::string& filename) {
+    int fd = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat status;
+    if (fstat(fd, &status) != 0 ||
+        static_cast<uint64_t>(status.st_size) < sizeof(IndexHeader)) {
+        close(fd);
+        return false;
+    }
+
+    size_ = static_cast<uint64_t>(status.st_size);
+    void* data = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (data == MAP_FAILED) {
+        return false;
+    }
+
+    data_ = static_cast<const uint8_t*>(data);
+    return true;
+}
+
+#else
+
+bool IndexReader::Map(const std::string& filename) {
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ,
+                              FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) ||
+        static_cast<uint64_t>(fileSize.QuadPart) < sizeof(IndexHeader)) {
+        CloseHandle(file);
+        return false;
+    }
+
+    mapping_ = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0,
+                                  nullptr);
+    CloseHandle(file);
+
+    if (!mapping_) {
+        return false;
+    }
+
+    data_ = static_cast<const uint8_t*>(
+        MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+    if (!data_) {
+        CloseHandle(mapping_);
+        mapping_ = nullptr;
+        return false;
+    }
+
+    size_ = static_cast<uint64_t>(fileSize.QuadPart);
+    return true;
+}
+
+#endif
+
+/*
+Check the header and point each known column at its section. Sections this
+reader does not know are skipped, a missing section is an empty column.
+*/
+bool IndexReader::ReadSections() {
+    const IndexHeader& header = Header();
+
+    if (std::memcmp(header.magic, INDEX_MAGIC, sizeof(header.magic)) ||
+        header.version != INDEX_VERSION ||
+        (header.flags & INDEX_FLAG_UPDATING) ||
+        header.digest_size > hashing::HASH_DIGEST_MAXIMUM_SIZE ||
+        sizeof(IndexHeader) + static_cast<uint64_t>(header.section_count) *
+            sizeof(IndexSectionEntry) > size_) {
+        return false;
+    }
+
+    Columns& columns = columns_;
+    columns.digest_size = header.digest_size;
+    auto table = reinterpret_cast<const IndexSectionEntry*>(
+        data_ + sizeof(IndexHeader));
+
+    for (uint32_t i = 0; i < header.section_count; i++) {
+        const IndexSectionEntry& section = table[i];
+
+        if (section.offset % INDEX_SECTION_ALIGNMENT ||
+            section.offset > size_ ||
+            (section.element_size && section.count >
+                 (size_ - section.offset) / section.element_size)) {
+            return false;
+        }
+
+        const uint8_t* start = data_ + section.offset;
+        bool valid = true;
+
+        switch (static_cast<IndexSection>(section.id)) {
+            case IndexSection::STRING_DATA:
+                valid = SetColumn(section, start, &columns.string_data);
+                break;
+
+            case IndexSection::STRING_OFFSETS:
+                valid = SetColumn(section, start, &columns.string_offsets);
+                break;
+
+            case IndexSection::DIRECTORY_PARENTS:
+                valid = SetColumn(section, start,
+                                  &columns.directory_parents);
+                break;
+
+            case IndexSection::DIRECTORY_NAMES:
+                valid = SetColumn(section, start, &columns.directory_names);
+                break;
+
+            case IndexSection::FILE_DIRECTORIES:
+                valid = SetColumn(section, start,
+                                  &columns.file_directories);
+                break;
+
+            case IndexSection::FILE_NAMES:
+                valid = SetColumn(section, start, &columns.file_names);
+                break;
+
+            case IndexSection::FILE_SIZES:
+                valid = SetColumn(section, start, &columns.file_sizes);
+                break;
+
+            case IndexSection::FILE_MODIFIED_TIMES:
+                valid = SetColumn(section, start,
+                                  &columns.file_modified_times);
+                break;
+
+            case IndexSection::FILE_DEVICES:
+                valid = SetColumn(section, start, &columns.file_devices);
+                break;
+
+            case IndexSection::FILE_INODES:
+                valid = SetColumn(section, start, &columns.file_inodes);
+                break;
+
+            case IndexSection::FILE_DIGESTS:
+                // One element per file, each digest_size bytes wide.
+                valid = section.element_size == header.digest_size;
+                columns.file_digests = IndexColumn<uint8_t>(
+                    start, section.count * section.element_size);
+                break;
+
+            case IndexSection::FILE_CHANGED_TIMES:
+                valid = SetColumn(section, start,
+                                  &columns.file_changed_times);
+                break;
+
+            case IndexSection::GROUP_SIZES:
+                valid = SetColumn(section, start, &columns.group_sizes);
+                break;
+
+            case IndexSection::GROUP_MEMBER_OFFSETS:
+                valid = SetColumn(section, start,
+                                  &columns.group_member_offsets);
+                break;
+
+            case IndexSection::GROUP_MEMBERS:
+                valid = SetColumn(section, start, &columns.group_members);
+                break;
+
+            case IndexSection::LINK_GROUP_KINDS:
+                valid = SetColumn(section, start, &columns.link_group_kinds);
+                break;
+
+            case IndexSection::LINK_GROUP_MEMBER_OFFSETS:
+                valid = SetColumn(section, start,
+                                  &columns.link_group_member_offsets);
+                break;
+
+            case IndexSection::LINK_GROUP_MEMBERS:
+                valid = SetColumn(section, start,
+                                  &columns.link_group_members);
+                break;
+
+            default:
+                break;
+        }
+
+        if (!valid) {
+            return false;
+        }
+    }
+
+    // Every column of a table must have a value for each of its rows.
+    uint64_t files = columns.file_sizes.Size();
+    uint64_t groups = columns.group_sizes.Size();
+    uint64_t linkGroups = columns.link_group_kinds.Size();
+
+    return columns.directory_names.Size() ==
+               columns.directory_parents.Size() &&
+           columns.file_directories.Size() == files &&
+           columns.file_names.Size() == files &&
+           columns.file_modified_times.Size() == files &&
+           columns.file_devices.Size() == files &&
+           columns.file_inodes.Size() == files &&
+           columns.file_digests.Size() == files * columns.digest_size &&
+           (columns.file_changed_times.Size() == files ||
+            columns.file_changed_times.Size() == 0) &&
+           OffsetsMatch(columns.group_member_offsets, groups) &&
+           OffsetsMatch(columns.link_group_member_offsets, linkGroups) &&
+           (columns.string_offsets.Size() > 0 ||
+            columns.string_data.Size() == 0);
+}
+
+}   // namespace index
+}   // namespace common
+}   // namespace duplitrace
@@ -0,0 +1,193 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#ifndef INDEXREADER_H_
+#define INDEXREADER_H_
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "IndexFormat.h"
+#include "../hashing/Hasher.h"
+
+namespace duplitrace { namespace common { namespace index {
+
+// A column of a mapped index, only valid while the reader is open.
+template <typename T>
+class IndexColumn {
+ public:
+    IndexColumn() : data_(nullptr), size_(0) {}
+
+    IndexColumn(const T* data, uint64_t size) : data_(data), size_(size) {}
+
+    const T& operator[](uint64_t index) const { return data_[index]; }
+
+    uint64_t Size() const { return size_; }
+
+    const T* begin() const { return data_; }
+
+    const T* end() const { return data_ + size_; }
+
+ private:
+    const T* data_;
+    uint64_t size_;
+};
+
+struct IndexDuplicateGroup {
+    uint64_t size;
+    IndexColumn<uint64_t> files;
+};
+
+struct IndexLinkGroup {
+    IndexLinkKind kind;
+    IndexColumn<uint64_t> files;
+};
+
+/*
+Read-only view of an index file. The file is mapped into memory and nothing
+is deserialised, each query only touches the pages of the columns it reads,
+e.g. finding the large duplicate groups reads the group sizes and nothing
+else. Safe to share between threads once opened.
+*/
+class IndexReader {
+ public:
+    IndexReader();
+
+    ~IndexReader();
+
+    IndexReader(const IndexReader&) = delete;
+    IndexReader& operator=(const IndexReader&) = delete;
+
+    bool Open(const std::string& filename);
+
+    void Close();
+
+    int64_t CreatedTime() const;
+
+    hashing::HashAlgorithm Algorithm() const;
+
+    uint64_t DirectoryCount() const {
+        return columns_.directory_parents.Size();
+    }
+
+    uint64_t FileCount() const { return columns_.file_sizes.Size(); }
+
+    uint64_t GroupCount() const { return columns_.group_sizes.Size(); }
+
+    uint64_t LinkGroupCount() const {
+        return columns_.link_group_kinds.Size();
+    }
+
+    std::string_view String(uint32_t id) const;
+
+    std::string DirectoryPath(uint32_t directory) const;
+
+    std::string FilePath(uint64_t file) const;
+
+    const IndexColumn<uint32_t>& DirectoryParents() const {
+        return columns_.directory_parents;
+    }
+
+    const IndexColumn<uint32_t>& DirectoryNames() const {
+        return columns_.directory_names;
+    }
+
+    const IndexColumn<uint32_t>& FileDirectories() const {
+        return columns_.file_directories;
+    }
+
+    const IndexColumn<uint32_t>& FileNames() const {
+        return columns_.file_names;
+    }
+
+    const IndexColumn<uint64_t>& FileSizes() const {
+        return columns_.file_sizes;
+    }
+
+    const IndexColumn<int64_t>& FileModifiedTimes() const {
+        return columns_.file_modified_times;
+    }
+
+    const IndexColumn<uint64_t>& FileDevices() const {
+        return columns_.file_devices;
+    }
+
+    const IndexColumn<uint64_t>& FileInodes() const {
+        return columns_.file_inodes;
+    }
+
+    // Empty if the index was written without change times.
+    const IndexColumn<int64_t>& FileChangedTimes() const {
+        return columns_.file_changed_times;
+    }
+
+    hashing::HashDigest FileDigest(uint64_t file) const;
+
+    IndexDuplicateGroup Group(uint64_t group) const;
+
+    std::vector<uint64_t> GroupsOfAtLeast(uint64_t minimumSize) const;
+
+    IndexLinkGroup LinkGroup(uint64_t group) const;
+
+ private:
+    const uint8_t* data_;
+    uint64_t size_;
+
+    // File mapping handle, only used on Windows.
+    void* mapping_;
+
+    // Columns of the open index, empty when no index is open.
+    struct Columns {
+        IndexColumn<char> string_data;
+        IndexColumn<uint64_t> string_offsets;
+        IndexColumn<uint32_t> directory_parents;
+        IndexColumn<uint32_t> directory_names;
+        IndexColumn<uint32_t> file_directories;
+        IndexColumn<uint32_t> file_names;
+        IndexColumn<uint64_t> file_sizes;
+        IndexColumn<int64_t> file_modified_times;
+        IndexColumn<uint64_t> file_devices;
+        IndexColumn<uint64_t> file_inodes;
+        IndexColumn<uint8_t> file_digests;
+        IndexColumn<int64_t> file_changed_times;
+        IndexColumn<uint64_t> group_sizes;
+        IndexColumn<uint64_t> group_member_offsets;
+        IndexColumn<uint64_t> group_members;
+        IndexColumn<uint8_t> link_group_kinds;
+        IndexColumn<uint64_t> link_group_member_offsets;
+        IndexColumn<uint64_t> link_group_members;
+        uint32_t digest_size = 0;
+    };
+
+    Columns columns_;
+
+    bool Map(const std::string& filename);
+
+    bool ReadSections();
+
+    const IndexHeader& Header() const {
+        return *reinterpret_cast<const IndexHeader*>(data_);
+    }
+};
+
+}   // namespace index
+}   // namespace common
+}   // namespace duplitrace
+
+#endif  // INDEXREADER_H_
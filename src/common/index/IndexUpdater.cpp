@@ -0,0 +1,491 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+#include "IndexUpdater.h"
+
+namespace duplitrace { namespace common { namespace index {
+
+// Every section an index is written with, an index missing any of them is
+// too old to be updated.
+static const IndexSection INDEX_UPDATED_SECTIONS[] = {
+    IndexSection::STRING_DATA,
+    IndexSection::STRING_OFFSETS,
+    IndexSection::DIRECTORY_PARENTS,
+    IndexSection::DIRECTORY_NAMES,
+    IndexSection::FILE_DIRECTORIES,
+    IndexSection::FILE_NAMES,
+    IndexSection::FILE_SIZES,
+    IndexSection::FILE_MODIFIED_TIMES,
+    IndexSection::FILE_DEVICES,
+    IndexSection::FILE_INODES,
+    IndexSection::FILE_DIGESTS,
+    IndexSection::GROUP_SIZES,
+    IndexSection::GROUP_MEMBER_OFFSETS,
+    IndexSection::GROUP_MEMBERS,
+    IndexSection::FILE_CHANGED_TIMES,
+    IndexSection::LINK_GROUP_KINDS,
+    IndexSection::LINK_GROUP_MEMBER_OFFSETS,
+    IndexSection::LINK_GROUP_MEMBERS
+};
+
+static bool WriteZeros(std::ostream* file, uint64_t length) {
+    static const char ZEROS[4096] = {};
+
+    while (length && *file) {
+        size_t chunk = static_cast<size_t>(
+            std::min<uint64_t>(length, sizeof(ZEROS)));
+        file->write(ZEROS, chunk);
+        length -= chunk;
+    }
+
+    return static_cast<bool>(*file);
+}
+
+static bool CopyBytes(std::istream* from, uint64_t offset, uint64_t length,
+                      std::ostream* to) {
+    std::vector<char> buffer(64 * 1024);
+
+    from->seekg(static_cast<std::streamoff>(offset));
+
+    while (length && *from && *to) {
+        size_t chunk = static_cast<size_t>(
+            std::min<uint64_t>(length, buffer.size()));
+        from->read(buffer.data(), chunk);
+        to->write(buffer.data(), chunk);
+        length -= chunk;
+    }
+
+    return *from && *to;
+}
+
+IndexUpdater::IndexUpdater() :
+    changed_(false) {
+    std::memset(&header_, 0, sizeof(header_));
+}
+
+/*
+Read the header and section table of an index to update.
+
+returns:
+    False if the file cannot be read, is not an index this version writes,
+    was not completely updated or is missing a section.
+*/
+bool IndexUpdater::Open(const std::string& filename) {
+    filename_ = filename;
+    sections_.clear();
+    overwrites_.clear();
+    changed_ = false;
+
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    if (!file) {
+        return false;
+    }
+
+    uint64_t size = static_cast<uint64_t>(file.tellg());
+    file.seekg(0);
+
+    if (!file.read(reinterpret_cast<char*>(&header_), sizeof(header_)) ||
+        std::memcmp(header_.magic, INDEX_MAGIC, sizeof(header_.magic)) ||
+        header_.version != INDEX_VERSION ||
+        (header_.flags & INDEX_FLAG_UPDATING) ||
+        header_.digest_size > hashing::HASH_DIGEST_MAXIMUM_SIZE ||
+        sizeof(IndexHeader) + static_cast<uint64_t>(header_.section_count) *
+            sizeof(IndexSectionEntry) > size) {
+        return false;
+    }
+
+    std::vector<IndexSectionEntry> table(header_.section_count);
+    if (!file.read(reinterpret_cast<char*>(table.data()),
+                   table.size() * sizeof(IndexSectionEntry))) {
+        return false;
+    }
+
+    for (const auto& entry : table) {
+        if (entry.offset % INDEX_SECTION_ALIGNMENT || entry.offset > size ||
+            (entry.element_size &&
+             entry.count > (size - entry.offset) / entry.element_size)) {
+            return false;
+        }
+
+        // A section's spare rows run up to the next section's start.
+        uint64_t end = size;
+        for (const auto& next : table) {
+            if (next.offset > entry.offset) {
+                end = std::min(end, next.offset);
+            }
+        }
+
+        uint64_t capacity = entry.element_size ?
+            (end - entry.offset) / entry.element_size : UINT64_MAX;
+        sections_.push_back({ entry, capacity, {} });
+    }
+
+    for (IndexSection id : INDEX_UPDATED_SECTIONS) {
+        if (!Find(id)) {
+            sections_.clear();
+            return false;
+        }
+    }
+
+    return Find(IndexSection::FILE_DIGESTS)->entry.element_size ==
+           header_.digest_size;
+}
+
+uint64_t IndexUpdater::StringCount() const {
+    uint64_t offsets = Count(IndexSection::STRING_OFFSETS);
+    return offsets ? offsets - 1 : 0;
+}
+
+uint32_t IndexUpdater::AddString(std::string_view value) {
+    uint32_t id = static_cast<uint32_t>(StringCount());
+
+    Section* data = Find(IndexSection::STRING_DATA);
+    data->appended.insert(data->appended.end(), value.begin(), value.end());
+    AppendOffset(IndexSection::STRING_OFFSETS,
+                 Count(IndexSection::STRING_DATA));
+
+    return id;
+}
+
+uint32_t IndexUpdater::AddDirectory(uint32_t parent, uint32_t name) {
+    uint32_t id = static_cast<uint32_t>(DirectoryCount());
+
+    Append<uint32_t>(IndexSection::DIRECTORY_PARENTS, parent);
+    Append<uint32_t>(IndexSection::DIRECTORY_NAMES, name);
+
+    return id;
+}
+
+/*
+Add a file, its digest is all zeros until SetDigest() is called.
+
+returns:
+    Id of the new file.
+*/
+uint64_t IndexUpdater::AddFile(const IndexFileEntry& file) {
+    uint64_t id = FileCount();
+    std::vector<uint8_t> digest(header_.digest_size, 0);
+
+    Append<uint32_t>(IndexSection::FILE_DIRECTORIES, file.directory);
+    Append<uint32_t>(IndexSection::FILE_NAMES, file.name);
+    Append<uint64_t>(IndexSection::FILE_SIZES, file.size);
+    Append<int64_t>(IndexSection::FILE_MODIFIED_TIMES,
+                    file.modified_time_ns);
+    Append<uint64_t>(IndexSection::FILE_DEVICES, file.device);
+    Append<uint64_t>(IndexSection::FILE_INODES, file.inode);
+    Append<int64_t>(IndexSection::FILE_CHANGED_TIMES, file.changed_time_ns);
+    AppendRow(IndexSection::FILE_DIGESTS, digest.data());
+
+    return id;
+}
+
+// Overwrite a file that has changed, its digest is all zeros until
+// SetDigest() is called.
+void IndexUpdater::ReplaceFile(uint64_t file, const IndexFileEntry& entry) {
+    std::vector<uint8_t> digest(header_.digest_size, 0);
+
+    Set<uint32_t>(IndexSection::FILE_DIRECTORIES, file, entry.directory);
+    Set<uint32_t>(IndexSection::FILE_NAMES, file, entry.name);
+    Set<uint64_t>(IndexSection::FILE_SIZES, file, entry.size);
+    Set<int64_t>(IndexSection::FILE_MODIFIED_TIMES, file,
+                 entry.modified_time_ns);
+    Set<uint64_t>(IndexSection::FILE_DEVICES, file, entry.device);
+    Set<uint64_t>(IndexSection::FILE_INODES, file, entry.inode);
+    Set<int64_t>(IndexSection::FILE_CHANGED_TIMES, file,
+                 entry.changed_time_ns);
+    SetRow(IndexSection::FILE_DIGESTS, file, digest.data());
+}
+
+void IndexUpdater::RemoveFile(uint64_t file) {
+    Set<uint32_t>(IndexSection::FILE_DIRECTORIES, file, INDEX_REMOVED_FILE);
+}
+
+void IndexUpdater::SetDigest(uint64_t file,
+                             const hashing::HashDigest& digest) {
+    std::vector<uint8_t> bytes(header_.digest_size, 0);
+
+    std::memcpy(bytes.data(), digest.bytes.data(),
+                std::min<size_t>(digest.size, bytes.size()));
+    SetRow(IndexSection::FILE_DIGESTS, file, bytes.data());
+}
+
+void IndexUpdater::AddDuplicateGroup(uint64_t size,
+                                     const std::vector<uint64_t>& files) {
+    Append<uint64_t>(IndexSection::GROUP_SIZES, size);
+    for (uint64_t file : files) {
+        Append<uint64_t>(IndexSection::GROUP_MEMBERS, file);
+    }
+    AppendOffset(IndexSection::GROUP_MEMBER_OFFSETS,
+                 Count(IndexSection::GROUP_MEMBERS));
+}
+
+// A removed group keeps its members, but its size is 0.
+void IndexUpdater::RemoveGroup(uint64_t group) {
+    Set<uint64_t>(IndexSection::GROUP_SIZES, group, 0);
+}
+
+void IndexUpdater::AddLinkGroup(IndexLinkKind kind,
+                                const std::vector<uint64_t>& files) {
+    Append<uint8_t>(IndexSection::LINK_GROUP_KINDS,
+                    static_cast<uint8_t>(kind));
+    for (uint64_t file : files) {
+        Append<uint64_t>(IndexSection::LINK_GROUP_MEMBERS, file);
+    }
+    AppendOffset(IndexSection::LINK_GROUP_MEMBER_OFFSETS,
+                 Count(IndexSection::LINK_GROUP_MEMBERS));
+}
+
+void IndexUpdater::RemoveLinkGroup(uint64_t group) {
+    Set<uint8_t>(IndexSection::LINK_GROUP_KINDS, group,
+                 static_cast<uint8_t>(IndexLinkKind::REMOVED));
+}
+
+/*
+Write the changes to the index. They are written in place if they fit, the
+index is flagged as being updated until they have all been written, so an
+update that fails part way is not mistaken for a complete index. If they do
+not fit, the index is rewritten to a temporary file which is then renamed.
+
+returns:
+    False if the index could not be written, inPlace is set to whether the
+    changes were written in place.
+*/
+bool IndexUpdater::Write(bool* inPlace) {
+    bool fits = true;
+
+    for (const auto& section : sections_) {
+        fits = fits && Count(static_cast<IndexSection>(section.entry.id)) <=
+                       section.capacity;
+    }
+
+    if (inPlace) {
+        *inPlace = fits;
+    }
+
+    if (!changed_) {
+        return true;
+    }
+
+    if (!(fits ? WriteInPlace() : Rewrite())) {
+        return false;
+    }
+
+    // Start again from what is now in the file.
+    return Open(filename_);
+}
+
+IndexUpdater::Section* IndexUpdater::Find(IndexSection id) {
+    for (auto& section : sections_) {
+        if (section.entry.id == static_cast<uint32_t>(id)) {
+            return &section;
+        }
+    }
+
+    return nullptr;
+}
+
+const IndexUpdater::Section* IndexUpdater::Find(IndexSection id) const {
+    return const_cast<IndexUpdater*>(this)->Find(id);
+}
+
+uint64_t IndexUpdater::Count(IndexSection id) const {
+    const Section* section = Find(id);
+    if (!section) {
+        return 0;
+    }
+
+    uint32_t elementSize = section->entry.element_size;
+    return section->entry.count +
+           (elementSize ? section->appended.size() / elementSize : 0);
+}
+
+void IndexUpdater::AppendRow(IndexSection id, const void* value) {
+    Section* section = Find(id);
+    auto bytes = static_cast<const uint8_t*>(value);
+
+    section->appended.insert(section->appended.end(), bytes,
+                             bytes + section->entry.element_size);
+    changed_ = true;
+}
+
+void IndexUpdater::SetRow(IndexSection id, uint64_t row, const void* value) {
+    Section* section = Find(id);
+    uint32_t elementSize = section->entry.element_size;
+    auto bytes = static_cast<const uint8_t*>(value);
+
+    if (row >= section->entry.count) {
+        std::memcpy(section->appended.data() +
+                    (row - section->entry.count) * elementSize,
+                    bytes, elementSize);
+    } else {
+        overwrites_[{ id, row }].assign(bytes, bytes + elementSize);
+    }
+
+    changed_ = true;
+}
+
+// Add a row's end offset to a list of offsets, which starts with a 0 when it
+// has its first row.
+void IndexUpdater::AppendOffset(IndexSection id, uint64_t offset) {
+    if (Count(id) == 0) {
+        Append<uint64_t>(id, 0);
+    }
+
+    Append<uint64_t>(id, offset);
+}
+
+bool IndexUpdater::WriteInPlace() {
+    std::fstream file(filename_,
+                      std::ios::in | std::ios::out | std::ios::binary);
+    if (!file) {
+        return false;
+    }
+
+    IndexHeader header = header_;
+    header.flags |= INDEX_FLAG_UPDATING;
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.flush();
+
+    std::vector<IndexSectionEntry> table;
+
+    for (const auto& section : sections_) {
+        const IndexSectionEntry& entry = section.entry;
+
+        if (!section.appended.empty()) {
+            file.seekp(static_cast<std::streamoff>(
+                entry.offset + entry.count * entry.element_size));
+            file.write(reinterpret_cast<const char*>(section.appended.data()),
+                       section.appended.size());
+        }
+
+        table.push_back(entry);
+        table.back().count = Count(static_cast<IndexSection>(entry.id));
+    }
+
+    for (const auto& overwrite : overwrites_) {
+        const IndexSectionEntry& entry = Find(overwrite.first.first)->entry;
+
+        file.seekp(static_cast<std::streamoff>(
+            entry.offset + overwrite.first.second * entry.element_size));
+        file.write(reinterpret_cast<const char*>(overwrite.second.data()),
+                   overwrite.second.size());
+    }
+
+    file.seekp(sizeof(header));
+    file.write(reinterpret_cast<const char*>(table.data()),
+               table.size() * sizeof(IndexSectionEntry));
+    file.flush();
+
+    // Only now is the index complete again.
+    header.flags &= ~INDEX_FLAG_UPDATING;
+    header.created_time = static_cast<int64_t>(std::time(nullptr));
+    file.seekp(0);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.close();
+
+    return !file.fail();
+}
+
+bool IndexUpdater::Rewrite() {
+    std::ifstream source(filename_, std::ios::binary);
+    if (!source) {
+        return false;
+    }
+
+    std::string temporaryName = filename_ + ".tmp";
+    std::ofstream target(temporaryName, std::ios::binary | std::ios::trunc);
+    if (!target) {
+        return false;
+    }
+
+    IndexHeader header = header_;
+    header.created_time = static_cast<int64_t>(std::time(nullptr));
+
+    std::vector<IndexSectionEntry> table;
+    uint64_t offset = AlignIndexSection(
+        sizeof(header) + sections_.size() * sizeof(IndexSectionEntry));
+
+    for (const auto& section : sections_) {
+        uint64_t count = Count(static_cast<IndexSection>(section.entry.id));
+
+        table.push_back(section.entry);
+        table.back().count = count;
+        table.back().offset = offset;
+        offset = AlignIndexSection(offset + (count + IndexSpareRows(count)) *
+                                            section.entry.element_size);
+    }
+
+    target.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    target.write(reinterpret_cast<const char*>(table.data()),
+                 table.size() * sizeof(IndexSectionEntry));
+
+    uint64_t written = sizeof(header) +
+                       table.size() * sizeof(IndexSectionEntry);
+    bool ok = static_cast<bool>(target);
+
+    for (size_t i = 0; i < sections_.size() && ok; i++) {
+        const Section& section = sections_[i];
+
+        ok = WriteZeros(&target, table[i].offset - written) &&
+             CopyBytes(&source, section.entry.offset,
+                       section.entry.count * section.entry.element_size,
+                       &target) &&
+             target.write(reinterpret_cast<const char*>(
+                              section.appended.data()),
+                          section.appended.size());
+        written = table[i].offset + table[i].count * table[i].element_size;
+    }
+
+    ok = ok && WriteZeros(&target, offset - written);
+
+    for (const auto& overwrite : overwrites_) {
+        size_t i = Find(overwrite.first.first) - sections_.data();
+
+        target.seekp(static_cast<std::streamoff>(
+            table[i].offset + overwrite.first.second * table[i].element_size));
+        target.write(reinterpret_cast<const char*>(overwrite.second.data()),
+                     overwrite.second.size());
+    }
+
+    target.close();
+    ok = ok && !target.fail();
+
+    std::error_code error;
+    if (ok) {
+        std::filesystem::rename(temporaryName, filename_, error);
+    }
+
+    if (!ok || error) {
+        std::remove(temporaryName.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+}   // namespace index
+}   // namespace common
+}   // namespace duplitrace
@@ -0,0 +1,142 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#ifndef INDEXUPDATER_H_
+#define INDEXUPDATER_H_
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "IndexFormat.h"
+#include "IndexWriter.h"
+#include "../hashing/Hasher.h"
+
+namespace duplitrace { namespace common { namespace index {
+
+/*
+Updates an existing index file without rewriting it. Rows are added after
+the existing ones and existing rows are overwritten, rows are never moved,
+so the ids of directories, files and groups stay valid. Files and groups
+that have gone are marked as removed rather than taken out.
+
+Changes are held in memory until Write(). When every section has room for
+its new rows they are written into the file in place, otherwise the file is
+rewritten with fresh spare rows. A reader that already has the index open
+may see part of an update made in place, one opened afterwards sees all of
+it. Directory and name ids of the files added are ids in the index, not in
+a path store. An updater is not thread safe.
+*/
+class IndexUpdater {
+ public:
+    IndexUpdater();
+
+    IndexUpdater(const IndexUpdater&) = delete;
+    IndexUpdater& operator=(const IndexUpdater&) = delete;
+
+    bool Open(const std::string& filename);
+
+    uint64_t StringCount() const;
+
+    uint64_t DirectoryCount() const {
+        return Count(IndexSection::DIRECTORY_PARENTS);
+    }
+
+    uint64_t FileCount() const { return Count(IndexSection::FILE_SIZES); }
+
+    uint64_t GroupCount() const { return Count(IndexSection::GROUP_SIZES); }
+
+    uint64_t LinkGroupCount() const {
+        return Count(IndexSection::LINK_GROUP_KINDS);
+    }
+
+    uint32_t AddString(std::string_view value);
+
+    uint32_t AddDirectory(uint32_t parent, uint32_t name);
+
+    uint64_t AddFile(const IndexFileEntry& file);
+
+    void ReplaceFile(uint64_t file, const IndexFileEntry& entry);
+
+    void RemoveFile(uint64_t file);
+
+    void SetDigest(uint64_t file, const hashing::HashDigest& digest);
+
+    void AddDuplicateGroup(uint64_t size, const std::vector<uint64_t>& files);
+
+    void RemoveGroup(uint64_t group);
+
+    void AddLinkGroup(IndexLinkKind kind, const std::vector<uint64_t>& files);
+
+    void RemoveLinkGroup(uint64_t group);
+
+    bool Changed() const { return changed_; }
+
+    bool Write(bool* inPlace = nullptr);
+
+ private:
+    struct Section {
+        IndexSectionEntry entry;
+
+        // Rows that fit before the next section, or the end of the file.
+        uint64_t capacity;
+
+        std::vector<uint8_t> appended;
+    };
+
+    std::string filename_;
+    IndexHeader header_;
+    std::vector<Section> sections_;
+    std::map<std::pair<IndexSection, uint64_t>, std::vector<uint8_t>>
+        overwrites_;
+    bool changed_;
+
+    Section* Find(IndexSection id);
+
+    const Section* Find(IndexSection id) const;
+
+    uint64_t Count(IndexSection id) const;
+
+    void AppendRow(IndexSection id, const void* value);
+
+    void SetRow(IndexSection id, uint64_t row, const void* value);
+
+    template <typename T>
+    void Append(IndexSection id, T value) {
+        AppendRow(id, &value);
+    }
+
+    template <typename T>
+    void Set(IndexSection id, uint64_t row, T value) {
+        SetRow(id, row, &value);
+    }
+
+    void AppendOffset(IndexSection id, uint64_t offset);
+
+    bool WriteInPlace();
+
+    bool Rewrite();
+};
+
+}   // namespace index
+}   // namespace common
+}   // namespace duplitrace
+
+#endif  // INDEXUPDATER_H_
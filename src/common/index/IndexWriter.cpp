@@ -0,0 +1,268 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <functional>
+#include <system_error>
+#include "IndexWriter.h"
+
+namespace duplitrace { namespace common { namespace index {
+
+static_assert(INDEX_NO_DIRECTORY == PATH_STORE_NO_DIRECTORY,
+              "path store directory ids are written as-is");
+
+// A section waiting to be written, its data is produced by the write
+// function when the file is written.
+struct PendingSection {
+    IndexSection id;
+    uint32_t element_size;
+    uint64_t count;
+    std::function<bool(std::FILE*)> write;
+};
+
+static bool WriteBytes(std::FILE* file, const void* data, size_t length) {
+    return std::fwrite(data, 1, length, file) == length;
+}
+
+template <typename T>
+static PendingSection Column(IndexSection id, const std::vector<T>& values) {
+    return { id, sizeof(T), values.size(), [&values](std::FILE* file) {
+        return WriteBytes(file, values.data(), values.size() * sizeof(T));
+    } };
+}
+
+// Write a column of a value per path store entry, without building it in
+// memory first.
+template <typename T, typename Generator>
+static PendingSection GeneratedColumn(IndexSection id, uint64_t count,
+                                      Generator generator) {
+    return { id, sizeof(T), count, [count, generator](std::FILE* file) {
+        for (uint64_t i = 0; i < count; i++) {
+            T value = generator(i);
+            if (!WriteBytes(file, &value, sizeof(value))) {
+                return false;
+            }
+        }
+        return true;
+    } };
+}
+
+static bool WriteZeros(std::FILE* file, uint64_t length) {
+    static const char ZEROS[4096] = {};
+
+    while (length) {
+        size_t chunk = static_cast<size_t>(
+            std::min<uint64_t>(length, sizeof(ZEROS)));
+        if (!WriteBytes(file, ZEROS, chunk)) {
+            return false;
+        }
+        length -= chunk;
+    }
+
+    return true;
+}
+
+IndexWriter::IndexWriter(hashing::HashAlgorithm algorithm,
+                         const PathStore& paths) :
+    algorithm_(algorithm),
+    digest_size_(hashing::HashDigestSize(algorithm)),
+    paths_(&paths),
+    group_member_offsets_({ 0 }),
+    link_group_member_offsets_({ 0 }) {
+}
+
+/*
+Add a file, its digest is all zeros until SetDigest() is called.
+
+returns:
+    Id of the new file.
+*/
+uint64_t IndexWriter::AddFile(const IndexFileEntry& file) {
+    file_directories_.push_back(file.directory);
+    file_names_.push_back(file.name);
+    file_sizes_.push_back(file.size);
+    file_modified_times_.push_back(file.modified_time_ns);
+    file_devices_.push_back(file.device);
+    file_inodes_.push_back(file.inode);
+    file_changed_times_.push_back(file.changed_time_ns);
+    file_digests_.resize(file_digests_.size() + digest_size_, 0);
+
+    return file_sizes_.size() - 1;
+}
+
+void IndexWriter::SetDigest(uint64_t file,
+                            const hashing::HashDigest& digest) {
+    std::memcpy(file_digests_.data() + file * digest_size_,
+                digest.bytes.data(), std::min(digest.size, digest_size_));
+}
+
+void IndexWriter::CopyDigest(uint64_t from, uint64_t to) {
+    std::memcpy(file_digests_.data() + to * digest_size_,
+                file_digests_.data() + from * digest_size_, digest_size_);
+}
+
+void IndexWriter::AddDuplicateGroup(uint64_t size,
+                                    const std::vector<uint64_t>& files) {
+    group_sizes_.push_back(size);
+    group_members_.insert(group_members_.end(), files.begin(), files.end());
+    group_member_offsets_.push_back(group_members_.size());
+}
+
+// Record files whose contents are shared, e.g. hard links to one inode.
+void IndexWriter::AddLinkGroup(IndexLinkKind kind,
+                               const std::vector<uint64_t>& files) {
+    link_group_kinds_.push_back(static_cast<uint8_t>(kind));
+    link_group_members_.insert(link_group_members_.end(), files.begin(),
+                               files.end());
+    link_group_member_offsets_.push_back(link_group_members_.size());
+}
+
+/*
+Write the index to a file. It is written to a temporary file first and then
+renamed, so readers never see a partly written index. Each section is
+followed by spare rows, which IndexUpdater fills when the index is updated.
+
+returns:
+    False if the file could not be written.
+*/
+bool IndexWriter::Write(const std::string& filename) const {
+    const PathStore& paths = *paths_;
+    uint32_t nameCount = paths.NameCount();
+    uint32_t directoryCount = paths.DirectoryCount();
+    uint64_t nameOffset = 0;
+
+    const PendingSection sections[] = {
+        { IndexSection::STRING_DATA, 1, paths.NameBytes(),
+          [&paths, nameCount](std::FILE* file) {
+              for (uint32_t i = 0; i < nameCount; i++) {
+                  std::string_view name = paths.Name(i);
+                  if (!WriteBytes(file, name.data(), name.size())) {
+                      return false;
+                  }
+              }
+              return true;
+          } },
+        GeneratedColumn<uint64_t>(IndexSection::STRING_OFFSETS,
+                                  nameCount + 1ULL,
+            [&paths, &nameOffset, nameCount](uint64_t i) {
+                uint64_t offset = nameOffset;
+                if (i < nameCount) {
+                    nameOffset += paths.Name(static_cast<uint32_t>(i)).size();
+                }
+                return offset;
+            }),
+        GeneratedColumn<uint32_t>(IndexSection::DIRECTORY_PARENTS,
+                                  directoryCount,
+            [&paths](uint64_t i) {
+                return paths.DirectoryParent(static_cast<uint32_t>(i));
+            }),
+        GeneratedColumn<uint32_t>(IndexSection::DIRECTORY_NAMES,
+                                  directoryCount,
+            [&paths](uint64_t i) {
+                return paths.DirectoryName(static_cast<uint32_t>(i));
+            }),
+        Column(IndexSection::FILE_DIRECTORIES, file_directories_),
+        Column(IndexSection::FILE_NAMES, file_names_),
+        Column(IndexSection::FILE_SIZES, file_sizes_),
+        Column(IndexSection::FILE_MODIFIED_TIMES, file_modified_times_),
+        Column(IndexSection::FILE_DEVICES, file_devices_),
+        Column(IndexSection::FILE_INODES, file_inodes_),
+        { IndexSection::FILE_DIGESTS, static_cast<uint32_t>(digest_size_),
+          file_sizes_.size(), [this](std::FILE* file) {
+              return WriteBytes(file, file_digests_.data(),
+                                file_digests_.size());
+          } },
+        Column(IndexSection::GROUP_SIZES, group_sizes_),
+        Column(IndexSection::GROUP_MEMBER_OFFSETS, group_member_offsets_),
+        Column(IndexSection::GROUP_MEMBERS, group_members_),
+        Column(IndexSection::FILE_CHANGED_TIMES, file_changed_times_),
+        Column(IndexSection::LINK_GROUP_KINDS, link_group_kinds_),
+        Column(IndexSection::LINK_GROUP_MEMBER_OFFSETS,
+               link_group_member_offsets_),
+        Column(IndexSection::LINK_GROUP_MEMBERS, link_group_members_)
+    };
+    const size_t sectionCount = sizeof(sections) / sizeof(sections[0]);
+
+    IndexHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, INDEX_MAGIC, sizeof(header.magic));
+    header.version = INDEX_VERSION;
+    header.section_count = sectionCount;
+    header.digest_size = static_cast<uint32_t>(digest_size_);
+    header.hash_algorithm = static_cast<uint32_t>(algorithm_);
+    header.created_time = static_cast<int64_t>(std::time(nullptr));
+
+    std::vector<IndexSectionEntry> table(sectionCount);
+    uint64_t offset = AlignIndexSection(
+        sizeof(header) + sectionCount * sizeof(IndexSectionEntry));
+
+    for (size_t i = 0; i < sectionCount; i++) {
+        table[i].id = static_cast<uint32_t>(sections[i].id);
+        table[i].element_size = sections[i].element_size;
+        table[i].count = sections[i].count;
+        table[i].offset = offset;
+        offset = AlignIndexSection(
+            offset + (sections[i].count + IndexSpareRows(sections[i].count)) *
+                     sections[i].element_size);
+    }
+
+    std::string temporaryName = filename + ".tmp";
+    std::FILE* file = std::fopen(temporaryName.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+
+    uint64_t written = sizeof(header) + table.size() * sizeof(table[0]);
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+              std::fwrite(table.data(), sizeof(table[0]), table.size(),
+                          file) == table.size();
+
+    for (size_t i = 0; i < sectionCount && ok; i++) {
+        uint64_t length = sections[i].count * sections[i].element_size;
+
+        ok = WriteZeros(file, table[i].offset - written) &&
+             sections[i].write(file);
+        written = table[i].offset + length;
+    }
+
+    // The last section's spare rows run to the end of the file.
+    ok = ok && WriteZeros(file, offset - written);
+
+    ok = std::fclose(file) == 0 && ok;
+
+    std::error_code error;
+    if (ok) {
+        std::filesystem::rename(temporaryName, filename, error);
+    }
+
+    if (!ok || error) {
+        std::remove(temporaryName.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+}   // namespace index
+}   // namespace common
+}   // namespace duplitrace
@@ -0,0 +1,93 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#ifndef INDEXWRITER_H_
+#define INDEXWRITER_H_
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "IndexFormat.h"
+#include "../PathStore.h"
+#include "../hashing/Hasher.h"
+
+namespace duplitrace { namespace common { namespace index {
+
+// A file, its directory and name are ids in the writer's path store.
+struct IndexFileEntry {
+    uint32_t directory;
+    uint32_t name;
+    uint64_t size;
+    int64_t modified_time_ns;
+    uint64_t device;
+    uint64_t inode;
+    int64_t changed_time_ns;
+};
+
+/*
+Builds an index in memory, a column at a time, and writes it out in one go.
+Directories and path segments are taken from a path store, whose ids are
+used as-is, so the store must outlive the writer. A writer is not thread
+safe.
+*/
+class IndexWriter {
+ public:
+    IndexWriter(hashing::HashAlgorithm algorithm, const PathStore& paths);
+
+    uint64_t AddFile(const IndexFileEntry& file);
+
+    void SetDigest(uint64_t file, const hashing::HashDigest& digest);
+
+    void CopyDigest(uint64_t from, uint64_t to);
+
+    void AddDuplicateGroup(uint64_t size, const std::vector<uint64_t>& files);
+
+    void AddLinkGroup(IndexLinkKind kind, const std::vector<uint64_t>& files);
+
+    uint64_t FileCount() const { return file_sizes_.size(); }
+
+    bool Write(const std::string& filename) const;
+
+ private:
+    hashing::HashAlgorithm algorithm_;
+    size_t digest_size_;
+    const PathStore* paths_;
+
+    std::vector<uint32_t> file_directories_;
+    std::vector<uint32_t> file_names_;
+    std::vector<uint64_t> file_sizes_;
+    std::vector<int64_t> file_modified_times_;
+    std::vector<uint64_t> file_devices_;
+    std::vector<uint64_t> file_inodes_;
+    std::vector<int64_t> file_changed_times_;
+    std::vector<uint8_t> file_digests_;
+
+    std::vector<uint64_t> group_sizes_;
+    std::vector<uint64_t> group_member_offsets_;
+    std::vector<uint64_t> group_members_;
+
+    std::vector<uint8_t> link_group_kinds_;
+    std::vector<uint64_t> link_group_member_offsets_;
+    std::vector<uint64_t> link_group_members_;
+};
+
+}   // namespace index
+}   // namespace common
+}   // namespace duplitrace
+
+#endif  // INDEXWRITER_H_
@@ -0,0 +1,149 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#include <algorithm>
+#include "ChangeWatcher.h"
+#include "FanotifyChangeWatcher.h"
+#include "InotifyChangeWatcher.h"
+
+namespace duplitrace { namespace common { namespace io {
+
+void DirtyDirectorySet::Mark(const std::string& path, bool recursive) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    directories_[path] |= recursive;
+}
+
+bool DirtyDirectorySet::Empty() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    return directories_.empty();
+}
+
+/*
+Take every dirty directory, leaving the set empty. Directories that are
+below a recursively dirty directory are dropped as they are covered by it.
+
+returns:
+    Dirty directories, sorted by path.
+*/
+std::vector<DirtyDirectory> DirtyDirectorySet::Take() {
+    std::unordered_map<std::string, bool> directories;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        directories.swap(directories_);
+    }
+
+    std::vector<DirtyDirectory> taken;
+
+    for (const auto& directory : directories) {
+        bool covered = false;
+        std::string ancestor = directory.first;
+
+        for (size_t end = ancestor.rfind('/');
+             end != std::string::npos && end > 0 && !covered;
+             end = ancestor.rfind('/')) {
+            ancestor.resize(end);
+
+            auto found = directories.find(ancestor);
+            covered = found != directories.end() && found->second;
+        }
+
+        if (!covered) {
+            taken.push_back({ directory.first, directory.second });
+        }
+    }
+
+    std::sort(taken.begin(), taken.end(),
+              [](const DirtyDirectory& left, const DirtyDirectory& right) {
+                  return left.path < right.path;
+              });
+
+    return taken;
+}
+
+/*
+Create a watcher for a directory tree. fanotify needs privileges and a
+recent kernel (5.9), so it is only used when it can be set up.
+
+returns:
+    New watcher, or null if the tree cannot be watched with any back-end.
+*/
+std::unique_ptr<ChangeWatcher> CreateChangeWatcher(
+        ChangeWatcherBackend backend, const std::string& root,
+        DirtyDirectorySet* dirty) {
+    if (backend != ChangeWatcherBackend::INOTIFY) {
+        auto watcher = std::make_unique<FanotifyChangeWatcher>(root, dirty);
+
+        if (watcher->Initialise()) {
+            return watcher;
+        }
+
+        if (backend == ChangeWatcherBackend::FANOTIFY) {
+            return nullptr;
+        }
+    }
+
+    auto watcher = std::make_unique<InotifyChangeWatcher>(root, dirty);
+    if (!watcher->Initialise()) {
+        return nullptr;
+    }
+
+    return watcher;
+}
+
+std::string ChangeWatcherBackendName(ChangeWatcherBackend backend) {
+    switch (backend) {
+        case ChangeWatcherBackend::AUTOMATIC:
+            return "AUTOMATIC";
+
+        case ChangeWatcherBackend::FANOTIFY:
+            return "FANOTIFY";
+
+        case ChangeWatcherBackend::INOTIFY:
+            return "INOTIFY";
+    }
+
+    return "unknown";
+}
+
+/*
+Look up a back-end by its name, as used in the configuration file.
+
+returns:
+    True if the name is a known back-end.
+*/
+bool ChangeWatcherBackendFromName(std::string_view name,
+                                  ChangeWatcherBackend* backend) {
+    for (ChangeWatcherBackend candidate : {
+            ChangeWatcherBackend::AUTOMATIC,
+            ChangeWatcherBackend::FANOTIFY,
+            ChangeWatcherBackend::INOTIFY }) {
+        if (ChangeWatcherBackendName(candidate) == name) {
+            *backend = candidate;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+}   // namespace io
+}   // namespace common
+}   // namespace duplitrace
@@ -0,0 +1,104 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#ifndef CHANGEWATCHER_H_
+#define CHANGEWATCHER_H_
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace duplitrace { namespace common { namespace io {
+
+enum class ChangeWatcherBackend {
+    // fanotify when the process is privileged enough, otherwise inotify.
+    AUTOMATIC,
+
+    // A single filesystem-wide fanotify mark, needs CAP_SYS_ADMIN and
+    // CAP_DAC_READ_SEARCH.
+    FANOTIFY,
+
+    // An inotify watch on every directory in the tree.
+    INOTIFY
+};
+
+struct DirtyDirectory {
+    std::string path;
+
+    // Set when everything below the directory may have changed as well, e.g.
+    // it was created, moved or deleted, or change events were lost.
+    bool recursive;
+};
+
+/*
+Directories that have had changes since they were last taken, each is held
+once however many events it had. Safe to mark from one thread while another
+takes.
+*/
+class DirtyDirectorySet {
+ public:
+    void Mark(const std::string& path, bool recursive);
+
+    bool Empty() const;
+
+    std::vector<DirtyDirectory> Take();
+
+ private:
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, bool> directories_;
+};
+
+/*
+Watches a directory tree and marks the directories that changes happen in as
+dirty. A watcher has no thread of its own, its file descriptor becomes
+readable when events are waiting and ProcessEvents() then reads them without
+blocking, so it can be driven by an event loop.
+*/
+class ChangeWatcher {
+ public:
+    virtual ~ChangeWatcher() = default;
+
+    virtual ChangeWatcherBackend Backend() const = 0;
+
+    virtual int FileDescriptor() const = 0;
+
+    virtual void ProcessEvents() = 0;
+
+    // Number of directories that could not be watched, changes in them are
+    // only picked up by a full scan.
+    virtual uint64_t UnwatchedDirectories() const { return 0; }
+};
+
+std::unique_ptr<ChangeWatcher> CreateChangeWatcher(
+    ChangeWatcherBackend backend, const std::string& root,
+    DirtyDirectorySet* dirty);
+
+std::string ChangeWatcherBackendName(ChangeWatcherBackend backend);
+
+bool ChangeWatcherBackendFromName(std::string_view name,
+                                  ChangeWatcherBackend* backend);
+
+}   // namespace io
+}   // namespace common
+}   // namespace duplitrace
+
+#endif  // CHANGEWATCHER_H_
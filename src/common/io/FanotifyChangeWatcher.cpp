@@ -0,0 +1,242 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include "FanotifyChangeWatcher.h"
+#include "../Platform.h"
+
+#if DUPLITRACE_PLATFORM == DUPLITRACE_PLATFORM_LINUX
+#include <fcntl.h>
+#include <sys/fanotify.h>
+#include <unistd.h>
+
+#if defined(FAN_REPORT_DFID_NAME) && defined(FAN_MARK_FILESYSTEM)
+#  define FANOTIFY_WATCHER_AVAILABLE 1
+#endif
+#endif
+
+namespace duplitrace { namespace common { namespace io {
+
+// Size of the buffer events are read into, enough for many events at once.
+const size_t FANOTIFY_BUFFER_SIZE = 64 * 1024;
+
+// Resolved directory handles are forgotten once there are this many.
+const size_t FANOTIFY_MAXIMUM_CACHED_DIRECTORIES = 64 * 1024;
+
+FanotifyChangeWatcher::FanotifyChangeWatcher(const std::string& root,
+                                             DirtyDirectorySet* dirty) :
+    root_(root),
+    dirty_(dirty),
+    fd_(-1),
+    mount_fd_(-1),
+    buffer_(FANOTIFY_BUFFER_SIZE) {
+    while (root_.size() > 1 && root_.back() == '/') {
+        root_.pop_back();
+    }
+}
+
+// Mark a resolved path as dirty if it is in the tree.
+void FanotifyChangeWatcher::Mark(const std::string& path, bool recursive) {
+    const std::string& resolved = resolved_root_;
+
+    if (path.compare(0, resolved.size(), resolved) != 0) {
+        return;
+    }
+
+    if (path.size() == resolved.size()) {
+        dirty_->Mark(root_, recursive);
+    } else if (resolved == "/") {
+        dirty_->Mark(root_ == "/" ? path : root_ + path, recursive);
+    } else if (path[resolved.size()] == '/') {
+        dirty_->Mark(root_ + path.substr(resolved.size()), recursive);
+    }
+}
+
+#if defined(FANOTIFY_WATCHER_AVAILABLE)
+
+const uint64_t FANOTIFY_EVENT_MASK = FAN_CREATE | FAN_DELETE | FAN_MODIFY |
+                                     FAN_ATTRIB | FAN_MOVED_FROM |
+                                     FAN_MOVED_TO | FAN_DELETE_SELF |
+                                     FAN_MOVE_SELF | FAN_ONDIR;
+
+// Events that change which directories exist.
+const uint64_t FANOTIFY_DIRECTORY_EVENTS = FAN_CREATE | FAN_DELETE |
+                                           FAN_MOVED_FROM | FAN_MOVED_TO;
+
+FanotifyChangeWatcher::~FanotifyChangeWatcher() {
+    if (fd_ != -1) {
+        close(fd_);
+    }
+
+    if (mount_fd_ != -1) {
+        close(mount_fd_);
+    }
+}
+
+/*
+Mark the filesystem the tree is on. Paths reported by the kernel are fully
+resolved, so the root is resolved too before they are compared.
+
+returns:
+    False if fanotify is unavailable or the process lacks the privileges.
+*/
+bool FanotifyChangeWatcher::Initialise() {
+    char resolved[PATH_MAX];
+    if (!realpath(root_.c_str(), resolved)) {
+        return false;
+    }
+    resolved_root_ = resolved;
+
+    fd_ = fanotify_init(FAN_CLASS_NOTIF | FAN_CLOEXEC | FAN_NONBLOCK |
+                        FAN_REPORT_DFID_NAME, O_RDONLY | O_LARGEFILE);
+    if (fd_ == -1) {
+        return false;
+    }
+
+    mount_fd_ = open(resolved, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+    return mount_fd_ != -1 &&
+           fanotify_mark(fd_, FAN_MARK_ADD | FAN_MARK_FILESYSTEM,
+                         FANOTIFY_EVENT_MASK, AT_FDCWD, resolved) == 0;
+}
+
+void FanotifyChangeWatcher::ProcessEvents() {
+    while (true) {
+        ssize_t length = read(fd_, buffer_.data(), buffer_.size());
+        if (length <= 0) {
+            break;
+        }
+
+        auto event = reinterpret_cast<const struct fanotify_event_metadata*>(
+            buffer_.data());
+
+        for (; FAN_EVENT_OK(event, length);
+             event = FAN_EVENT_NEXT(event, length)) {
+            if (event->vers != FANOTIFY_METADATA_VERSION) {
+                return;
+            }
+
+            // Events were dropped, so anything may have changed.
+            if (event->mask & FAN_Q_OVERFLOW) {
+                dirty_->Mark(root_, true);
+                continue;
+            }
+
+            auto info = reinterpret_cast<const struct fanotify_event_info_fid*>(
+                reinterpret_cast<const char*>(event) + event->metadata_len);
+            if (event->event_len <= event->metadata_len ||
+                info->hdr.info_type != FAN_EVENT_INFO_TYPE_DFID_NAME) {
+                continue;
+            }
+
+            // The name follows the directory's file handle.
+            auto handle =
+                reinterpret_cast<const struct file_handle*>(info->handle);
+            std::string name(reinterpret_cast<const char*>(
+                handle->f_handle + handle->handle_bytes));
+
+            std::string directory;
+            if (!ResolveDirectory(handle, &directory)) {
+                continue;
+            }
+
+            std::string path = name == "." ? directory :
+                               directory + "/" + name;
+
+            if (!(event->mask & FAN_ONDIR)) {
+                Mark(directory, false);
+            } else if (event->mask & (FANOTIFY_DIRECTORY_EVENTS |
+                                      FAN_DELETE_SELF | FAN_MOVE_SELF)) {
+                // Cached paths below a moved directory are now wrong.
+                directory_paths_.clear();
+                Mark(path, true);
+            }
+        }
+    }
+}
+
+/*
+Find the path of the directory a file handle refers to, through the link in
+/proc for a descriptor opened by handle.
+
+returns:
+    False if the directory no longer exists.
+*/
+bool FanotifyChangeWatcher::ResolveDirectory(const void* handle,
+                                             std::string* path) {
+    auto fileHandle = static_cast<const struct file_handle*>(handle);
+    std::string key(static_cast<const char*>(handle),
+                    sizeof(struct file_handle) + fileHandle->handle_bytes);
+
+    auto found = directory_paths_.find(key);
+    if (found != directory_paths_.end()) {
+        *path = found->second;
+        return true;
+    }
+
+    int fd = open_by_handle_at(mount_fd_,
+                               const_cast<struct file_handle*>(fileHandle),
+                               O_PATH | O_CLOEXEC);
+    if (fd == -1) {
+        return false;
+    }
+
+    char link[64];
+    char target[PATH_MAX];
+    snprintf(link, sizeof(link), "/proc/self/fd/%d", fd);
+    ssize_t length = readlink(link, target, sizeof(target));
+    close(fd);
+
+    if (length <= 0 || static_cast<size_t>(length) >= sizeof(target)) {
+        return false;
+    }
+
+    if (directory_paths_.size() >= FANOTIFY_MAXIMUM_CACHED_DIRECTORIES) {
+        directory_paths_.clear();
+    }
+
+    path->assign(target, static_cast<size_t>(length));
+    directory_paths_.emplace(std::move(key), *path);
+
+    return true;
+}
+
+#else
+
+FanotifyChangeWatcher::~FanotifyChangeWatcher() {
+}
+
+bool FanotifyChangeWatcher::Initialise() {
+    return false;
+}
+
+void FanotifyChangeWatcher::ProcessEvents() {
+}
+
+bool FanotifyChangeWatcher::ResolveDirectory(const void*, std::string*) {
+    return false;
+}
+
+#endif
+
+}   // namespace io
+}   // namespace common
+}   // namespace duplitrace
@@ -0,0 +1,74 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#ifndef FANOTIFYCHANGEWATCHER_H_
+#define FANOTIFYCHANGEWATCHER_H_
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "ChangeWatcher.h"
+
+namespace duplitrace { namespace common { namespace io {
+
+/*
+Watcher with a single fanotify mark on the whole filesystem the tree is on,
+so no per-directory setup is needed however large the tree is. Events name
+the directory they happened in by file handle, which is resolved to a path
+and dropped if it is outside the tree. Resolved handles are cached until a
+directory is moved or deleted. Dirty paths are reported under the root as it
+was given, even if it is reached through a symbolic link.
+*/
+class FanotifyChangeWatcher : public ChangeWatcher {
+ public:
+    FanotifyChangeWatcher(const std::string& root, DirtyDirectorySet* dirty);
+
+    ~FanotifyChangeWatcher() override;
+
+    FanotifyChangeWatcher(const FanotifyChangeWatcher&) = delete;
+    FanotifyChangeWatcher& operator=(const FanotifyChangeWatcher&) = delete;
+
+    bool Initialise();
+
+    ChangeWatcherBackend Backend() const override {
+        return ChangeWatcherBackend::FANOTIFY;
+    }
+
+    int FileDescriptor() const override { return fd_; }
+
+    void ProcessEvents() override;
+
+ private:
+    std::string root_;
+    std::string resolved_root_;
+    DirtyDirectorySet* dirty_;
+    int fd_;
+    int mount_fd_;
+    std::vector<char> buffer_;
+    std::unordered_map<std::string, std::string> directory_paths_;
+
+    bool ResolveDirectory(const void* handle, std::string* path);
+
+    void Mark(const std::string& path, bool recursive);
+};
+
+}   // namespace io
+}   // namespace common
+}   // namespace duplitrace
+
+#endif  // FANOTIFYCHANGEWATCHER_H_
@@ -0,0 +1,143 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#include <sys/stat.h>
+#include <charconv>
+#include "FileReader.h"
+#include "IoUringFileReader.h"
+#include "PreadFileReader.h"
+#include "../Utilities.h"
+
+namespace duplitrace { namespace common { namespace io {
+
+/*
+Create a reader for the configured back-end. io_uring can be missing (old
+kernels, non-Linux platforms) or disabled (seccomp profiles, the
+kernel.io_uring_disabled sysctl), in which case the pread back-end is used
+even if io_uring was asked for.
+
+returns:
+    New reader, never null.
+*/
+std::unique_ptr<FileReader> CreateFileReader(
+        const FileReaderSettings& settings) {
+    if (settings.backend != FileReaderBackend::PREAD) {
+        auto reader = std::make_unique<IoUringFileReader>(settings);
+
+        if (reader->Initialise()) {
+            return reader;
+        }
+    }
+
+    return std::make_unique<PreadFileReader>(settings);
+}
+
+std::string FileReaderBackendName(FileReaderBackend backend) {
+    switch (backend) {
+        case FileReaderBackend::AUTOMATIC:
+            return "AUTOMATIC";
+
+        case FileReaderBackend::IO_URING:
+            return "IO_URING";
+
+        case FileReaderBackend::PREAD:
+            return "PREAD";
+    }
+
+    return "unknown";
+}
+
+/*
+Look up a back-end by its name, as used in the configuration file.
+
+returns:
+    True if the name is a known back-end.
+*/
+bool FileReaderBackendFromName(std::string_view name,
+                               FileReaderBackend* backend) {
+    for (FileReaderBackend candidate : { FileReaderBackend::AUTOMATIC,
+                                         FileReaderBackend::IO_URING,
+                                         FileReaderBackend::PREAD }) {
+        if (FileReaderBackendName(candidate) == name) {
+            *backend = candidate;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*
+Get the maximum number of reads that may be in flight on a device.
+
+returns:
+    The device's own queue depth if it has one, otherwise the default.
+*/
+size_t DeviceQueueDepth(const FileReaderSettings& settings, uint64_t device) {
+    auto entry = settings.device_queue_depths.find(device);
+    size_t depth = entry != settings.device_queue_depths.end() ?
+                   entry->second : settings.queue_depth;
+
+    return depth ? depth : 1;
+}
+
+/*
+Parse a comma separated list of path:depth entries, e.g. "/mnt/nas:16".
+Each path is resolved to the device it is on, so any path on a device can be
+used to set its queue depth.
+
+returns:
+    False if an entry is malformed or its path does not exist, badEntry is
+    set to the entry.
+*/
+bool ParseDeviceQueueDepths(std::string_view text,
+                            std::unordered_map<uint64_t, size_t>* depths,
+                            std::string* badEntry) {
+    for (std::string_view entry : StringSplitter(text, ',')) {
+        if (entry.empty()) {
+            continue;
+        }
+
+        size_t separator = entry.rfind(':');
+        size_t depth = 0;
+        std::from_chars_result parsed { nullptr, std::errc::invalid_argument };
+        struct stat status;
+
+        if (separator != std::string_view::npos) {
+            parsed = std::from_chars(entry.data() + separator + 1,
+                                     entry.data() + entry.size(), depth);
+        }
+
+        if (parsed.ec != std::errc() ||
+            parsed.ptr != entry.data() + entry.size() || depth == 0 ||
+            stat(std::string(entry.substr(0, separator)).c_str(),
+                 &status) != 0) {
+            *badEntry = entry;
+            return false;
+        }
+
+        (*depths)[static_cast<uint64_t>(status.st_dev)] = depth;
+    }
+
+    return true;
+}
+
+}   // namespace io
+}   // namespace common
+}   // namespace duplitrace
@@ -0,0 +1,119 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#ifndef FILEREADER_H_
+#define FILEREADER_H_
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace duplitrace { namespace common { namespace io {
+
+enum class FileReaderBackend {
+    // io_uring when the kernel supports it, otherwise pread.
+    AUTOMATIC,
+
+    // Batched open/read/close through a Linux io_uring.
+    IO_URING,
+
+    // Blocking reads on a small pool of threads.
+    PREAD
+};
+
+struct FileRange {
+    uint64_t offset;
+    uint64_t length;
+};
+
+// A file to be read, the ranges are read in order and a range that runs
+// past the end of the file stops at the end of the file.
+struct FileReadRequest {
+    std::string path;
+    uint64_t device;
+    std::vector<FileRange> ranges;
+};
+
+// Receives the next block of a request, in file order. Return false to
+// abandon the rest of the request.
+using FileDataHandler = std::function<bool(size_t request,
+                                           const uint8_t* data,
+                                           size_t length)>;
+
+// Called once per request when it has finished, error is 0 on success or
+// an errno value (ECANCELED if the data handler abandoned it).
+using FileCompletedHandler = std::function<void(size_t request, int error)>;
+
+struct FileReaderSettings {
+    FileReaderBackend backend = FileReaderBackend::AUTOMATIC;
+
+    // Maximum number of reads in flight on one device, unless overridden
+    // for that device.
+    size_t queue_depth = 128;
+    std::unordered_map<uint64_t, size_t> device_queue_depths;
+
+    // Size of each read, and of the buffers the data is delivered in.
+    size_t block_size = 64 * 1024;
+
+    // Number of threads used by the pread back-end.
+    size_t thread_count = 4;
+};
+
+/*
+Reads batches of files and passes their contents to a handler block by
+block. A reader is not thread safe, each thread should create its own, but
+the handlers for different requests may be called from different threads
+(by the pread back-end) so they must only share thread safe state.
+*/
+class FileReader {
+ public:
+    virtual ~FileReader() = default;
+
+    virtual FileReaderBackend Backend() const = 0;
+
+    virtual void ReadFiles(const std::vector<FileReadRequest>& requests,
+                           const FileDataHandler& dataHandler,
+                           const FileCompletedHandler& completedHandler) = 0;
+
+    // Number of requests worth passing to a single ReadFiles() call.
+    virtual size_t PreferredBatchSize() const = 0;
+};
+
+std::unique_ptr<FileReader> CreateFileReader(
+    const FileReaderSettings& settings);
+
+std::string FileReaderBackendName(FileReaderBackend backend);
+
+bool FileReaderBackendFromName(std::string_view name,
+                               FileReaderBackend* backend);
+
+size_t DeviceQueueDepth(const FileReaderSettings& settings, uint64_t device);
+
+bool ParseDeviceQueueDepths(std::string_view text,
+                            std::unordered_map<uint64_t, size_t>* depths,
+                            std::string* badEntry);
+
+}   // namespace io
+}   // namespace common
+}   // namespace duplitrace
+
+#endif  // FILEREADER_H_
@@ -0,0 +1,114 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#include "FileWatcher.h"
+#include "../Platform.h"
+
+#if DUPLITRACE_PLATFORM == DUPLITRACE_PLATFORM_LINUX
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace duplitrace { namespace common { namespace io {
+
+// Size of the buffer events are read into.
+const size_t FILE_WATCHER_BUFFER_SIZE = 4096;
+
+FileWatcher::FileWatcher(const std::string& filename) :
+    fd_(-1),
+    buffer_(FILE_WATCHER_BUFFER_SIZE) {
+    size_t separator = filename.rfind('/');
+
+    if (separator == std::string::npos) {
+        directory_ = ".";
+        name_ = filename;
+    } else {
+        directory_ = separator ? filename.substr(0, separator) : "/";
+        name_ = filename.substr(separator + 1);
+    }
+}
+
+#if DUPLITRACE_PLATFORM == DUPLITRACE_PLATFORM_LINUX
+
+FileWatcher::~FileWatcher() {
+    if (fd_ != -1) {
+        close(fd_);
+    }
+}
+
+/*
+Start watching the file's directory.
+
+returns:
+    False if it cannot be watched.
+*/
+bool FileWatcher::Initialise() {
+    fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd_ == -1) {
+        return false;
+    }
+
+    return inotify_add_watch(fd_, directory_.c_str(),
+                             IN_CLOSE_WRITE | IN_MOVED_TO |
+                             IN_ONLYDIR) != -1;
+}
+
+bool FileWatcher::ProcessEvents() {
+    bool changed = false;
+
+    while (true) {
+        ssize_t length = read(fd_, buffer_.data(), buffer_.size());
+        if (length <= 0) {
+            break;
+        }
+
+        for (ssize_t offset = 0; offset < length;) {
+            auto event = reinterpret_cast<const struct inotify_event*>(
+                buffer_.data() + offset);
+            offset += sizeof(struct inotify_event) + event->len;
+
+            // Events were dropped, one of them may have been for the file.
+            if ((event->mask & IN_Q_OVERFLOW) ||
+                (event->len && name_ == event->name)) {
+                changed = true;
+            }
+        }
+    }
+
+    return changed;
+}
+
+#else
+
+FileWatcher::~FileWatcher() {
+}
+
+bool FileWatcher::Initialise() {
+    return false;
+}
+
+bool FileWatcher::ProcessEvents() {
+    return false;
+}
+
+#endif
+
+}   // namespace io
+}   // namespace common
+}   // namespace duplitrace
@@ -0,0 +1,66 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#ifndef FILEWATCHER_H_
+#define FILEWATCHER_H_
+#include <string>
+#include <vector>
+
+namespace duplitrace { namespace common { namespace io {
+
+/*
+Watches a single file, e.g. a configuration file, for being written. The
+directory it is in is watched rather than the file itself, so the file is
+still followed when an editor replaces it by renaming a new copy over it.
+Only Linux (inotify) is supported.
+*/
+class FileWatcher {
+ public:
+    explicit FileWatcher(const std::string& filename);
+
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    bool Initialise();
+
+    // Becomes readable when there are events to process.
+    int FileDescriptor() const { return fd_; }
+
+    /*
+    Read the pending events, without blocking.
+
+    returns:
+        True if the file has been written or replaced since the last call.
+    */
+    bool ProcessEvents();
+
+ private:
+    std::string directory_;
+    std::string name_;
+    int fd_;
+    std::vector<char> buffer_;
+};
+
+}   // namespace io
+}   // namespace common
+}   // namespace duplitrace
+
+#endif  // FILEWATCHER_H_
@@ -0,0 +1,221 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#include <cerrno>
+#include "InotifyChangeWatcher.h"
+#include "../Platform.h"
+
+#if DUPLITRACE_PLATFORM == DUPLITRACE_PLATFORM_LINUX
+#include <dirent.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace duplitrace { namespace common { namespace io {
+
+// Size of the buffer events are read into, enough for many events at once.
+const size_t INOTIFY_BUFFER_SIZE = 64 * 1024;
+
+InotifyChangeWatcher::InotifyChangeWatcher(const std::string& root,
+                                           DirtyDirectorySet* dirty) :
+    root_(root),
+    dirty_(dirty),
+    fd_(-1),
+    buffer_(INOTIFY_BUFFER_SIZE),
+    unwatched_directories_(0) {
+    while (root_.size() > 1 && root_.back() == '/') {
+        root_.pop_back();
+    }
+}
+
+#if DUPLITRACE_PLATFORM == DUPLITRACE_PLATFORM_LINUX
+
+const uint32_t INOTIFY_WATCH_MASK = IN_CREATE | IN_DELETE | IN_MODIFY |
+                                    IN_CLOSE_WRITE | IN_ATTRIB |
+                                    IN_MOVED_FROM | IN_MOVED_TO |
+                                    IN_DELETE_SELF | IN_MOVE_SELF |
+                                    IN_ONLYDIR | IN_DONT_FOLLOW;
+
+InotifyChangeWatcher::~InotifyChangeWatcher() {
+    if (fd_ != -1) {
+        close(fd_);
+    }
+}
+
+/*
+Create the inotify instance and watch every directory that is already in the
+tree, which for a large tree takes a while.
+
+returns:
+    False if the root of the tree could not be watched.
+*/
+bool InotifyChangeWatcher::Initialise() {
+    fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd_ == -1) {
+        return false;
+    }
+
+    WatchTree(root_);
+
+    return !watches_.empty();
+}
+
+void InotifyChangeWatcher::ProcessEvents() {
+    while (true) {
+        ssize_t length = read(fd_, buffer_.data(), buffer_.size());
+        if (length <= 0) {
+            break;
+        }
+
+        for (ssize_t offset = 0; offset < length;) {
+            auto event = reinterpret_cast<const struct inotify_event*>(
+                buffer_.data() + offset);
+            offset += sizeof(struct inotify_event) + event->len;
+
+            // Events were dropped, so anything may have changed.
+            if (event->mask & IN_Q_OVERFLOW) {
+                dirty_->Mark(root_, true);
+                continue;
+            }
+
+            auto watch = watches_.find(event->wd);
+            if (watch == watches_.end()) {
+                continue;
+            }
+
+            if (event->mask & IN_IGNORED) {
+                watches_.erase(watch);
+                continue;
+            }
+
+            const std::string& directory = watch->second;
+
+            if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF)) {
+                if (directory == root_) {
+                    dirty_->Mark(root_, true);
+                }
+                continue;
+            }
+
+            if (!event->len) {
+                continue;
+            }
+
+            std::string path = directory + "/" + event->name;
+
+            if (!(event->mask & IN_ISDIR)) {
+                dirty_->Mark(directory, false);
+            } else if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                WatchTree(path);
+                dirty_->Mark(path, true);
+            } else if (event->mask & IN_MOVED_FROM) {
+                UnwatchTree(path);
+                dirty_->Mark(path, true);
+            } else if (event->mask & IN_DELETE) {
+                dirty_->Mark(path, true);
+            }
+        }
+    }
+}
+
+// Watch a directory and every directory below it.
+void InotifyChangeWatcher::WatchTree(const std::string& path) {
+    std::vector<std::string> pending = { path };
+
+    while (!pending.empty()) {
+        std::string directory = std::move(pending.back());
+        pending.pop_back();
+
+        int watch = inotify_add_watch(fd_, directory.c_str(),
+                                      INOTIFY_WATCH_MASK);
+        if (watch == -1) {
+            if (errno == ENOSPC) {
+                unwatched_directories_++;
+            }
+            continue;
+        }
+
+        watches_[watch] = directory;
+
+        DIR* handle = opendir(directory.c_str());
+        if (!handle) {
+            continue;
+        }
+
+        while (struct dirent* entry = readdir(handle)) {
+            const char* name = entry->d_name;
+            if (name[0] == '.' &&
+                (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+                continue;
+            }
+
+            std::string child = directory + "/" + name;
+            struct stat status;
+
+            if (entry->d_type == DT_DIR ||
+                (entry->d_type == DT_UNKNOWN &&
+                 lstat(child.c_str(), &status) == 0 &&
+                 S_ISDIR(status.st_mode))) {
+                pending.push_back(std::move(child));
+            }
+        }
+
+        closedir(handle);
+    }
+}
+
+// Stop watching a directory that has been moved away, and everything in it.
+void InotifyChangeWatcher::UnwatchTree(const std::string& path) {
+    std::string prefix = path + "/";
+
+    for (auto watch = watches_.begin(); watch != watches_.end();) {
+        if (watch->second == path ||
+            watch->second.compare(0, prefix.size(), prefix) == 0) {
+            inotify_rm_watch(fd_, watch->first);
+            watch = watches_.erase(watch);
+        } else {
+            ++watch;
+        }
+    }
+}
+
+#else
+
+InotifyChangeWatcher::~InotifyChangeWatcher() {
+}
+
+bool InotifyChangeWatcher::Initialise() {
+    return false;
+}
+
+void InotifyChangeWatcher::ProcessEvents() {
+}
+
+void InotifyChangeWatcher::WatchTree(const std::string&) {
+}
+
+void InotifyChangeWatcher::UnwatchTree(const std::string&) {
+}
+
+#endif
+
+}   // namespace io
+}   // namespace common
+}   // namespace duplitrace
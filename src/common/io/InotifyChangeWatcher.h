@@ -0,0 +1,76 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#ifndef INOTIFYCHANGEWATCHER_H_
+#define INOTIFYCHANGEWATCHER_H_
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "ChangeWatcher.h"
+
+namespace duplitrace { namespace common { namespace io {
+
+/*
+Watcher with an inotify watch on every directory of the tree. Watches are
+added for new directories as they appear, and removed for directories that
+are moved away. Each watch costs kernel memory and is limited by
+fs.inotify.max_user_watches, directories over the limit go unwatched.
+*/
+class InotifyChangeWatcher : public ChangeWatcher {
+ public:
+    InotifyChangeWatcher(const std::string& root, DirtyDirectorySet* dirty);
+
+    ~InotifyChangeWatcher() override;
+
+    InotifyChangeWatcher(const InotifyChangeWatcher&) = delete;
+    InotifyChangeWatcher& operator=(const InotifyChangeWatcher&) = delete;
+
+    bool Initialise();
+
+    ChangeWatcherBackend Backend() const override {
+        return ChangeWatcherBackend::INOTIFY;
+    }
+
+    int FileDescriptor() const override { return fd_; }
+
+    void ProcessEvents() override;
+
+    uint64_t UnwatchedDirectories() const override {
+        return unwatched_directories_;
+    }
+
+ private:
+    std::string root_;
+    DirtyDirectorySet* dirty_;
+    int fd_;
+    std::unordered_map<int, std::string> watches_;
+    std::vector<char> buffer_;
+    uint64_t unwatched_directories_;
+
+    void WatchTree(const std::string& path);
+
+    void UnwatchTree(const std::string& path);
+};
+
+}   // namespace io
+}   // namespace common
+}   // namespace duplitrace
+
+#endif  // INOTIFYCHANGEWATCHER_H_
@@ -0,0 +1,517 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include "IoUringFileReader.h"
+#include "../Platform.h"
+
+#if DUPLITRACE_PLATFORM == DUPLITRACE_PLATFORM_LINUX && \
+    __has_include(<linux/io_uring.h>)
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#if defined(__NR_io_uring_setup)
+#  define IO_URING_READER_AVAILABLE 1
+#endif
+#endif
+
+namespace duplitrace { namespace common { namespace io {
+
+// Buffers are registered with one iovec each and the kernel accepts at most
+// UIO_MAXIOV of them.
+const size_t IO_URING_MAXIMUM_SLOTS = 1024;
+
+// Buffers are page aligned and a whole number of pages.
+const size_t IO_URING_BUFFER_ALIGNMENT = 4096;
+
+IoUringFileReader::IoUringFileReader(const FileReaderSettings& settings) :
+    settings_(settings),
+    block_size_(0),
+    ring_fd_(-1),
+    buffers_registered_(false),
+    sq_ring_(nullptr),
+    sq_ring_size_(0),
+    cq_ring_(nullptr),
+    cq_ring_size_(0),
+    sqes_(nullptr),
+    sqes_size_(0),
+    sq_head_(nullptr),
+    sq_tail_(nullptr),
+    sq_mask_(0),
+    sq_array_(nullptr),
+    cq_head_(nullptr),
+    cq_tail_(nullptr),
+    cq_mask_(0),
+    cqes_(nullptr),
+    pending_submissions_(0),
+    buffer_memory_(nullptr) {
+    size_t blockSize = settings.block_size ? settings.block_size : 64 * 1024;
+    block_size_ = (blockSize + IO_URING_BUFFER_ALIGNMENT - 1) /
+                  IO_URING_BUFFER_ALIGNMENT * IO_URING_BUFFER_ALIGNMENT;
+}
+
+#if defined(IO_URING_READER_AVAILABLE)
+
+IoUringFileReader::~IoUringFileReader() {
+    if (sqes_) {
+        munmap(sqes_, sqes_size_);
+    }
+
+    if (cq_ring_ && cq_ring_ != sq_ring_) {
+        munmap(cq_ring_, cq_ring_size_);
+    }
+
+    if (sq_ring_) {
+        munmap(sq_ring_, sq_ring_size_);
+    }
+
+    if (ring_fd_ >= 0) {
+        close(ring_fd_);
+    }
+
+    std::free(buffer_memory_);
+}
+
+/*
+Create the ring and its buffers, one slot for each read that may be in
+flight on the busiest device.
+
+returns:
+    False if io_uring is not available or lacks an operation that is needed,
+    the caller should fall back to another reader.
+*/
+bool IoUringFileReader::Initialise() {
+    size_t slotCount = settings_.queue_depth;
+    for (const auto& device : settings_.device_queue_depths) {
+        slotCount = std::max(slotCount, device.second);
+    }
+    slotCount = std::clamp<size_t>(slotCount, 1, IO_URING_MAXIMUM_SLOTS);
+
+    if (!CreateRing(static_cast<unsigned>(slotCount)) ||
+        !OperationsSupported()) {
+        return false;
+    }
+
+    void* memory = nullptr;
+    if (posix_memalign(&memory, IO_URING_BUFFER_ALIGNMENT,
+                       slotCount * block_size_) != 0) {
+        return false;
+    }
+    buffer_memory_ = static_cast<uint8_t*>(memory);
+
+    slots_.resize(slotCount);
+    for (size_t i = 0; i < slotCount; i++) {
+        slots_[i].buffer = buffer_memory_ + i * block_size_;
+        free_slots_.push_back(slotCount - 1 - i);
+    }
+
+    RegisterBuffers();
+    return true;
+}
+
+/*
+Read a batch of requests. Each device has its requests started in order, up
+to its queue depth, and a new request is started as soon as one finishes.
+*/
+void IoUringFileReader::ReadFiles(
+        const std::vector<FileReadRequest>& requests,
+        const FileDataHandler& dataHandler,
+        const FileCompletedHandler& completedHandler) {
+    for (size_t i = 0; i < requests.size(); i++) {
+        waiting_[requests[i].device].push_back(i);
+    }
+
+    size_t remaining = requests.size();
+    StartWaitingRequests(requests);
+
+    while (remaining) {
+        if (!SubmitAndWait()) {
+            // The ring is unusable, fail whatever is left rather than hang.
+            for (size_t i = 0; i < slots_.size(); i++) {
+                if (slots_[i].state != SlotState::FREE) {
+                    if (slots_[i].fd >= 0) {
+                        close(slots_[i].fd);
+                    }
+                    completedHandler(slots_[i].request, EIO);
+                    ReleaseSlot(i, requests);
+                }
+            }
+
+            for (auto& device : waiting_) {
+                for (size_t request : device.second) {
+                    completedHandler(request, EIO);
+                }
+            }
+            break;
+        }
+
+        unsigned head = *cq_head_;
+        unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+
+        while (head != tail) {
+            const io_uring_cqe& cqe = cqes_[head & cq_mask_];
+            size_t slotIndex = static_cast<size_t>(cqe.user_data);
+            int result = cqe.res;
+            head++;
+
+            if (HandleCompletion(slotIndex, result, requests, dataHandler,
+                                 completedHandler)) {
+                remaining--;
+            }
+        }
+
+        __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+        StartWaitingRequests(requests);
+    }
+
+    waiting_.clear();
+    in_flight_.clear();
+}
+
+size_t IoUringFileReader::PreferredBatchSize() const {
+    return slots_.size() * 2;
+}
+
+bool IoUringFileReader::CreateRing(unsigned entries) {
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+
+    ring_fd_ = static_cast<int>(syscall(__NR_io_uring_setup, entries,
+                                        &params));
+    if (ring_fd_ < 0) {
+        return false;
+    }
+
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size_ = params.cq_off.cqes +
+                    params.cq_entries * sizeof(io_uring_cqe);
+
+    bool singleMapping = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (singleMapping) {
+        sq_ring_size_ = cq_ring_size_ =
+            std::max(sq_ring_size_, cq_ring_size_);
+    }
+
+    sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+    if (sq_ring_ == MAP_FAILED) {
+        sq_ring_ = nullptr;
+        return false;
+    }
+
+    if (singleMapping) {
+        cq_ring_ = sq_ring_;
+    } else {
+        cq_ring_ = mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, ring_fd_,
+                        IORING_OFF_CQ_RING);
+        if (cq_ring_ == MAP_FAILED) {
+            cq_ring_ = nullptr;
+            return false;
+        }
+    }
+
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        return false;
+    }
+    sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+    auto* sq = static_cast<uint8_t*>(sq_ring_);
+    sq_head_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sq_mask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+
+    auto* cq = static_cast<uint8_t*>(cq_ring_);
+    cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cq_mask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+    return true;
+}
+
+// openat and close through io_uring need Linux 5.6 or newer.
+bool IoUringFileReader::OperationsSupported() {
+    const size_t operationCount = 256;
+    std::vector<uint8_t> memory(sizeof(io_uring_probe) +
+                                operationCount * sizeof(io_uring_probe_op));
+    auto* probe = reinterpret_cast<io_uring_probe*>(memory.data());
+
+    if (syscall(__NR_io_uring_register, ring_fd_, IORING_REGISTER_PROBE,
+                probe, operationCount) < 0) {
+        return false;
+    }
+
+    for (int operation : { IORING_OP_OPENAT, IORING_OP_READ,
+                           IORING_OP_READ_FIXED, IORING_OP_CLOSE }) {
+        if (operation > probe->last_op ||
+            !(probe->ops[operation].flags & IO_URING_OP_SUPPORTED)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*
+Registered buffers save the kernel from mapping the pages on every read, but
+before Linux 5.12 they count against RLIMIT_MEMLOCK. If registering fails the
+same buffers are used for ordinary reads instead.
+*/
+void IoUringFileReader::RegisterBuffers() {
+    std::vector<iovec> buffers(slots_.size());
+
+    for (size_t i = 0; i < slots_.size(); i++) {
+        buffers[i].iov_base = slots_[i].buffer;
+        buffers[i].iov_len = block_size_;
+    }
+
+    buffers_registered_ = syscall(__NR_io_uring_register, ring_fd_,
+                                  IORING_REGISTER_BUFFERS, buffers.data(),
+                                  static_cast<unsigned>(buffers.size())) == 0;
+}
+
+// Start waiting requests one device at a time so that a single busy device
+// cannot take every free slot.
+void IoUringFileReader::StartWaitingRequests(
+        const std::vector<FileReadRequest>& requests) {
+    bool started = true;
+
+    while (started && !free_slots_.empty()) {
+        started = false;
+
+        for (auto& device : waiting_) {
+            size_t& inFlight = in_flight_[device.first];
+
+            if (device.second.empty() || free_slots_.empty() ||
+                inFlight >= DeviceQueueDepth(settings_, device.first)) {
+                continue;
+            }
+
+            size_t slotIndex = free_slots_.back();
+            free_slots_.pop_back();
+
+            Slot& slot = slots_[slotIndex];
+            slot.request = device.second.front();
+            slot.range = 0;
+            slot.offset = requests[slot.request].ranges.empty() ?
+                          0 : requests[slot.request].ranges[0].offset;
+            slot.error = 0;
+            device.second.pop_front();
+            inFlight++;
+
+            QueueOpen(slotIndex, requests[slot.request].path.c_str());
+            started = true;
+        }
+    }
+}
+
+/*
+Move a slot on to its next operation once the current one has completed.
+
+returns:
+    True if the slot's request has finished.
+*/
+bool IoUringFileReader::HandleCompletion(
+        size_t slotIndex, int result,
+        const std::vector<FileReadRequest>& requests,
+        const FileDataHandler& dataHandler,
+        const FileCompletedHandler& completedHandler) {
+    Slot& slot = slots_[slotIndex];
+
+    if (slot.state == SlotState::CLOSING) {
+        completedHandler(slot.request, slot.error);
+        ReleaseSlot(slotIndex, requests);
+        return true;
+    }
+
+    if (slot.state == SlotState::OPENING) {
+        if (result < 0) {
+            completedHandler(slot.request, -result);
+            ReleaseSlot(slotIndex, requests);
+            return true;
+        }
+
+        slot.fd = result;
+        QueueNextRead(slotIndex, requests);
+        return false;
+    }
+
+    // Otherwise the slot is reading.
+    if (result == -EINTR || result == -EAGAIN) {
+        QueueNextRead(slotIndex, requests);
+    } else if (result < 0) {
+        slot.error = -result;
+        QueueClose(slotIndex);
+    } else if (result == 0) {
+        // The file is shorter than the range, skip to the next range.
+        const auto& ranges = requests[slot.request].ranges;
+        slot.range++;
+        slot.offset = slot.range < ranges.size() ?
+                      ranges[slot.range].offset : 0;
+        QueueNextRead(slotIndex, requests);
+    } else if (!dataHandler(slot.request, slot.buffer,
+                            static_cast<size_t>(result))) {
+        slot.error = ECANCELED;
+        QueueClose(slotIndex);
+    } else {
+        slot.offset += static_cast<uint64_t>(result);
+        QueueNextRead(slotIndex, requests);
+    }
+
+    return false;
+}
+
+void IoUringFileReader::ReleaseSlot(
+        size_t slotIndex, const std::vector<FileReadRequest>& requests) {
+    Slot& slot = slots_[slotIndex];
+
+    in_flight_[requests[slot.request].device]--;
+    slot.state = SlotState::FREE;
+    slot.fd = -1;
+    free_slots_.push_back(slotIndex);
+}
+
+void IoUringFileReader::QueueNextRead(
+        size_t slotIndex, const std::vector<FileReadRequest>& requests) {
+    Slot& slot = slots_[slotIndex];
+    const auto& ranges = requests[slot.request].ranges;
+
+    while (slot.range < ranges.size() &&
+           slot.offset >= ranges[slot.range].offset +
+                          ranges[slot.range].length) {
+        slot.range++;
+        slot.offset = slot.range < ranges.size() ?
+                      ranges[slot.range].offset : 0;
+    }
+
+    if (slot.range >= ranges.size()) {
+        QueueClose(slotIndex);
+        return;
+    }
+
+    uint64_t end = ranges[slot.range].offset + ranges[slot.range].length;
+    io_uring_sqe* sqe = NextSubmission(slotIndex);
+
+    sqe->opcode = buffers_registered_ ? IORING_OP_READ_FIXED : IORING_OP_READ;
+    sqe->fd = slot.fd;
+    sqe->off = slot.offset;
+    sqe->addr = reinterpret_cast<uint64_t>(slot.buffer);
+    sqe->len = static_cast<uint32_t>(
+        std::min<uint64_t>(block_size_, end - slot.offset));
+    sqe->buf_index = buffers_registered_ ? static_cast<uint16_t>(slotIndex)
+                                         : 0;
+    slot.state = SlotState::READING;
+}
+
+void IoUringFileReader::QueueOpen(size_t slotIndex, const char* path) {
+    io_uring_sqe* sqe = NextSubmission(slotIndex);
+
+    sqe->opcode = IORING_OP_OPENAT;
+    sqe->fd = AT_FDCWD;
+    sqe->addr = reinterpret_cast<uint64_t>(path);
+    sqe->open_flags = O_RDONLY | O_CLOEXEC;
+    slots_[slotIndex].state = SlotState::OPENING;
+}
+
+void IoUringFileReader::QueueClose(size_t slotIndex) {
+    io_uring_sqe* sqe = NextSubmission(slotIndex);
+
+    sqe->opcode = IORING_OP_CLOSE;
+    sqe->fd = slots_[slotIndex].fd;
+    slots_[slotIndex].state = SlotState::CLOSING;
+}
+
+// Each slot has at most one operation queued and the ring has an entry for
+// every slot, so there is always room for another submission.
+io_uring_sqe* IoUringFileReader::NextSubmission(size_t slotIndex) {
+    unsigned tail = *sq_tail_;
+    unsigned index = tail & sq_mask_;
+    io_uring_sqe* sqe = &sqes_[index];
+
+    std::memset(sqe, 0, sizeof(*sqe));
+    sqe->user_data = slotIndex;
+    sq_array_[index] = index;
+
+    __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+    pending_submissions_++;
+    return sqe;
+}
+
+/*
+Submit everything queued since the last call and wait for at least one
+completion.
+
+returns:
+    False if the ring has failed.
+*/
+bool IoUringFileReader::SubmitAndWait() {
+    while (true) {
+        long submitted = syscall(__NR_io_uring_enter, ring_fd_,  // NOLINT
+                                 pending_submissions_, 1,
+                                 IORING_ENTER_GETEVENTS, nullptr, 0);
+        if (submitted >= 0) {
+            pending_submissions_ -= static_cast<unsigned>(submitted);
+            return true;
+        }
+
+        if (errno != EINTR && errno != EAGAIN) {
+            return false;
+        }
+    }
+}
+
+#else
+
+IoUringFileReader::~IoUringFileReader() {
+}
+
+bool IoUringFileReader::Initialise() {
+    return false;
+}
+
+void IoUringFileReader::ReadFiles(
+        const std::vector<FileReadRequest>& requests,
+        const FileDataHandler&,
+        const FileCompletedHandler& completedHandler) {
+    for (size_t i = 0; i < requests.size(); i++) {
+        completedHandler(i, ENOSYS);
+    }
+}
+
+size_t IoUringFileReader::PreferredBatchSize() const {
+    return 1;
+}
+
+#endif
+
+}   // namespace io
+}   // namespace common
+}   // namespace duplitrace
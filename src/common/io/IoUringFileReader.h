@@ -0,0 +1,143 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#ifndef IOURINGFILEREADER_H_
+#define IOURINGFILEREADER_H_
+#include <cstdint>
+#include <deque>
+#include <unordered_map>
+#include <vector>
+#include "FileReader.h"
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+namespace duplitrace { namespace common { namespace io {
+
+/*
+Reader that keeps many files in flight from a single thread. The openat,
+read and close for every file are queued on a Linux io_uring and submitted
+in batches, so one system call starts or completes hundreds of operations.
+Each in-flight file owns a slot in a set of buffers that are registered
+with the kernel when the memory lock limit allows it.
+*/
+class IoUringFileReader : public FileReader {
+ public:
+    explicit IoUringFileReader(const FileReaderSettings& settings);
+
+    ~IoUringFileReader() override;
+
+    IoUringFileReader(const IoUringFileReader&) = delete;
+    IoUringFileReader& operator=(const IoUringFileReader&) = delete;
+
+    bool Initialise();
+
+    FileReaderBackend Backend() const override {
+        return FileReaderBackend::IO_URING;
+    }
+
+    void ReadFiles(const std::vector<FileReadRequest>& requests,
+                   const FileDataHandler& dataHandler,
+                   const FileCompletedHandler& completedHandler) override;
+
+    size_t PreferredBatchSize() const override;
+
+ private:
+    enum class SlotState {
+        FREE,
+        OPENING,
+        READING,
+        CLOSING
+    };
+
+    // A file that is being read, and the buffer its reads land in.
+    struct Slot {
+        SlotState state = SlotState::FREE;
+        size_t request = 0;
+        size_t range = 0;
+        uint64_t offset = 0;
+        int fd = -1;
+        int error = 0;
+        uint8_t* buffer = nullptr;
+    };
+
+    FileReaderSettings settings_;
+    size_t block_size_;
+    int ring_fd_;
+    bool buffers_registered_;
+
+    void* sq_ring_;
+    size_t sq_ring_size_;
+    void* cq_ring_;
+    size_t cq_ring_size_;
+    io_uring_sqe* sqes_;
+    size_t sqes_size_;
+
+    unsigned* sq_head_;
+    unsigned* sq_tail_;
+    unsigned sq_mask_;
+    unsigned* sq_array_;
+    unsigned* cq_head_;
+    unsigned* cq_tail_;
+    unsigned cq_mask_;
+    io_uring_cqe* cqes_;
+    unsigned pending_submissions_;
+
+    std::vector<Slot> slots_;
+    std::vector<size_t> free_slots_;
+    uint8_t* buffer_memory_;
+
+    // Requests that have not been started yet, and the reads in flight,
+    // for each device.
+    std::unordered_map<uint64_t, std::deque<size_t>> waiting_;
+    std::unordered_map<uint64_t, size_t> in_flight_;
+
+    bool CreateRing(unsigned entries);
+
+    bool OperationsSupported();
+
+    void RegisterBuffers();
+
+    void StartWaitingRequests(const std::vector<FileReadRequest>& requests);
+
+    bool HandleCompletion(size_t slotIndex, int result,
+                          const std::vector<FileReadRequest>& requests,
+                          const FileDataHandler& dataHandler,
+                          const FileCompletedHandler& completedHandler);
+
+    void ReleaseSlot(size_t slotIndex,
+                     const std::vector<FileReadRequest>& requests);
+
+    void QueueNextRead(size_t slotIndex,
+                       const std::vector<FileReadRequest>& requests);
+
+    void QueueOpen(size_t slotIndex, const char* path);
+
+    void QueueClose(size_t slotIndex);
+
+    io_uring_sqe* NextSubmission(size_t slotIndex);
+
+    bool SubmitAndWait();
+};
+
+}   // namespace io
+}   // namespace common
+}   // namespace duplitrace
+
+#endif  // IOURINGFILEREADER_H_
@@ -0,0 +1,171 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include "PreadFileReader.h"
+#include "../Platform.h"
+
+#if DUPLITRACE_PLATFORM == DUPLITRACE_PLATFORM_LINUX
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace duplitrace { namespace common { namespace io {
+
+PreadFileReader::PreadFileReader(const FileReaderSettings& settings) :
+    block_size_(settings.block_size ? settings.block_size : 64 * 1024),
+    pool_(settings.thread_count ? settings.thread_count : 1) {
+}
+
+/*
+Read every request on the pool threads and wait until they have all
+completed. The per-device queue depths are not applied, the number of
+threads already bounds the reads in flight.
+*/
+void PreadFileReader::ReadFiles(const std::vector<FileReadRequest>& requests,
+                                const FileDataHandler& dataHandler,
+                                const FileCompletedHandler& completedHandler) {
+    std::mutex mutex;
+    std::condition_variable allCompleted;
+    size_t remaining = requests.size();
+
+    auto finished = [&] {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--remaining == 0) {
+            allCompleted.notify_one();
+        }
+    };
+
+    for (size_t i = 0; i < requests.size(); i++) {
+        bool submitted = pool_.Submit([&, i] {
+            thread_local std::vector<uint8_t> buffer;
+            int error = ReadFile(requests[i], i, &buffer, dataHandler);
+
+            completedHandler(i, error);
+            finished();
+        });
+
+        if (!submitted) {
+            completedHandler(i, ECANCELED);
+            finished();
+        }
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    allCompleted.wait(lock, [&remaining] { return remaining == 0; });
+}
+
+size_t PreadFileReader::PreferredBatchSize() const {
+    return pool_.ThreadCount() * 4;
+}
+
+/*
+Read the ranges of a single request.
+
+returns:
+    0 on success, otherwise an errno value.
+*/
+int PreadFileReader::ReadFile(const FileReadRequest& request, size_t index,
+                              std::vector<uint8_t>* buffer,
+                              const FileDataHandler& dataHandler) {
+    buffer->resize(block_size_);
+
+#if DUPLITRACE_PLATFORM == DUPLITRACE_PLATFORM_LINUX
+    int fd = open(request.path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return errno;
+    }
+
+    int error = 0;
+
+    for (const auto& range : request.ranges) {
+        uint64_t offset = range.offset;
+        uint64_t end = range.offset + range.length;
+
+        while (offset < end && !error) {
+            size_t length = static_cast<size_t>(
+                std::min<uint64_t>(block_size_, end - offset));
+            ssize_t bytesRead = pread(fd, buffer->data(), length,
+                                      static_cast<off_t>(offset));
+
+            if (bytesRead < 0) {
+                if (errno != EINTR) {
+                    error = errno;
+                }
+                continue;
+            }
+
+            if (bytesRead == 0) {
+                break;
+            }
+
+            if (!dataHandler(index, buffer->data(),
+                             static_cast<size_t>(bytesRead))) {
+                error = ECANCELED;
+            }
+            offset += static_cast<uint64_t>(bytesRead);
+        }
+    }
+
+    close(fd);
+    return error;
+#else
+    std::FILE* file = std::fopen(request.path.c_str(), "rb");
+    if (!file) {
+        return errno ? errno : ENOENT;
+    }
+
+    int error = 0;
+
+    for (const auto& range : request.ranges) {
+        if (_fseeki64(file, static_cast<__int64>(range.offset), SEEK_SET)) {
+            error = EIO;
+        }
+
+        uint64_t remaining = range.length;
+
+        while (remaining && !error) {
+            size_t length = static_cast<size_t>(
+                std::min<uint64_t>(block_size_, remaining));
+            size_t bytesRead = std::fread(buffer->data(), 1, length, file);
+
+            if (bytesRead == 0) {
+                error = std::ferror(file) ? EIO : 0;
+                break;
+            }
+
+            if (!dataHandler(index, buffer->data(), bytesRead)) {
+                error = ECANCELED;
+            }
+            remaining -= bytesRead;
+        }
+    }
+
+    std::fclose(file);
+    return error;
+#endif
+}
+
+}   // namespace io
+}   // namespace common
+}   // namespace duplitrace
@@ -0,0 +1,57 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#ifndef PREADFILEREADER_H_
+#define PREADFILEREADER_H_
+#include <vector>
+#include "FileReader.h"
+#include "../WorkerPool.h"
+
+namespace duplitrace { namespace common { namespace io {
+
+// Fallback reader, each request is read with blocking positional reads on
+// one of a small pool of threads.
+class PreadFileReader : public FileReader {
+ public:
+    explicit PreadFileReader(const FileReaderSettings& settings);
+
+    FileReaderBackend Backend() const override {
+        return FileReaderBackend::PREAD;
+    }
+
+    void ReadFiles(const std::vector<FileReadRequest>& requests,
+                   const FileDataHandler& dataHandler,
+                   const FileCompletedHandler& completedHandler) override;
+
+    size_t PreferredBatchSize() const override;
+
+ private:
+    size_t block_size_;
+    WorkerPool pool_;
+
+    int ReadFile(const FileReadRequest& request, size_t index,
+                 std::vector<uint8_t>* buffer,
+                 const FileDataHandler& dataHandler);
+};
+
+}   // namespace io
+}   // namespace common
+}   // namespace duplitrace
+
+#endif  // PREADFILEREADER_H_
@@ -0,0 +1,132 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#include <cstdint>
+#include <vector>
+#include "SharedExtents.h"
+#include "../Platform.h"
+
+#if DUPLITRACE_PLATFORM == DUPLITRACE_PLATFORM_LINUX
+#include <fcntl.h>
+#include <linux/fiemap.h>
+#include <linux/fs.h>
+#include <linux/magic.h>
+#include <sys/ioctl.h>
+#include <sys/vfs.h>
+#include <unistd.h>
+#endif
+
+namespace duplitrace { namespace common { namespace io {
+
+// Files with more extents than this are read as normal.
+const uint32_t SHARED_EXTENTS_MAXIMUM_EXTENTS = 64;
+
+#if DUPLITRACE_PLATFORM == DUPLITRACE_PLATFORM_LINUX
+
+// Extents whose data cannot be compared by location alone.
+const uint32_t SHARED_EXTENTS_UNUSABLE_FLAGS =
+    FIEMAP_EXTENT_UNKNOWN | FIEMAP_EXTENT_DELALLOC | FIEMAP_EXTENT_ENCODED |
+    FIEMAP_EXTENT_DATA_ENCRYPTED | FIEMAP_EXTENT_NOT_ALIGNED |
+    FIEMAP_EXTENT_DATA_INLINE | FIEMAP_EXTENT_DATA_TAIL |
+    FIEMAP_EXTENT_UNWRITTEN;
+
+/*
+Check whether the filesystem a path is on can share extents between files
+(reflinks), i.e. it is btrfs or XFS.
+
+returns:
+    True if it is worth asking for the extents of files on it.
+*/
+bool FilesystemSharesExtents(const std::string& path) {
+    struct statfs status;
+    if (statfs(path.c_str(), &status) != 0) {
+        return false;
+    }
+
+    return status.f_type == BTRFS_SUPER_MAGIC ||
+           status.f_type == XFS_SUPER_MAGIC;
+}
+
+/*
+Read the extent map of a file whose data is entirely in extents shared with
+other files. Two files of the same size on the same device with the same map
+are reflinked copies, their contents are identical without being read.
+
+returns:
+    False if any of the file is not in a plain shared extent, or the map
+    could not be read.
+*/
+bool ReadSharedExtents(const std::string& path, std::string* extents) {
+    int fd = open(path.c_str(), O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd == -1) {
+        return false;
+    }
+
+    std::vector<uint8_t> buffer(sizeof(struct fiemap) +
+                                SHARED_EXTENTS_MAXIMUM_EXTENTS *
+                                sizeof(struct fiemap_extent));
+    auto map = reinterpret_cast<struct fiemap*>(buffer.data());
+    map->fm_start = 0;
+    map->fm_length = FIEMAP_MAX_OFFSET;
+    map->fm_flags = 0;
+    map->fm_extent_count = SHARED_EXTENTS_MAXIMUM_EXTENTS;
+
+    bool mapped = ioctl(fd, FS_IOC_FIEMAP, map) == 0;
+    close(fd);
+
+    if (!mapped || map->fm_mapped_extents == 0 ||
+        !(map->fm_extents[map->fm_mapped_extents - 1].fe_flags &
+          FIEMAP_EXTENT_LAST)) {
+        return false;
+    }
+
+    extents->clear();
+
+    for (uint32_t i = 0; i < map->fm_mapped_extents; i++) {
+        const struct fiemap_extent& extent = map->fm_extents[i];
+
+        if (!(extent.fe_flags & FIEMAP_EXTENT_SHARED) ||
+            (extent.fe_flags & SHARED_EXTENTS_UNUSABLE_FLAGS)) {
+            return false;
+        }
+
+        uint64_t location[3] = { extent.fe_logical, extent.fe_physical,
+                                 extent.fe_length };
+        extents->append(reinterpret_cast<const char*>(location),
+                        sizeof(location));
+    }
+
+    return true;
+}
+
+#else
+
+bool FilesystemSharesExtents(const std::string&) {
+    return false;
+}
+
+bool ReadSharedExtents(const std::string&, std::string*) {
+    return false;
+}
+
+#endif
+
+}   // namespace io
+}   // namespace common
+}   // namespace duplitrace
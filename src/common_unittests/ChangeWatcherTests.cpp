@@ -0,0 +1,141 @@
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "gtest/gtest.h"
+#include "io/ChangeWatcher.h"
+#include "io/FileWatcher.h"
+
+using duplitrace::common::io::ChangeWatcher;
+using duplitrace::common::io::ChangeWatcherBackend;
+using duplitrace::common::io::CreateChangeWatcher;
+using duplitrace::common::io::DirtyDirectory;
+using duplitrace::common::io::DirtyDirectorySet;
+using duplitrace::common::io::FileWatcher;
+
+TEST(DirtyDirectorySetTest, TakeCoalescesDirectories) {
+    DirtyDirectorySet dirty;
+
+    dirty.Mark("/data/photos", false);
+    dirty.Mark("/data/photos", false);
+    dirty.Mark("/data/music", false);
+    dirty.Mark("/data/music/albums/new", false);
+    dirty.Mark("/data/music", true);
+    dirty.Mark("/data/musical", false);
+
+    std::vector<DirtyDirectory> taken = dirty.Take();
+
+    ASSERT_EQ(taken.size(), 3u);
+    EXPECT_EQ(taken[0].path, "/data/music");
+    EXPECT_TRUE(taken[0].recursive);
+    EXPECT_EQ(taken[1].path, "/data/musical");
+    EXPECT_FALSE(taken[1].recursive);
+    EXPECT_EQ(taken[2].path, "/data/photos");
+    EXPECT_FALSE(taken[2].recursive);
+
+    EXPECT_TRUE(dirty.Empty());
+    EXPECT_TRUE(dirty.Take().empty());
+}
+
+class ChangeWatcherTest : public ::testing::Test {
+ protected:
+    void SetUp() override {
+        root_ = (std::filesystem::temp_directory_path() /
+                 "duplitrace_change_watcher_test").string();
+        std::filesystem::remove_all(root_);
+        std::filesystem::create_directories(root_ + "/existing/deep");
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(root_);
+    }
+
+    // Process events until something is dirty or a second has passed.
+    static std::vector<DirtyDirectory> WaitForChanges(
+            ChangeWatcher* watcher, DirtyDirectorySet* dirty) {
+        for (int i = 0; i < 100 && dirty->Empty(); i++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            watcher->ProcessEvents();
+        }
+
+        return dirty->Take();
+    }
+
+    static void WriteFile(const std::string& path) {
+        std::ofstream file(path);
+        file << "contents";
+    }
+
+    std::string root_;
+};
+
+TEST_F(ChangeWatcherTest, InotifyMarksChangedDirectories) {
+    DirtyDirectorySet dirty;
+    auto watcher = CreateChangeWatcher(ChangeWatcherBackend::INOTIFY, root_,
+                                       &dirty);
+    if (!watcher) {
+        GTEST_SKIP() << "inotify is not available";
+    }
+
+    EXPECT_EQ(watcher->Backend(), ChangeWatcherBackend::INOTIFY);
+
+    WriteFile(root_ + "/existing/deep/file");
+    auto changes = WaitForChanges(watcher.get(), &dirty);
+
+    ASSERT_EQ(changes.size(), 1u);
+    EXPECT_EQ(changes[0].path, root_ + "/existing/deep");
+    EXPECT_FALSE(changes[0].recursive);
+
+    // A new directory is dirty in full, and is watched from then on.
+    std::filesystem::create_directories(root_ + "/created");
+    changes = WaitForChanges(watcher.get(), &dirty);
+
+    ASSERT_EQ(changes.size(), 1u);
+    EXPECT_EQ(changes[0].path, root_ + "/created");
+    EXPECT_TRUE(changes[0].recursive);
+
+    WriteFile(root_ + "/created/file");
+    changes = WaitForChanges(watcher.get(), &dirty);
+
+    ASSERT_EQ(changes.size(), 1u);
+    EXPECT_EQ(changes[0].path, root_ + "/created");
+    EXPECT_FALSE(changes[0].recursive);
+
+    // A directory moved away takes everything below it with it.
+    std::filesystem::rename(root_ + "/existing", root_ + "/moved");
+    changes = WaitForChanges(watcher.get(), &dirty);
+
+    ASSERT_EQ(changes.size(), 2u);
+    EXPECT_EQ(changes[0].path, root_ + "/existing");
+    EXPECT_TRUE(changes[0].recursive);
+    EXPECT_EQ(changes[1].path, root_ + "/moved");
+    EXPECT_TRUE(changes[1].recursive);
+}
+
+TEST_F(ChangeWatcherTest, FileWatcherSeesFileReplaced) {
+    std::string filename = root_ + "/watched.cfg";
+    WriteFile(filename);
+
+    FileWatcher watcher(filename);
+    if (!watcher.Initialise()) {
+        GTEST_SKIP() << "inotify is not available";
+    }
+
+    // Other files in the directory are ignored.
+    WriteFile(root_ + "/other.cfg");
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    EXPECT_FALSE(watcher.ProcessEvents());
+
+    // As an editor saves it, by renaming a new copy over it.
+    WriteFile(filename + ".new");
+    std::filesystem::rename(filename + ".new", filename);
+
+    bool changed = false;
+    for (int i = 0; i < 100 && !changed; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        changed = watcher.ProcessEvents();
+    }
+    EXPECT_TRUE(changed);
+}
@@ -0,0 +1,271 @@
+#include <algorithm>
+#include <cstdlib>
+#include <ctime>
+#include <random>
+#include <string>
+#include <vector>
+#include "gtest/gtest.h"
+#include "../cron_parser/CompiledCronExpression.h"
+
+using duplitrace::cronparser::BadCronExpression;
+using duplitrace::cronparser::CompiledCronExpression;
+using duplitrace::cronparser::CronExpression;
+
+// Number of random expressions compared with CronExpression.
+const int COMPILED_CRON_TEST_RANDOM_EXPRESSIONS = 2000;
+
+// Local time for the start of a search, the month is one-based.
+static std::tm MakeTime(int year, int month, int day, int hour, int minute,
+                        int second) {
+    std::tm time = {};
+    time.tm_year = year - 1900;
+    time.tm_mon = month - 1;
+    time.tm_mday = day;
+    time.tm_hour = hour;
+    time.tm_min = minute;
+    time.tm_sec = second;
+    time.tm_isdst = -1;
+    return time;
+}
+
+static void ExpectTime(const std::tm& time, int year, int month, int day,
+                       int hour, int minute, int second) {
+    EXPECT_EQ(time.tm_year + 1900, year);
+    EXPECT_EQ(time.tm_mon + 1, month);
+    EXPECT_EQ(time.tm_mday, day);
+    EXPECT_EQ(time.tm_hour, hour);
+    EXPECT_EQ(time.tm_min, minute);
+    EXPECT_EQ(time.tm_sec, second);
+}
+
+static std::tm NextTrigger(const char* expression, const std::tm& start) {
+    return CompiledCronExpression(CronExpression(expression))
+        .getNextTriggerTime(start);
+}
+
+/*
+Build a random field for an expression: any value, a value, a range, a list
+or a step, between the field's minimum and maximum.
+
+returns:
+    Text of the field.
+*/
+static std::string RandomField(std::mt19937* random, int minimum,
+                               int maximum) {
+    std::uniform_int_distribution<int> value(minimum, maximum);
+    int first = value(*random);
+    int second = value(*random);
+    int low = std::min(first, second);
+    int high = std::max(first, second);
+    int step = std::uniform_int_distribution<int>(1, 7)(*random);
+
+    switch (std::uniform_int_distribution<int>(0, 5)(*random)) {
+        case 0:
+            return "*";
+        case 1:
+            return std::to_string(first);
+        case 2:
+            return std::to_string(low) + "-" + std::to_string(high);
+        case 3:
+            return std::to_string(first) + "," + std::to_string(second);
+        case 4:
+            return "*/" + std::to_string(step);
+        default:
+            return std::to_string(low) + "-" + std::to_string(high) + "/" +
+                   std::to_string(step);
+    }
+}
+
+// CronExpression normalises its results with mktime(), so the comparison
+// runs in UTC where no local time is skipped or repeated.
+class CompiledCronExpressionTest : public ::testing::Test {
+ protected:
+    void SetUp() override {
+        const char* timeZone = std::getenv("TZ");
+        had_time_zone_ = timeZone != nullptr;
+        time_zone_ = timeZone ? timeZone : "";
+
+        setenv("TZ", "UTC", 1);
+        tzset();
+    }
+
+    void TearDown() override {
+        if (had_time_zone_) {
+            setenv("TZ", time_zone_.c_str(), 1);
+        } else {
+            unsetenv("TZ");
+        }
+        tzset();
+    }
+
+    bool had_time_zone_;
+    std::string time_zone_;
+};
+
+TEST_F(CompiledCronExpressionTest, NextTriggerIsAfterTheStart) {
+    ExpectTime(NextTrigger("* * * * * *", MakeTime(2024, 5, 14, 10, 0, 0)),
+               2024, 5, 14, 10, 0, 1);
+    ExpectTime(NextTrigger("0 */15 * * * *",
+                           MakeTime(2024, 5, 14, 10, 15, 0)),
+               2024, 5, 14, 10, 30, 0);
+    ExpectTime(NextTrigger("0 */15 * * * *",
+                           MakeTime(2024, 5, 14, 10, 59, 59)),
+               2024, 5, 14, 11, 0, 0);
+}
+
+TEST_F(CompiledCronExpressionTest, NextTriggerCrossesMonthsAndYears) {
+    ExpectTime(NextTrigger("0 0 12 31 * *", MakeTime(2024, 3, 31, 13, 0, 0)),
+               2024, 5, 31, 12, 0, 0);
+    ExpectTime(NextTrigger("* * * * * *", MakeTime(2023, 12, 31, 23, 59, 59)),
+               2024, 1, 1, 0, 0, 0);
+    ExpectTime(NextTrigger("0 30 9 * JAN *", MakeTime(2024, 2, 1, 0, 0, 0)),
+               2025, 1, 1, 9, 30, 0);
+}
+
+TEST_F(CompiledCronExpressionTest, NextTriggerFindsLeapDays) {
+    ExpectTime(NextTrigger("0 0 0 29 2 *", MakeTime(2024, 2, 29, 0, 0, 0)),
+               2028, 2, 29, 0, 0, 0);
+
+    // 2100 is not a leap year.
+    ExpectTime(NextTrigger("0 0 0 29 2 *", MakeTime(2096, 3, 1, 0, 0, 0)),
+               2104, 2, 29, 0, 0, 0);
+}
+
+TEST_F(CompiledCronExpressionTest, NextTriggerFillsInTheDayOfWeekAndYear) {
+    // Both day fields have to match, the 13th of January 2024 is a Saturday.
+    std::tm trigger = NextTrigger("0 0 0 13 * FRI",
+                                  MakeTime(2024, 1, 1, 0, 0, 0));
+
+    ExpectTime(trigger, 2024, 9, 13, 0, 0, 0);
+    EXPECT_EQ(trigger.tm_wday, 5);
+    EXPECT_EQ(trigger.tm_yday, 256);
+    EXPECT_EQ(trigger.tm_isdst, -1);
+}
+
+TEST_F(CompiledCronExpressionTest, NextTriggerThrowsIfNeverFires) {
+    EXPECT_THROW(NextTrigger("0 0 0 30 2 *", MakeTime(2024, 1, 1, 0, 0, 0)),
+                 BadCronExpression);
+    EXPECT_THROW(NextTrigger("0 0 0 31 4 *", MakeTime(2024, 1, 1, 0, 0, 0)),
+                 BadCronExpression);
+}
+
+TEST_F(CompiledCronExpressionTest, RandomExpressionsMatchCronExpression) {
+    std::mt19937 random(20240514);
+
+    for (int i = 0; i < COMPILED_CRON_TEST_RANDOM_EXPRESSIONS; i++) {
+        std::string text = RandomField(&random, 0, 59) + " " +
+                           RandomField(&random, 0, 59) + " " +
+                           RandomField(&random, 0, 23) + " " +
+                           RandomField(&random, 1, 31) + " " +
+                           RandomField(&random, 1, 12) + " " +
+                           RandomField(&random, 0, 6);
+        std::tm start = MakeTime(
+            std::uniform_int_distribution<int>(1990, 2060)(random),
+            std::uniform_int_distribution<int>(1, 12)(random),
+            std::uniform_int_distribution<int>(1, 28)(random),
+            std::uniform_int_distribution<int>(0, 23)(random),
+            std::uniform_int_distribution<int>(0, 59)(random),
+            std::uniform_int_distribution<int>(0, 59)(random));
+        SCOPED_TRACE(text + " after " + std::to_string(start.tm_year + 1900) +
+                     "-" + std::to_string(start.tm_mon + 1) + "-" +
+                     std::to_string(start.tm_mday));
+
+        CronExpression expression(text);
+        CompiledCronExpression compiled(expression);
+        std::tm expected;
+
+        try {
+            expected = expression.getNextTriggerTime(start);
+        }
+        catch (const BadCronExpression&) {
+            EXPECT_THROW(compiled.getNextTriggerTime(start),
+                         BadCronExpression);
+            continue;
+        }
+
+        std::tm actual = compiled.getNextTriggerTime(start);
+        ExpectTime(actual, expected.tm_year + 1900, expected.tm_mon + 1,
+                   expected.tm_mday, expected.tm_hour, expected.tm_min,
+                   expected.tm_sec);
+        EXPECT_EQ(actual.tm_wday, expected.tm_wday);
+        EXPECT_EQ(actual.tm_yday, expected.tm_yday);
+    }
+}
+
+TEST_F(CompiledCronExpressionTest, NextTriggerTimesStopAtTheCount) {
+    CompiledCronExpression hourly(CronExpression("0 0 * * * *"));
+    std::vector<int> hours;
+
+    for (const std::tm& trigger :
+         hourly.getNextTriggerTimes(MakeTime(2024, 5, 14, 22, 0, 0), 3)) {
+        hours.push_back(trigger.tm_hour);
+    }
+
+    // The start itself is not a trigger time, and the days roll over.
+    EXPECT_EQ(hours, std::vector<int>({ 23, 0, 1 }));
+
+    EXPECT_EQ(hourly.getNextTriggerTimes(MakeTime(2024, 5, 14, 22, 0, 0), 0)
+                  .begin(),
+              hourly.getNextTriggerTimes(MakeTime(2024, 5, 14, 22, 0, 0), 0)
+                  .end());
+}
+
+TEST_F(CompiledCronExpressionTest, NextTriggerTimesMatchRepeatedSearches) {
+    CronExpression expression("30 */20 9-17 * * MON-FRI");
+    CompiledCronExpression compiled(expression);
+    std::tm expected = MakeTime(2024, 2, 27, 16, 0, 0);
+    int count = 0;
+
+    for (const std::tm& trigger : compiled.getNextTriggerTimes(expected, 100)) {
+        expected = expression.getNextTriggerTime(expected);
+        ExpectTime(trigger, expected.tm_year + 1900, expected.tm_mon + 1,
+                   expected.tm_mday, expected.tm_hour, expected.tm_min,
+                   expected.tm_sec);
+        count++;
+    }
+
+    EXPECT_EQ(count, 100);
+}
+
+TEST_F(CompiledCronExpressionTest, TriggerTimesBetweenIncludeOnlyTheStart) {
+    CompiledCronExpression hourly(CronExpression("0 0 * * * *"));
+    std::vector<int> hours;
+
+    for (const std::tm& trigger :
+         hourly.getTriggerTimesBetween(MakeTime(2024, 5, 14, 10, 0, 0),
+                                       MakeTime(2024, 5, 14, 13, 0, 0))) {
+        hours.push_back(trigger.tm_hour);
+    }
+
+    EXPECT_EQ(hours, std::vector<int>({ 10, 11, 12 }));
+}
+
+TEST_F(CompiledCronExpressionTest, EmptyRangeHasNoTriggerTimes) {
+    CompiledCronExpression everySecond(CronExpression("* * * * * *"));
+    std::tm start = MakeTime(2024, 5, 14, 10, 0, 0);
+
+    auto same = everySecond.getTriggerTimesBetween(start, start);
+    EXPECT_EQ(same.begin(), same.end());
+
+    auto backwards = everySecond.getTriggerTimesBetween(
+        start, MakeTime(2024, 5, 14, 9, 0, 0));
+    EXPECT_EQ(backwards.begin(), backwards.end());
+
+    // The range ends before the first trigger time.
+    CompiledCronExpression noon(CronExpression("0 0 12 * * *"));
+    auto morning = noon.getTriggerTimesBetween(
+        start, MakeTime(2024, 5, 14, 12, 0, 0));
+    EXPECT_EQ(morning.begin(), morning.end());
+}
+
+TEST_F(CompiledCronExpressionTest, NeverFiringExpressionHasNoTriggerTimes) {
+    CompiledCronExpression thirtiethFebruary(CronExpression("0 0 0 30 2 *"));
+    std::tm start = MakeTime(2024, 1, 1, 0, 0, 0);
+
+    auto next = thirtiethFebruary.getNextTriggerTimes(start, 5);
+    EXPECT_EQ(next.begin(), next.end());
+
+    auto between = thirtiethFebruary.getTriggerTimesBetween(
+        start, MakeTime(2124, 1, 1, 0, 0, 0));
+    EXPECT_EQ(between.begin(), between.end());
+}
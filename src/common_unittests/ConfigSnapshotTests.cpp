@@ -0,0 +1,289 @@
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "gtest/gtest.h"
+#include "ConfigManager.h"
+#include "ConfigSetup.h"
+#include "ConfigSetupItem.h"
+#include "ConfigSnapshot.h"
+
+using duplitrace::common::ConfigKey;
+using duplitrace::common::ConfigKeyHash;
+using duplitrace::common::ConfigManager;
+using duplitrace::common::ConfigSetup;
+using duplitrace::common::ConfigSetupItem;
+using duplitrace::common::ConfigSnapshot;
+using duplitrace::common::CONFIG_ITEM_TYPE_INTEGER;
+using duplitrace::common::CONFIG_ITEM_TYPE_STRING;
+
+constexpr char SNAPSHOT_SECTION[] = "snapshot_section";
+constexpr char SNAPSHOT_INT[] = "int_value";
+constexpr char SNAPSHOT_STRING[] = "str_value";
+
+TEST(ConfigSnapshotTest, KeysAreWorkedOutWhenCompiling) {
+    constexpr ConfigKey key = CONFIG_KEY(SNAPSHOT_SECTION, SNAPSHOT_INT);
+
+    EXPECT_EQ(key.hash, ConfigKeyHash(std::string(SNAPSHOT_SECTION),
+                                      std::string(SNAPSHOT_INT)));
+    // The separator keeps names that only differ in where they are split
+    // apart.
+    EXPECT_NE(ConfigKeyHash("ab", "c"), ConfigKeyHash("a", "bc"));
+}
+
+TEST(ConfigSnapshotTest, ReadsValuesByKey) {
+    ConfigSnapshot snapshot;
+
+    // Enough items for the table to grow.
+    for (int i = 0; i < 100; i++) {
+        EXPECT_TRUE(snapshot.AddInt("section", std::to_string(i), i));
+        EXPECT_TRUE(snapshot.AddString("strings", std::to_string(i),
+                                       "value " + std::to_string(i)));
+    }
+
+    EXPECT_EQ(snapshot.Size(), 200u);
+
+    for (int i = 0; i < 100; i++) {
+        std::string item = std::to_string(i);
+        EXPECT_EQ(snapshot.Int({ ConfigKeyHash("section", item) }), i);
+        EXPECT_EQ(snapshot.String({ ConfigKeyHash("strings", item) }),
+                  "value " + item);
+    }
+
+    EXPECT_FALSE(snapshot.AddInt("section", "1", 2));
+    EXPECT_FALSE(snapshot.Contains({ ConfigKeyHash("section", "100") }));
+}
+
+TEST(ConfigSnapshotTest, WrongKeyOrTypeThrows) {
+    ConfigSnapshot snapshot;
+    snapshot.AddInt(SNAPSHOT_SECTION, SNAPSHOT_INT, 1);
+
+    EXPECT_THROW(snapshot.Int(CONFIG_KEY(SNAPSHOT_SECTION, SNAPSHOT_STRING)),
+                 std::invalid_argument);
+    EXPECT_THROW(snapshot.String(CONFIG_KEY(SNAPSHOT_SECTION, SNAPSHOT_INT)),
+                 std::invalid_argument);
+}
+
+TEST(ConfigSnapshotTest, BuiltFromConfiguration) {
+    duplitrace::common::SectionsMap sections = {
+        {
+            SNAPSHOT_SECTION,
+            {
+                {
+                    SNAPSHOT_INT,
+                    ConfigSetupItem(SNAPSHOT_INT, CONFIG_ITEM_TYPE_INTEGER)
+                        .DefaultValue(42)
+                },
+                {
+                    SNAPSHOT_STRING,
+                    ConfigSetupItem(SNAPSHOT_STRING, CONFIG_ITEM_TYPE_STRING)
+                        .DefaultValue("default")
+                }
+            }
+        }
+    };
+    ConfigSetup layout(sections);
+    ConfigManager configManager;
+    configManager.Configure(&layout);
+
+    ASSERT_TRUE(configManager.processConfig());
+
+    std::shared_ptr<const ConfigSnapshot> snapshot = configManager.Snapshot();
+    EXPECT_EQ(snapshot->Size(), 2u);
+    EXPECT_EQ(snapshot->Int(CONFIG_KEY(SNAPSHOT_SECTION, SNAPSHOT_INT)), 42);
+    EXPECT_EQ(snapshot->String(CONFIG_KEY(SNAPSHOT_SECTION, SNAPSHOT_STRING)),
+              "default");
+}
+
+TEST(ConfigSnapshotTest, ComparesValuesBetweenSnapshots) {
+    ConfigSnapshot first;
+    ConfigSnapshot second;
+    first.AddInt(SNAPSHOT_SECTION, SNAPSHOT_INT, 1);
+    first.AddString(SNAPSHOT_SECTION, SNAPSHOT_STRING, "same");
+    second.AddInt(SNAPSHOT_SECTION, SNAPSHOT_INT, 2);
+    second.AddString(SNAPSHOT_SECTION, SNAPSHOT_STRING, "same");
+
+    EXPECT_FALSE(first.SameValue(second,
+                                 CONFIG_KEY(SNAPSHOT_SECTION, SNAPSHOT_INT)));
+    EXPECT_TRUE(first.SameValue(second,
+                                CONFIG_KEY(SNAPSHOT_SECTION, SNAPSHOT_STRING)));
+    EXPECT_TRUE(first.SameValue(second, CONFIG_KEY("missing", "missing")));
+}
+
+TEST(ConfigSnapshotTest, ReloadPublishesNewSnapshot) {
+    duplitrace::common::SectionsMap sections = {
+        {
+            SNAPSHOT_SECTION,
+            {
+                {
+                    SNAPSHOT_INT,
+                    ConfigSetupItem(SNAPSHOT_INT, CONFIG_ITEM_TYPE_INTEGER)
+                        .DefaultValue(42)
+                }
+            }
+        }
+    };
+    std::string filename = (std::filesystem::temp_directory_path() /
+                            "duplitrace_config_reload.cfg").string();
+    std::ofstream(filename) << "[snapshot_section]\nint_value=1\n";
+
+    ConfigSetup layout(sections);
+    ConfigManager configManager;
+    configManager.Configure(&layout, filename, true);
+    ASSERT_TRUE(configManager.processConfig());
+
+    std::shared_ptr<const ConfigSnapshot> first = configManager.Snapshot();
+    EXPECT_EQ(first->Int(CONFIG_KEY(SNAPSHOT_SECTION, SNAPSHOT_INT)), 1);
+
+    std::ofstream(filename) << "[snapshot_section]\nint_value=2\n";
+    ASSERT_TRUE(configManager.processConfig());
+
+    // Readers still holding the first snapshot see it unchanged. This
+    // thread's own copy is let go of on its next read, and the snapshot is
+    // freed once the last holder releases it.
+    EXPECT_EQ(first->Int(CONFIG_KEY(SNAPSHOT_SECTION, SNAPSHOT_INT)), 1);
+    EXPECT_EQ(configManager.Current().Int(
+        CONFIG_KEY(SNAPSHOT_SECTION, SNAPSHOT_INT)), 2);
+    std::weak_ptr<const ConfigSnapshot> released = first;
+    first.reset();
+    EXPECT_TRUE(released.expired());
+
+    EXPECT_EQ(configManager.Snapshot()->Int(
+        CONFIG_KEY(SNAPSHOT_SECTION, SNAPSHOT_INT)), 2);
+    EXPECT_EQ(configManager.GetIntEntry(SNAPSHOT_SECTION, SNAPSHOT_INT), 2);
+
+    // A rejected configuration leaves the current one in place.
+    std::ofstream(filename) << "[snapshot_section]\nint_value=3\n";
+    EXPECT_FALSE(configManager.processConfig(
+        [](const ConfigSnapshot& config) {
+            return config.Int(
+                CONFIG_KEY(SNAPSHOT_SECTION, SNAPSHOT_INT)) < 3;
+        }));
+
+    std::ofstream(filename) << "[snapshot_section]\nint_value=four\n";
+    testing::internal::CaptureStderr();
+    EXPECT_FALSE(configManager.processConfig());
+    testing::internal::GetCapturedStderr();
+
+    EXPECT_EQ(configManager.Snapshot()->Int(
+        CONFIG_KEY(SNAPSHOT_SECTION, SNAPSHOT_INT)), 2);
+
+    std::filesystem::remove(filename);
+}
+
+TEST(ConfigSnapshotTest, ReloadCannotChangeRestartItems) {
+    duplitrace::common::SectionsMap sections = {
+        {
+            SNAPSHOT_SECTION,
+            {
+                {
+                    SNAPSHOT_INT,
+                    ConfigSetupItem(SNAPSHOT_INT, CONFIG_ITEM_TYPE_INTEGER)
+                        .DefaultValue(42)
+                },
+                {
+                    SNAPSHOT_STRING,
+                    ConfigSetupItem(SNAPSHOT_STRING, CONFIG_ITEM_TYPE_STRING)
+                        .RestartRequired(true)
+                        .DefaultValue("first")
+                }
+            }
+        }
+    };
+    std::string filename = (std::filesystem::temp_directory_path() /
+                            "duplitrace_config_restart.cfg").string();
+    std::ofstream(filename) << "[snapshot_section]\nint_value=1\n";
+
+    ConfigSetup layout(sections);
+    ConfigManager configManager;
+    configManager.Configure(&layout, filename, true);
+    ASSERT_TRUE(configManager.processConfig());
+
+    std::shared_ptr<const ConfigSnapshot> first = configManager.Snapshot();
+
+    // Changing the item is rejected, along with the rest of the reload.
+    std::ofstream(filename)
+        << "[snapshot_section]\nint_value=2\nstr_value=second\n";
+    testing::internal::CaptureStderr();
+    EXPECT_FALSE(configManager.processConfig());
+    EXPECT_NE(testing::internal::GetCapturedStderr().find(
+                  "snapshot_section::str_value cannot be changed"),
+              std::string::npos);
+
+    EXPECT_EQ(configManager.Snapshot(), first);
+    EXPECT_EQ(configManager.Current().Int(
+        CONFIG_KEY(SNAPSHOT_SECTION, SNAPSHOT_INT)), 1);
+
+    // Other items can still be reloaded while it stays the same.
+    std::ofstream(filename)
+        << "[snapshot_section]\nint_value=3\nstr_value=first\n";
+    ASSERT_TRUE(configManager.processConfig());
+
+    EXPECT_EQ(configManager.Current().Int(
+        CONFIG_KEY(SNAPSHOT_SECTION, SNAPSHOT_INT)), 3);
+    EXPECT_EQ(configManager.Current().String(
+        CONFIG_KEY(SNAPSHOT_SECTION, SNAPSHOT_STRING)), "first");
+    EXPECT_EQ(first->Int(CONFIG_KEY(SNAPSHOT_SECTION, SNAPSHOT_INT)), 1);
+
+    std::filesystem::remove(filename);
+}
+
+TEST(ConfigSnapshotTest, ReadersOnOtherThreadsSeeReloads) {
+    duplitrace::common::SectionsMap sections = {
+        {
+            SNAPSHOT_SECTION,
+            {
+                {
+                    SNAPSHOT_INT,
+                    ConfigSetupItem(SNAPSHOT_INT, CONFIG_ITEM_TYPE_INTEGER)
+                        .DefaultValue(42)
+                }
+            }
+        }
+    };
+    std::string filename = (std::filesystem::temp_directory_path() /
+                            "duplitrace_config_readers.cfg").string();
+    std::ofstream(filename) << "[snapshot_section]\nint_value=0\n";
+
+    ConfigSetup layout(sections);
+    ConfigManager configManager;
+    configManager.Configure(&layout, filename, true);
+    ASSERT_TRUE(configManager.processConfig());
+
+    const int reloads = 50;
+    std::atomic<bool> backwards(false);
+    std::vector<std::thread> readers;
+
+    // Each reader only ever sees the value go up, and sees the last one.
+    for (int i = 0; i < 4; i++) {
+        readers.emplace_back([&configManager, &backwards] {
+            int last = 0;
+
+            while (last != reloads) {
+                int value = configManager.Current().Int(
+                    CONFIG_KEY(SNAPSHOT_SECTION, SNAPSHOT_INT));
+                if (value < last) {
+                    backwards = true;
+                }
+                last = value;
+            }
+        });
+    }
+
+    for (int value = 1; value <= reloads; value++) {
+        std::ofstream(filename) << "[snapshot_section]\nint_value="
+                                << value << "\n";
+        EXPECT_TRUE(configManager.processConfig());
+    }
+
+    for (auto& reader : readers) {
+        reader.join();
+    }
+
+    EXPECT_FALSE(backwards);
+    std::filesystem::remove(filename);
+}
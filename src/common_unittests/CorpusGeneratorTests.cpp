@@ -0,0 +1,128 @@
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <set>
+#include <string>
+#include <vector>
+#include "gtest/gtest.h"
+#include "CorpusGenerator.h"
+
+using duplitrace::common::CorpusGenerator;
+using duplitrace::common::CorpusSettings;
+using duplitrace::common::CorpusSizeDistribution;
+
+static std::string ReadContents(const std::filesystem::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(file),
+                       std::istreambuf_iterator<char>());
+}
+
+class CorpusGeneratorTest : public ::testing::Test {
+ protected:
+    void SetUp() override {
+        directory_ = std::filesystem::temp_directory_path() /
+                     "duplitrace_corpus_generator_test";
+        std::filesystem::remove_all(directory_);
+
+        settings_.depth = 2;
+        settings_.fan_out = 3;
+        settings_.files_per_directory = 10;
+        settings_.max_size = 4096;
+        settings_.duplicate_ratio = 0.3;
+        settings_.hard_link_ratio = 0.1;
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(directory_);
+    }
+
+    std::filesystem::path directory_;
+    CorpusSettings settings_;
+};
+
+TEST_F(CorpusGeneratorTest, SameSeedGivesSameTree) {
+    CorpusGenerator first(settings_);
+    CorpusGenerator second(settings_);
+
+    ASSERT_TRUE(first.Generate((directory_ / "first").string()));
+    ASSERT_TRUE(second.Generate((directory_ / "second").string()));
+
+    // 13 directories of 10 files.
+    EXPECT_EQ(first.Statistics().directories, 13u);
+    EXPECT_EQ(first.Statistics().files, 130u);
+    EXPECT_EQ(first.Statistics().bytes, second.Statistics().bytes);
+
+    for (const auto& entry :
+         std::filesystem::recursive_directory_iterator(directory_ / "first")) {
+        if (entry.is_regular_file()) {
+            auto relative = std::filesystem::relative(entry.path(),
+                                                      directory_ / "first");
+            EXPECT_EQ(ReadContents(entry.path()),
+                      ReadContents(directory_ / "second" / relative));
+        }
+    }
+
+    settings_.seed = 2;
+    CorpusGenerator other(settings_);
+    ASSERT_TRUE(other.Generate((directory_ / "other").string()));
+    EXPECT_NE(ReadContents(directory_ / "first" / "f0.bin"),
+              ReadContents(directory_ / "other" / "f0.bin"));
+}
+
+TEST_F(CorpusGeneratorTest, GroupsMatchTheFiles) {
+    CorpusGenerator generator(settings_);
+    ASSERT_TRUE(generator.Generate(directory_.string()));
+
+    auto duplicates = generator.DuplicateGroups();
+    auto links = generator.HardLinkGroups();
+    ASSERT_FALSE(duplicates.empty());
+    ASSERT_FALSE(links.empty());
+
+    std::set<std::string> contents;
+
+    for (const auto& group : duplicates) {
+        std::string first = ReadContents(directory_ / group.paths[0]);
+        EXPECT_EQ(first.size(), group.size);
+        EXPECT_TRUE(contents.insert(first).second);
+
+        for (const auto& path : group.paths) {
+            EXPECT_EQ(ReadContents(directory_ / path), first);
+            EXPECT_FALSE(std::filesystem::equivalent(
+                directory_ / group.paths[0], directory_ / path) &&
+                path != group.paths[0]);
+        }
+    }
+
+    for (const auto& group : links) {
+        for (const auto& path : group) {
+            EXPECT_TRUE(std::filesystem::equivalent(directory_ / group[0],
+                                                    directory_ / path));
+        }
+    }
+}
+
+TEST_F(CorpusGeneratorTest, SparseFilesHaveDataAtEachEnd) {
+    settings_.depth = 0;
+    settings_.files_per_directory = 1;
+    settings_.size_distribution = CorpusSizeDistribution::FIXED;
+    settings_.max_size = 1024 * 1024;
+    settings_.sparse_ratio = 1.0;
+
+    CorpusGenerator generator(settings_);
+    ASSERT_TRUE(generator.Generate(directory_.string()));
+    EXPECT_EQ(generator.Statistics().sparse_files, 1u);
+
+    std::string contents = ReadContents(directory_ / "f0.bin");
+    ASSERT_EQ(contents.size(), 1024u * 1024u);
+    EXPECT_NE(contents.substr(0, 4096), std::string(4096, '\0'));
+    EXPECT_EQ(contents.substr(4096, 4096), std::string(4096, '\0'));
+    EXPECT_NE(contents.substr(contents.size() - 4096), std::string(4096, '\0'));
+}
+
+TEST_F(CorpusGeneratorTest, RootMustBeEmpty) {
+    std::filesystem::create_directories(directory_);
+    std::ofstream(directory_ / "existing");
+
+    CorpusGenerator generator(settings_);
+    EXPECT_FALSE(generator.Generate(directory_.string()));
+}
@@ -0,0 +1,83 @@
+#include <vector>
+#include "gtest/gtest.h"
+#include "../cron_parser/CronExpressionCache.h"
+
+using duplitrace::cronparser::BadCronExpression;
+using duplitrace::cronparser::CronExpression;
+using duplitrace::cronparser::CronExpressionCache;
+using duplitrace::cronparser::CronExpressionHasher;
+
+TEST(CronExpressionCacheTest, SpacingAndCaseDoNotMatter) {
+    CronExpressionCache cache;
+
+    auto first = cache.Find("0 30 2 * * SUN");
+
+    EXPECT_EQ(cache.Find("  0 30   2 * * sun "), first);
+    EXPECT_EQ(cache.Find("0 30 2 * * Sun"), first);
+    EXPECT_EQ(cache.TextCount(), 1u);
+    EXPECT_EQ(cache.ExpressionCount(), 1u);
+}
+
+TEST(CronExpressionCacheTest, SameScheduleSharesOneInstance) {
+    CronExpressionCache cache;
+
+    auto byName = cache.Find("0 30 2 * * SUN");
+    auto byNumber = cache.Find("0 30 2 * * 0");
+    EXPECT_EQ(byName, byNumber);
+
+    auto ascending = cache.Find("0 0,30 * * * *");
+    auto descending = cache.Find("0 30,0 * * * *");
+    auto stepped = cache.Find("0 */30 * * * *");
+    EXPECT_EQ(ascending, descending);
+    EXPECT_EQ(ascending, stepped);
+
+    EXPECT_NE(byName, ascending);
+    EXPECT_EQ(cache.TextCount(), 5u);
+    EXPECT_EQ(cache.ExpressionCount(), 2u);
+}
+
+TEST(CronExpressionCacheTest, InvalidExpressionIsNotCached) {
+    CronExpressionCache cache;
+
+    EXPECT_THROW(cache.Find("0 30 2 * * FUNDAY"), BadCronExpression);
+    EXPECT_THROW(cache.Find(""), BadCronExpression);
+    EXPECT_EQ(cache.TextCount(), 0u);
+    EXPECT_EQ(cache.ExpressionCount(), 0u);
+}
+
+TEST(CronExpressionCacheTest, GlobalCacheIsShared) {
+    EXPECT_EQ(&CronExpressionCache::Global(), &CronExpressionCache::Global());
+    EXPECT_EQ(CronExpressionCache::Global().Find("0 0 12 * * MON-FRI"),
+              CronExpressionCache::Global().Find("0 0 12 * * 1-5"));
+}
+
+TEST(CronExpressionHasherTest, HashAgreesWithEquality) {
+    const std::vector<CronExpression> expressions {
+        CronExpression("0 30 2 * * SUN"),
+        CronExpression("0 30 2 * * 0"),
+        CronExpression("0 30 2 ? * 0"),
+        CronExpression("0 30 2 * * MON"),
+        CronExpression("0 0,30 * * * *"),
+        CronExpression("0 30,0 * * * *"),
+        CronExpression("0 */30 * * * *"),
+        CronExpression("30 0 * * * *"),
+        CronExpression("0 0 0 1 JAN *"),
+        CronExpression("0 0 0 1 1 *"),
+        CronExpression("0 0 0 1 2 *"),
+        CronExpression("* * * * * *")
+    };
+    CronExpressionHasher hasher;
+
+    for (const auto& left : expressions) {
+        for (const auto& right : expressions) {
+            SCOPED_TRACE(left.Expression() + " and " + right.Expression());
+
+            if (left == right) {
+                EXPECT_EQ(hasher(left), hasher(right));
+            } else {
+                // Not required of a hash, but these should not collide.
+                EXPECT_NE(hasher(left), hasher(right));
+            }
+        }
+    }
+}
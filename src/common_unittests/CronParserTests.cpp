@@ -0,0 +1,164 @@
+#include <cstdlib>
+#include <ctime>
+#include <string>
+#include "gtest/gtest.h"
+#include "../cron_parser/CronParser.h"
+
+using duplitrace::cronparser::BadCronExpression;
+using duplitrace::cronparser::CronExpression;
+
+// Local time for the start of a search, the month is one-based.
+static std::tm MakeTime(int year, int month, int day, int hour, int minute,
+                        int second) {
+    std::tm time = {};
+    time.tm_year = year - 1900;
+    time.tm_mon = month - 1;
+    time.tm_mday = day;
+    time.tm_hour = hour;
+    time.tm_min = minute;
+    time.tm_sec = second;
+    time.tm_isdst = -1;
+    return time;
+}
+
+static void ExpectTime(const std::tm& time, int year, int month, int day,
+                       int hour, int minute, int second) {
+    EXPECT_EQ(time.tm_year + 1900, year);
+    EXPECT_EQ(time.tm_mon + 1, month);
+    EXPECT_EQ(time.tm_mday, day);
+    EXPECT_EQ(time.tm_hour, hour);
+    EXPECT_EQ(time.tm_min, minute);
+    EXPECT_EQ(time.tm_sec, second);
+}
+
+TEST(CronParserTest, NextTriggerIsAfterTheStart) {
+    CronExpression everySecond("* * * * * *");
+    CronExpression quarterHours("0 */15 * * * *");
+
+    ExpectTime(everySecond.getNextTriggerTime(MakeTime(2024, 5, 14, 10, 0, 0)),
+               2024, 5, 14, 10, 0, 1);
+    ExpectTime(quarterHours.getNextTriggerTime(
+                   MakeTime(2024, 5, 14, 10, 15, 0)),
+               2024, 5, 14, 10, 30, 0);
+    ExpectTime(quarterHours.getNextTriggerTime(
+                   MakeTime(2024, 5, 14, 10, 59, 59)),
+               2024, 5, 14, 11, 0, 0);
+}
+
+TEST(CronParserTest, NextTriggerRollsOverTheMonth) {
+    CronExpression firstOfMonth("0 0 0 1 * *");
+    CronExpression thirtyFirst("0 0 12 31 * *");
+
+    ExpectTime(firstOfMonth.getNextTriggerTime(
+                   MakeTime(2024, 1, 31, 12, 0, 0)),
+               2024, 2, 1, 0, 0, 0);
+
+    // Months without a 31st are skipped.
+    ExpectTime(thirtyFirst.getNextTriggerTime(MakeTime(2024, 3, 31, 13, 0, 0)),
+               2024, 5, 31, 12, 0, 0);
+}
+
+TEST(CronParserTest, NextTriggerRollsOverTheYear) {
+    CronExpression everySecond("* * * * * *");
+    CronExpression january("0 30 9 * JAN *");
+
+    ExpectTime(everySecond.getNextTriggerTime(
+                   MakeTime(2023, 12, 31, 23, 59, 59)),
+               2024, 1, 1, 0, 0, 0);
+    ExpectTime(january.getNextTriggerTime(MakeTime(2024, 2, 1, 0, 0, 0)),
+               2025, 1, 1, 9, 30, 0);
+}
+
+TEST(CronParserTest, NextTriggerFindsLeapDays) {
+    CronExpression leapDay("0 0 0 29 2 *");
+
+    ExpectTime(leapDay.getNextTriggerTime(MakeTime(2023, 3, 1, 0, 0, 0)),
+               2024, 2, 29, 0, 0, 0);
+    ExpectTime(leapDay.getNextTriggerTime(MakeTime(2024, 2, 29, 0, 0, 0)),
+               2028, 2, 29, 0, 0, 0);
+
+    // 2100 is not a leap year.
+    ExpectTime(leapDay.getNextTriggerTime(MakeTime(2096, 3, 1, 0, 0, 0)),
+               2104, 2, 29, 0, 0, 0);
+}
+
+TEST(CronParserTest, NextTriggerNeedsDayOfMonthAndDayOfWeek) {
+    CronExpression fridayThirteenth("0 0 0 13 * FRI");
+    CronExpression mondays("0 0 8 ? * MON");
+
+    // Both day fields have to match, the 13th of January 2024 is a Saturday.
+    ExpectTime(fridayThirteenth.getNextTriggerTime(
+                   MakeTime(2024, 1, 1, 0, 0, 0)),
+               2024, 9, 13, 0, 0, 0);
+    ExpectTime(fridayThirteenth.getNextTriggerTime(
+                   MakeTime(2024, 9, 13, 0, 0, 0)),
+               2024, 12, 13, 0, 0, 0);
+
+    ExpectTime(mondays.getNextTriggerTime(MakeTime(2024, 5, 14, 0, 0, 0)),
+               2024, 5, 20, 8, 0, 0);
+    EXPECT_EQ(mondays.getNextTriggerTime(
+                  MakeTime(2024, 5, 14, 0, 0, 0)).tm_wday, 1);
+}
+
+TEST(CronParserTest, NextTriggerThrowsIfNeverFires) {
+    CronExpression thirtiethFebruary("0 0 0 30 2 *");
+    CronExpression thirtyFirstApril("0 0 0 31 4 *");
+
+    EXPECT_THROW(thirtiethFebruary.getNextTriggerTime(
+                     MakeTime(2024, 1, 1, 0, 0, 0)),
+                 BadCronExpression);
+    EXPECT_THROW(thirtyFirstApril.getNextTriggerTime(
+                     MakeTime(2024, 1, 1, 0, 0, 0)),
+                 BadCronExpression);
+}
+
+TEST(CronParserTest, StartIsNormalisedBeforeSearching) {
+    CronExpression everySecond("* * * * * *");
+    CronExpression firstOfMonth("0 0 0 1 * *");
+
+    ExpectTime(everySecond.getNextTriggerTime(
+                   MakeTime(2024, 12, 31, 23, 59, 60)),
+               2025, 1, 1, 0, 0, 1);
+    ExpectTime(firstOfMonth.getNextTriggerTime(MakeTime(2024, 4, 31, 0, 0, 0)),
+               2024, 6, 1, 0, 0, 0);
+}
+
+// Runs a test in a time zone with daylight saving, given as a POSIX rule so
+// that it does not depend on the time zone database.
+class CronParserDaylightSavingTest : public ::testing::Test {
+ protected:
+    void SetUp() override {
+        const char* timeZone = std::getenv("TZ");
+        had_time_zone_ = timeZone != nullptr;
+        time_zone_ = timeZone ? timeZone : "";
+
+        setenv("TZ", "EST5EDT,M3.2.0,M11.1.0", 1);
+        tzset();
+    }
+
+    void TearDown() override {
+        if (had_time_zone_) {
+            setenv("TZ", time_zone_.c_str(), 1);
+        } else {
+            unsetenv("TZ");
+        }
+        tzset();
+    }
+
+    bool had_time_zone_;
+    std::string time_zone_;
+};
+
+TEST_F(CronParserDaylightSavingTest, SkippedTimesAreNotTriggered) {
+    CronExpression halfPastTwo("0 30 2 * * *");
+    CronExpression halfPast("0 30 * * * *");
+
+    // 02:00 to 03:00 does not exist on 10th March 2024, so 02:30 is missed
+    // that day rather than being moved to 03:30.
+    ExpectTime(halfPastTwo.getNextTriggerTime(MakeTime(2024, 3, 10, 0, 0, 0)),
+               2024, 3, 11, 2, 30, 0);
+
+    // Hourly runs carry on from the first time after the change.
+    ExpectTime(halfPast.getNextTriggerTime(MakeTime(2024, 3, 10, 1, 45, 0)),
+               2024, 3, 10, 3, 30, 0);
+}
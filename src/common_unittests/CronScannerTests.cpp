@@ -0,0 +1,133 @@
+#include <string>
+#include <string_view>
+#include "gtest/gtest.h"
+#include "../cron_parser/CronParser.h"
+
+using duplitrace::cronparser::BadCronExpression;
+using duplitrace::cronparser::CronExpression;
+using duplitrace::cronparser::CronScanResult;
+using duplitrace::cronparser::ScanCronExpression;
+
+// Whether an expression is rejected with the given message, usable in a
+// static_assert.
+static constexpr bool ScanFails(std::string_view expression,
+                                std::string_view message) {
+    const CronScanResult result = ScanCronExpression(expression);
+    return result.error != nullptr && message == result.error;
+}
+
+// Expressions are scanned when building, so these fail the build if broken.
+static_assert(ScanCronExpression("0 0 3 * * *").error == nullptr);
+static_assert(ScanCronExpression("0 0 3 * * *").fields.hours == 1u << 3);
+static_assert(ScanCronExpression("0 0 0 ? * MON-FRI").fields.days_of_week ==
+              0x3E);
+static_assert(ScanCronExpression("0 0 0 1 JAN/3 *").fields.months == 0x249);
+static_assert(ScanFails("0 0 0 * * 0/MON", "Value is not a number"));
+static_assert(ScanFails("0/0 * * * * *",
+                        "Incrementer must be a positive value"));
+static_assert(ScanFails("0 0 24 * * *", "Specified range exceeds maximum"));
+static_assert(ScanFails("0 0 0 * * * *",
+                        "cron expression must have six fields"));
+
+// An expression scanned when building matches one scanned when running.
+TEST(CronScannerTest, CronExpressionMacroMatchesConstructor) {
+    CronExpression built = CRON_EXPRESSION("0 */15 9-17 ? JAN-MAR MON-FRI");
+    CronExpression scanned("0 */15 9-17 ? JAN-MAR MON-FRI");
+
+    EXPECT_EQ(built, scanned);
+    EXPECT_EQ(built.Expression(), "0 */15 9-17 ? JAN-MAR MON-FRI");
+}
+
+TEST(CronScannerTest, NamesMatchTheirNumbers) {
+    EXPECT_EQ(CronExpression("0 0 0 * JAN-DEC SUN-SAT"),
+              CronExpression("0 0 0 * 1-12 0-6"));
+    EXPECT_EQ(CronExpression("0 0 0 * jun,Aug wed"),
+              CronExpression("0 0 0 * 6,8 3"));
+
+    // Names are only valid in the fields they belong to.
+    EXPECT_THROW(CronExpression("0 0 0 * MON *"), BadCronExpression);
+    EXPECT_THROW(CronExpression("0 0 0 * * JAN"), BadCronExpression);
+    EXPECT_THROW(CronExpression("0 0 MON * * *"), BadCronExpression);
+}
+
+TEST(CronScannerTest, QuestionMarkIsAnyDay) {
+    EXPECT_EQ(CronExpression("0 0 0 ? * *"), CronExpression("0 0 0 * * *"));
+    EXPECT_EQ(CronExpression("0 0 0 * * ?"), CronExpression("0 0 0 * * *"));
+
+    // Only the day fields accept it, and only on its own.
+    EXPECT_THROW(CronExpression("? 0 0 * * *"), BadCronExpression);
+    EXPECT_THROW(CronExpression("0 0 0 * ? *"), BadCronExpression);
+    EXPECT_THROW(CronExpression("0 0 0 ?,1 * *"), BadCronExpression);
+}
+
+TEST(CronScannerTest, RangesAndStepsSetTheirValues) {
+    constexpr CronScanResult result =
+        ScanCronExpression("5-7 */20 1-10/3 10/7 2/5 ?");
+
+    EXPECT_EQ(result.error, nullptr);
+    EXPECT_EQ(result.fields.seconds, 0xE0u);
+    EXPECT_EQ(result.fields.minutes, 1u | 1u << 20 | 1ull << 40);
+    EXPECT_EQ(result.fields.hours, 1u << 1 | 1u << 4 | 1u << 7 | 1u << 10);
+
+    // Day 10, 17, 24 and 31, bit 0 is the first of the month.
+    EXPECT_EQ(result.fields.days_of_month,
+              1u << 9 | 1u << 16 | 1u << 23 | 1u << 30);
+
+    // February, July and December, bit 0 is January.
+    EXPECT_EQ(result.fields.months, 1u << 1 | 1u << 6 | 1u << 11);
+    EXPECT_EQ(result.fields.days_of_week, 0x7Fu);
+}
+
+TEST(CronScannerTest, StepIsAPositiveNumber) {
+    EXPECT_EQ(ScanCronExpression("0/59 * * * * *").fields.seconds,
+              1u | 1ull << 59);
+    EXPECT_EQ(ScanCronExpression("*/255 * * * * *").fields.seconds, 1u);
+
+    EXPECT_TRUE(ScanFails("*/0 * * * * *",
+                          "Incrementer must be a positive value"));
+    EXPECT_TRUE(ScanFails("*/ * * * * *", "Value is not a number"));
+    EXPECT_TRUE(ScanFails("*/-1 * * * * *", "Value is not a number"));
+    EXPECT_TRUE(ScanFails("*/256 * * * * *", "Value is out of range"));
+    EXPECT_TRUE(ScanFails("0 0 0 * JAN/FEB *", "Value is not a number"));
+    EXPECT_TRUE(ScanFails("0 0 0 * * SUN/mon", "Value is not a number"));
+    EXPECT_TRUE(ScanFails("0/1/2 * * * * *",
+                          "Incrementer must have two fields"));
+}
+
+TEST(CronScannerTest, InvalidExpressionsGiveTheirReason) {
+    const struct {
+        const char* expression;
+        const char* message;
+    } cases[] = {
+        { "", "Invalid empty cron expression" },
+        { "    ", "cron expression must have six fields" },
+        { "0 0 0 * *", "cron expression must have six fields" },
+        { "0 0 0 * * * *", "cron expression must have six fields" },
+        { "60 * * * * *", "Specified range exceeds maximum" },
+        { "* * * 0 * *", "Specified range is less than minimum" },
+        { "* * * * 13 *", "Specified range exceeds maximum" },
+        { "* * 5-2 * * *", "Specified range start exceeds range end" },
+        { "* * 1-2-3 * * *", "Specified range requires two fields" },
+        { "* * 1- * * *", "Value is not a number" },
+        { "1, * * * * *", "Value cannot end with comma" },
+        { "1,,2 * * * * *", "Value is not a number" },
+        { "x * * * * *", "Value is not a number" },
+
+        // The fields are checked in the same order whatever the errors.
+        { "0 0 0 0 13 7", "Specified range exceeds maximum" },
+        { "0 0 0 0 13 *", "Specified range is less than minimum" }
+    };
+
+    for (const auto& test : cases) {
+        SCOPED_TRACE(test.expression);
+        EXPECT_TRUE(ScanFails(test.expression, test.message));
+
+        try {
+            CronExpression expression(test.expression);
+            ADD_FAILURE() << "No exception was thrown";
+        }
+        catch (const BadCronExpression& ex) {
+            EXPECT_EQ(std::string(ex.what()), test.message);
+        }
+    }
+}
@@ -0,0 +1,140 @@
+#include <cstdlib>
+#include <ctime>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include "gtest/gtest.h"
+#include "../cron_parser/CompiledCronExpression.h"
+#include "../cron_parser/CronTimeZone.h"
+
+using duplitrace::cronparser::BadCronTimeZone;
+using duplitrace::cronparser::CompiledCronExpression;
+using duplitrace::cronparser::CRONPARSER_TIMEZONE_DIRECTORY;
+using duplitrace::cronparser::CronExpression;
+using duplitrace::cronparser::CronTimeZone;
+
+/*
+Seconds since 1970-01-01 00:00:00 of a date and time, which is a UTC time or
+a local time depending on what it is passed to. The month is one-based.
+*/
+static int64_t Seconds(int year, int month, int day, int hour, int minute,
+                       int second) {
+    std::tm time = {};
+    time.tm_year = year - 1900;
+    time.tm_mon = month - 1;
+    time.tm_mday = day;
+    time.tm_hour = hour;
+    time.tm_min = minute;
+    time.tm_sec = second;
+    return static_cast<int64_t>(timegm(&time));
+}
+
+// The zones are read from the system's tzdata, which may not be installed.
+class CronTimeZoneTest : public ::testing::Test {
+ protected:
+    void SetUp() override {
+        const char* directory = std::getenv("TZDIR");
+        std::filesystem::path london =
+            std::filesystem::path(directory ? directory :
+                                  CRONPARSER_TIMEZONE_DIRECTORY) /
+            "Europe" / "London";
+
+        if (!std::filesystem::exists(london)) {
+            GTEST_SKIP() << "The time zone files are not installed";
+        }
+    }
+};
+
+TEST_F(CronTimeZoneTest, SkippedLocalTimesMapToTheClocksGoingForward) {
+    auto london = CronTimeZone::Find("Europe/London");
+    int64_t clocksChange = Seconds(2024, 3, 31, 1, 0, 0);
+
+    EXPECT_EQ(london->Name(), "Europe/London");
+    EXPECT_EQ(london->UtcOffset(clocksChange - 1), 0);
+    EXPECT_EQ(london->UtcOffset(clocksChange), 3600);
+
+    // 01:00 to 01:59 local time never happen on the 31st of March 2024.
+    EXPECT_EQ(london->UtcTime(Seconds(2024, 3, 31, 0, 59, 59)),
+              clocksChange - 1);
+    EXPECT_EQ(london->UtcTime(Seconds(2024, 3, 31, 1, 30, 0)), clocksChange);
+    EXPECT_EQ(london->UtcTime(Seconds(2024, 3, 31, 2, 0, 0)), clocksChange);
+    EXPECT_EQ(london->UtcTime(Seconds(2024, 3, 31, 2, 30, 0)),
+              clocksChange + 1800);
+
+    // A trigger time in the gap fires as the clocks go forward.
+    CompiledCronExpression halfPastOne(CronExpression("0 30 1 * * *"));
+    EXPECT_EQ(halfPastOne.getNextTriggerTime(
+                  static_cast<std::time_t>(Seconds(2024, 3, 30, 12, 0, 0)),
+                  *london),
+              clocksChange);
+}
+
+TEST_F(CronTimeZoneTest, RepeatedLocalTimesMapToTheFirstOccurrence) {
+    auto sydney = CronTimeZone::Find("Australia/Sydney");
+
+    // At 03:00 daylight time on the 7th of April 2024 the clocks go back to
+    // 02:00 standard time, so 02:00 to 02:59 happen twice.
+    int64_t clocksChange = Seconds(2024, 4, 6, 16, 0, 0);
+    int64_t firstTime = clocksChange - 1800;
+    int64_t secondTime = clocksChange + 1800;
+
+    EXPECT_EQ(sydney->UtcOffset(firstTime), 11 * 3600);
+    EXPECT_EQ(sydney->UtcOffset(secondTime), 10 * 3600);
+    EXPECT_EQ(sydney->UtcTime(Seconds(2024, 4, 7, 2, 30, 0)), firstTime);
+
+    EXPECT_EQ(sydney->LatestLocalTime(firstTime),
+              Seconds(2024, 4, 7, 2, 30, 0));
+    EXPECT_EQ(sydney->LatestLocalTime(secondTime),
+              Seconds(2024, 4, 7, 2, 59, 59));
+    EXPECT_EQ(sydney->LatestLocalTime(clocksChange + 3600),
+              Seconds(2024, 4, 7, 3, 0, 0));
+
+    // A trigger time in the repeated hour only fires the first time through.
+    CompiledCronExpression halfPastTwo(CronExpression("0 30 2 * * *"));
+    EXPECT_EQ(halfPastTwo.getNextTriggerTime(
+                  static_cast<std::time_t>(firstTime - 1), *sydney),
+              firstTime);
+    EXPECT_EQ(halfPastTwo.getNextTriggerTime(
+                  static_cast<std::time_t>(firstTime), *sydney),
+              Seconds(2024, 4, 7, 16, 30, 0));
+}
+
+TEST_F(CronTimeZoneTest, RuleIsFollowedPastTheLastTransition) {
+    auto london = CronTimeZone::Find("Europe/London");
+
+    // Zone files only list transitions up to 2037 at the latest, later ones
+    // come from the rule at the end of the file. Summer time starts on the
+    // last Sunday in March, which in 2300 is the 25th.
+    int64_t clocksChange = Seconds(2300, 3, 25, 1, 0, 0);
+
+    EXPECT_EQ(london->UtcOffset(clocksChange - 1), 0);
+    EXPECT_EQ(london->UtcOffset(clocksChange), 3600);
+    EXPECT_EQ(london->UtcOffset(Seconds(2300, 7, 1, 12, 0, 0)), 3600);
+    EXPECT_EQ(london->UtcOffset(Seconds(2300, 12, 1, 12, 0, 0)), 0);
+    EXPECT_EQ(london->UtcTime(Seconds(2300, 3, 25, 1, 30, 0)), clocksChange);
+}
+
+TEST_F(CronTimeZoneTest, ZonesAreLoadedOnce) {
+    EXPECT_EQ(CronTimeZone::Find("Europe/London"),
+              CronTimeZone::Find("Europe/London"));
+    EXPECT_EQ(CronTimeZone::Find("UTC")->UtcOffset(0), 0);
+}
+
+TEST_F(CronTimeZoneTest, InvalidOrMissingZonesThrow) {
+    for (const char* name : { "", "/etc/localtime", "../../etc/passwd",
+                              "Europe/../../etc/passwd", "Europe/New York",
+                              "Europe/London;" }) {
+        SCOPED_TRACE(name);
+        try {
+            CronTimeZone::Find(name);
+            ADD_FAILURE() << "No exception was thrown";
+        }
+        catch (const BadCronTimeZone& ex) {
+            EXPECT_EQ(std::string(ex.what()),
+                      "Invalid time zone name '" + std::string(name) + "'");
+        }
+    }
+
+    EXPECT_THROW(CronTimeZone::Find("Europe/Atlantis"), BadCronTimeZone);
+    EXPECT_THROW(CronTimeZone::Find("Europe"), BadCronTimeZone);
+}
@@ -0,0 +1,91 @@
+#include <chrono>
+#include <ctime>
+#include <thread>
+#include <unistd.h>
+#include "gtest/gtest.h"
+#include "EventLoop.h"
+
+using duplitrace::common::EventLoop;
+using namespace std::chrono_literals;
+
+TEST(EventLoopTest, WakeUnblocksTheLoop) {
+    EventLoop loop;
+    ASSERT_TRUE(loop.Initialise());
+
+    std::thread waker([&loop] {
+        std::this_thread::sleep_for(20ms);
+        loop.Wake();
+    });
+
+    auto started = std::chrono::steady_clock::now();
+    loop.WaitForEvents();
+    waker.join();
+
+    EXPECT_GE(std::chrono::steady_clock::now() - started, 10ms);
+
+    // A wake up that arrives before the wait is not lost.
+    loop.Wake();
+    loop.WaitForEvents();
+}
+
+TEST(EventLoopTest, DeadlineRunsTheTimerCallback) {
+    EventLoop loop;
+    ASSERT_TRUE(loop.Initialise());
+    int fired = 0;
+
+    loop.SetTimerCallback([&fired] { fired++; });
+
+    // An overdue deadline fires straight away.
+    loop.SetDeadline(std::time(nullptr) - 10);
+    loop.WaitForEvents();
+    EXPECT_EQ(fired, 1);
+
+    // The deadline is a wall clock second, so this fires within two seconds.
+    auto started = std::chrono::steady_clock::now();
+    loop.SetDeadline(std::time(nullptr) + 1);
+    loop.WaitForEvents();
+    EXPECT_EQ(fired, 2);
+    EXPECT_LT(std::chrono::steady_clock::now() - started, 3s);
+}
+
+TEST(EventLoopTest, ClearedDeadlineDoesNotFire) {
+    EventLoop loop;
+    ASSERT_TRUE(loop.Initialise());
+    int fired = 0;
+
+    loop.SetTimerCallback([&fired] { fired++; });
+    loop.SetDeadline(std::time(nullptr) - 10);
+    loop.SetDeadline(std::nullopt);
+
+    std::thread waker([&loop] {
+        std::this_thread::sleep_for(20ms);
+        loop.Wake();
+    });
+
+    loop.WaitForEvents();
+    waker.join();
+
+    EXPECT_EQ(fired, 0);
+}
+
+TEST(EventLoopTest, ReadableDescriptorRunsItsCallback) {
+    EventLoop loop;
+    ASSERT_TRUE(loop.Initialise());
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+    int readable = 0;
+
+    ASSERT_TRUE(loop.AddFileDescriptor(fds[0], [&readable, &fds] {
+        char byte;
+        EXPECT_EQ(read(fds[0], &byte, 1), 1);
+        readable++;
+    }));
+
+    ASSERT_EQ(write(fds[1], "x", 1), 1);
+    loop.WaitForEvents();
+    EXPECT_EQ(readable, 1);
+
+    EXPECT_TRUE(loop.RemoveFileDescriptor(fds[0]));
+    close(fds[0]);
+    close(fds[1]);
+}
@@ -0,0 +1,177 @@
+#include <cerrno>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "gtest/gtest.h"
+#include "io/FileReader.h"
+#include "io/SharedExtents.h"
+
+using duplitrace::common::io::CreateFileReader;
+using duplitrace::common::io::FileRange;
+using duplitrace::common::io::FileReadRequest;
+using duplitrace::common::io::FileReaderBackend;
+using duplitrace::common::io::FileReaderSettings;
+using duplitrace::common::io::ReadSharedExtents;
+
+const FileReaderBackend FILE_READER_TEST_BACKENDS[] = {
+    FileReaderBackend::AUTOMATIC, FileReaderBackend::PREAD
+};
+
+// Reads every request and returns the data each one received.
+static std::vector<std::string> ReadAll(
+        FileReaderBackend backend,
+        const std::vector<FileReadRequest>& requests,
+        std::vector<int>* errors) {
+    FileReaderSettings settings;
+    settings.backend = backend;
+    settings.queue_depth = 8;
+    settings.block_size = 4096;
+
+    auto reader = CreateFileReader(settings);
+    std::vector<std::string> contents(requests.size());
+    std::mutex mutex;
+
+    errors->assign(requests.size(), -1);
+    reader->ReadFiles(requests,
+        [&](size_t request, const uint8_t* data, size_t length) {
+            std::lock_guard<std::mutex> lock(mutex);
+            contents[request].append(reinterpret_cast<const char*>(data),
+                                     length);
+            return true;
+        },
+        [&](size_t request, int error) {
+            std::lock_guard<std::mutex> lock(mutex);
+            (*errors)[request] = error;
+        });
+
+    return contents;
+}
+
+class FileReaderTest : public ::testing::Test {
+ protected:
+    void SetUp() override {
+        directory_ = std::filesystem::temp_directory_path() /
+                     "duplitrace_file_reader_test";
+        std::filesystem::create_directories(directory_);
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(directory_);
+    }
+
+    std::string WriteFile(const std::string& name, size_t length) {
+        std::string path = (directory_ / name).string();
+        std::ofstream file(path, std::ios::binary);
+
+        for (size_t i = 0; i < length; i++) {
+            file.put(static_cast<char>(i % 251));
+        }
+
+        return path;
+    }
+
+    static std::string Expected(size_t offset, size_t length) {
+        std::string data;
+
+        for (size_t i = offset; i < offset + length; i++) {
+            data.push_back(static_cast<char>(i % 251));
+        }
+
+        return data;
+    }
+
+    std::filesystem::path directory_;
+};
+
+TEST_F(FileReaderTest, ReadsRangesInOrderOnEveryBackend) {
+    std::vector<FileReadRequest> requests;
+
+    // More files than the queue depth, and sizes either side of a block.
+    for (size_t i = 0; i < 40; i++) {
+        size_t length = 1000 + i * 613;
+        requests.push_back({ WriteFile("file" + std::to_string(i), length), 0,
+                             { { 0, 100 }, { length - 100, 100 } } });
+    }
+
+    for (FileReaderBackend backend : FILE_READER_TEST_BACKENDS) {
+        std::vector<int> errors;
+        auto contents = ReadAll(backend, requests, &errors);
+
+        for (size_t i = 0; i < requests.size(); i++) {
+            size_t length = 1000 + i * 613;
+
+            EXPECT_EQ(errors[i], 0) << "file " << i;
+            EXPECT_EQ(contents[i],
+                      Expected(0, 100) + Expected(length - 100, 100))
+                << "file " << i;
+        }
+    }
+}
+
+TEST_F(FileReaderTest, RangePastEndStopsAtEndOfFile) {
+    std::vector<FileReadRequest> requests = {
+        { WriteFile("short", 10000), 0, { { 5000, 1 << 20 } } }
+    };
+
+    for (FileReaderBackend backend : FILE_READER_TEST_BACKENDS) {
+        std::vector<int> errors;
+        auto contents = ReadAll(backend, requests, &errors);
+
+        EXPECT_EQ(errors[0], 0);
+        EXPECT_EQ(contents[0], Expected(5000, 5000));
+    }
+}
+
+TEST_F(FileReaderTest, MissingFileReportsError) {
+    std::vector<FileReadRequest> requests = {
+        { (directory_ / "missing").string(), 0, { { 0, 100 } } },
+        { WriteFile("present", 100), 0, { { 0, 100 } } }
+    };
+
+    for (FileReaderBackend backend : FILE_READER_TEST_BACKENDS) {
+        std::vector<int> errors;
+        auto contents = ReadAll(backend, requests, &errors);
+
+        EXPECT_EQ(errors[0], ENOENT);
+        EXPECT_EQ(errors[1], 0);
+        EXPECT_EQ(contents[1], Expected(0, 100));
+    }
+}
+
+TEST_F(FileReaderTest, HandlerCanAbandonRequest) {
+    std::vector<FileReadRequest> requests = {
+        { WriteFile("abandoned", 100000), 0, { { 0, 100000 } } }
+    };
+
+    for (FileReaderBackend backend : FILE_READER_TEST_BACKENDS) {
+        FileReaderSettings settings;
+        settings.backend = backend;
+        settings.block_size = 4096;
+
+        auto reader = CreateFileReader(settings);
+        size_t blocks = 0;
+        int error = -1;
+
+        reader->ReadFiles(requests,
+            [&blocks](size_t, const uint8_t*, size_t) {
+                return ++blocks < 2;
+            },
+            [&error](size_t, int result) { error = result; });
+
+        EXPECT_EQ(blocks, 2u);
+        EXPECT_EQ(error, ECANCELED);
+    }
+}
+
+TEST_F(FileReaderTest, UnsharedFileHasNoSharedExtents) {
+    std::string path = WriteFile("unshared", 100000);
+    std::string extents;
+
+    // A file that was just written only has extents of its own, whatever
+    // the filesystem.
+    EXPECT_FALSE(ReadSharedExtents(path, &extents));
+    EXPECT_FALSE(ReadSharedExtents(path + ".missing", &extents));
+}
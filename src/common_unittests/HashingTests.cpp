@@ -0,0 +1,140 @@
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "gtest/gtest.h"
+#include "hashing/Hasher.h"
+
+using duplitrace::common::hashing::CreateHasher;
+using duplitrace::common::hashing::HashAlgorithm;
+using duplitrace::common::hashing::HashKernel;
+using duplitrace::common::hashing::HashKernelSupported;
+
+struct HashTestVector {
+    size_t length;
+    const char* xxh3;
+    const char* blake3;
+};
+
+// Reference values for an input of bytes 0, 1, ..., 250, 0, 1, ... (the
+// pattern used by the BLAKE3 test vectors), covering each XXH3 length class
+// and both sides of the BLAKE3 chunk and SIMD batch boundaries.
+const HashTestVector HASH_TEST_VECTORS[] = {
+    { 0, "2d06800538d394c2",
+      "af1349b9f5f9a1a6a0404dea36dcc9499bcb25c9adc112b7cc9a93cae41f3262" },
+    { 1, "c44bdff4074eecdb",
+      "2d3adedff11b61f14c886e35afa036736dcd87a74d27b5c1510225d0f592e213" },
+    { 3, "5f4299fc161c9cbb",
+      "e1be4d7a8ab5560aa4199eea339849ba8e293d55ca0a81006726d184519e647f" },
+    { 8, "3a1c2d7c85af88f8",
+      "2351207d04fc16ade43ccab08600939c7c1fa70a5c0aaca76063d04c3228eaeb" },
+    { 16, "8355e3a6f61770db",
+      "a6a492965517a830cb75fdb713465aa465f2f098233896fea44c1d98268bf9e3" },
+    { 17, "9ef341a99de37328",
+      "8462aa7be93b09fda7b93cf9f9cddb703f6dd2cc0c8edd5f9eee092edf8abf0c" },
+    { 128, "85c6174c7ff4c46b",
+      "f17e570564b26578c33bb7f44643f539624b05df1a76c81f30acd548c44b45ef" },
+    { 129, "ec7642b431ba3e5a",
+      "683aaae9f3c5ba37eaaf072aed0f9e30bac0865137bae68b1fde4ca2aebdcb12" },
+    { 240, "375a384d957fe865",
+      "45e1a0dc23dbe51733d7269a3c0f519c2a63b0718835b2b537677eba734db0d8" },
+    { 241, "02e8cd95421c6d02",
+      "749b36ae651c22e8567db692a6876e0ca4fd3daeb7aa8fa3ab2f642ccc69a8f6" },
+    { 1024, "e5d78bafa45b2aa5",
+      "42214739f095a406f3fc83deb889744ac00df831c10daa55189b5d121c855af7" },
+    { 1025, "e95c42288f28186e",
+      "d00278ae47eb27b34faecf67b4fe263f82d5412916c1ffd97c8cb7fb814b8444" },
+    { 4096, "7135ffa504f1bc71",
+      "015094013f57a5277b59d8475c0501042c0b642e531b0a1c8f58d2163229e969" },
+    { 16385, "fea38d9173737a4b",
+      "1dabe216be2578830263b049de1639f39f05a4da616b9b78c7a5e4e41662fd1f" },
+    { 102400, "1428e17f1cac2837",
+      "bc3e3d41a1146b069abffad3c0d44860cf664390afce4d9661f7902e7943e085" },
+    { 1048577, "47a84c196fd973df",
+      "2f053cd7472cf0cd2f9adaf45c1180255b91b9a865404a63671a0ee5f792ed33" },
+};
+
+const HashKernel HASH_TEST_KERNELS[] = {
+    HashKernel::SCALAR, HashKernel::NEON, HashKernel::AVX2, HashKernel::AVX512
+};
+
+static std::vector<uint8_t> TestInput(size_t length) {
+    std::vector<uint8_t> input(length);
+    for (size_t i = 0; i < length; i++) {
+        input[i] = static_cast<uint8_t>(i % 251);
+    }
+    return input;
+}
+
+static std::string HashInPieces(HashAlgorithm algorithm, HashKernel kernel,
+                                const std::vector<uint8_t>& input,
+                                size_t pieceSize) {
+    auto hasher = CreateHasher(algorithm, kernel);
+
+    for (size_t offset = 0; offset < input.size(); offset += pieceSize) {
+        hasher->Update(input.data() + offset,
+                       std::min(pieceSize, input.size() - offset));
+    }
+
+    return hasher->Finalise().ToHexString();
+}
+
+TEST(HashingTest, Xxh3MatchesReferenceOnEveryKernel) {
+    for (HashKernel kernel : HASH_TEST_KERNELS) {
+        if (!HashKernelSupported(kernel)) {
+            continue;
+        }
+
+        for (const auto& vector : HASH_TEST_VECTORS) {
+            auto input = TestInput(vector.length);
+
+            EXPECT_EQ(HashInPieces(HashAlgorithm::XXH3, kernel, input,
+                                   input.size() + 1), vector.xxh3)
+                << "length " << vector.length;
+        }
+    }
+}
+
+TEST(HashingTest, Blake3MatchesReferenceOnEveryKernel) {
+    for (HashKernel kernel : HASH_TEST_KERNELS) {
+        if (!HashKernelSupported(kernel)) {
+            continue;
+        }
+
+        for (const auto& vector : HASH_TEST_VECTORS) {
+            auto input = TestInput(vector.length);
+
+            EXPECT_EQ(HashInPieces(HashAlgorithm::BLAKE3, kernel, input,
+                                   input.size() + 1), vector.blake3)
+                << "length " << vector.length;
+        }
+    }
+}
+
+TEST(HashingTest, StreamingMatchesSingleUpdate) {
+    auto input = TestInput(1048577);
+
+    // Piece sizes that straddle the XXH3 buffer, BLAKE3 chunks and the
+    // read buffer size used by the duplicate pipeline.
+    for (size_t pieceSize : { 1, 63, 257, 1023, 1024, 4097, 262144 }) {
+        EXPECT_EQ(HashInPieces(HashAlgorithm::XXH3, HashKernel::AVX512,
+                               input, pieceSize),
+                  "47a84c196fd973df") << "piece size " << pieceSize;
+        EXPECT_EQ(HashInPieces(HashAlgorithm::BLAKE3, HashKernel::AVX512,
+                               input, pieceSize),
+                  "2f053cd7472cf0cd2f9adaf45c1180255b91b9a865404a63671a0ee5f"
+                  "792ed33") << "piece size " << pieceSize;
+    }
+}
+
+TEST(HashingTest, ResetStartsAFreshHash) {
+    auto input = TestInput(4096);
+    auto hasher = CreateHasher(HashAlgorithm::BLAKE3);
+
+    hasher->Update(input.data(), 1000);
+    hasher->Reset();
+    hasher->Update(input.data(), input.size());
+
+    EXPECT_EQ(hasher->Finalise().ToHexString(),
+              "015094013f57a5277b59d8475c0501042c0b642e531b0a1c8f58d2163229"
+              "e969");
+}
@@ -0,0 +1,297 @@
+#include <cstddef>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "gtest/gtest.h"
+#include "hashing/Hasher.h"
+#include "index/IndexReader.h"
+#include "index/IndexUpdater.h"
+#include "index/IndexWriter.h"
+#include "PathStore.h"
+
+using duplitrace::common::PathStore;
+using duplitrace::common::hashing::HashAlgorithm;
+using duplitrace::common::hashing::HashDigest;
+using duplitrace::common::index::INDEX_FLAG_UPDATING;
+using duplitrace::common::index::INDEX_NO_DIRECTORY;
+using duplitrace::common::index::INDEX_REMOVED_FILE;
+using duplitrace::common::index::IndexHeader;
+using duplitrace::common::index::IndexLinkKind;
+using duplitrace::common::index::IndexReader;
+using duplitrace::common::index::IndexUpdater;
+using duplitrace::common::index::IndexWriter;
+
+class IndexFileTest : public ::testing::Test {
+ protected:
+    void SetUp() override {
+        filename_ = (std::filesystem::temp_directory_path() /
+                     "duplitrace_index_test.dtindex").string();
+    }
+
+    void TearDown() override {
+        std::remove(filename_.c_str());
+    }
+
+    static HashDigest TestDigest(uint8_t value) {
+        HashDigest digest;
+        digest.size = 32;
+        digest.bytes.fill(value);
+        return digest;
+    }
+
+    std::string filename_;
+};
+
+TEST_F(IndexFileTest, WrittenIndexReadsBack) {
+    PathStore paths;
+    IndexWriter writer(HashAlgorithm::BLAKE3, paths);
+
+    uint32_t root = paths.AddDirectory(INDEX_NO_DIRECTORY, "/data");
+    uint32_t photos = paths.AddDirectory(root, "photos");
+    uint32_t backup = paths.AddDirectory(root, "backup");
+    uint32_t image = paths.InternName("a.jpg");
+
+    uint64_t first = writer.AddFile({ photos, image, 2000, 11, 1, 100, 21 });
+    uint64_t second = writer.AddFile({ backup, image, 2000, 12, 1, 101,
+                                       22 });
+    uint64_t third = writer.AddFile({ backup, paths.InternName("small.txt"),
+                                      10, 13, 1, 102, 23 });
+
+    writer.SetDigest(first, TestDigest(0xAB));
+    writer.SetDigest(second, TestDigest(0xAB));
+    writer.AddDuplicateGroup(2000, { first, second });
+    ASSERT_TRUE(writer.Write(filename_));
+
+    IndexReader reader;
+    ASSERT_TRUE(reader.Open(filename_));
+
+    EXPECT_EQ(reader.Algorithm(), HashAlgorithm::BLAKE3);
+    EXPECT_EQ(reader.DirectoryCount(), 3u);
+    EXPECT_EQ(reader.FileCount(), 3u);
+    EXPECT_EQ(reader.GroupCount(), 1u);
+
+    EXPECT_EQ(reader.FilePath(first), "/data/photos/a.jpg");
+    EXPECT_EQ(reader.FilePath(second), "/data/backup/a.jpg");
+    EXPECT_EQ(reader.FilePath(third), "/data/backup/small.txt");
+
+    // The shared name is only stored once.
+    EXPECT_EQ(reader.FileNames()[first], reader.FileNames()[second]);
+
+    EXPECT_EQ(reader.FileSizes()[third], 10u);
+    EXPECT_EQ(reader.FileModifiedTimes()[second], 12);
+    EXPECT_EQ(reader.FileDevices()[first], 1u);
+    EXPECT_EQ(reader.FileInodes()[third], 102u);
+    EXPECT_EQ(reader.FileChangedTimes()[second], 22);
+
+    EXPECT_EQ(reader.FileDigest(first), TestDigest(0xAB));
+    EXPECT_EQ(reader.FileDigest(third), TestDigest(0x00));
+
+    auto group = reader.Group(0);
+    EXPECT_EQ(group.size, 2000u);
+    ASSERT_EQ(group.files.Size(), 2u);
+    EXPECT_EQ(group.files[0], first);
+    EXPECT_EQ(group.files[1], second);
+}
+
+TEST_F(IndexFileTest, GroupsOfAtLeastFiltersBySize) {
+    PathStore paths;
+    IndexWriter writer(HashAlgorithm::XXH3, paths);
+    uint32_t root = paths.AddDirectory(INDEX_NO_DIRECTORY, "/data");
+    uint32_t leftName = paths.InternName("left");
+    uint32_t rightName = paths.InternName("right");
+    std::vector<uint64_t> sizes = { 100, 5000, 1ULL << 31, 1ULL << 40 };
+
+    for (uint64_t size : sizes) {
+        uint64_t left = writer.AddFile({ root, leftName, size, 0, 1, 1,
+                                         0 });
+        uint64_t right = writer.AddFile({ root, rightName, size, 0, 1, 2,
+                                          0 });
+        writer.AddDuplicateGroup(size, { left, right });
+    }
+    ASSERT_TRUE(writer.Write(filename_));
+
+    IndexReader reader;
+    ASSERT_TRUE(reader.Open(filename_));
+
+    EXPECT_EQ(reader.GroupsOfAtLeast(1ULL << 30),
+              (std::vector<uint64_t> { 2, 3 }));
+    EXPECT_EQ(reader.GroupsOfAtLeast(0).size(), 4u);
+    EXPECT_EQ(reader.FileDigest(0).size, 8u);
+}
+
+TEST_F(IndexFileTest, LinkGroupsReadBack) {
+    PathStore paths;
+    IndexWriter writer(HashAlgorithm::BLAKE3, paths);
+    uint32_t root = paths.AddDirectory(INDEX_NO_DIRECTORY, "/data");
+    std::vector<uint64_t> files;
+
+    for (uint64_t i = 0; i < 5; i++) {
+        files.push_back(writer.AddFile({ root,
+            paths.InternName("file" + std::to_string(i)), 4096, 0, 1,
+            i < 3 ? 50 : 60 + i, 0 }));
+    }
+
+    writer.SetDigest(files[0], TestDigest(0x11));
+    writer.CopyDigest(files[0], files[2]);
+    writer.AddLinkGroup(IndexLinkKind::HARD_LINK,
+                        { files[0], files[1], files[2] });
+    writer.AddLinkGroup(IndexLinkKind::SHARED_EXTENTS,
+                        { files[3], files[4] });
+    ASSERT_TRUE(writer.Write(filename_));
+
+    IndexReader reader;
+    ASSERT_TRUE(reader.Open(filename_));
+
+    // No duplicate groups were added, which is still a valid index.
+    EXPECT_EQ(reader.GroupCount(), 0u);
+    ASSERT_EQ(reader.LinkGroupCount(), 2u);
+
+    auto links = reader.LinkGroup(0);
+    EXPECT_EQ(links.kind, IndexLinkKind::HARD_LINK);
+    EXPECT_EQ(std::vector<uint64_t>(links.files.begin(), links.files.end()),
+              (std::vector<uint64_t> { files[0], files[1], files[2] }));
+
+    auto shared = reader.LinkGroup(1);
+    EXPECT_EQ(shared.kind, IndexLinkKind::SHARED_EXTENTS);
+    EXPECT_EQ(shared.files.Size(), 2u);
+
+    EXPECT_EQ(reader.FileDigest(files[2]), TestDigest(0x11));
+    EXPECT_EQ(reader.FileDigest(files[1]), TestDigest(0x00));
+}
+
+TEST_F(IndexFileTest, RejectsFileThatIsNotAnIndex) {
+    {
+        std::ofstream file(filename_, std::ios::binary);
+        file << std::string(4096, 'x');
+    }
+
+    IndexReader reader;
+    EXPECT_FALSE(reader.Open(filename_));
+    EXPECT_FALSE(reader.Open(filename_ + ".missing"));
+    EXPECT_EQ(reader.FileCount(), 0u);
+}
+
+TEST_F(IndexFileTest, UpdateIsWrittenInPlace) {
+    PathStore paths;
+    IndexWriter writer(HashAlgorithm::BLAKE3, paths);
+    uint32_t root = paths.AddDirectory(INDEX_NO_DIRECTORY, "/data");
+    uint32_t image = paths.InternName("a.jpg");
+
+    uint64_t first = writer.AddFile({ root, image, 2000, 11, 1, 100, 21 });
+    uint32_t otherImage = paths.InternName("b.jpg");
+    uint64_t second = writer.AddFile({ root, otherImage, 2000, 12, 1, 101,
+                                       22 });
+    writer.SetDigest(first, TestDigest(0xAB));
+    writer.SetDigest(second, TestDigest(0xAB));
+    writer.AddDuplicateGroup(2000, { first, second });
+    ASSERT_TRUE(writer.Write(filename_));
+
+    auto size = std::filesystem::file_size(filename_);
+
+    IndexUpdater updater;
+    ASSERT_TRUE(updater.Open(filename_));
+    EXPECT_FALSE(updater.Changed());
+
+    uint32_t backup = updater.AddDirectory(root,
+                                           updater.AddString("backup"));
+    uint64_t third = updater.AddFile({ backup, image, 2000, 13, 1, 102,
+                                       23 });
+    updater.ReplaceFile(second, { root, otherImage, 3000, 14, 1, 101,
+                                   24 });
+    updater.RemoveFile(first);
+    updater.RemoveGroup(0);
+    updater.SetDigest(third, TestDigest(0xCD));
+    updater.AddLinkGroup(IndexLinkKind::HARD_LINK, { second, third });
+
+    bool inPlace = false;
+    ASSERT_TRUE(updater.Write(&inPlace));
+    EXPECT_TRUE(inPlace);
+    EXPECT_FALSE(updater.Changed());
+    EXPECT_EQ(std::filesystem::file_size(filename_), size);
+
+    IndexReader reader;
+    ASSERT_TRUE(reader.Open(filename_));
+
+    // Rows keep their ids, removed ones are only marked.
+    EXPECT_EQ(reader.DirectoryCount(), 2u);
+    ASSERT_EQ(reader.FileCount(), 3u);
+    EXPECT_EQ(reader.FileDirectories()[first], INDEX_REMOVED_FILE);
+    EXPECT_EQ(reader.FilePath(second), "/data/b.jpg");
+    EXPECT_EQ(reader.FilePath(third), "/data/backup/a.jpg");
+    EXPECT_EQ(reader.FileSizes()[second], 3000u);
+    EXPECT_EQ(reader.FileChangedTimes()[second], 24);
+    EXPECT_EQ(reader.FileDigest(second), TestDigest(0x00));
+    EXPECT_EQ(reader.FileDigest(third), TestDigest(0xCD));
+
+    EXPECT_EQ(reader.GroupCount(), 1u);
+    EXPECT_TRUE(reader.GroupsOfAtLeast(0).empty());
+    ASSERT_EQ(reader.LinkGroupCount(), 1u);
+    EXPECT_EQ(reader.LinkGroup(0).files.Size(), 2u);
+}
+
+TEST_F(IndexFileTest, UpdateThatDoesNotFitRewritesIndex) {
+    PathStore paths;
+    IndexWriter writer(HashAlgorithm::XXH3, paths);
+    uint32_t root = paths.AddDirectory(INDEX_NO_DIRECTORY, "/data");
+    uint64_t first = writer.AddFile({ root, paths.InternName("first"), 10,
+                                      0, 1, 1, 0 });
+    ASSERT_TRUE(writer.Write(filename_));
+
+    IndexUpdater updater;
+    ASSERT_TRUE(updater.Open(filename_));
+
+    // Far more rows than the spare space left after the files.
+    const uint64_t ADDED_FILES = 1000;
+    std::vector<uint64_t> files;
+
+    for (uint64_t i = 0; i < ADDED_FILES; i++) {
+        uint32_t name = updater.AddString("file" + std::to_string(i));
+        files.push_back(updater.AddFile({ root, name, 10, 0, 1, 2 + i, 0 }));
+    }
+    updater.RemoveFile(first);
+    updater.AddDuplicateGroup(10, files);
+
+    bool inPlace = true;
+    ASSERT_TRUE(updater.Write(&inPlace));
+    EXPECT_FALSE(inPlace);
+
+    {
+        IndexReader reader;
+        ASSERT_TRUE(reader.Open(filename_));
+        ASSERT_EQ(reader.FileCount(), ADDED_FILES + 1);
+        EXPECT_EQ(reader.FileDirectories()[first], INDEX_REMOVED_FILE);
+        EXPECT_EQ(reader.FilePath(files.back()), "/data/file999");
+        EXPECT_EQ(reader.Group(0).files.Size(), ADDED_FILES);
+    }
+
+    // The rewritten index has room for the next update.
+    updater.AddFile({ root, updater.AddString("last"), 10, 0, 1, 5000, 0 });
+    ASSERT_TRUE(updater.Write(&inPlace));
+    EXPECT_TRUE(inPlace);
+
+    IndexReader reader;
+    ASSERT_TRUE(reader.Open(filename_));
+    EXPECT_EQ(reader.FilePath(ADDED_FILES + 1), "/data/last");
+}
+
+TEST_F(IndexFileTest, UnfinishedUpdateIsRejected) {
+    PathStore paths;
+    IndexWriter writer(HashAlgorithm::XXH3, paths);
+    paths.AddDirectory(INDEX_NO_DIRECTORY, "/data");
+    ASSERT_TRUE(writer.Write(filename_));
+
+    {
+        std::fstream file(filename_,
+                          std::ios::in | std::ios::out | std::ios::binary);
+        uint32_t flags = INDEX_FLAG_UPDATING;
+        file.seekp(offsetof(IndexHeader, flags));
+        file.write(reinterpret_cast<const char*>(&flags), sizeof(flags));
+    }
+
+    IndexReader reader;
+    IndexUpdater updater;
+    EXPECT_FALSE(reader.Open(filename_));
+    EXPECT_FALSE(updater.Open(filename_));
+}
@@ -0,0 +1,70 @@
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "gtest/gtest.h"
+#include "InodeSet.h"
+
+using duplitrace::common::InodeSet;
+
+TEST(InodeSetTest, OnlyFirstInsertOfAnInodeIsNew) {
+    InodeSet inodes;
+
+    EXPECT_TRUE(inodes.Insert(1, 100));
+    EXPECT_FALSE(inodes.Insert(1, 100));
+
+    // The same inode number on another device is a different file.
+    EXPECT_TRUE(inodes.Insert(2, 100));
+
+    EXPECT_TRUE(inodes.Contains(1, 100));
+    EXPECT_FALSE(inodes.Contains(1, 101));
+    EXPECT_EQ(inodes.Size(), 2u);
+}
+
+TEST(InodeSetTest, InodeZeroIsRejected) {
+    InodeSet inodes;
+
+    EXPECT_FALSE(inodes.Insert(1, 0));
+    EXPECT_FALSE(inodes.Contains(1, 0));
+    EXPECT_EQ(inodes.Size(), 0u);
+}
+
+TEST(InodeSetTest, GrowsToHoldManyInodes) {
+    InodeSet inodes;
+    uint64_t initialUsage = inodes.MemoryUsage();
+
+    for (uint64_t inode = 1; inode <= 100000; inode++) {
+        ASSERT_TRUE(inodes.Insert(7, inode));
+    }
+
+    EXPECT_EQ(inodes.Size(), 100000u);
+    EXPECT_GT(inodes.MemoryUsage(), initialUsage);
+
+    for (uint64_t inode = 1; inode <= 100000; inode++) {
+        ASSERT_TRUE(inodes.Contains(7, inode));
+    }
+    EXPECT_FALSE(inodes.Contains(7, 100001));
+}
+
+TEST(InodeSetTest, ConcurrentInsertsClaimEachInodeOnce) {
+    InodeSet inodes;
+    std::atomic<uint64_t> claimed(0);
+    std::vector<std::thread> threads;
+
+    // Every thread inserts the same inodes, each must be new exactly once.
+    for (int i = 0; i < 8; i++) {
+        threads.emplace_back([&inodes, &claimed] {
+            for (uint64_t inode = 1; inode <= 20000; inode++) {
+                if (inodes.Insert(3, inode)) {
+                    claimed++;
+                }
+            }
+        });
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_EQ(claimed, 20000u);
+    EXPECT_EQ(inodes.Size(), 20000u);
+}
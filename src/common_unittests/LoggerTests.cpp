@@ -0,0 +1,224 @@
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "gtest/gtest.h"
+#include "Logger.h"
+#include "spdlog/sinks/base_sink.h"
+
+using duplitrace::common::CountingAsyncLogger;
+using duplitrace::common::LogOverflowPolicy;
+using duplitrace::common::LogQueueStatistics;
+using duplitrace::common::LoggerHandle;
+using namespace std::chrono_literals;
+
+const int LOGGER_TEST_THREAD_COUNT = 4;
+const int LOGGER_TEST_SWAP_COUNT = 50;
+const size_t LOGGER_TEST_QUEUE_SIZE = 2;
+
+// Counts the messages it is given instead of writing them anywhere.
+class CountingSink : public spdlog::sinks::base_sink<std::mutex> {
+ public:
+    size_t Count() const { return count_; }
+
+ protected:
+    void sink_it_(const spdlog::details::log_msg&) override {
+        count_++;
+    }
+
+    void flush_() override {
+    }
+
+ private:
+    std::atomic<size_t> count_ { 0 };
+};
+
+// Runs before any logger is set, no other test sets one.
+TEST(LoggerTest, HandleUsesTheDefaultLoggerUntilOneIsSet) {
+    EXPECT_EQ(LoggerHandle::Get(), spdlog::default_logger_raw());
+
+    auto sink = std::make_shared<CountingSink>();
+    auto logger = std::make_shared<spdlog::logger>("logger_test", sink);
+    LoggerHandle::Set(logger);
+
+    EXPECT_EQ(LoggerHandle::Get(), logger.get());
+    LOGGER->info("Logged through the handle");
+    EXPECT_EQ(sink->Count(), 1u);
+}
+
+TEST(LoggerTest, HandleCanBeSwappedWhileOtherThreadsLog) {
+    auto sink = std::make_shared<CountingSink>();
+    std::atomic<bool> stop(false);
+    std::atomic<size_t> logged(0);
+    std::vector<std::thread> threads;
+
+    LoggerHandle::Set(std::make_shared<spdlog::logger>("logger_test", sink));
+
+    for (int i = 0; i < LOGGER_TEST_THREAD_COUNT; i++) {
+        threads.emplace_back([&stop, &logged] {
+            while (!stop) {
+                LOGGER->info("Message {0}", logged.load());
+                logged++;
+            }
+        });
+    }
+
+    // The loggers handed over are released here, the handle must keep them
+    // alive for the threads still logging to them.
+    for (int i = 0; i < LOGGER_TEST_SWAP_COUNT; i++) {
+        LoggerHandle::Set(
+            std::make_shared<spdlog::logger>("logger_test", sink));
+        std::this_thread::yield();
+    }
+
+    stop = true;
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_GT(logged, 0u);
+    EXPECT_EQ(sink->Count(), logged);
+}
+
+// Holds up the logging thread on the first message it is given, until it is
+// released, so that the queue behind it fills up.
+class StallingSink : public spdlog::sinks::base_sink<std::mutex> {
+ public:
+    void WaitUntilStalled() {
+        std::unique_lock<std::mutex> lock(state_mutex_);
+        changed_.wait(lock, [this] { return stalled_; });
+    }
+
+    void Release() {
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        released_ = true;
+        changed_.notify_all();
+    }
+
+    // Wait for the given number of messages to have been written.
+    bool WaitForCount(size_t count) {
+        std::unique_lock<std::mutex> lock(state_mutex_);
+        return changed_.wait_for(lock, 5s, [this, count] {
+            return count_ >= count;
+        });
+    }
+
+    size_t Count() {
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        return count_;
+    }
+
+ protected:
+    void sink_it_(const spdlog::details::log_msg&) override {
+        std::unique_lock<std::mutex> lock(state_mutex_);
+        stalled_ = true;
+        count_++;
+        changed_.notify_all();
+        changed_.wait(lock, [this] { return released_; });
+    }
+
+    void flush_() override {
+    }
+
+ private:
+    std::mutex state_mutex_;
+    std::condition_variable changed_;
+    bool stalled_ = false;
+    bool released_ = false;
+    size_t count_ = 0;
+};
+
+// An async logger with a tiny queue in front of a stalled sink.
+class CountingAsyncLoggerTest : public ::testing::Test {
+ protected:
+    void SetUp() override {
+        pool_ = std::make_shared<spdlog::details::thread_pool>(
+            LOGGER_TEST_QUEUE_SIZE, 1);
+        sink_ = std::make_shared<StallingSink>();
+    }
+
+    void TearDown() override {
+        sink_->Release();
+    }
+
+    std::unique_ptr<CountingAsyncLogger> CreateLogger(
+            LogOverflowPolicy policy) {
+        std::vector<spdlog::sink_ptr> sinks { sink_ };
+        return std::make_unique<CountingAsyncLogger>(
+            "queue_test", sinks.begin(), sinks.end(), pool_,
+            LOGGER_TEST_QUEUE_SIZE, policy);
+    }
+
+    // Stall the logging thread on one message and fill the queue behind it.
+    void FillQueue(CountingAsyncLogger* logger) {
+        logger->info("Stalls the logging thread");
+        sink_->WaitUntilStalled();
+
+        for (size_t i = 0; i < LOGGER_TEST_QUEUE_SIZE; i++) {
+            logger->info("Fills the queue");
+        }
+    }
+
+    std::shared_ptr<spdlog::details::thread_pool> pool_;
+    std::shared_ptr<StallingSink> sink_;
+};
+
+TEST_F(CountingAsyncLoggerTest, DiscardDropsAndCountsNewMessages) {
+    auto logger = CreateLogger(LogOverflowPolicy::DISCARD);
+    FillQueue(logger.get());
+
+    for (int i = 0; i < 3; i++) {
+        logger->info("Dropped");
+    }
+
+    LogQueueStatistics statistics = logger->Statistics();
+    EXPECT_EQ(statistics.discarded, 3u);
+    EXPECT_EQ(statistics.overrun, 0u);
+    EXPECT_EQ(statistics.blocked, 0u);
+
+    sink_->Release();
+    EXPECT_TRUE(sink_->WaitForCount(1 + LOGGER_TEST_QUEUE_SIZE));
+    std::this_thread::sleep_for(20ms);
+    EXPECT_EQ(sink_->Count(), 1 + LOGGER_TEST_QUEUE_SIZE);
+}
+
+TEST_F(CountingAsyncLoggerTest, OverrunDropsAndCountsQueuedMessages) {
+    auto logger = CreateLogger(LogOverflowPolicy::OVERRUN_OLDEST);
+    FillQueue(logger.get());
+
+    for (int i = 0; i < 3; i++) {
+        logger->info("Replaces a queued message");
+    }
+
+    LogQueueStatistics statistics = logger->Statistics();
+    EXPECT_EQ(statistics.overrun, 3u);
+    EXPECT_EQ(statistics.discarded, 0u);
+    EXPECT_EQ(statistics.blocked, 0u);
+
+    sink_->Release();
+    EXPECT_TRUE(sink_->WaitForCount(1 + LOGGER_TEST_QUEUE_SIZE));
+}
+
+TEST_F(CountingAsyncLoggerTest, BlockWaitsForRoomAndCountsIt) {
+    auto logger = CreateLogger(LogOverflowPolicy::BLOCK);
+    FillQueue(logger.get());
+
+    std::atomic<bool> logged(false);
+    std::thread blocked([&logger, &logged] {
+        logger->info("Waits for room");
+        logged = true;
+    });
+
+    std::this_thread::sleep_for(50ms);
+    EXPECT_FALSE(logged);
+
+    sink_->Release();
+    blocked.join();
+
+    EXPECT_TRUE(logged);
+    EXPECT_EQ(logger->Statistics().blocked, 1u);
+    EXPECT_TRUE(sink_->WaitForCount(2 + LOGGER_TEST_QUEUE_SIZE));
+}
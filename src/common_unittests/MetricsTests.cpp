@@ -0,0 +1,169 @@
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+#include "gtest/gtest.h"
+#include "EventLoop.h"
+#include "Metrics.h"
+#include "MetricsEndpoint.h"
+
+using duplitrace::common::EventLoop;
+using duplitrace::common::MetricCounter;
+using duplitrace::common::MetricGauge;
+using duplitrace::common::MetricHistogram;
+using duplitrace::common::MetricHistogramSnapshot;
+using duplitrace::common::MetricType;
+using duplitrace::common::MetricsEndpoint;
+using duplitrace::common::MetricsRegistry;
+
+TEST(MetricsTest, CounterAddsUpEveryThread) {
+    MetricCounter counter;
+    std::vector<std::thread> threads;
+
+    for (int i = 0; i < 8; i++) {
+        threads.emplace_back([&counter] {
+            for (int j = 0; j < 10000; j++) {
+                counter.Add();
+            }
+            counter.Add(5);
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_EQ(counter.Value(), 8u * 10005u);
+}
+
+TEST(MetricsTest, GaugeGoesUpAndDown) {
+    MetricGauge gauge;
+
+    gauge.Add(3);
+    gauge.Add(-5);
+    EXPECT_EQ(gauge.Value(), -2);
+
+    gauge.Set(7);
+    EXPECT_EQ(gauge.Value(), 7);
+}
+
+TEST(MetricsTest, HistogramBucketsHoldTheirValues) {
+    // Every value is in a bucket whose upper bound is at or above it, and
+    // within an eighth of it.
+    std::vector<uint64_t> values = { 0, 1, 7, 8, 9, 15, 16, 17, 1000,
+                                     123456789, uint64_t(1) << 40,
+                                     UINT64_MAX };
+
+    for (uint64_t value : values) {
+        size_t index = MetricHistogram::BucketIndex(value);
+        uint64_t bound = MetricHistogram::BucketUpperBound(index);
+
+        ASSERT_LT(index, duplitrace::common::METRICS_HISTOGRAM_BUCKETS);
+        EXPECT_GE(bound, value);
+        EXPECT_LE(bound - value, value / 8);
+
+        if (index > 0) {
+            EXPECT_LT(MetricHistogram::BucketUpperBound(index - 1), value);
+        }
+    }
+}
+
+TEST(MetricsTest, HistogramQuantiles) {
+    MetricHistogram histogram;
+
+    for (uint64_t value = 1; value <= 1000; value++) {
+        histogram.Record(value);
+    }
+
+    MetricHistogramSnapshot snapshot = histogram.Snapshot();
+    EXPECT_EQ(snapshot.count, 1000u);
+    EXPECT_EQ(snapshot.sum, 500500u);
+
+    uint64_t median = snapshot.Quantile(0.5);
+    EXPECT_GE(median, 500u);
+    EXPECT_LE(median, 500u + 500u / 8);
+
+    EXPECT_GE(snapshot.Quantile(1.0), 1000u);
+    EXPECT_EQ(MetricHistogramSnapshot().Quantile(0.5), 0u);
+}
+
+TEST(MetricsTest, PrometheusText) {
+    MetricsRegistry registry;
+
+    registry.AddCounter("test_files_total", "Files seen")->Add(42);
+    registry.AddGauge("test_depth", "Queue depth", "stage=\"a\"")->Set(3);
+    registry.AddGauge("test_depth", "Queue depth", "stage=\"b\"")->Set(4);
+    registry.AddCallback("test_hits_total", "Hits", MetricType::COUNTER,
+                         [] { return 9.0; });
+    registry.AddHistogram("test_seconds", "Latency", 1e-3)->Record(2);
+
+    std::string text = registry.PrometheusText();
+
+    EXPECT_NE(text.find("# HELP test_files_total Files seen\n"
+                        "# TYPE test_files_total counter\n"
+                        "test_files_total 42\n"), std::string::npos);
+    EXPECT_NE(text.find("# TYPE test_depth gauge\n"
+                        "test_depth{stage=\"a\"} 3\n"
+                        "test_depth{stage=\"b\"} 4\n"), std::string::npos);
+    EXPECT_NE(text.find("test_hits_total 9\n"), std::string::npos);
+    EXPECT_NE(text.find("# TYPE test_seconds summary\n"
+                        "test_seconds{quantile=\"0.5\"} 0.002\n"),
+              std::string::npos);
+    EXPECT_NE(text.find("test_seconds_sum 0.002\n"
+                        "test_seconds_count 1\n"), std::string::npos);
+}
+
+TEST(MetricsTest, EndpointDoesNotWaitForSlowClients) {
+    // Far more text than a socket buffers, so it cannot be sent in one go.
+    MetricsRegistry registry;
+    for (int i = 0; i < 20000; i++) {
+        registry.AddCounter("duplitrace_test_" + std::to_string(i) + "_total",
+                            "Counter that pads out the metrics text");
+    }
+    std::string expected = registry.PrometheusText();
+
+    std::string path = (std::filesystem::temp_directory_path() /
+                        "duplitrace_metrics_test.sock").string();
+    EventLoop loop;
+    ASSERT_TRUE(loop.Initialise());
+    MetricsEndpoint endpoint(&registry, &loop);
+    ASSERT_TRUE(endpoint.Listen(path));
+
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, path.data(), path.size());
+
+    int client = socket(AF_UNIX, SOCK_STREAM, 0);
+    ASSERT_GE(client, 0);
+    ASSERT_EQ(connect(client, reinterpret_cast<sockaddr*>(&address),
+                      sizeof(address)), 0);
+
+    // The connection is accepted without waiting for the client to read.
+    auto started = std::chrono::steady_clock::now();
+    loop.WaitForEvents();
+    EXPECT_LT(std::chrono::steady_clock::now() - started,
+              std::chrono::milliseconds(500));
+
+    std::string received;
+    char buffer[65536];
+    while (true) {
+        ssize_t bytesRead = recv(client, buffer, sizeof(buffer),
+                                 MSG_DONTWAIT);
+        if (bytesRead > 0) {
+            received.append(buffer, static_cast<size_t>(bytesRead));
+        } else if (bytesRead == 0) {
+            break;
+        } else {
+            loop.WaitForEvents();
+        }
+    }
+    close(client);
+
+    EXPECT_EQ(received, expected);
+}
@@ -0,0 +1,86 @@
+#include <string>
+#include <thread>
+#include <vector>
+#include "gtest/gtest.h"
+#include "PathStore.h"
+
+using duplitrace::common::PATH_STORE_NO_DIRECTORY;
+using duplitrace::common::PathStore;
+
+TEST(PathStoreTest, NamesAreStoredOnce) {
+    PathStore paths;
+
+    uint32_t first = paths.InternName("photo.jpg");
+    uint32_t second = paths.InternName("notes.txt");
+
+    EXPECT_NE(first, second);
+    EXPECT_EQ(paths.InternName("photo.jpg"), first);
+    EXPECT_EQ(paths.Name(first), "photo.jpg");
+    EXPECT_EQ(paths.Name(second), "notes.txt");
+    EXPECT_EQ(paths.NameCount(), 2u);
+    EXPECT_EQ(paths.NameBytes(), 18u);
+
+    // Names are null terminated so they can be passed to system calls.
+    EXPECT_EQ(paths.Name(first).data()[paths.Name(first).size()], '\0');
+}
+
+TEST(PathStoreTest, PathsAreRebuiltFromDirectories) {
+    PathStore paths;
+
+    uint32_t root = paths.AddDirectory(PATH_STORE_NO_DIRECTORY, "/data");
+    uint32_t photos = paths.AddDirectory(root, "photos");
+    uint32_t backup = paths.AddDirectory(root, "backup");
+    uint32_t nested = paths.AddDirectory(backup, "photos");
+    uint32_t slashRoot = paths.AddDirectory(PATH_STORE_NO_DIRECTORY, "/");
+
+    EXPECT_EQ(paths.DirectoryCount(), 5u);
+    EXPECT_EQ(paths.DirectoryParent(photos), root);
+    EXPECT_EQ(paths.DirectoryParent(root), PATH_STORE_NO_DIRECTORY);
+    EXPECT_EQ(paths.DirectoryName(photos), paths.DirectoryName(nested));
+
+    EXPECT_EQ(paths.DirectoryPath(root), "/data");
+    EXPECT_EQ(paths.DirectoryPath(nested), "/data/backup/photos");
+    EXPECT_EQ(paths.FilePath(photos, paths.InternName("a.jpg")),
+              "/data/photos/a.jpg");
+    EXPECT_EQ(paths.FilePath(slashRoot, paths.InternName("b")), "/b");
+}
+
+TEST(PathStoreTest, LongNamesAreKept) {
+    PathStore paths;
+    std::string longName(100000, 'x');
+
+    uint32_t id = paths.InternName(longName);
+
+    EXPECT_EQ(paths.Name(id), longName);
+    EXPECT_EQ(paths.InternName(longName), id);
+}
+
+TEST(PathStoreTest, ConcurrentInterningGivesOneIdPerName) {
+    const size_t threadCount = 8;
+    const size_t nameCount = 20000;
+    PathStore paths;
+    std::vector<std::vector<uint32_t>> ids(threadCount);
+    std::vector<std::thread> threads;
+
+    for (size_t t = 0; t < threadCount; t++) {
+        threads.emplace_back([&paths, &ids, t] {
+            for (size_t i = 0; i < nameCount; i++) {
+                ids[t].push_back(
+                    paths.InternName("name" + std::to_string(i)));
+            }
+        });
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_EQ(paths.NameCount(), nameCount);
+
+    for (size_t i = 0; i < nameCount; i++) {
+        for (size_t t = 1; t < threadCount; t++) {
+            ASSERT_EQ(ids[t][i], ids[0][i]);
+        }
+        ASSERT_EQ(paths.Name(ids[0][i]), "name" + std::to_string(i));
+    }
+}
@@ -0,0 +1,136 @@
+#include <ctime>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "gtest/gtest.h"
+#include "WorkerPool.h"
+#include "../scheduler/Scheduler.h"
+
+using duplitrace::common::WorkerPool;
+using duplitrace::cronparser::BadCronExpression;
+using duplitrace::cronparser::CronExpression;
+using duplitrace::scheduler::ScheduledJobId;
+using duplitrace::scheduler::Scheduler;
+
+/*
+14th November 2023 22:13:20 UTC. Only the seconds and minutes fields are used
+below, so the expected times hold in any zone with a whole minute offset.
+*/
+const std::time_t SCHEDULER_TEST_NOW = 1700000000;
+
+// Records the order callbacks run in, the pool has a single thread.
+class SchedulerTest : public ::testing::Test {
+ protected:
+    SchedulerTest() : pool_(1), scheduler_(&pool_) {}
+
+    ScheduledJobId AddJob(const char* expression, const std::string& name) {
+        return scheduler_.AddJob(CronExpression(expression), [this, name] {
+            std::lock_guard<std::mutex> lock(mutex_);
+            fired_.push_back(name);
+        }, SCHEDULER_TEST_NOW);
+    }
+
+    // Wait for the callbacks that have been fired to finish.
+    std::vector<std::string> Fired() {
+        pool_.Shutdown();
+        return fired_;
+    }
+
+    WorkerPool pool_;
+    Scheduler scheduler_;
+    std::mutex mutex_;
+    std::vector<std::string> fired_;
+};
+
+TEST_F(SchedulerTest, JobsFireInDeadlineOrder) {
+    AddJob("0 * * * * *", "minute");
+    AddJob("*/10 * * * * *", "ten seconds");
+    AddJob("45 * * * * *", "forty five");
+
+    EXPECT_EQ(scheduler_.JobCount(), 3u);
+    EXPECT_EQ(scheduler_.NextDeadline(), SCHEDULER_TEST_NOW + 10);
+    EXPECT_EQ(scheduler_.RunPending(SCHEDULER_TEST_NOW + 9), 0u);
+    EXPECT_EQ(scheduler_.RunPending(SCHEDULER_TEST_NOW + 10), 1u);
+    EXPECT_EQ(scheduler_.NextDeadline(), SCHEDULER_TEST_NOW + 20);
+    EXPECT_EQ(scheduler_.RunPending(SCHEDULER_TEST_NOW + 25), 2u);
+    EXPECT_EQ(scheduler_.NextDeadline(), SCHEDULER_TEST_NOW + 30);
+    EXPECT_EQ(scheduler_.RunPending(SCHEDULER_TEST_NOW + 40), 2u);
+
+    std::vector<std::string> expected = {
+        "ten seconds", "ten seconds", "forty five", "ten seconds", "minute"
+    };
+    EXPECT_EQ(Fired(), expected);
+}
+
+TEST_F(SchedulerTest, RemovedJobsDoNotFire) {
+    ScheduledJobId first = AddJob("*/10 * * * * *", "first");
+    ScheduledJobId second = AddJob("0 * * * * *", "second");
+    AddJob("45 * * * * *", "third");
+
+    // The removed job's heap entry is at the top, it is skipped.
+    EXPECT_TRUE(scheduler_.RemoveJob(first));
+    EXPECT_FALSE(scheduler_.RemoveJob(first));
+    EXPECT_FALSE(scheduler_.RemoveJob(12345));
+    EXPECT_EQ(scheduler_.JobCount(), 2u);
+    EXPECT_EQ(scheduler_.NextDeadline(), SCHEDULER_TEST_NOW + 25);
+
+    EXPECT_TRUE(scheduler_.RemoveJob(second));
+    EXPECT_EQ(scheduler_.RunPending(SCHEDULER_TEST_NOW + 50), 1u);
+
+    EXPECT_EQ(Fired(), std::vector<std::string>{ "third" });
+}
+
+TEST_F(SchedulerTest, CompactingTheHeapKeepsLiveJobs) {
+    std::vector<ScheduledJobId> jobs;
+
+    for (int i = 0; i < 200; i++) {
+        jobs.push_back(AddJob(i % 2 ? "*/10 * * * * *" : "0 * * * * *",
+                              std::to_string(i)));
+    }
+
+    // Rescheduling leaves a stale entry behind for each of the jobs that
+    // fired, then most of the jobs are removed so the heap is compacted.
+    EXPECT_EQ(scheduler_.RunPending(SCHEDULER_TEST_NOW + 10), 100u);
+
+    for (size_t i = 0; i < jobs.size(); i++) {
+        if (i % 20 != 0 && i % 20 != 1) {
+            EXPECT_TRUE(scheduler_.RemoveJob(jobs[i]));
+        }
+    }
+
+    EXPECT_EQ(scheduler_.JobCount(), 20u);
+    EXPECT_EQ(scheduler_.NextDeadline(), SCHEDULER_TEST_NOW + 20);
+    EXPECT_EQ(scheduler_.RunPending(SCHEDULER_TEST_NOW + 20), 10u);
+    EXPECT_EQ(scheduler_.NextDeadline(), SCHEDULER_TEST_NOW + 30);
+    EXPECT_EQ(scheduler_.RunPending(SCHEDULER_TEST_NOW + 40), 20u);
+    EXPECT_EQ(Fired().size(), 130u);
+}
+
+TEST_F(SchedulerTest, MissedTriggersAreNotReplayed) {
+    AddJob("* * * * * *", "every second");
+
+    // The clock jumps forward an hour, the job only fires once and carries
+    // on from the new time.
+    EXPECT_EQ(scheduler_.RunPending(SCHEDULER_TEST_NOW + 3600), 1u);
+    EXPECT_EQ(scheduler_.NextDeadline(), SCHEDULER_TEST_NOW + 3601);
+    EXPECT_EQ(scheduler_.RunPending(SCHEDULER_TEST_NOW + 3600), 0u);
+
+    EXPECT_EQ(Fired().size(), 1u);
+}
+
+TEST_F(SchedulerTest, JobWithNoFutureTriggerIsRemoved) {
+    EXPECT_THROW(AddJob("0 0 0 30 2 *", "never"), BadCronExpression);
+    EXPECT_EQ(scheduler_.JobCount(), 0u);
+
+    AddJob("* * * * * *", "last");
+
+    // Nothing can trigger after the end of time, so the job is dropped once
+    // it has fired.
+    EXPECT_EQ(scheduler_.RunPending(std::numeric_limits<std::time_t>::max()),
+              1u);
+    EXPECT_EQ(scheduler_.JobCount(), 0u);
+    EXPECT_FALSE(scheduler_.NextDeadline().has_value());
+
+    EXPECT_EQ(Fired(), std::vector<std::string>{ "last" });
+}
@@ -0,0 +1,53 @@
+#include <array>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "gtest/gtest.h"
+#include "Utilities.h"
+
+using duplitrace::common::StringSplitInto;
+using duplitrace::common::StringSplitter;
+
+static std::vector<std::string_view> Split(std::string_view text,
+                                           char delimiter) {
+    StringSplitter splitter(text, delimiter);
+    return std::vector<std::string_view>(splitter.begin(), splitter.end());
+}
+
+TEST(StringSplitterTest, SplitsOnEveryDelimiter) {
+    EXPECT_EQ(Split("a,bc,d", ','),
+              (std::vector<std::string_view> { "a", "bc", "d" }));
+    EXPECT_EQ(Split("a,,b", ','),
+              (std::vector<std::string_view> { "a", "", "b" }));
+    EXPECT_EQ(Split(",a,", ','),
+              (std::vector<std::string_view> { "", "a", "" }));
+    EXPECT_EQ(Split("abc", ','), (std::vector<std::string_view> { "abc" }));
+    EXPECT_TRUE(Split("", ',').empty());
+}
+
+TEST(StringSplitterTest, TokensAreViewsIntoTheText) {
+    std::string text = "0 15 10";
+    auto tokens = Split(text, ' ');
+
+    ASSERT_EQ(tokens.size(), 3u);
+    EXPECT_EQ(tokens[1].data(), text.data() + 2);
+}
+
+TEST(StringSplitterTest, StopsAtTheEndOfAViewThatIsNotTerminated) {
+    std::string_view text("1-5,7", 3);
+
+    EXPECT_EQ(Split(text, '-'), (std::vector<std::string_view> { "1", "5" }));
+}
+
+TEST(StringSplitterTest, SplitIntoCountsTokensPastCapacity) {
+    std::array<std::string_view, 2> parts;
+
+    EXPECT_EQ(StringSplitInto("10-20", '-', &parts), 2u);
+    EXPECT_EQ(parts[0], "10");
+    EXPECT_EQ(parts[1], "20");
+
+    EXPECT_EQ(StringSplitInto("1-2-3", '-', &parts), 3u);
+    EXPECT_EQ(parts[1], "2");
+
+    EXPECT_EQ(StringSplitInto("", '-', &parts), 0u);
+}
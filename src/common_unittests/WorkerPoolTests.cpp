@@ -0,0 +1,111 @@
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include "gtest/gtest.h"
+#include "WorkerPool.h"
+
+using duplitrace::common::WorkerPool;
+using namespace std::chrono_literals;
+
+TEST(WorkerPoolTest, RunsEveryTaskAndCallsBackAfterEach) {
+    std::atomic<int> ran(0);
+    std::atomic<int> completed(0);
+    WorkerPool pool(4, [&completed] { completed++; });
+
+    EXPECT_EQ(pool.ThreadCount(), 4u);
+
+    for (int i = 0; i < 100; i++) {
+        EXPECT_TRUE(pool.Submit([&ran] { ran++; }));
+    }
+
+    pool.Shutdown();
+
+    EXPECT_EQ(ran, 100);
+    EXPECT_EQ(completed, 100);
+    EXPECT_FALSE(pool.Submit([&ran] { ran++; }));
+}
+
+TEST(WorkerPoolTest, TaskExceptionsDoNotStopTheWorker) {
+    std::atomic<int> ran(0);
+    WorkerPool pool(1);
+
+    pool.Submit([] { throw std::runtime_error("task failed"); });
+    pool.Submit([] { throw 1; });
+    pool.Submit([&ran] { ran++; });
+    pool.Shutdown();
+
+    EXPECT_EQ(ran, 1);
+}
+
+TEST(WorkerPoolTest, TimedShutdownDrainsQueuedWork) {
+    std::atomic<int> ran(0);
+    WorkerPool pool(2);
+
+    for (int i = 0; i < 10; i++) {
+        pool.Submit([&ran] {
+            std::this_thread::sleep_for(1ms);
+            ran++;
+        });
+    }
+
+    EXPECT_TRUE(pool.Shutdown(10s));
+    EXPECT_EQ(ran, 10);
+    EXPECT_FALSE(pool.StopRequested());
+}
+
+TEST(WorkerPoolTest, TimedShutdownStopsLongRunningWork) {
+    std::atomic<bool> started(false);
+    std::atomic<int> ran(0);
+    WorkerPool pool(1);
+
+    // The first task runs until it is asked to stop, the second never gets
+    // to start and is discarded.
+    pool.Submit([&pool, &started] {
+        started = true;
+        while (!pool.StopRequested()) {
+            std::this_thread::sleep_for(1ms);
+        }
+    });
+    pool.Submit([&ran] { ran++; });
+
+    while (!started) {
+        std::this_thread::sleep_for(1ms);
+    }
+
+    EXPECT_FALSE(pool.Shutdown(20ms));
+    EXPECT_TRUE(pool.StopRequested());
+    EXPECT_EQ(ran, 0);
+    EXPECT_EQ(pool.PendingTasks(), 0u);
+}
+
+TEST(WorkerPoolTest, TimedShutdownWaitsForStuckWork) {
+    std::atomic<bool> started(false);
+    std::atomic<bool> release(false);
+    std::atomic<bool> finished(false);
+    WorkerPool pool(1);
+
+    // The task ignores StopRequested(), it only returns once it is released.
+    pool.Submit([&started, &release, &finished] {
+        started = true;
+        while (!release) {
+            std::this_thread::sleep_for(1ms);
+        }
+        finished = true;
+    });
+
+    while (!started) {
+        std::this_thread::sleep_for(1ms);
+    }
+
+    std::thread releaser([&release] {
+        std::this_thread::sleep_for(100ms);
+        release = true;
+    });
+
+    // The task uses state on this stack, so the shutdown must not return
+    // before it has.
+    EXPECT_FALSE(pool.Shutdown(20ms, 20ms));
+    EXPECT_TRUE(finished);
+
+    releaser.join();
+}
@@ -0,0 +1,150 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include "argparse/argparse.hpp"
+#include "CorpusGenerator.h"
+
+using duplitrace::common::CorpusGenerator;
+using duplitrace::common::CorpusSettings;
+using duplitrace::common::CorpusStatistics;
+
+/*
+Write a synthetic tree for scan benchmarks and tests, e.g. on a tmpfs:
+    mount -t tmpfs -o size=8g tmpfs /mnt/corpus
+    corpus_generator /mnt/corpus/tree --depth 4 --fan-out 10 \
+        --files-per-directory 90 --manifest /mnt/corpus/manifest.txt
+gives 999,990 files across 11,111 directories.
+*/
+int main (int argc, char** argv) {
+    CorpusSettings defaults;
+
+    argparse::ArgumentParser arguments_parser(argv[0]);
+    arguments_parser.add_argument("root")
+        .help("Directory to write the tree in, it must be empty");
+    arguments_parser.add_argument("--seed")
+        .default_value(defaults.seed)
+        .scan<'u', uint64_t>()
+        .help("Seed the tree is generated from");
+    arguments_parser.add_argument("--depth")
+        .default_value(defaults.depth)
+        .scan<'u', size_t>()
+        .help("Levels of directories below the root");
+    arguments_parser.add_argument("--fan-out")
+        .default_value(defaults.fan_out)
+        .scan<'u', size_t>()
+        .help("Subdirectories in each directory");
+    arguments_parser.add_argument("--files-per-directory")
+        .default_value(defaults.files_per_directory)
+        .scan<'u', size_t>()
+        .help("Files in each directory");
+    arguments_parser.add_argument("--size-distribution")
+        .default_value(duplitrace::common::CorpusSizeDistributionName(
+            defaults.size_distribution))
+        .help("FIXED, UNIFORM or LOG_UNIFORM");
+    arguments_parser.add_argument("--min-size")
+        .default_value(defaults.min_size)
+        .scan<'u', uint64_t>()
+        .help("Smallest file size in bytes");
+    arguments_parser.add_argument("--max-size")
+        .default_value(defaults.max_size)
+        .scan<'u', uint64_t>()
+        .help("Largest file size in bytes");
+    arguments_parser.add_argument("--duplicate-ratio")
+        .default_value(defaults.duplicate_ratio)
+        .scan<'g', double>()
+        .help("Chance of a file being a copy of an earlier file");
+    arguments_parser.add_argument("--hard-link-ratio")
+        .default_value(defaults.hard_link_ratio)
+        .scan<'g', double>()
+        .help("Chance of a file being a hard link to an earlier file");
+    arguments_parser.add_argument("--sparse-ratio")
+        .default_value(defaults.sparse_ratio)
+        .scan<'g', double>()
+        .help("Chance of a file of 64KiB or more being sparse");
+    arguments_parser.add_argument("--manifest")
+        .default_value(std::string(""))
+        .help("File to list the duplicate and hard link groups in");
+
+    try {
+        arguments_parser.parse_args(argc, argv);
+    }
+    catch (const std::exception& err) {
+        std::cerr << err.what() << std::endl;
+        std::cerr << arguments_parser;
+        return EXIT_FAILURE;
+    }
+
+    CorpusSettings settings;
+    settings.seed = arguments_parser.get<uint64_t>("--seed");
+    settings.depth = arguments_parser.get<size_t>("--depth");
+    settings.fan_out = arguments_parser.get<size_t>("--fan-out");
+    settings.files_per_directory =
+        arguments_parser.get<size_t>("--files-per-directory");
+    settings.min_size = arguments_parser.get<uint64_t>("--min-size");
+    settings.max_size = arguments_parser.get<uint64_t>("--max-size");
+    settings.duplicate_ratio =
+        arguments_parser.get<double>("--duplicate-ratio");
+    settings.hard_link_ratio =
+        arguments_parser.get<double>("--hard-link-ratio");
+    settings.sparse_ratio = arguments_parser.get<double>("--sparse-ratio");
+
+    auto distribution =
+        arguments_parser.get<std::string>("--size-distribution");
+    if (!duplitrace::common::CorpusSizeDistributionFromName(
+            distribution, &settings.size_distribution)) {
+        std::cout << "[ERROR] Unknown size distribution '" << distribution
+            << "'" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    auto root = arguments_parser.get<std::string>("root");
+    auto startTime = std::chrono::steady_clock::now();
+
+    CorpusGenerator generator(settings);
+    if (!generator.Generate(root)) {
+        std::cout << "[ERROR] Unable to generate the tree in '" << root
+            << "', it must be empty and writable" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - startTime;
+    const CorpusStatistics& statistics = generator.Statistics();
+
+    std::cout << "[INFO] Generated " << statistics.files << " files ("
+        << statistics.duplicates << " duplicates, "
+        << statistics.hard_links << " hard links, "
+        << statistics.sparse_files << " sparse) in "
+        << statistics.directories << " directories, "
+        << statistics.bytes << " bytes, in " << elapsed.count() << "s"
+        << std::endl;
+
+    auto manifest = arguments_parser.get<std::string>("--manifest");
+    if (!manifest.empty() && !generator.WriteManifest(manifest)) {
+        std::cout << "[ERROR] Unable to write the manifest '" << manifest
+            << "'" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
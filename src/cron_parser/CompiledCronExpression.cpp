@@ -0,0 +1,422 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#include <limits>
+#include "CompiledCronExpression.h"
+#include "CronCalendar.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace duplitrace { namespace cronparser {
+
+// Day of the year each month starts on, for normal and leap years.
+static const int MONTH_STARTS[2][CRONPARSER_BITFIELD_VALUE_MONTHS + 1] = {
+    { 0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334, 365 },
+    { 0, 31, 60, 91, 121, 152, 182, 213, 244, 274, 305, 335, 366 }
+};
+
+// Position of the lowest set bit, the mask must not be zero.
+static int LowestSetBit(uint64_t mask) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, mask);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctzll(mask);
+#endif
+}
+
+/*
+Find the first set bit at or after a given position.
+
+returns:
+    Position of the set bit, or -1 if there are none.
+*/
+static int NextSetBit(uint64_t mask, int from) {
+    if (from >= 64) {
+        return -1;
+    }
+
+    mask &= ~0ULL << from;
+    return mask ? LowestSetBit(mask) : -1;
+}
+
+static CronTriggerCursor CursorFromTime(const std::tm& time) {
+    int year = time.tm_year + 1900;
+
+    return { year,
+             MONTH_STARTS[IsLeapYear(year)][time.tm_mon] + time.tm_mday - 1,
+             time.tm_hour, time.tm_min, time.tm_sec };
+}
+
+// Value that orders cursors by the time they point at.
+static int64_t CursorKey(const CronTriggerCursor& cursor) {
+    int64_t days = static_cast<int64_t>(cursor.year) * 366 +
+                   cursor.day_of_year;
+
+    return ((days * 24 + cursor.hour) * 60 + cursor.minute) * 60 +
+           cursor.second;
+}
+
+static std::tm CursorToTime(const CronTriggerCursor& cursor) {
+    const int* monthStarts = MONTH_STARTS[IsLeapYear(cursor.year)];
+    int month = 0;
+    while (cursor.day_of_year >= monthStarts[month + 1]) {
+        month++;
+    }
+
+    std::tm time = {};
+    time.tm_year = cursor.year - 1900;
+    time.tm_mon = month;
+    time.tm_mday = cursor.day_of_year - monthStarts[month] + 1;
+    time.tm_hour = cursor.hour;
+    time.tm_min = cursor.minute;
+    time.tm_sec = cursor.second;
+    time.tm_wday = (DayOfWeek(cursor.year, 0, 1) + cursor.day_of_year) % 7;
+    time.tm_yday = cursor.day_of_year;
+    time.tm_isdst = -1;
+
+    return time;
+}
+
+// Set a run of bits in a calendar, starting at a day of the year.
+static void SetCalendarBits(CronCalendar* calendar, int dayOfYear,
+                            uint64_t bits) {
+    int word = dayOfYear / 64;
+    int shift = dayOfYear % 64;
+
+    (*calendar)[word] |= bits << shift;
+    if (shift != 0 && word + 1 < CRONPARSER_CALENDAR_WORDS) {
+        (*calendar)[word + 1] |= bits >> (64 - shift);
+    }
+}
+
+CompiledCronExpression::CompiledCronExpression(
+        const CronExpression& expression) :
+    seconds_(expression.Seconds().to_ullong()),
+    minutes_(expression.Minutes().to_ullong()),
+    hours_(expression.Hours().to_ullong()) {
+    const uint64_t daysOfWeek = expression.DaysOfWeek().to_ullong();
+    const uint64_t daysOfMonth = expression.DaysOfMonth().to_ullong();
+    const BitsetMonths months = expression.Months();
+
+    // Days matching the month and day of the month fields, for normal and
+    // leap years.
+    CronCalendar dates[2] = {};
+
+    for (int leap = 0; leap < 2; leap++) {
+        for (int month = 0; month < CRONPARSER_BITFIELD_VALUE_MONTHS;
+             month++) {
+            if (months.test(month)) {
+                int start = MONTH_STARTS[leap][month];
+                int days = MONTH_STARTS[leap][month + 1] - start;
+                SetCalendarBits(&dates[leap], start,
+                                daysOfMonth & ((1ULL << days) - 1));
+            }
+        }
+    }
+
+    // Days matching the day of the week field in a 64 day run, for each day
+    // of the week it can start on. As 64 days is 9 weeks and a day, the next
+    // run is the one starting on the following day of the week.
+    uint64_t weeks[7];
+
+    for (int weekDay = 0; weekDay < 7; weekDay++) {
+        uint64_t week = ((daysOfWeek >> weekDay) |
+                         (daysOfWeek << (7 - weekDay))) & 0x7F;
+        for (int shift = 7; shift < 64; shift *= 2) {
+            week |= week << shift;
+        }
+        weeks[weekDay] = week;
+    }
+
+    for (int type = 0; type < CRONPARSER_CALENDAR_YEAR_TYPES; type++) {
+        for (int word = 0; word < CRONPARSER_CALENDAR_WORDS; word++) {
+            calendars_[type][word] = dates[type / 7][word] &
+                                     weeks[(type + word) % 7];
+        }
+    }
+}
+
+/*
+Calculate the next time after a start time that matches the expression. The
+start time's day of the week, day of the year and daylight saving flag are
+ignored.
+
+returns:
+    Next trigger time, a BadCronExpression exception is thrown if the
+    expression never triggers (e.g. 30th February).
+*/
+std::tm CompiledCronExpression::getNextTriggerTime(
+        const std::tm& start_time) const {
+    CronTriggerCursor cursor = CursorFromTime(start_time);
+
+    // Start checking from the next second, a value of 60 simply fails to
+    // match and carries into the minutes.
+    cursor.second++;
+
+    if (!FirstTrigger(&cursor)) {
+        throw BadCronExpression("Cron expression has no future trigger time");
+    }
+
+    return CursorToTime(cursor);
+}
+
+/*
+Calculate the next time after a UTC time that the expression triggers in a
+time zone, without going through the C library. A local time that is skipped
+when the clocks go forward triggers at the moment they do, and one that is
+repeated when they go back only triggers the first time through.
+
+returns:
+    Next trigger time, a BadCronExpression exception is thrown if the
+    expression never triggers.
+*/
+std::time_t CompiledCronExpression::getNextTriggerTime(
+        std::time_t after, const CronTimeZone& time_zone) const {
+    int64_t localTime = time_zone.LatestLocalTime(after);
+    int64_t days = FloorDivide(localTime, CRONPARSER_SECONDS_PER_DAY);
+    int secondOfDay = static_cast<int>(localTime -
+                                       days * CRONPARSER_SECONDS_PER_DAY);
+    int year = YearFromDays(days);
+
+    CronTriggerCursor cursor = {
+        year,
+        static_cast<int>(days - DaysFromCivil(year, 0, 1)),
+        secondOfDay / 3600,
+        secondOfDay / 60 % 60,
+        secondOfDay % 60 + 1
+    };
+
+    if (!FirstTrigger(&cursor)) {
+        throw BadCronExpression("Cron expression has no future trigger time");
+    }
+
+    int64_t triggerDay = DaysFromCivil(cursor.year, 0, 1) + cursor.day_of_year;
+    int64_t triggerTime = triggerDay * CRONPARSER_SECONDS_PER_DAY +
+                          cursor.hour * 3600 + cursor.minute * 60 +
+                          cursor.second;
+
+    return static_cast<std::time_t>(time_zone.UtcTime(triggerTime));
+}
+
+/*
+Generate the next trigger times after a start time, as getNextTriggerTime()
+would return them if it was called over and over. Fewer are generated if the
+expression stops triggering.
+*/
+CronTriggerRange CompiledCronExpression::getNextTriggerTimes(
+        const std::tm& start_time, size_t count) const {
+    CronTriggerCursor start = CursorFromTime(start_time);
+    start.second++;
+
+    return CronTriggerRange(*this, start,
+                            std::numeric_limits<int64_t>::max(), count);
+}
+
+// Generate every trigger time at or after a start time and before an end.
+CronTriggerRange CompiledCronExpression::getTriggerTimesBetween(
+        const std::tm& start_time, const std::tm& end_time) const {
+    return CronTriggerRange(*this, CursorFromTime(start_time),
+                            CursorKey(CursorFromTime(end_time)),
+                            std::numeric_limits<size_t>::max());
+}
+
+const CronCalendar& CompiledCronExpression::YearCalendar(int year) const {
+    return calendars_[(IsLeapYear(year) ? 7 : 0) + DayOfWeek(year, 0, 1)];
+}
+
+/*
+Find the first day of a year at or after a given (zero-based) day of the year
+that matches the expression.
+
+returns:
+    Day of the year, or -1 if there are no more matching days in the year.
+*/
+int CompiledCronExpression::NextDayOfYear(int year, int dayOfYear) const {
+    const CronCalendar& calendar = YearCalendar(year);
+    int word = dayOfYear / 64;
+
+    if (word >= CRONPARSER_CALENDAR_WORDS) {
+        return -1;
+    }
+
+    uint64_t days = calendar[word] & (~0ULL << (dayOfYear % 64));
+
+    while (days == 0) {
+        if (++word == CRONPARSER_CALENDAR_WORDS) {
+            return -1;
+        }
+        days = calendar[word];
+    }
+
+    return word * 64 + LowestSetBit(days);
+}
+
+/*
+Move a time of day forward to the first matching time at or after it, when a
+field moves forward the fields below it start again from their first value.
+
+returns:
+    False if there is no matching time left in the day.
+*/
+bool CompiledCronExpression::NextTimeOfDay(int* hour, int* minute,
+                                           int* second) const {
+    int nextHour = NextSetBit(hours_, *hour);
+
+    if (nextHour == *hour) {
+        int nextMinute = NextSetBit(minutes_, *minute);
+
+        if (nextMinute == *minute) {
+            int nextSecond = NextSetBit(seconds_, *second);
+            if (nextSecond >= 0) {
+                *second = nextSecond;
+                return true;
+            }
+            nextMinute = NextSetBit(minutes_, *minute + 1);
+        }
+
+        if (nextMinute >= 0) {
+            *minute = nextMinute;
+            *second = LowestSetBit(seconds_);
+            return true;
+        }
+        nextHour = NextSetBit(hours_, *hour + 1);
+    }
+
+    if (nextHour < 0) {
+        return false;
+    }
+
+    *hour = nextHour;
+    *minute = LowestSetBit(minutes_);
+    *second = LowestSetBit(seconds_);
+    return true;
+}
+
+/*
+Move a cursor to the first matching day at or after its day, searching into
+later years if needed.
+
+returns:
+    False if the expression never matches again.
+*/
+bool CompiledCronExpression::NextMatchingDay(
+        CronTriggerCursor* cursor) const {
+    const int lastYear = cursor->year + CRONPARSER_MAXIMUM_YEARS_SEARCHED;
+    int day = NextDayOfYear(cursor->year, cursor->day_of_year);
+
+    while (day < 0) {
+        if (++cursor->year > lastYear) {
+            return false;
+        }
+        day = NextDayOfYear(cursor->year, 0);
+    }
+
+    cursor->day_of_year = day;
+    return true;
+}
+
+/*
+Move a cursor to the first trigger time at or after it. Its day only counts
+if it matches and has a matching time left, otherwise the trigger is at the
+first matching time of a later day.
+
+returns:
+    False if the expression never triggers again.
+*/
+bool CompiledCronExpression::FirstTrigger(CronTriggerCursor* cursor) const {
+    if (NextDayOfYear(cursor->year, cursor->day_of_year) ==
+            cursor->day_of_year &&
+        NextTimeOfDay(&cursor->hour, &cursor->minute, &cursor->second)) {
+        return true;
+    }
+
+    cursor->day_of_year++;
+    cursor->hour = LowestSetBit(hours_);
+    cursor->minute = LowestSetBit(minutes_);
+    cursor->second = LowestSetBit(seconds_);
+
+    return NextMatchingDay(cursor);
+}
+
+/*
+Move a cursor from one trigger time to the next. Its day is known to match,
+so only the time of day is searched unless the day has no triggers left.
+
+returns:
+    False if the expression never triggers again.
+*/
+bool CompiledCronExpression::NextTrigger(CronTriggerCursor* cursor) const {
+    cursor->second++;
+
+    if (NextTimeOfDay(&cursor->hour, &cursor->minute, &cursor->second)) {
+        return true;
+    }
+
+    cursor->day_of_year++;
+    cursor->hour = LowestSetBit(hours_);
+    cursor->minute = LowestSetBit(minutes_);
+    cursor->second = LowestSetBit(seconds_);
+
+    return NextMatchingDay(cursor);
+}
+
+CronTriggerIterator::CronTriggerIterator(
+        const CompiledCronExpression* expression,
+        const CronTriggerCursor& start, int64_t endKey, size_t count) :
+    expression_(expression),
+    cursor_(start),
+    end_key_(endKey),
+    remaining_(count),
+    trigger_() {
+    if (!expression_->FirstTrigger(&cursor_)) {
+        expression_ = nullptr;
+        return;
+    }
+
+    Settle();
+}
+
+CronTriggerIterator& CronTriggerIterator::operator++() {
+    remaining_--;
+
+    if (!expression_->NextTrigger(&cursor_)) {
+        expression_ = nullptr;
+        return *this;
+    }
+
+    Settle();
+    return *this;
+}
+
+// Fill in the current trigger time, or end if it is past the last one.
+void CronTriggerIterator::Settle() {
+    if (remaining_ == 0 || CursorKey(cursor_) >= end_key_) {
+        expression_ = nullptr;
+        return;
+    }
+
+    trigger_ = CursorToTime(cursor_);
+}
+
+}  // namespace cronparser
+}  // namespace duplitrace
@@ -0,0 +1,179 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#ifndef COMPILEDCRONEXPRESSION_H_
+#define COMPILEDCRONEXPRESSION_H_
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <iterator>
+#include "CronParser.h"
+#include "CronTimeZone.h"
+
+namespace duplitrace { namespace cronparser {
+
+// Number of 64 bit words needed for a bit per day of a leap year.
+const int CRONPARSER_CALENDAR_WORDS = 6;
+
+/*
+ Which days of a year fall on which day of the week only depends on whether
+ it is a leap year and what day the 1st of January is, so there are just 14
+ kinds of year.
+*/
+const int CRONPARSER_CALENDAR_YEAR_TYPES = 14;
+
+using CronCalendar = std::array<uint64_t, CRONPARSER_CALENDAR_WORDS>;
+
+// Position of a (possible) trigger time, the day of the year is zero-based.
+struct CronTriggerCursor {
+    int year;
+    int day_of_year;
+    int hour;
+    int minute;
+    int second;
+};
+
+class CompiledCronExpression;
+class CronTriggerRange;
+
+/*
+Input iterator over the trigger times of a compiled expression. Each step
+carries on from the previous trigger time rather than searching again from a
+start time, so it is usually a single bit scan. The expression must outlive
+the iterator.
+*/
+class CronTriggerIterator {
+ public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = std::tm;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const std::tm*;
+    using reference = const std::tm&;
+
+    // End of the trigger times.
+    CronTriggerIterator() : expression_(nullptr), cursor_(), end_key_(0),
+                            remaining_(0), trigger_() {}
+
+    CronTriggerIterator(const CompiledCronExpression* expression,
+                        const CronTriggerCursor& start, int64_t endKey,
+                        size_t count);
+
+    reference operator*() const { return trigger_; }
+
+    pointer operator->() const { return &trigger_; }
+
+    CronTriggerIterator& operator++();
+
+    // Only the end of the trigger times compares equal to anything.
+    bool operator==(const CronTriggerIterator& right) const {
+        return expression_ == nullptr && right.expression_ == nullptr;
+    }
+
+    bool operator!=(const CronTriggerIterator& right) const {
+        return !(*this == right);
+    }
+
+ private:
+    const CompiledCronExpression* expression_;
+    CronTriggerCursor cursor_;
+    int64_t end_key_;
+    size_t remaining_;
+    std::tm trigger_;
+
+    void Settle();
+};
+
+/*
+Form of a cron expression built for answering trigger time queries, e.g. for
+a scheduler re-evaluating many schedules. The seconds, minutes and hours are
+held as 64 bit masks so the next matching value is a single bit scan. The
+month, day of the month and day of the week fields are folded into a
+day-of-year calendar for each kind of year, so the next matching day is found
+without walking the days one at a time.
+
+Unlike CronExpression::getNextTriggerTime() the result is not normalised with
+mktime(), its day of the week and day of the year are filled in directly and
+the daylight saving flag is left as -1 for when it is converted to a time_t.
+*/
+class CompiledCronExpression {
+ public:
+    explicit CompiledCronExpression(const CronExpression& expression);
+
+    std::tm getNextTriggerTime(const std::tm& start_time) const;
+
+    std::time_t getNextTriggerTime(std::time_t after,
+                                   const CronTimeZone& time_zone) const;
+
+    CronTriggerRange getNextTriggerTimes(const std::tm& start_time,
+                                         size_t count) const;
+
+    CronTriggerRange getTriggerTimesBetween(const std::tm& start_time,
+                                            const std::tm& end_time) const;
+
+ private:
+    friend class CronTriggerIterator;
+
+    uint64_t seconds_;
+    uint64_t minutes_;
+    uint64_t hours_;
+    std::array<CronCalendar, CRONPARSER_CALENDAR_YEAR_TYPES> calendars_;
+
+    const CronCalendar& YearCalendar(int year) const;
+
+    int NextDayOfYear(int year, int dayOfYear) const;
+
+    bool NextTimeOfDay(int* hour, int* minute, int* second) const;
+
+    bool NextMatchingDay(CronTriggerCursor* cursor) const;
+
+    bool FirstTrigger(CronTriggerCursor* cursor) const;
+
+    bool NextTrigger(CronTriggerCursor* cursor) const;
+};
+
+/*
+Lazily generated trigger times of an expression, for use in a range based for
+loop. It holds its own copy of the expression, so it may be a temporary.
+*/
+class CronTriggerRange {
+ public:
+    CronTriggerRange(const CompiledCronExpression& expression,
+                     const CronTriggerCursor& start, int64_t endKey,
+                     size_t count) :
+        expression_(expression), start_(start), end_key_(endKey),
+        count_(count) {}
+
+    CronTriggerIterator begin() const {
+        return CronTriggerIterator(&expression_, start_, end_key_, count_);
+    }
+
+    CronTriggerIterator end() const { return CronTriggerIterator(); }
+
+ private:
+    CompiledCronExpression expression_;
+    CronTriggerCursor start_;
+    int64_t end_key_;
+    size_t count_;
+};
+
+}  // namespace cronparser
+}  // namespace duplitrace
+
+#endif  // COMPILEDCRONEXPRESSION_H_
@@ -0,0 +1,125 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#ifndef CRONCALENDAR_H_
+#define CRONCALENDAR_H_
+#include <cstdint>
+
+namespace duplitrace { namespace cronparser {
+
+const int CRONPARSER_SECONDS_PER_DAY = 86400;
+
+inline bool IsLeapYear(int year) {
+    return (year % 4 == 0) && ((year % 100 != 0) || (year % 400 == 0));
+}
+
+// Number of days in a month, the month is zero-based (as per std::tm).
+inline int DaysInMonth(int year, int month) {
+    static const int DAYS_IN_MONTH[] = {
+        31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31
+    };
+
+    if (month == 1 && IsLeapYear(year)) {
+        return 29;
+    }
+
+    return DAYS_IN_MONTH[month];
+}
+
+/*
+Calculate the day of the week (0 = Sunday) for a date without going through
+the C library, uses Sakamoto's method. The month is zero-based.
+*/
+inline int DayOfWeek(int year, int month, int day) {
+    static const int MONTH_OFFSETS[] = {
+        0, 3, 2, 5, 0, 3, 5, 1, 4, 6, 2, 4
+    };
+
+    if (month < 2) {
+        year -= 1;
+    }
+
+    return (year + year / 4 - year / 100 + year / 400 +
+            MONTH_OFFSETS[month] + day) % 7;
+}
+
+// Division that rounds towards minus infinity, e.g. for times before 1970.
+inline int64_t FloorDivide(int64_t value, int64_t divisor) {
+    int64_t quotient = value / divisor;
+    return (value % divisor != 0 && value < 0) ? quotient - 1 : quotient;
+}
+
+/*
+Number of days from 1st January 1970 to a date, negative before it. The
+month is zero-based. Uses Howard Hinnant's days_from_civil algorithm.
+*/
+inline int64_t DaysFromCivil(int year, int month, int day) {
+    int64_t y = static_cast<int64_t>(year) - (month < 2 ? 1 : 0);
+    int64_t era = (y >= 0 ? y : y - 399) / 400;
+    int64_t yearOfEra = y - era * 400;
+    int64_t dayOfYear = (153 * (month < 2 ? month + 10 : month - 2) + 2) / 5 +
+                        day - 1;
+    int64_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 +
+                       dayOfYear;
+
+    return era * 146097 + dayOfEra - 719468;
+}
+
+/*
+Date of a day counting from 1st January 1970, the inverse of DaysFromCivil().
+The month is zero-based. Uses Howard Hinnant's civil_from_days algorithm.
+*/
+inline void CivilFromDays(int64_t days, int* year, int* month, int* day) {
+    days += 719468;
+    int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    int64_t dayOfEra = days - era * 146097;
+    int64_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 -
+                         dayOfEra / 146096) / 365;
+    int64_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 -
+                                    yearOfEra / 100);
+    int64_t shiftedMonth = (5 * dayOfYear + 2) / 153;
+
+    // The algorithm's years start in March.
+    *day = static_cast<int>(dayOfYear - (153 * shiftedMonth + 2) / 5 + 1);
+    *month = static_cast<int>(shiftedMonth < 10 ? shiftedMonth + 2 :
+                                                  shiftedMonth - 10);
+    *year = static_cast<int>(yearOfEra + era * 400 +
+                             (shiftedMonth >= 10 ? 1 : 0));
+}
+
+// Year a day falls in, counting the days from 1st January 1970.
+inline int YearFromDays(int64_t days) {
+    days += 719468;
+    int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    int64_t dayOfEra = days - era * 146097;
+    int64_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 -
+                         dayOfEra / 146096) / 365;
+    int64_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 -
+                                    yearOfEra / 100);
+    int64_t shiftedMonth = (5 * dayOfYear + 2) / 153;
+
+    // The algorithm's years start in March.
+    return static_cast<int>(yearOfEra + era * 400 +
+                            (shiftedMonth >= 10 ? 1 : 0));
+}
+
+}  // namespace cronparser
+}  // namespace duplitrace
+
+#endif  // CRONCALENDAR_H_
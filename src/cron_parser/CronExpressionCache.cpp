@@ -0,0 +1,98 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#include <cctype>
+#include "CronExpressionCache.h"
+#include "Utilities.h"
+
+namespace duplitrace { namespace cronparser {
+
+// Key for an expression's text, its fields upper cased and separated by a
+// single space.
+static std::string NormalisedText(std::string_view expression) {
+    std::string text;
+    text.reserve(expression.size());
+
+    for (std::string_view field : common::StringSplitter(expression, ' ')) {
+        if (field.empty()) {
+            continue;
+        }
+
+        if (!text.empty()) {
+            text += ' ';
+        }
+        for (char character : field) {
+            text += static_cast<char>(
+                std::toupper(static_cast<unsigned char>(character)));
+        }
+    }
+
+    return text;
+}
+
+CronExpressionCache& CronExpressionCache::Global() {
+    static CronExpressionCache cache;
+    return cache;
+}
+
+/*
+Find the compiled form of an expression, parsing and compiling it if it has
+not been seen before. A BadCronExpression exception is thrown if the
+expression is invalid.
+*/
+std::shared_ptr<const CompiledCronExpression> CronExpressionCache::Find(
+        std::string_view expression) {
+    std::string text = NormalisedText(expression);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        auto found = by_text_.find(text);
+        if (found != by_text_.end()) {
+            return found->second;
+        }
+    }
+
+    // Parse outside of the lock, if another thread adds the same expression
+    // meanwhile then the first one in is kept.
+    CronExpression parsed(text);
+    auto compiled = std::make_shared<const CompiledCronExpression>(parsed);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    CompiledPointer shared =
+        by_value_.emplace(std::move(parsed), compiled).first->second;
+
+    return by_text_.emplace(std::move(text), shared).first->second;
+}
+
+// Number of distinct (normalised) texts that have been looked up.
+size_t CronExpressionCache::TextCount() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return by_text_.size();
+}
+
+// Number of distinct compiled expressions held.
+size_t CronExpressionCache::ExpressionCount() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return by_value_.size();
+}
+
+}  // namespace cronparser
+}  // namespace duplitrace
@@ -0,0 +1,63 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#ifndef CRONEXPRESSIONCACHE_H_
+#define CRONEXPRESSIONCACHE_H_
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include "CompiledCronExpression.h"
+#include "CronParser.h"
+
+namespace duplitrace { namespace cronparser {
+
+/*
+Cache of compiled cron expressions, so that an expression used by many
+schedules is parsed once and held once. Expressions are looked up by their
+text, with the spacing and case of the fields normalised, and then by value,
+so different texts for the same schedule (e.g. "0 0,30 * * * *" and
+"0 30,0 * * * *") share a compiled expression. Entries are kept for the
+life of the cache, the process-wide one is returned by Global().
+*/
+class CronExpressionCache {
+ public:
+    static CronExpressionCache& Global();
+
+    std::shared_ptr<const CompiledCronExpression> Find(
+        std::string_view expression);
+
+    size_t TextCount();
+
+    size_t ExpressionCount();
+
+ private:
+    using CompiledPointer = std::shared_ptr<const CompiledCronExpression>;
+
+    std::mutex mutex_;
+    std::unordered_map<std::string, CompiledPointer> by_text_;
+    std::unordered_map<CronExpression, CompiledPointer,
+                       CronExpressionHasher> by_value_;
+};
+
+}  // namespace cronparser
+}  // namespace duplitrace
+
+#endif  // CRONEXPRESSIONCACHE_H_
@@ -20,42 +20,78 @@ Copyright 2024 DupliTrace Development Team
     Code is based on croncpp by Mariusbancila:
         https://github.com/mariusbancila/croncpp
 */
+#include <algorithm>
+#include <ctime>
+#include "CronCalendar.h"
 #include "CronParser.h"
 
 namespace duplitrace { namespace cronparser {
 
-const char SPECIAL_CHARACTER_ASTERISK = '*';
-const char SPECIAL_CHARACTER_COMMA = ',';
-const char SPECIAL_CHARACTER_HYPHEN = '-';
+/*
+Find the first set bit at or after a given position.
 
-CronExpression::CronExpression(std::string_view expression) {
-    if (expression.empty())
-        throw BadCronExpression("Invalid empty cron expression");
+returns:
+    Position of the set bit, or the bitset size if there are none.
+*/
+template <size_t SIZE>
+static size_t FindNextSetBit(const std::bitset<SIZE>& bits, int from) {
+    for (size_t i = static_cast<size_t>(std::max(from, 0)); i < SIZE; ++i) {
+        if (bits.test(i)) {
+            return i;
+        }
+    }
 
-    auto fields = common::StringSplit(expression, ' ');
-    fields.erase(
-        std::remove_if(std::begin(fields), std::end(fields),
-            [](std::string_view s) {return s.empty (); }),
-        std::end(fields));
+    return SIZE;
+}
 
-    if (fields.size() != 6)
-        throw BadCronExpression("cron expression must have six fields");
+/*
+Count the seconds from 1st January 1970 to the fields of a local time, as if
+no time zone applied. Out of range fields simply carry into the larger ones,
+e.g. a second of 60 is the start of the next minute.
+*/
+static int64_t FieldSeconds(int year, int month, int day, int hour,
+                            int minute, int second) {
+    int64_t months = static_cast<int64_t>(year) * 12 + month;
+    int64_t wholeYears = FloorDivide(months, 12);
+
+    return (DaysFromCivil(static_cast<int>(wholeYears),
+                          static_cast<int>(months - wholeYears * 12), 1) +
+            day - 1) * CRONPARSER_SECONDS_PER_DAY +
+           hour * 3600LL + minute * 60LL + second;
+}
 
-    SetCronField(fields[0], seconds_, CRONPARSER_MINIMUM_SECONDS,
-                 CRONPARSER_MAXIMUM_SECONDS);
-    SetCronField(fields[1], minutes_, CRONPARSER_MINIMUM_MINUTES,
-                 CRONPARSER_MAXIMUM_MINUTES);
-    SetCronField(fields[2], hours_, CRONPARSER_MINIMUM_HOURS,
-                 CRONPARSER_MAXIMUM_HOURS);
+static int64_t FieldSeconds(const std::tm& time) {
+    return FieldSeconds(time.tm_year + 1900, time.tm_mon, time.tm_mday,
+                        time.tm_hour, time.tm_min, time.tm_sec);
+}
+
+// Scan the fields of an expression, throwing if it is not valid.
+static CronFieldMasks ScanValidExpression(std::string_view expression) {
+    CronScanResult result = ScanCronExpression(expression);
+
+    if (result.error) {
+        throw BadCronExpression(result.error);
+    }
 
-    SetDaysOfWeek(fields[5], days_of_week_);
-    SetDaysOfMonth(fields[3], days_of_month_);
-    SetMonths(fields[4], months_);
+    return result.fields;
+}
+
+CronExpression::CronExpression(std::string_view expression) :
+    CronExpression(ScanValidExpression(expression), expression) {
+}
 
-    expression_string_ = expression;
+CronExpression::CronExpression(const CronFieldMasks& fields,
+                               std::string_view expression) :
+    seconds_(fields.seconds),
+    minutes_(fields.minutes),
+    hours_(fields.hours),
+    days_of_week_(fields.days_of_week),
+    days_of_month_(fields.days_of_month),
+    months_(fields.months),
+    expression_string_(expression) {
 }
 
-bool CronExpression::operator==(const CronExpression &right) {
+bool CronExpression::operator==(const CronExpression &right) const {
     return
         seconds_ == right.seconds_ &&
         minutes_ == right.minutes_ &&
@@ -65,224 +101,138 @@ bool CronExpression::operator==(const CronExpression &right) {
         months_ == right.months_;
 }
 
-bool CronExpression::operator!=(const CronExpression &right) {
+bool CronExpression::operator!=(const CronExpression &right) const {
     return !(*this == right);
 }
 
-std::tm CronExpression::getNextTriggerTime(const std::tm& start_time) {
-    std::tm next_time = start_time;
-
-    // Start checking from the next second
-    next_time.tm_sec += 1;
-
-    while (true) {
-        // If seconds exceed the maximum allowed value
-        // (CRONPARSER_BITFIELD_VALUE_SECONDS), reset to 0 and increment
-        // minutes.
-        if (next_time.tm_sec >= CRONPARSER_BITFIELD_VALUE_SECONDS) {
-            next_time.tm_sec = 0;
-            next_time.tm_min += 1;
+std::tm CronExpression::getNextTriggerTime(const std::tm& start_time) const {
+    int year, month, day, hour, minute, second;
+
+    // Move the search on to a local time given as a count of FieldSeconds().
+    auto search_from = [&](int64_t seconds) {
+        int64_t days = FloorDivide(seconds, CRONPARSER_SECONDS_PER_DAY);
+        int second_of_day = static_cast<int>(
+            seconds - days * CRONPARSER_SECONDS_PER_DAY);
+
+        CivilFromDays(days, &year, &month, &day);
+        hour = second_of_day / 3600;
+        minute = second_of_day / 60 % 60;
+        second = second_of_day % 60;
+    };
+
+    // The start is normalised first, so that e.g. the 32nd of a month or a
+    // time after 23:59:59 is carried over rather than searched from, and
+    // checking starts from the next second.
+    search_from(FieldSeconds(start_time) + 1);
+
+    // Every field is resolved by jumping straight to the next set bit at or
+    // after the current value. When a field has no set bit left it wraps to
+    // the start and the next larger field is advanced, after which the search
+    // restarts from the month. Lower fields are reset whenever a larger field
+    // moves forward, so each pass can only ever move the time forward.
+    const int last_year = year + CRONPARSER_MAXIMUM_YEARS_SEARCHED;
+
+    while (year <= last_year) {
+        size_t next_month = FindNextSetBit(months_, month);
+        if (next_month == months_.size()) {
+            year++;
+            month = 0;
+            day = 1;
+            hour = minute = second = 0;
+            continue;
         }
-
-        // If minutes exceed the maximum allowed value
-        // (CRONPARSER_BITFIELD_VALUE_MINUTES), reset to 0 and increment hours.
-        if (next_time.tm_min >= CRONPARSER_BITFIELD_VALUE_MINUTES) {
-            next_time.tm_min = 0;
-            next_time.tm_hour += 1;
+        if (static_cast<int>(next_month) != month) {
+            month = static_cast<int>(next_month);
+            day = 1;
+            hour = minute = second = 0;
         }
 
-        // If hours exceed the maximum allowed value
-        // (CRONPARSER_BITFIELD_VALUE_HOURS), reset to 0 and increment the day
-        // of the month.
-        if (next_time.tm_hour >= CRONPARSER_BITFIELD_VALUE_HOURS) {
-            next_time.tm_hour = 0;
-            next_time.tm_mday += 1;
+        // Both the day of the month and the day of the week must match, the
+        // day of the week is walked forward alongside the day of the month.
+        const int days_in_month = DaysInMonth(year, month);
+        int week_day = DayOfWeek(year, month, day);
+        int next_day = day;
+
+        while (next_day <= days_in_month &&
+               !(days_of_month_.test(static_cast<size_t>(next_day) - 1) &&
+                 days_of_week_.test(week_day))) {
+            next_day++;
+            week_day = (week_day + 1) % CRONPARSER_BITFIELD_VALUE_DAYS_OF_WEEK;
         }
 
-        // Handle non-existent dates (e.g., April 31) and leap years (e.g.,
-        // February 30).
-        if (next_time.tm_mday > CRONPARSER_BITFIELD_VALUE_DAYS_OF_MONTH ||
-            (next_time.tm_mon == 1 && next_time.tm_mday == 30 &&
-            !((next_time.tm_year + 1900) % 4 == 0 &&
-            ((next_time.tm_year + 1900) % 100 != 0 ||
-            (next_time.tm_year + 1900) % 400 == 0)))) {
-            next_time.tm_mday = 1;
-            next_time.tm_mon += 1;
+        if (next_day > days_in_month) {
+            month++;
+            if (month >= CRONPARSER_BITFIELD_VALUE_MONTHS) {
+                month = 0;
+                year++;
+            }
+            day = 1;
+            hour = minute = second = 0;
+            continue;
         }
-
-        // If months exceed the maximum allowed value
-        // (CRONPARSER_BITFIELD_VALUE_MONTHS), reset to 0 and increment the
-        // year.
-        if (next_time.tm_mon >= CRONPARSER_BITFIELD_VALUE_MONTHS) {
-            next_time.tm_mon = 0;
-            next_time.tm_year += 1;
+        if (next_day != day) {
+            day = next_day;
+            hour = minute = second = 0;
         }
 
-        // Normalise the time structure after any changes
-        std::mktime(&next_time);
-
-        // Check if the current next_time values match the cron expression
-        // fields (seconds, minutes, hours, days of the month, months, and days
-        // of the week).The.test () method is used to check if the specific
-        // field value is valid according to the cron expression.
-        // * seconds_.test (next_time.tm_sec) : Checks if the current second is
-        //   valid.
-        // * minutes_.test (next_time.tm_min) : Checks if the current minute is
-        //   valid.
-        // * hours_.test (next_time.tm_hour) : Checks if the current hour is
-        //   valid.
-        // * days_of_week_.test (next_time.tm_mday - 1) : Checks if the current
-        //   day of the month is valid (subtracting 1 because tm_mday is
-        //   1 - based).
-        // * months_.test (next_time.tm_mon) : Checks if the current month is
-        //    valid.
-        // * days_of_week_.test (next_time.tm_wday) : Checks if the current day
-        //   of the week is valid.
-        if (seconds_.test(next_time.tm_sec) &&
-            minutes_.test(next_time.tm_min) &&
-            hours_.test(next_time.tm_hour) &&
-            days_of_month_.test(static_cast<size_t>(next_time.tm_mday) -1) &&
-            months_.test(next_time.tm_mon) &&
-            days_of_week_.test(next_time.tm_wday)) {
-            break;
+        size_t next_hour = FindNextSetBit(hours_, hour);
+        if (next_hour == hours_.size()) {
+            day++;
+            hour = minute = second = 0;
+            continue;
         }
-
-        next_time.tm_sec += 1;
-    }
-
-    return next_time;
-}
-
-cronparser_int CronExpression::ToCronParserInt(std::string_view text) {
-    try {
-        return static_cast<cronparser_int>(std::stoul (text.data ()));
-    }
-    catch (std::exception const& ex) {
-        throw BadCronExpression(ex.what());
-    }
-}
-
-std::pair<cronparser_int, cronparser_int> CronExpression::CreateIntRange(
-        std::string_view field,
-        cronparser_int const minval,
-        cronparser_int const maxval) {
-    cronparser_int firstValue = 0;
-    cronparser_int lastValue = 0;
-
-    if (field.size() == 1 && field[0] == SPECIAL_CHARACTER_ASTERISK) {
-        firstValue = minval;
-        lastValue = maxval;
-    } else if (!common::StringContains(field, SPECIAL_CHARACTER_HYPHEN)) {
-        firstValue = ToCronParserInt(field);
-        lastValue = firstValue;
-    } else {
-        auto parts = common::StringSplit(field, SPECIAL_CHARACTER_HYPHEN);
-        if (parts.size () != 2)
-            throw BadCronExpression("Specified range requires two fields");
-
-        firstValue = ToCronParserInt(parts[0]);
-        lastValue = ToCronParserInt(parts[1]);
-    }
-
-    if (firstValue > maxval || lastValue > maxval) {
-        throw BadCronExpression("Specified range exceeds maximum");
-    }
-    if (firstValue < minval || lastValue < minval) {
-        throw BadCronExpression("Specified range is less than minimum");
-    }
-    if (firstValue > lastValue) {
-        throw BadCronExpression("Specified range start exceeds range end");
-    }
-
-    return { firstValue, lastValue };
-}
-
-template <size_t SIZE>
-void CronExpression::SetCronField(std::string_view value,
-                                  std::bitset<SIZE>& target,
-                                  cronparser_int const minValue,
-                                  cronparser_int const maxValue) {
-    // Check that cron field doesn't end with a comma.
-    if (value.length() > 0 &&
-        value[value.length() - 1] == SPECIAL_CHARACTER_COMMA) {
-        throw BadCronExpression("Value cannot end with comma");
-    }
-
-    // Split the string with the ',' delimiter, if the fields are empty then
-    // generate an exception.
-    auto fields = common::StringSplit(value, SPECIAL_CHARACTER_COMMA);
-    if (fields.empty()) {
-        throw BadCronExpression("Cron expression cannot be parsed");
-    }
-
-    for (auto const& field : fields) {
-        if (!common::StringContains(field, '/')) {
-            auto [first, last] = CreateIntRange(field, minValue, maxValue);
-
-            for (cronparser_int i = first - minValue; i <= last - minValue;
-                 ++i) {
-                target.set(i);
-            }
-        } else {
-            auto parts = common::StringSplit(field, '/');
-            if (parts.size() != 2)
-                throw BadCronExpression("Incrementer must have two fields");
-
-            auto [first, last] = CreateIntRange(parts[0], minValue, maxValue);
-
-            if (!common::StringContains(parts[0], '-')) {
-                last = maxValue;
-            }
-
-            auto delta = ToCronParserInt(parts[1]);
-            if (delta <= 0)
-                throw BadCronExpression("Incrementer must be a positive value");
-
-            for (cronparser_int i = first - minValue; i <= last - minValue;
-                i += delta) {
-                target.set(i);
-            }
+        if (static_cast<int>(next_hour) != hour) {
+            hour = static_cast<int>(next_hour);
+            minute = second = 0;
         }
-    }
-}
-
-void CronExpression::SetDaysOfWeek(std::string value, std::bitset<7>& target) {
-    auto days = common::ToUpper(value);
-    auto days_replaced = ReplaceOrdinals(days, DAY_OF_WEEK);
-
-    if (days_replaced.size () == 1 && days_replaced[0] == '?')
-        days_replaced[0] = '*';
-
-    SetCronField(days_replaced, target, CRONPARSER_MINIMUM_DAYS_OF_WEEK,
-                 CRONPARSER_MAXIMUM_DAYS_OF_WEEK);
-}
 
-void CronExpression::SetDaysOfMonth(std::string value,
-                                    std::bitset<31>& target) {
-    if (value.size () == 1 && value[0] == '?')
-        value[0] = '*';
+        size_t next_minute = FindNextSetBit(minutes_, minute);
+        if (next_minute == minutes_.size()) {
+            hour++;
+            minute = second = 0;
+            continue;
+        }
+        if (static_cast<int>(next_minute) != minute) {
+            minute = static_cast<int>(next_minute);
+            second = 0;
+        }
 
-    SetCronField(value, target, CRONPARSER_MINIMUM_DAYS_OF_MONTH,
-                 CRONPARSER_MAXIMUM_DAYS_OF_MONTH);
-}
+        size_t next_second = FindNextSetBit(seconds_, second);
+        if (next_second == seconds_.size()) {
+            minute++;
+            second = 0;
+            continue;
+        }
 
-void CronExpression::SetMonths(std::string value, std::bitset<12>& target) {
-    auto month = common::ToUpper(value);
-    auto month_replaced = ReplaceOrdinals(month, MONTH);
+        // All of the fields match, normalise the time structure once so that
+        // the day of the week/year and daylight saving flag are filled in.
+        std::tm next_time = {};
+        next_time.tm_year = year - 1900;
+        next_time.tm_mon = month;
+        next_time.tm_mday = day;
+        next_time.tm_hour = hour;
+        next_time.tm_min = minute;
+        next_time.tm_sec = static_cast<int>(next_second);
+        next_time.tm_isdst = -1;
+        std::mktime(&next_time);
 
-    SetCronField(month_replaced, target, CRONPARSER_MINIMUM_MONTHS,
-                 CRONPARSER_MAXIMUM_MONTHS);
-}
+        // mktime() moves a time skipped by a daylight saving change on, e.g.
+        // 02:30 to 03:30, which is not a time that was matched, so the search
+        // carries on from there. Should it be moved back instead the skipped
+        // time is simply passed over.
+        int64_t matched = FieldSeconds(year, month, day, hour, minute,
+                                       static_cast<int>(next_second));
+        int64_t normalised = FieldSeconds(next_time);
+
+        if (normalised != matched) {
+            search_from(std::max(normalised, matched + 1));
+            continue;
+        }
 
-std::string CronExpression::ReplaceOrdinals(
-    std::string text, std::vector<std::string> const& replacement) {
-    for (size_t i = 0; i < replacement.size(); ++i) {
-        auto pos = text.find(replacement[i]);
-        if (std::string::npos != pos)
-            text.replace(pos, 3, std::to_string(i));
+        return next_time;
     }
 
-    return text;
+    throw BadCronExpression("Cron expression has no future trigger time");
 }
 
 }  // namespace cronparser
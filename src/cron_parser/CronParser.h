@@ -23,13 +23,14 @@ Copyright 2024 DupliTrace Development Team
 #ifndef CRONPARSER_H_
 #define CRONPARSER_H_
 #include <bitset>
+#include <cstdint>
+#include <ctime>
 #include <stdexcept>
 #include <string>
-#include <utility>
-#include <vector>
+#include <string_view>
 #include "Platform.h"
-#include "Utilities.h"
 #include "CronParserConstants.h"
+#include "CronScanner.h"
 
 #if (DUPLITRACE_PLATFORM == DUPLITRACE_PLATFORM_WINDOWS_MSVC)
   #if defined(_MSVC_LANG) && _MSVC_LANG == 201703L
@@ -60,7 +61,11 @@ class CronExpression {
  public:
      explicit CronExpression(std::string_view expression);
 
-     std::string Expression() { return expression_string_; }
+     // Fields already scanned from the expression, see CRON_EXPRESSION.
+     CronExpression(const CronFieldMasks& fields,
+                    std::string_view expression);
+
+     std::string Expression() const { return expression_string_; }
 
      BitsetSeconds Seconds() const { return seconds_; }
      BitsetMinutes Minutes() const { return minutes_; }
@@ -69,10 +74,10 @@ class CronExpression {
      BitsetDaysOfMonth DaysOfMonth() const { return days_of_month_;  }
      BitsetMonths Months() const { return months_; }
 
-     bool operator==(const CronExpression &right);
-     bool operator!=(const CronExpression &right);
+     bool operator==(const CronExpression &right) const;
+     bool operator!=(const CronExpression &right) const;
 
-     std::tm getNextTriggerTime(const std::tm& start_time);
+     std::tm getNextTriggerTime(const std::tm& start_time) const;
 
  private:
      BitsetSeconds seconds_;
@@ -82,28 +87,47 @@ class CronExpression {
      BitsetDaysOfMonth days_of_month_;
      BitsetMonths months_;
      std::string     expression_string_;
+};
 
-     cronparser_int ToCronParserInt(std::string_view text);
-
-     std::pair<cronparser_int, cronparser_int> CreateIntRange(
-         std::string_view field,
-         cronparser_int const minval,
-         cronparser_int const maxval);
-
-     template <size_t SIZE>
-     void SetCronField(std::string_view value, std::bitset<SIZE>& target,
-                       cronparser_int const minValue,
-                       cronparser_int const maxValue);
-
-     void SetDaysOfWeek(std::string value, std::bitset<7>& target);
-     void SetDaysOfMonth(std::string value, std::bitset<31>& target);
-     void SetMonths(std::string value, std::bitset<12>& target);
-
-     std::string ReplaceOrdinals(std::string text,
-                                 std::vector<std::string> const& replacement);
+// Allows a CronExpression to be used as an unordered container key, hashes
+// the fields so that expressions that compare equal hash the same whatever
+// their text.
+struct CronExpressionHasher {
+    size_t operator()(const CronExpression& expression) const {
+        const uint64_t fields[] = {
+            expression.Seconds().to_ullong(),
+            expression.Minutes().to_ullong(),
+            expression.Hours().to_ullong(),
+            expression.DaysOfWeek().to_ullong(),
+            expression.DaysOfMonth().to_ullong(),
+            expression.Months().to_ullong()
+        };
+        uint64_t hash = 0;
+
+        for (uint64_t field : fields) {
+            hash = (hash ^ field) * 0x9E3779B97F4A7C15ULL;
+            hash ^= hash >> 32;
+        }
+
+        return static_cast<size_t>(hash);
+    }
 };
 
 }  // namespace cronparser
 }  // namespace duplitrace
 
+/*
+Create a CronExpression from a literal, the expression is scanned when
+building and an invalid one fails to compile.
+*/
+#define CRON_EXPRESSION(text) \
+    duplitrace::cronparser::CronExpression( \
+        [] { \
+            constexpr duplitrace::cronparser::CronScanResult result = \
+                duplitrace::cronparser::ScanCronExpression(text); \
+            static_assert(result.error == nullptr, \
+                          "Invalid cron expression: " text); \
+            return result.fields; \
+        }(), text)
+
 #endif  // CRONPARSER_H_
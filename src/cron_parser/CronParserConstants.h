@@ -19,8 +19,7 @@ Copyright 2024 DupliTrace Development Team
 */
 #ifndef CRONPARSERCONSTANTS_H_
 #define CRONPARSERCONSTANTS_H_
-#include <string>
-#include <vector>
+#include <cstdint>
 #include "Platform.h"
 
 #if (DUPLITRACE_PLATFORM == DUPLITRACE_PLATFORM_WINDOWS_MSVC)
@@ -81,6 +80,13 @@ const cronparser_int CRONPARSER_MINIMUM_MONTHS = 1;
 /* The maximum value for the month field in a cron expression */
 const cronparser_int CRONPARSER_MAXIMUM_MONTHS = 12;
 
+/*
+ The number of years searched for a trigger time before a cron expression is
+ deemed to never trigger (e.g. 30th February). The Gregorian calendar repeats
+ every 400 years so nothing can be found beyond that.
+*/
+const int CRONPARSER_MAXIMUM_YEARS_SEARCHED = 400;
+
 const int CRONPARSER_BITFIELD_VALUE_SECONDS = 60;
 const int CRONPARSER_BITFIELD_VALUE_MINUTES = 60;
 const int CRONPARSER_BITFIELD_VALUE_HOURS = 24;
@@ -98,7 +104,7 @@ const int CRONPARSER_BITFIELD_VALUE_DAYS_OF_WEEK = 7;
  5 - Friday
  6 - Saturday
 */
-const std::vector<std::string> DAY_OF_WEEK = {
+constexpr const char* DAY_OF_WEEK[] = {
     "SUN",
     "MON",
     "TUE",
@@ -123,8 +129,7 @@ const std::vector<std::string> DAY_OF_WEEK = {
  11 - November
  12 - December
 */
-const std::vector<std::string> MONTH = {
-    "NONE",
+constexpr const char* MONTH[] = {
     "JAN",
     "FEB",
     "MAR",
@@ -0,0 +1,341 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#ifndef CRONSCANNER_H_
+#define CRONSCANNER_H_
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <string_view>
+#include "CronParserConstants.h"
+
+namespace duplitrace { namespace cronparser {
+
+// Fields of a cron expression, bit 0 of each is the field's minimum value.
+struct CronFieldMasks {
+    uint64_t seconds;
+    uint64_t minutes;
+    uint64_t hours;
+    uint64_t days_of_week;
+    uint64_t days_of_month;
+    uint64_t months;
+};
+
+/*
+Values a field accepts. Names are in order from the minimum value, and a lone
+'?' is the same as '*' if the field allows any value.
+*/
+struct CronFieldSpec {
+    int minimum;
+    int maximum;
+    const char* const* names;
+    size_t name_count;
+    bool allow_any;
+};
+
+// Fields of a scanned cron expression, or why it is not valid.
+struct CronScanResult {
+    CronFieldMasks fields;
+    const char* error;
+};
+
+constexpr CronFieldSpec CRONPARSER_SECONDS_SPEC = {
+    CRONPARSER_MINIMUM_SECONDS, CRONPARSER_MAXIMUM_SECONDS, nullptr, 0, false
+};
+
+constexpr CronFieldSpec CRONPARSER_MINUTES_SPEC = {
+    CRONPARSER_MINIMUM_MINUTES, CRONPARSER_MAXIMUM_MINUTES, nullptr, 0, false
+};
+
+constexpr CronFieldSpec CRONPARSER_HOURS_SPEC = {
+    CRONPARSER_MINIMUM_HOURS, CRONPARSER_MAXIMUM_HOURS, nullptr, 0, false
+};
+
+constexpr CronFieldSpec CRONPARSER_DAYS_OF_WEEK_SPEC = {
+    CRONPARSER_MINIMUM_DAYS_OF_WEEK, CRONPARSER_MAXIMUM_DAYS_OF_WEEK,
+    DAY_OF_WEEK, std::size(DAY_OF_WEEK), true
+};
+
+constexpr CronFieldSpec CRONPARSER_DAYS_OF_MONTH_SPEC = {
+    CRONPARSER_MINIMUM_DAYS_OF_MONTH, CRONPARSER_MAXIMUM_DAYS_OF_MONTH,
+    nullptr, 0, true
+};
+
+constexpr CronFieldSpec CRONPARSER_MONTHS_SPEC = {
+    CRONPARSER_MINIMUM_MONTHS, CRONPARSER_MAXIMUM_MONTHS,
+    MONTH, std::size(MONTH), false
+};
+
+// Compare a value with a field name, ignoring case.
+constexpr bool CronNameEquals(std::string_view text, std::string_view name) {
+    if (text.size() != name.size()) {
+        return false;
+    }
+
+    for (size_t i = 0; i < text.size(); i++) {
+        char letter = text[i];
+        if (letter >= 'a' && letter <= 'z') {
+            letter = static_cast<char>(letter - 'a' + 'A');
+        }
+        if (letter != name[i]) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*
+Scan a number, the whole of the text must be digits. The digits are converted
+by hand rather than with std::from_chars, which cannot be used in a constant
+expression.
+
+returns:
+    Null if the number was scanned, otherwise why it could not be.
+*/
+constexpr const char* ScanCronNumber(std::string_view text, int* value) {
+    if (text.empty()) {
+        return "Value is not a number";
+    }
+
+    int number = 0;
+
+    for (char digit : text) {
+        if (digit < '0' || digit > '9') {
+            return "Value is not a number";
+        }
+
+        number = number * 10 + (digit - '0');
+        if (number > std::numeric_limits<cronparser_int>::max()) {
+            return "Value is out of range";
+        }
+    }
+
+    *value = number;
+    return nullptr;
+}
+
+/*
+Scan a single value of a field, the whole of the text must be a number or
+one of the field's names.
+
+returns:
+    Null if the value was scanned, otherwise why it could not be.
+*/
+constexpr const char* ScanCronValue(std::string_view text,
+                                    const CronFieldSpec& spec, int* value) {
+    for (size_t i = 0; i < spec.name_count; i++) {
+        if (CronNameEquals(text, spec.names[i])) {
+            *value = spec.minimum + static_cast<int>(i);
+            return nullptr;
+        }
+    }
+
+    return ScanCronNumber(text, value);
+}
+
+/*
+Scan one item of a comma separated field: '*', a value or a range of values,
+optionally followed by a '/' and an increment, e.g. '5', '1-5', or '0/15'.
+
+returns:
+    Null if the item was scanned, otherwise why it could not be.
+*/
+constexpr const char* ScanCronItem(std::string_view item,
+                                   const CronFieldSpec& spec,
+                                   uint64_t* mask) {
+    const size_t slash = item.find('/');
+    const std::string_view range = item.substr(0, slash);
+    const size_t hyphen = range.find('-');
+    int first = 0;
+    int last = 0;
+    int delta = 1;
+
+    if (slash != std::string_view::npos &&
+        item.find('/', slash + 1) != std::string_view::npos) {
+        return "Incrementer must have two fields";
+    }
+
+    if (range.size() == 1 && range[0] == '*') {
+        first = spec.minimum;
+        last = spec.maximum;
+    } else if (hyphen == std::string_view::npos) {
+        if (const char* error = ScanCronValue(range, spec, &first)) {
+            return error;
+        }
+        last = first;
+    } else {
+        if (range.find('-', hyphen + 1) != std::string_view::npos) {
+            return "Specified range requires two fields";
+        }
+        if (const char* error = ScanCronValue(range.substr(0, hyphen), spec,
+                                              &first)) {
+            return error;
+        }
+        if (const char* error = ScanCronValue(range.substr(hyphen + 1), spec,
+                                              &last)) {
+            return error;
+        }
+    }
+
+    if (first > spec.maximum || last > spec.maximum) {
+        return "Specified range exceeds maximum";
+    }
+    if (first < spec.minimum || last < spec.minimum) {
+        return "Specified range is less than minimum";
+    }
+    if (first > last) {
+        return "Specified range start exceeds range end";
+    }
+
+    if (slash != std::string_view::npos) {
+        // A single value with an increment runs to the end of the field.
+        if (hyphen == std::string_view::npos) {
+            last = spec.maximum;
+        }
+        // The increment is a count, never one of the field's names.
+        if (const char* error = ScanCronNumber(item.substr(slash + 1),
+                                               &delta)) {
+            return error;
+        }
+        if (delta <= 0) {
+            return "Incrementer must be a positive value";
+        }
+    }
+
+    for (int value = first; value <= last; value += delta) {
+        *mask |= uint64_t{1} << (value - spec.minimum);
+    }
+
+    return nullptr;
+}
+
+/*
+Scan a comma separated field.
+
+returns:
+    Null if the field was scanned, otherwise why it could not be.
+*/
+constexpr const char* ScanCronField(std::string_view field,
+                                    const CronFieldSpec& spec,
+                                    uint64_t* mask) {
+    if (!field.empty() && field.back() == ',') {
+        return "Value cannot end with comma";
+    }
+    if (field.empty()) {
+        return "Cron expression cannot be parsed";
+    }
+    if (spec.allow_any && field == "?") {
+        field = "*";
+    }
+
+    *mask = 0;
+
+    for (size_t start = 0; start <= field.size();) {
+        size_t comma = field.find(',', start);
+        if (comma == std::string_view::npos) {
+            comma = field.size();
+        }
+
+        if (const char* error = ScanCronItem(
+                field.substr(start, comma - start), spec, mask)) {
+            return error;
+        }
+        start = comma + 1;
+    }
+
+    return nullptr;
+}
+
+/*
+Scan a six field cron expression in a single pass without allocating, it can
+be used in a constant expression so a literal can be checked when building,
+e.g. static_assert(ScanCronExpression("0 0 3 * * *").error == nullptr).
+
+returns:
+    Fields of the expression, the error is null unless it is not valid.
+*/
+constexpr CronScanResult ScanCronExpression(std::string_view expression) {
+    CronScanResult result = { {0, 0, 0, 0, 0, 0}, nullptr };
+
+    if (expression.empty()) {
+        result.error = "Invalid empty cron expression";
+        return result;
+    }
+
+    // Fields may be separated by any number of spaces.
+    std::string_view fields[6] = {};
+    size_t fieldCount = 0;
+
+    for (size_t start = 0; start < expression.size();) {
+        size_t end = expression.find(' ', start);
+        if (end == std::string_view::npos) {
+            end = expression.size();
+        }
+
+        if (end != start) {
+            if (fieldCount == 6) {
+                fieldCount++;
+                break;
+            }
+            fields[fieldCount++] = expression.substr(start, end - start);
+        }
+        start = end + 1;
+    }
+
+    if (fieldCount != 6) {
+        result.error = "cron expression must have six fields";
+        return result;
+    }
+
+    // Fields are scanned in the order they were always checked in, so the
+    // same error is reported for an expression with more than one.
+    CronFieldMasks& masks = result.fields;
+
+    result.error = ScanCronField(fields[0], CRONPARSER_SECONDS_SPEC,
+                                 &masks.seconds);
+    if (!result.error) {
+        result.error = ScanCronField(fields[1], CRONPARSER_MINUTES_SPEC,
+                                     &masks.minutes);
+    }
+    if (!result.error) {
+        result.error = ScanCronField(fields[2], CRONPARSER_HOURS_SPEC,
+                                     &masks.hours);
+    }
+    if (!result.error) {
+        result.error = ScanCronField(fields[5], CRONPARSER_DAYS_OF_WEEK_SPEC,
+                                     &masks.days_of_week);
+    }
+    if (!result.error) {
+        result.error = ScanCronField(fields[3], CRONPARSER_DAYS_OF_MONTH_SPEC,
+                                     &masks.days_of_month);
+    }
+    if (!result.error) {
+        result.error = ScanCronField(fields[4], CRONPARSER_MONTHS_SPEC,
+                                     &masks.months);
+    }
+
+    return result;
+}
+
+}  // namespace cronparser
+}  // namespace duplitrace
+
+#endif  // CRONSCANNER_H_
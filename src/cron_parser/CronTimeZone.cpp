@@ -0,0 +1,481 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <system_error>
+#include <utility>
+#include "CronCalendar.h"
+#include "CronTimeZone.h"
+
+namespace duplitrace { namespace cronparser {
+
+const char TIMEZONE_FILE_MAGIC[] = "TZif";
+const size_t TIMEZONE_HEADER_SIZE = 44;
+
+// Daylight saving rules default to moving the clocks at 02:00 local time and
+// forward by an hour.
+const int TIMEZONE_RULE_DEFAULT_TIME = 7200;
+const int TIMEZONE_RULE_DEFAULT_SAVING = 3600;
+
+// Counts from the header in front of each block of a zone file.
+struct ZoneFileCounts {
+    size_t is_ut_count;
+    size_t is_std_count;
+    size_t leap_count;
+    size_t time_count;
+    size_t type_count;
+    size_t char_count;
+};
+
+// Day a daylight saving rule changes the clocks on, in one of the POSIX TZ
+// forms: Mm.w.d, Jn (ignoring 29th February) or n (counting it).
+struct ZoneRuleDate {
+    char form;
+    int month;
+    int week;
+    int week_day;
+    int day;
+    int time;
+};
+
+// Read a big-endian signed integer of 4 or 8 bytes.
+static int64_t ReadInteger(std::string_view data, size_t offset,
+                           size_t size) {
+    uint64_t value = 0;
+
+    for (size_t i = 0; i < size; i++) {
+        value = (value << 8) | static_cast<uint8_t>(data[offset + i]);
+    }
+
+    if (size == 4) {
+        return static_cast<int32_t>(static_cast<uint32_t>(value));
+    }
+    return static_cast<int64_t>(value);
+}
+
+static ZoneFileCounts ReadCounts(std::string_view data, size_t offset) {
+    auto count = [&](size_t index) {
+        return static_cast<size_t>(static_cast<uint32_t>(
+            ReadInteger(data, offset + 20 + index * 4, 4)));
+    };
+
+    return { count(0), count(1), count(2), count(3), count(4), count(5) };
+}
+
+// Size of the data block after a header, for 4 or 8 byte times.
+static size_t BlockSize(const ZoneFileCounts& counts, size_t timeSize) {
+    return counts.time_count * timeSize + counts.time_count +
+           counts.type_count * 6 + counts.char_count +
+           counts.leap_count * (timeSize + 4) + counts.is_std_count +
+           counts.is_ut_count;
+}
+
+// Skip a zone abbreviation, either alphabetic or quoted with '<' and '>'.
+static bool ParseRuleName(std::string_view rule, size_t* position) {
+    size_t start = *position;
+
+    if (start < rule.size() && rule[start] == '<') {
+        size_t end = rule.find('>', start);
+        if (end == std::string_view::npos) {
+            return false;
+        }
+        *position = end + 1;
+        return true;
+    }
+
+    while (*position < rule.size() &&
+           ((rule[*position] >= 'A' && rule[*position] <= 'Z') ||
+            (rule[*position] >= 'a' && rule[*position] <= 'z'))) {
+        (*position)++;
+    }
+
+    return *position - start >= 3;
+}
+
+static bool ParseRuleNumber(std::string_view rule, size_t* position,
+                            int* value) {
+    size_t start = *position;
+    *value = 0;
+
+    while (*position < rule.size() && rule[*position] >= '0' &&
+           rule[*position] <= '9' && *position - start < 4) {
+        *value = *value * 10 + (rule[*position] - '0');
+        (*position)++;
+    }
+
+    return *position != start;
+}
+
+// Parse a [+|-]hh[:mm[:ss]] time, into seconds.
+static bool ParseRuleTime(std::string_view rule, size_t* position,
+                          int* seconds) {
+    int sign = 1;
+
+    if (*position < rule.size() &&
+        (rule[*position] == '+' || rule[*position] == '-')) {
+        sign = rule[*position] == '-' ? -1 : 1;
+        (*position)++;
+    }
+
+    int hours = 0;
+    if (!ParseRuleNumber(rule, position, &hours)) {
+        return false;
+    }
+
+    *seconds = hours * 3600;
+    for (int unit = 60; unit >= 1 && *position < rule.size() &&
+                        rule[*position] == ':'; unit /= 60) {
+        int value = 0;
+        (*position)++;
+        if (!ParseRuleNumber(rule, position, &value)) {
+            return false;
+        }
+        *seconds += value * unit;
+    }
+
+    *seconds *= sign;
+    return true;
+}
+
+static bool ParseRuleDate(std::string_view rule, size_t* position,
+                          ZoneRuleDate* date) {
+    if (*position >= rule.size()) {
+        return false;
+    }
+
+    date->form = rule[*position];
+    date->time = TIMEZONE_RULE_DEFAULT_TIME;
+
+    if (date->form == 'M') {
+        (*position)++;
+        if (!ParseRuleNumber(rule, position, &date->month) ||
+            *position >= rule.size() || rule[(*position)++] != '.' ||
+            !ParseRuleNumber(rule, position, &date->week) ||
+            *position >= rule.size() || rule[(*position)++] != '.' ||
+            !ParseRuleNumber(rule, position, &date->week_day) ||
+            date->month < 1 || date->month > 12 || date->week < 1 ||
+            date->week > 5 || date->week_day > 6) {
+            return false;
+        }
+    } else {
+        if (date->form == 'J') {
+            (*position)++;
+        }
+        if (!ParseRuleNumber(rule, position, &date->day) ||
+            date->day > 365 || (date->form == 'J' && date->day < 1)) {
+            return false;
+        }
+    }
+
+    if (*position < rule.size() && rule[*position] == '/') {
+        (*position)++;
+        return ParseRuleTime(rule, position, &date->time);
+    }
+
+    return true;
+}
+
+// Day, counting from 1st January 1970, that a rule date falls on in a year.
+static int64_t RuleDateDay(const ZoneRuleDate& date, int year) {
+    int64_t yearStart = DaysFromCivil(year, 0, 1);
+
+    if (date.form == 'J') {
+        bool afterLeapDay = IsLeapYear(year) && date.day >= 60;
+        return yearStart + date.day - 1 + (afterLeapDay ? 1 : 0);
+    }
+    if (date.form != 'M') {
+        return yearStart + date.day;
+    }
+
+    // The week'th given day of the week in the month, week 5 is the last.
+    int month = date.month - 1;
+    int64_t monthStart = DaysFromCivil(year, month, 1);
+    int monthStartDay = static_cast<int>(((monthStart % 7) + 11) % 7);
+    int64_t day = monthStart + (date.week_day - monthStartDay + 7) % 7 +
+                  (date.week - 1) * 7;
+
+    while (day >= monthStart + DaysInMonth(year, month)) {
+        day -= 7;
+    }
+
+    return day;
+}
+
+/*
+Find a time zone, it is loaded from its zone file the first time and then
+kept for the life of the process. A BadCronTimeZone exception is thrown if
+the zone is unknown or its file cannot be read.
+*/
+std::shared_ptr<const CronTimeZone> CronTimeZone::Find(std::string_view name) {
+    static std::mutex mutex;
+    static std::map<std::string, std::shared_ptr<const CronTimeZone>,
+                    std::less<>> zones;
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto found = zones.find(name);
+    if (found != zones.end()) {
+        return found->second;
+    }
+
+    // Zone names are relative paths, never allow them to leave the directory.
+    bool validName = !name.empty() && name.front() != '/' &&
+                     name.find("..") == std::string_view::npos;
+    for (char character : name) {
+        validName = validName &&
+            ((character >= 'A' && character <= 'Z') ||
+             (character >= 'a' && character <= 'z') ||
+             (character >= '0' && character <= '9') ||
+             character == '/' || character == '_' || character == '-' ||
+             character == '+');
+    }
+    if (!validName) {
+        throw BadCronTimeZone("Invalid time zone name '" +
+                              std::string(name) + "'");
+    }
+
+    const char* directory = std::getenv("TZDIR");
+    std::string path = std::string(directory != nullptr ? directory :
+                                   CRONPARSER_TIMEZONE_DIRECTORY) +
+                       "/" + std::string(name);
+
+    // A directory of zones (e.g. "Europe") opens, but cannot be read.
+    std::error_code error;
+    std::ifstream file;
+    if (std::filesystem::is_regular_file(path, error)) {
+        file.open(path, std::ios::binary);
+    }
+    if (!file.is_open()) {
+        throw BadCronTimeZone("Unknown time zone '" + std::string(name) +
+                              "'");
+    }
+
+    std::string data((std::istreambuf_iterator<char>(file)),
+                     std::istreambuf_iterator<char>());
+
+    std::shared_ptr<const CronTimeZone> zone(new CronTimeZone(name, data));
+    zones.emplace(std::string(name), zone);
+
+    return zone;
+}
+
+/*
+Load a zone from the contents of its zone file (RFC 8536). The 64 bit times
+from version 2 onwards are used when present. A BadCronTimeZone exception is
+thrown if the file is not a valid zone file.
+*/
+CronTimeZone::CronTimeZone(std::string_view name, const std::string& data) :
+    name_(name),
+    initial_offset_(0) {
+    const std::string invalid = "'" + name_ + "' is not a valid zone file";
+
+    if (data.size() < TIMEZONE_HEADER_SIZE ||
+        data.compare(0, 4, TIMEZONE_FILE_MAGIC) != 0) {
+        throw BadCronTimeZone(invalid);
+    }
+
+    bool hasRule = data[4] >= '2';
+    size_t header = 0;
+    size_t timeSize = 4;
+    ZoneFileCounts counts = ReadCounts(data, header);
+
+    if (hasRule) {
+        header = TIMEZONE_HEADER_SIZE + BlockSize(counts, 4);
+        if (data.size() < header + TIMEZONE_HEADER_SIZE) {
+            throw BadCronTimeZone(invalid);
+        }
+        counts = ReadCounts(data, header);
+        timeSize = 8;
+    }
+
+    size_t times = header + TIMEZONE_HEADER_SIZE;
+    size_t indices = times + counts.time_count * timeSize;
+    size_t types = indices + counts.time_count;
+    size_t blockEnd = times + BlockSize(counts, timeSize);
+
+    if (counts.type_count == 0 || data.size() < blockEnd) {
+        throw BadCronTimeZone(invalid);
+    }
+
+    auto typeOffset = [&](size_t type) {
+        return static_cast<int32_t>(ReadInteger(data, types + type * 6, 4));
+    };
+
+    initial_offset_ = typeOffset(0);
+
+    for (size_t i = 0; i < counts.time_count; i++) {
+        size_t type = static_cast<uint8_t>(data[indices + i]);
+        if (type >= counts.type_count) {
+            throw BadCronTimeZone(invalid);
+        }
+
+        transitions_.push_back(ReadInteger(data, times + i * timeSize,
+                                           timeSize));
+        offsets_.push_back(typeOffset(type));
+    }
+
+    // The footer holds the rule for times after the last transition.
+    if (hasRule && blockEnd < data.size() && data[blockEnd] == '\n') {
+        size_t end = data.find('\n', blockEnd + 1);
+        if (end == std::string::npos) {
+            throw BadCronTimeZone(invalid);
+        }
+        AddRuleTransitions(std::string_view(data).substr(
+            blockEnd + 1, end - blockEnd - 1));
+    }
+
+    for (size_t i = 0; i < transitions_.size(); i++) {
+        local_transitions_.push_back(
+            transitions_[i] + std::max(OffsetBefore(i), offsets_[i]));
+    }
+}
+
+// UTC offset, in seconds, in force at a UTC time.
+int32_t CronTimeZone::UtcOffset(int64_t utcTime) const {
+    auto next = std::upper_bound(transitions_.begin(), transitions_.end(),
+                                 utcTime);
+
+    return next == transitions_.begin() ?
+        initial_offset_ : offsets_[next - transitions_.begin() - 1];
+}
+
+/*
+Convert a local time to UTC. A local time that is repeated when the clocks go
+back is taken as its first occurrence, and one that is skipped when they go
+forward as the moment they go forward.
+*/
+int64_t CronTimeZone::UtcTime(int64_t localTime) const {
+    size_t passed = std::upper_bound(local_transitions_.begin(),
+                                     local_transitions_.end(), localTime) -
+                    local_transitions_.begin();
+    int32_t offset = passed == 0 ? initial_offset_ : offsets_[passed - 1];
+
+    if (passed < transitions_.size() && offsets_[passed] > offset &&
+        localTime >= transitions_[passed] + offset) {
+        return transitions_[passed];
+    }
+
+    return localTime - offset;
+}
+
+/*
+Latest local time that has been reached by a UTC time. This is normally its
+local time, but the second time through local times that are repeated when
+the clocks go back it is the end of the repeated times.
+*/
+int64_t CronTimeZone::LatestLocalTime(int64_t utcTime) const {
+    size_t passed = std::upper_bound(transitions_.begin(), transitions_.end(),
+                                     utcTime) - transitions_.begin();
+    if (passed == 0) {
+        return utcTime + initial_offset_;
+    }
+
+    return std::max(utcTime + offsets_[passed - 1],
+                    transitions_[passed - 1] + OffsetBefore(passed - 1) - 1);
+}
+
+int32_t CronTimeZone::OffsetBefore(size_t transition) const {
+    return transition == 0 ? initial_offset_ : offsets_[transition - 1];
+}
+
+/*
+Turn a POSIX TZ daylight saving rule, e.g. "GMT0BST,M3.5.0/1,M10.5.0", into
+transitions from the last one in the zone file up to the end of
+CRONPARSER_TIMEZONE_LAST_YEAR. A rule without daylight saving adds nothing.
+*/
+void CronTimeZone::AddRuleTransitions(std::string_view rule) {
+    const std::string invalid = "'" + name_ + "' has an invalid rule";
+    size_t position = 0;
+    int standardTime = 0;
+
+    if (rule.empty()) {
+        return;
+    }
+
+    // POSIX offsets are the time to add to get to UTC, e.g. EST5.
+    if (!ParseRuleName(rule, &position) ||
+        !ParseRuleTime(rule, &position, &standardTime)) {
+        throw BadCronTimeZone(invalid);
+    }
+    if (position == rule.size()) {
+        return;
+    }
+
+    int32_t standardOffset = -standardTime;
+    int32_t savingOffset = standardOffset + TIMEZONE_RULE_DEFAULT_SAVING;
+
+    if (!ParseRuleName(rule, &position)) {
+        throw BadCronTimeZone(invalid);
+    }
+    if (position < rule.size() && rule[position] != ',') {
+        int savingTime = 0;
+        if (!ParseRuleTime(rule, &position, &savingTime)) {
+            throw BadCronTimeZone(invalid);
+        }
+        savingOffset = -savingTime;
+    }
+
+    ZoneRuleDate start;
+    ZoneRuleDate end;
+
+    if (position == rule.size() || rule[position++] != ',' ||
+        !ParseRuleDate(rule, &position, &start) ||
+        position == rule.size() || rule[position++] != ',' ||
+        !ParseRuleDate(rule, &position, &end) || position != rule.size()) {
+        throw BadCronTimeZone(invalid);
+    }
+
+    int64_t last = transitions_.empty() ? INT64_MIN : transitions_.back();
+    int firstYear = transitions_.empty() ? 1970 :
+        YearFromDays(FloorDivide(last, CRONPARSER_SECONDS_PER_DAY));
+
+    for (int year = firstYear; year <= CRONPARSER_TIMEZONE_LAST_YEAR;
+         year++) {
+        // The start is given in standard time and the end in saving time.
+        int64_t savingStart = RuleDateDay(start, year) *
+            CRONPARSER_SECONDS_PER_DAY + start.time - standardOffset;
+        int64_t savingEnd = RuleDateDay(end, year) *
+            CRONPARSER_SECONDS_PER_DAY + end.time - savingOffset;
+
+        std::pair<int64_t, int32_t> changes[] = {
+            { savingStart, savingOffset },
+            { savingEnd, standardOffset }
+        };
+        if (savingEnd < savingStart) {
+            std::swap(changes[0], changes[1]);
+        }
+
+        for (const auto& change : changes) {
+            if (change.first > last) {
+                transitions_.push_back(change.first);
+                offsets_.push_back(change.second);
+                last = change.first;
+            }
+        }
+    }
+}
+
+}  // namespace cronparser
+}  // namespace duplitrace
@@ -0,0 +1,92 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#ifndef CRONTIMEZONE_H_
+#define CRONTIMEZONE_H_
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace duplitrace { namespace cronparser {
+
+// Directory the IANA time zone files are read from, unless TZDIR is set.
+constexpr char CRONPARSER_TIMEZONE_DIRECTORY[] = "/usr/share/zoneinfo";
+
+/*
+ Daylight saving rules that continue after a zone file's last transition are
+ turned into transitions up to the end of this year, after which the last
+ offset is used.
+*/
+const int CRONPARSER_TIMEZONE_LAST_YEAR = 2400;
+
+class BadCronTimeZone : public std::runtime_error {
+ public:
+    explicit BadCronTimeZone(const std::string& msg) :
+        std::runtime_error(msg) {
+    }
+};
+
+/*
+An IANA time zone (e.g. "Europe/London") for evaluating cron expressions,
+loaded from the tzdata files once and then shared. Converting between UTC
+and local time is a binary search of the zone's transitions, so unlike
+localtime_r() and mktime() it does not depend on the process' TZ setting or
+take a lock inside the C library.
+
+Times are in seconds, local times count from 1970-01-01 00:00:00 local time.
+Leap seconds are ignored, as they are by time_t.
+*/
+class CronTimeZone {
+ public:
+    static std::shared_ptr<const CronTimeZone> Find(std::string_view name);
+
+    const std::string& Name() const { return name_; }
+
+    int32_t UtcOffset(int64_t utcTime) const;
+
+    int64_t UtcTime(int64_t localTime) const;
+
+    int64_t LatestLocalTime(int64_t utcTime) const;
+
+ private:
+    std::string name_;
+
+    // UTC time of each transition and the UTC offset from it on.
+    std::vector<int64_t> transitions_;
+    std::vector<int32_t> offsets_;
+    int32_t initial_offset_;
+
+    // Local time at which each transition is over, i.e. after any repeated
+    // or skipped local times.
+    std::vector<int64_t> local_transitions_;
+
+    CronTimeZone(std::string_view name, const std::string& data);
+
+    int32_t OffsetBefore(size_t transition) const;
+
+    void AddRuleTransitions(std::string_view rule);
+};
+
+}  // namespace cronparser
+}  // namespace duplitrace
+
+#endif  // CRONTIMEZONE_H_
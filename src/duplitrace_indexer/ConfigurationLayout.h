@@ -20,12 +20,26 @@ Copyright 2024 DupliTrace Development Team
 #ifndef CONFIGURATIONLAYOUT_H_
 #define CONFIGURATIONLAYOUT_H_
 #include "ConfigSetup.h"
+#include "CrawlerSettings.h"
+#include "DetectionSettings.h"
+#include "HashCacheSettings.h"
+#include "IndexSettings.h"
+#include "IoSettings.h"
 #include "LoggerSettings.h"
+#include "MetricsSettings.h"
+#include "WatchSettings.h"
 
 namespace duplitrace { namespace indexer {
 
 common::SectionsMap CONFIGURATION_LAYOUT_MAP = {
-    { LOGGING_SECTION, LoggerSettings }
+    { LOGGING_SECTION, LoggerSettings },
+    { CRAWLER_SECTION, CrawlerSettings },
+    { DETECTION_SECTION, DetectionSettings },
+    { IO_SECTION, IoSettings },
+    { HASH_CACHE_SECTION, HashCacheSettings },
+    { INDEX_SECTION, IndexSettings },
+    { WATCH_SECTION, WatchSettings },
+    { METRICS_SECTION, MetricsSettings }
 };
 
 }   // namespace indexer
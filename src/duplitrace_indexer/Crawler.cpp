@@ -0,0 +1,567 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <thread>
+#include <utility>
+#include "Crawler.h"
+#include "Platform.h"
+
+#if DUPLITRACE_PLATFORM == DUPLITRACE_PLATFORM_LINUX
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#include <filesystem>
+#include <system_error>
+#endif
+
+namespace duplitrace { namespace indexer {
+
+// Size of the per-thread buffer that directory entries are read into.
+const size_t CRAWLER_DIRECTORY_BUFFER_SIZE = 64 * 1024;
+
+// Number of times an idle thread yields before it starts to sleep between
+// attempts at stealing work.
+const unsigned CRAWLER_IDLE_SPIN_COUNT = 64;
+
+const auto CRAWLER_IDLE_SLEEP = std::chrono::microseconds(100);
+
+#if DUPLITRACE_PLATFORM == DUPLITRACE_PLATFORM_LINUX
+
+const int CRAWLER_OPEN_FLAGS = O_RDONLY | O_DIRECTORY | O_CLOEXEC;
+
+// File descriptors left for everything other than directories kept open,
+// e.g. files being hashed, as a fraction of the open file limit and at least
+// this many.
+const rlim_t CRAWLER_RESERVED_DESCRIPTORS_DIVISOR = 4;
+const rlim_t CRAWLER_MINIMUM_RESERVED_DESCRIPTORS = 64;
+
+// Used if the open file limit cannot be read or is unlimited.
+const size_t CRAWLER_UNLIMITED_OPEN_DIRECTORIES = 65536;
+
+// Times a directory is opened by path again when the process is out of file
+// descriptors, waiting for directories kept open to be closed in between.
+const unsigned CRAWLER_OPEN_RETRY_COUNT = 100;
+
+// Record layout returned by the getdents64 system call.
+struct LinuxDirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;    // NOLINT(runtime/int)
+    unsigned char d_type;
+    char d_name[1];
+};
+
+static int64_t TimespecToNanoseconds(const struct timespec& time) {
+    return static_cast<int64_t>(time.tv_sec) * 1000000000LL + time.tv_nsec;
+}
+
+/*
+Number of directories that may be kept open, the configured maximum if one
+is given, but never more than the open file limit leaves after a reserve.
+
+returns:
+    The limit, 0 if no directory should be kept open.
+*/
+static size_t OpenDirectoryLimit(size_t configured) {
+    size_t available = CRAWLER_UNLIMITED_OPEN_DIRECTORIES;
+    struct rlimit limit;
+
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 &&
+        limit.rlim_cur != RLIM_INFINITY) {
+        rlim_t reserved = std::max(
+            limit.rlim_cur / CRAWLER_RESERVED_DESCRIPTORS_DIVISOR,
+            CRAWLER_MINIMUM_RESERVED_DESCRIPTORS);
+        available = limit.rlim_cur > reserved ?
+            static_cast<size_t>(limit.rlim_cur - reserved) : 0;
+    }
+
+    return configured ? std::min(configured, available) : available;
+}
+
+#else
+
+static size_t OpenDirectoryLimit(size_t configured) {
+    return configured;
+}
+
+#endif
+
+DirectoryNode::DirectoryNode(std::shared_ptr<DirectoryNode> parent,
+                             uint32_t id, bool recursive) :
+    parent_(std::move(parent)),
+    id_(id),
+    recursive_(recursive),
+    fd_(-1),
+    unopened_children_(0) {
+}
+
+DirectoryNode::~DirectoryNode() {
+#if DUPLITRACE_PLATFORM == DUPLITRACE_PLATFORM_LINUX
+    // Only happens if a crawl was stopped before all children were opened.
+    if (fd_ != -1) {
+        close(fd_);
+    }
+#endif
+}
+
+Crawler::Crawler(size_t threadCount, size_t maxOpenDirectories,
+                 common::PathStore* paths, common::InodeSet* inodes) :
+    thread_count_(threadCount ? threadCount : 1),
+    max_open_directories_(OpenDirectoryLimit(maxOpenDirectories)),
+    open_directory_limit_(max_open_directories_),
+    paths_(paths),
+    inodes_(inodes),
+    outstanding_directories_(0),
+    open_directories_(0),
+    visitor_(nullptr),
+    stop_requested_(nullptr) {
+}
+
+/*
+Crawl one or more directory trees, calling the visitor for every regular file
+found. Symbolic links are not followed. The crawl can be abandoned early by
+the optional stop check returning true.
+
+returns:
+    Statistics for the crawl.
+*/
+CrawlerStatistics Crawler::Crawl(const std::vector<std::string>& rootPaths,
+                                 const CrawlerFileVisitor& visitor,
+                                 const CrawlerStopCheck& stopRequested) {
+    std::vector<CrawlerDirectory> roots;
+
+    for (const auto& path : rootPaths) {
+        roots.push_back({ paths_->AddDirectory(
+                              common::PATH_STORE_NO_DIRECTORY, path),
+                          true });
+    }
+
+    return Crawl(roots, visitor, stopRequested);
+}
+
+/*
+Crawl directories that are already in the path store, either just the files
+directly in each directory or (if recursive) the whole tree below it.
+
+returns:
+    Statistics for the crawl.
+*/
+CrawlerStatistics Crawler::Crawl(
+        const std::vector<CrawlerDirectory>& directories,
+        const CrawlerFileVisitor& visitor,
+        const CrawlerStopCheck& stopRequested) {
+    visitor_ = &visitor;
+    stop_requested_ = &stopRequested;
+    outstanding_directories_ = 0;
+    open_directories_ = 0;
+    open_directory_limit_ = max_open_directories_;
+
+    queues_.clear();
+    for (size_t i = 0; i < thread_count_; i++) {
+        queues_.push_back(std::make_unique<WorkQueue>());
+    }
+
+    for (size_t i = 0; i < directories.size(); i++) {
+        PushDirectory(i % thread_count_,
+                      std::make_shared<DirectoryNode>(
+                          nullptr, directories[i].id,
+                          directories[i].recursive));
+    }
+
+    std::vector<ThreadContext> contexts(thread_count_);
+    std::vector<std::thread> threads;
+
+    for (size_t i = 0; i < thread_count_; i++) {
+        contexts[i].thread_id = i;
+        contexts[i].buffer.resize(CRAWLER_DIRECTORY_BUFFER_SIZE);
+        threads.emplace_back(&Crawler::CrawlThread, this, &contexts[i]);
+    }
+
+    CrawlerStatistics statistics;
+
+    for (size_t i = 0; i < thread_count_; i++) {
+        threads[i].join();
+
+        statistics.directories += contexts[i].statistics.directories;
+        statistics.files += contexts[i].statistics.files;
+        statistics.bytes += contexts[i].statistics.bytes;
+        statistics.errors += contexts[i].statistics.errors;
+        statistics.links += contexts[i].statistics.links;
+    }
+
+    queues_.clear();
+    return statistics;
+}
+
+void Crawler::CrawlThread(ThreadContext* context) {
+    unsigned idleCount = 0;
+
+    while (true) {
+        DirectoryNodePtr directory = NextDirectory(context->thread_id);
+
+        if (directory) {
+            ProcessDirectory(context, directory);
+
+            // Children have already been counted, so this can only reach
+            // zero once the whole tree has been processed.
+            outstanding_directories_--;
+            idleCount = 0;
+            continue;
+        }
+
+        if (outstanding_directories_ == 0) {
+            return;
+        }
+
+        if (++idleCount < CRAWLER_IDLE_SPIN_COUNT) {
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(CRAWLER_IDLE_SLEEP);
+        }
+    }
+}
+
+/*
+Take the newest directory from the thread's own deque, otherwise steal the
+oldest directory from another thread.
+*/
+DirectoryNodePtr Crawler::NextDirectory(size_t threadId) {
+    {
+        WorkQueue& own = *queues_[threadId];
+        std::lock_guard<std::mutex> lock(own.mutex);
+
+        if (!own.directories.empty()) {
+            DirectoryNodePtr directory = std::move(own.directories.back());
+            own.directories.pop_back();
+            return directory;
+        }
+    }
+
+    for (size_t i = 1; i < thread_count_; i++) {
+        WorkQueue& victim = *queues_[(threadId + i) % thread_count_];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+
+        if (!victim.directories.empty()) {
+            DirectoryNodePtr directory = std::move(victim.directories.front());
+            victim.directories.pop_front();
+            return directory;
+        }
+    }
+
+    return nullptr;
+}
+
+void Crawler::PushDirectory(size_t threadId, DirectoryNodePtr directory) {
+    outstanding_directories_++;
+
+    WorkQueue& queue = *queues_[threadId];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.directories.push_back(std::move(directory));
+}
+
+/*
+Count a file and pass it to the visitor. Only the first link found to an
+inode adds to the byte count, so that hard links are not counted twice.
+*/
+void Crawler::VisitFile(ThreadContext* context, CrawlerFileEntry* file) {
+    if (inodes_ && file->link_count > 1 && file->inode) {
+        file->first_link = inodes_->Insert(file->device, file->inode);
+    }
+
+    context->statistics.files++;
+    if (file->first_link) {
+        context->statistics.bytes += file->size;
+    } else {
+        context->statistics.links++;
+    }
+
+    (*visitor_)(*file);
+}
+
+#if DUPLITRACE_PLATFORM == DUPLITRACE_PLATFORM_LINUX
+
+void Crawler::ProcessDirectory(ThreadContext* context,
+                               const DirectoryNodePtr& directory) {
+    if (*stop_requested_ && (*stop_requested_)()) {
+        ReleaseParent(directory);
+        return;
+    }
+
+    int fd = OpenDirectory(directory);
+    int openError = errno;
+
+    // A directory that has gone is not an error, it may have been deleted
+    // since it was found (or since it was marked as changed).
+    if (fd == -1) {
+        if (openError != ENOENT) {
+            context->statistics.errors++;
+        }
+        return;
+    }
+
+    context->statistics.directories++;
+
+    std::vector<uint32_t> subdirectories;
+    char* buffer = context->buffer.data();
+
+    while (true) {
+        long bytesRead = syscall(SYS_getdents64, fd, buffer,   // NOLINT
+                                 context->buffer.size());
+        if (bytesRead <= 0) {
+            if (bytesRead < 0) {
+                context->statistics.errors++;
+            }
+            break;
+        }
+
+        for (long offset = 0; offset < bytesRead;) {    // NOLINT
+            auto entry = reinterpret_cast<LinuxDirent64*>(buffer + offset);
+            offset += entry->d_reclen;
+
+            const char* name = entry->d_name;
+            if (name[0] == '.' &&
+                (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+                continue;
+            }
+
+            if (entry->d_type == DT_DIR) {
+                if (directory->recursive_) {
+                    subdirectories.push_back(
+                        paths_->AddDirectory(directory->id_, name));
+                }
+                continue;
+            }
+
+            // The file system may not report the type, in which case the
+            // stat below decides.
+            if (entry->d_type != DT_REG && entry->d_type != DT_UNKNOWN) {
+                continue;
+            }
+
+            struct stat status;
+            if (fstatat(fd, name, &status, AT_SYMLINK_NOFOLLOW) != 0) {
+                context->statistics.errors++;
+                continue;
+            }
+
+            if (S_ISDIR(status.st_mode)) {
+                if (directory->recursive_) {
+                    subdirectories.push_back(
+                        paths_->AddDirectory(directory->id_, name));
+                }
+                continue;
+            }
+
+            if (!S_ISREG(status.st_mode)) {
+                continue;
+            }
+
+            CrawlerFileEntry file {
+                directory->id_,
+                paths_->InternName(name),
+                static_cast<uint64_t>(status.st_dev),
+                static_cast<uint64_t>(status.st_ino),
+                static_cast<uint64_t>(status.st_size),
+                TimespecToNanoseconds(status.st_mtim),
+                TimespecToNanoseconds(status.st_ctim),
+                static_cast<uint64_t>(status.st_nlink),
+                true
+            };
+
+            VisitFile(context, &file);
+        }
+    }
+
+    // Keep the directory open for its children to be opened relative to it,
+    // unless too many directories are already open, in which case they fall
+    // back to opening by path.
+    if (!subdirectories.empty() &&
+        open_directories_ <= open_directory_limit_) {
+        directory->unopened_children_ = subdirectories.size();
+        directory->fd_ = fd;
+    } else {
+        CloseDirectory(fd);
+    }
+
+    for (uint32_t id : subdirectories) {
+        PushDirectory(context->thread_id,
+                      std::make_shared<DirectoryNode>(directory, id, true));
+    }
+}
+
+/*
+Open a directory, relative to its parent if the parent is still open, and
+release the directory's hold on the parent. If the process is out of file
+descriptors the hold is released first, no more directories are kept open
+for the rest of the crawl than are open now and the directory is opened by
+path instead, waiting for the directories still open to be closed.
+
+returns:
+    The directory's descriptor, or -1 with errno set.
+*/
+int Crawler::OpenDirectory(const DirectoryNodePtr& directory) {
+    const DirectoryNodePtr& parent = directory->parent_;
+    int fd;
+
+    if (!parent) {
+        fd = open(paths_->DirectoryPath(directory->id_).c_str(),
+                  CRAWLER_OPEN_FLAGS);
+    } else if (parent->fd_ != -1) {
+        // Names in the store are null terminated.
+        const char* name =
+            paths_->Name(paths_->DirectoryName(directory->id_)).data();
+        fd = openat(parent->fd_, name, CRAWLER_OPEN_FLAGS | O_NOFOLLOW);
+    } else {
+        fd = open(paths_->DirectoryPath(directory->id_).c_str(),
+                  CRAWLER_OPEN_FLAGS | O_NOFOLLOW);
+    }
+    int openError = errno;
+
+    ReleaseParent(directory);
+
+    if (fd == -1 && (openError == EMFILE || openError == ENFILE)) {
+        size_t openNow = open_directories_;
+        size_t limit = open_directory_limit_;
+        while (openNow < limit &&
+               !open_directory_limit_.compare_exchange_weak(limit, openNow)) {
+        }
+
+        std::string path = paths_->DirectoryPath(directory->id_);
+        int flags = parent ? CRAWLER_OPEN_FLAGS | O_NOFOLLOW :
+                             CRAWLER_OPEN_FLAGS;
+
+        for (unsigned attempt = 0; attempt < CRAWLER_OPEN_RETRY_COUNT;
+             attempt++) {
+            fd = open(path.c_str(), flags);
+            openError = errno;
+
+            if (fd != -1 || (openError != EMFILE && openError != ENFILE)) {
+                break;
+            }
+            std::this_thread::sleep_for(CRAWLER_IDLE_SLEEP);
+        }
+    }
+
+    if (fd != -1) {
+        open_directories_++;
+    }
+
+    errno = openError;
+    return fd;
+}
+
+void Crawler::CloseDirectory(int fd) {
+    close(fd);
+    open_directories_--;
+}
+
+// Once every child of a directory has been opened its descriptor is closed.
+void Crawler::ReleaseParent(const DirectoryNodePtr& directory) {
+    const DirectoryNodePtr& parent = directory->parent_;
+
+    if (!parent || parent->fd_ == -1) {
+        return;
+    }
+
+    if (parent->unopened_children_.fetch_sub(1) == 1) {
+        CloseDirectory(parent->fd_.exchange(-1));
+    }
+}
+
+#else
+
+void Crawler::ProcessDirectory(ThreadContext* context,
+                               const DirectoryNodePtr& directory) {
+    if (*stop_requested_ && (*stop_requested_)()) {
+        return;
+    }
+
+    std::error_code error;
+    std::filesystem::directory_iterator entries(
+        paths_->DirectoryPath(directory->id_), error);
+    if (error) {
+        context->statistics.errors++;
+        return;
+    }
+
+    context->statistics.directories++;
+
+    for (const auto& entry : entries) {
+        if (entry.is_symlink(error)) {
+            continue;
+        }
+
+        std::string name = entry.path().filename().string();
+
+        if (entry.is_directory(error)) {
+            if (directory->recursive_) {
+                uint32_t id = paths_->AddDirectory(directory->id_, name);
+                PushDirectory(context->thread_id,
+                              std::make_shared<DirectoryNode>(directory, id,
+                                                              true));
+            }
+            continue;
+        }
+
+        if (!entry.is_regular_file(error)) {
+            continue;
+        }
+
+        auto modified = entry.last_write_time(error).time_since_epoch();
+        CrawlerFileEntry file {
+            directory->id_,
+            paths_->InternName(name),
+            0,
+            0,
+            static_cast<uint64_t>(entry.file_size(error)),
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                modified).count(),
+            0,
+            static_cast<uint64_t>(entry.hard_link_count(error)),
+            true
+        };
+
+        VisitFile(context, &file);
+    }
+}
+
+int Crawler::OpenDirectory(const DirectoryNodePtr& directory) {
+    (void)directory;
+    return -1;
+}
+
+void Crawler::CloseDirectory(int fd) {
+    (void)fd;
+}
+
+void Crawler::ReleaseParent(const DirectoryNodePtr& directory) {
+    (void)directory;
+}
+
+#endif
+
+}   // namespace indexer
+}   // namespace duplitrace
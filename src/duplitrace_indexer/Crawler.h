@@ -0,0 +1,177 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#ifndef CRAWLER_H_
+#define CRAWLER_H_
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "InodeSet.h"
+#include "PathStore.h"
+
+namespace duplitrace { namespace indexer {
+
+/*
+A directory waiting to be crawled. Its name and place in the tree are kept in
+the crawl's path store, the node only lives while the crawl needs it. While it
+still has subdirectories waiting to be opened the directory may keep its file
+descriptor open so that they can be opened relative to it.
+*/
+class DirectoryNode {
+ public:
+    DirectoryNode(std::shared_ptr<DirectoryNode> parent, uint32_t id,
+                  bool recursive);
+
+    ~DirectoryNode();
+
+    const std::shared_ptr<DirectoryNode>& Parent() const { return parent_; }
+
+    // Id of the directory in the path store.
+    uint32_t Id() const { return id_; }
+
+ private:
+    friend class Crawler;
+
+    std::shared_ptr<DirectoryNode> parent_;
+    uint32_t id_;
+    bool recursive_;
+    std::atomic<int> fd_;
+    std::atomic<size_t> unopened_children_;
+};
+
+using DirectoryNodePtr = std::shared_ptr<DirectoryNode>;
+
+// A regular file found by the crawler, the directory and name are ids in the
+// crawl's path store.
+struct CrawlerFileEntry {
+    uint32_t directory;
+    uint32_t name;
+    uint64_t device;
+    uint64_t inode;
+    uint64_t size;
+    int64_t modified_time_ns;
+    int64_t changed_time_ns;
+    uint64_t link_count;
+
+    // False for the second and later links to an inode already found in
+    // this crawl, their contents are the same as the first link's.
+    bool first_link;
+};
+
+// A directory already in the path store, to be crawled on its own or with
+// everything below it.
+struct CrawlerDirectory {
+    uint32_t id;
+    bool recursive;
+};
+
+struct CrawlerStatistics {
+    uint64_t directories = 0;
+    uint64_t files = 0;
+    uint64_t bytes = 0;
+    uint64_t errors = 0;
+
+    // Files that were a further hard link to an inode already found.
+    uint64_t links = 0;
+};
+
+// Called from the crawler threads, so it must be thread safe.
+using CrawlerFileVisitor = std::function<void(const CrawlerFileEntry&)>;
+using CrawlerStopCheck = std::function<bool()>;
+
+/*
+Parallel directory crawler. Each thread owns a deque of directories, it works
+depth first from the back of its own deque and when it runs dry it steals the
+oldest (and usually largest) directory from the front of another thread's
+deque. On Linux directories are read with getdents64() and entries are
+stat'ed with fstatat() relative to the directory's file descriptor, so no
+path is built per entry. Every directory and file name found is interned in
+the path store, which must outlive the crawl. Directories already in the
+store can be crawled again on their own, to pick up changes to them. Files
+with more than one hard link are looked up in the inode set, if one is given,
+so that every link after the first can be told apart.
+*/
+class Crawler {
+ public:
+    Crawler(size_t threadCount, size_t maxOpenDirectories,
+            common::PathStore* paths, common::InodeSet* inodes = nullptr);
+
+    size_t MaxOpenDirectories() const { return max_open_directories_; }
+
+    CrawlerStatistics Crawl(const std::vector<std::string>& rootPaths,
+                            const CrawlerFileVisitor& visitor,
+                            const CrawlerStopCheck& stopRequested = nullptr);
+
+    CrawlerStatistics Crawl(const std::vector<CrawlerDirectory>& directories,
+                            const CrawlerFileVisitor& visitor,
+                            const CrawlerStopCheck& stopRequested = nullptr);
+
+ private:
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<DirectoryNodePtr> directories;
+    };
+
+    struct ThreadContext {
+        size_t thread_id;
+        std::vector<char> buffer;
+        CrawlerStatistics statistics;
+    };
+
+    size_t thread_count_;
+    size_t max_open_directories_;
+
+    // Lowered from the maximum for the rest of a crawl if the process runs
+    // out of file descriptors.
+    std::atomic<size_t> open_directory_limit_;
+    common::PathStore* paths_;
+    common::InodeSet* inodes_;
+    std::vector<std::unique_ptr<WorkQueue>> queues_;
+    std::atomic<size_t> outstanding_directories_;
+    std::atomic<size_t> open_directories_;
+    const CrawlerFileVisitor* visitor_;
+    const CrawlerStopCheck* stop_requested_;
+
+    void CrawlThread(ThreadContext* context);
+
+    DirectoryNodePtr NextDirectory(size_t threadId);
+
+    void PushDirectory(size_t threadId, DirectoryNodePtr directory);
+
+    void ProcessDirectory(ThreadContext* context,
+                          const DirectoryNodePtr& directory);
+
+    int OpenDirectory(const DirectoryNodePtr& directory);
+
+    void CloseDirectory(int fd);
+
+    void ReleaseParent(const DirectoryNodePtr& directory);
+
+    void VisitFile(ThreadContext* context, CrawlerFileEntry* file);
+};
+
+}   // namespace indexer
+}   // namespace duplitrace
+
+#endif  // CRAWLER_H_
@@ -0,0 +1,103 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#ifndef CRAWLERSETTINGS_H_
+#define CRAWLERSETTINGS_H_
+#include <string>
+#include "ConfigSetup.h"
+#include "ConfigSetupItem.h"
+
+namespace duplitrace { namespace indexer {
+
+constexpr char CRAWLER_SECTION[] = "crawler";
+
+constexpr char CRAWLER_THREAD_COUNT[] = "thread_count";
+const int CRAWLER_THREAD_COUNT_DEFAULT = 8;
+
+// Most directories kept open for their children to be opened relative to,
+// 0 derives it from the process' open file limit.
+constexpr char CRAWLER_MAX_OPEN_DIRECTORIES[] = "max_open_directories";
+const int CRAWLER_MAX_OPEN_DIRECTORIES_DEFAULT = 0;
+
+// Comma separated list of the directory trees that are scanned.
+constexpr char CRAWLER_SCAN_PATHS[] = "scan_paths";
+
+// Cron expression for when the scan paths are scanned.
+constexpr char CRAWLER_SCAN_SCHEDULE[] = "scan_schedule";
+constexpr char CRAWLER_SCAN_SCHEDULE_DEFAULT[] = "0 0 3 * * *";
+
+// IANA time zone (e.g. "Europe/London") the scan and update schedules are
+// evaluated in, the system's local time is used if it is empty.
+constexpr char CRAWLER_SCHEDULE_TIME_ZONE[] = "schedule_time_zone";
+
+const common::SectionList CrawlerSettings = {
+    {
+        CRAWLER_THREAD_COUNT,
+        common::ConfigSetupItem(CRAWLER_THREAD_COUNT,
+                                common::CONFIG_ITEM_TYPE_INTEGER)
+                .DefaultValue(CRAWLER_THREAD_COUNT_DEFAULT)
+    },
+    {
+        CRAWLER_MAX_OPEN_DIRECTORIES,
+        common::ConfigSetupItem(CRAWLER_MAX_OPEN_DIRECTORIES,
+                                common::CONFIG_ITEM_TYPE_INTEGER)
+                .DefaultValue(CRAWLER_MAX_OPEN_DIRECTORIES_DEFAULT)
+    },
+    {
+        CRAWLER_SCAN_PATHS,
+        common::ConfigSetupItem(CRAWLER_SCAN_PATHS,
+                                common::CONFIG_ITEM_TYPE_STRING)
+                .RestartRequired(true)
+                .DefaultValue("")
+    },
+    {
+        CRAWLER_SCAN_SCHEDULE,
+        common::ConfigSetupItem(CRAWLER_SCAN_SCHEDULE,
+                                common::CONFIG_ITEM_TYPE_STRING)
+                .RestartRequired(true)
+                .DefaultValue(CRAWLER_SCAN_SCHEDULE_DEFAULT)
+    },
+    {
+        CRAWLER_SCHEDULE_TIME_ZONE,
+        common::ConfigSetupItem(CRAWLER_SCHEDULE_TIME_ZONE,
+                                common::CONFIG_ITEM_TYPE_STRING)
+                .RestartRequired(true)
+                .DefaultValue("")
+    }
+};
+
+#define GET_CRAWLER_THREAD_COUNT config_manager_.Current().Int(\
+            CONFIG_KEY(CRAWLER_SECTION, CRAWLER_THREAD_COUNT))
+
+#define GET_CRAWLER_MAX_OPEN_DIRECTORIES config_manager_.Current().Int(\
+            CONFIG_KEY(CRAWLER_SECTION, CRAWLER_MAX_OPEN_DIRECTORIES))
+
+#define GET_CRAWLER_SCAN_PATHS config_manager_.Current().String(\
+            CONFIG_KEY(CRAWLER_SECTION, CRAWLER_SCAN_PATHS))
+
+#define GET_CRAWLER_SCAN_SCHEDULE config_manager_.Current().String(\
+            CONFIG_KEY(CRAWLER_SECTION, CRAWLER_SCAN_SCHEDULE))
+
+#define GET_CRAWLER_SCHEDULE_TIME_ZONE config_manager_.Current().String(\
+            CONFIG_KEY(CRAWLER_SECTION, CRAWLER_SCHEDULE_TIME_ZONE))
+
+}   // namespace indexer
+}   // namespace duplitrace
+
+#endif  // CRAWLERSETTINGS_H_
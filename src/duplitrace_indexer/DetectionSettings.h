@@ -0,0 +1,108 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#ifndef DETECTIONSETTINGS_H_
+#define DETECTIONSETTINGS_H_
+#include <string>
+#include "ConfigSetup.h"
+#include "ConfigSetupItem.h"
+
+namespace duplitrace { namespace indexer {
+
+constexpr char DETECTION_SECTION[] = "detection";
+
+constexpr char DETECTION_HASH_THREAD_COUNT[] = "hash_thread_count";
+const int DETECTION_HASH_THREAD_COUNT_DEFAULT = 4;
+
+constexpr char DETECTION_SAMPLE_SIZE[] = "sample_size";
+const int DETECTION_SAMPLE_SIZE_DEFAULT = 4096;
+
+constexpr char DETECTION_HASH_ALGORITHM[] = "hash_algorithm";
+constexpr char DETECTION_HASH_ALGORITHM_XXH3[] = "XXH3";
+constexpr char DETECTION_HASH_ALGORITHM_BLAKE3[] = "BLAKE3";
+
+constexpr char DETECTION_VERIFY_CONTENTS[] = "verify_contents";
+constexpr char DETECTION_VERIFY_CONTENTS_YES[] = "YES";
+constexpr char DETECTION_VERIFY_CONTENTS_NO[] = "NO";
+
+constexpr char DETECTION_SHARED_EXTENTS[] = "shared_extents";
+constexpr char DETECTION_SHARED_EXTENTS_YES[] = "YES";
+constexpr char DETECTION_SHARED_EXTENTS_NO[] = "NO";
+
+const common::SectionList DetectionSettings = {
+    {
+        DETECTION_HASH_THREAD_COUNT,
+        common::ConfigSetupItem(DETECTION_HASH_THREAD_COUNT,
+                                common::CONFIG_ITEM_TYPE_INTEGER)
+                .DefaultValue(DETECTION_HASH_THREAD_COUNT_DEFAULT)
+    },
+    {
+        DETECTION_SAMPLE_SIZE,
+        common::ConfigSetupItem(DETECTION_SAMPLE_SIZE,
+                                common::CONFIG_ITEM_TYPE_INTEGER)
+                .DefaultValue(DETECTION_SAMPLE_SIZE_DEFAULT)
+    },
+    {
+        DETECTION_HASH_ALGORITHM,
+        common::ConfigSetupItem(DETECTION_HASH_ALGORITHM,
+                                common::CONFIG_ITEM_TYPE_STRING)
+                .DefaultValue(DETECTION_HASH_ALGORITHM_BLAKE3)
+                .ValidValues(common::StringList{
+                    DETECTION_HASH_ALGORITHM_XXH3,
+                    DETECTION_HASH_ALGORITHM_BLAKE3 })
+    },
+    {
+        DETECTION_VERIFY_CONTENTS,
+        common::ConfigSetupItem(DETECTION_VERIFY_CONTENTS,
+                                common::CONFIG_ITEM_TYPE_STRING)
+                .DefaultValue(DETECTION_VERIFY_CONTENTS_NO)
+                .ValidValues(common::StringList{
+                    DETECTION_VERIFY_CONTENTS_YES,
+                    DETECTION_VERIFY_CONTENTS_NO })
+    },
+    {
+        DETECTION_SHARED_EXTENTS,
+        common::ConfigSetupItem(DETECTION_SHARED_EXTENTS,
+                                common::CONFIG_ITEM_TYPE_STRING)
+                .DefaultValue(DETECTION_SHARED_EXTENTS_YES)
+                .ValidValues(common::StringList{
+                    DETECTION_SHARED_EXTENTS_YES,
+                    DETECTION_SHARED_EXTENTS_NO })
+    }
+};
+
+#define GET_DETECTION_HASH_THREAD_COUNT config_manager_.Current().Int(\
+            CONFIG_KEY(DETECTION_SECTION, DETECTION_HASH_THREAD_COUNT))
+
+#define GET_DETECTION_SAMPLE_SIZE config_manager_.Current().Int(\
+            CONFIG_KEY(DETECTION_SECTION, DETECTION_SAMPLE_SIZE))
+
+#define GET_DETECTION_HASH_ALGORITHM config_manager_.Current().String(\
+            CONFIG_KEY(DETECTION_SECTION, DETECTION_HASH_ALGORITHM))
+
+#define GET_DETECTION_VERIFY_CONTENTS config_manager_.Current().String(\
+            CONFIG_KEY(DETECTION_SECTION, DETECTION_VERIFY_CONTENTS))
+
+#define GET_DETECTION_SHARED_EXTENTS config_manager_.Current().String(\
+            CONFIG_KEY(DETECTION_SECTION, DETECTION_SHARED_EXTENTS))
+
+}   // namespace indexer
+}   // namespace duplitrace
+
+#endif  // DETECTIONSETTINGS_H_
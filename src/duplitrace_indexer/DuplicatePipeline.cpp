@@ -0,0 +1,568 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <utility>
+#include "DuplicatePipeline.h"
+#include "Logger.h"
+#include "io/SharedExtents.h"
+
+namespace duplitrace { namespace indexer {
+
+// Number of shards the size buckets are spread over, so that crawler threads
+// adding files rarely contend on the same lock.
+const size_t PIPELINE_SIZE_SHARD_COUNT = 64;
+
+// Size of the buffers used when comparing files byte for byte.
+const size_t PIPELINE_READ_BUFFER_SIZE = 256 * 1024;
+
+// Closes the file when it goes out of scope.
+class ScopedFile {
+ public:
+    explicit ScopedFile(const std::string& path) :
+        file_(std::fopen(path.c_str(), "rb")) {
+    }
+
+    ~ScopedFile() {
+        if (file_) {
+            std::fclose(file_);
+        }
+    }
+
+    std::FILE* Get() const { return file_; }
+
+ private:
+    std::FILE* file_;
+};
+
+std::string DuplicateCandidate::Path(const common::PathStore& paths) const {
+    return paths.FilePath(directory, name);
+}
+
+HashCacheKey DuplicateCandidate::CacheKey() const {
+    return { device, inode, size, modified_time_ns, changed_time_ns };
+}
+
+DuplicatePipeline::DuplicatePipeline(
+        const DuplicatePipelineSettings& settings) :
+    settings_(settings),
+    sample_queue_(settings.queue_capacity),
+    hash_queue_(settings.queue_capacity),
+    verify_queue_(settings.queue_capacity),
+    stop_requested_(nullptr),
+    candidate_files_(0),
+    files_sampled_(0),
+    files_fully_hashed_(0),
+    files_from_cache_(0),
+    files_verified_(0),
+    files_shared_extents_(0),
+    bytes_read_(0),
+    read_errors_(0) {
+    for (size_t i = 0; i < PIPELINE_SIZE_SHARD_COUNT; i++) {
+        size_shards_.push_back(std::make_unique<SizeShard>());
+    }
+}
+
+/*
+Stage 1: add a file to its size bucket, safe to call from multiple threads
+(e.g. from a crawler visitor). Empty files are ignored.
+*/
+void DuplicatePipeline::AddFile(DuplicateCandidate file) {
+    if (file.size == 0) {
+        return;
+    }
+
+    SizeShard& shard = *size_shards_[file.size % PIPELINE_SIZE_SHARD_COUNT];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.files[file.size].push_back(std::move(file));
+    candidate_files_++;
+}
+
+/*
+Run the added files through the detection stages.
+
+returns:
+    Groups of files with identical contents.
+*/
+std::vector<DuplicateGroup> DuplicatePipeline::Run(
+        const DuplicatePipelineStopCheck& stopRequested) {
+    stop_requested_ = &stopRequested;
+
+    BucketQueue* hashOutput =
+        settings_.verify_contents ? &verify_queue_ : nullptr;
+
+    // Samples are small, so the sample readers use smaller buffers.
+    size_t sampleBlockSize = std::min(settings_.reader.block_size,
+                                      2 * settings_.sample_size);
+
+    StartStage(settings_.sample_thread_count, &sample_queue_, &hash_queue_,
+               sampleBlockSize,
+               [this](std::vector<CandidateBucket>& batch,
+                      common::io::FileReader* reader) {
+                   SampleBuckets(batch, reader, &hash_queue_);
+               });
+    StartStage(settings_.hash_thread_count, &hash_queue_, hashOutput,
+               settings_.reader.block_size,
+               [this, hashOutput](std::vector<CandidateBucket>& batch,
+                                  common::io::FileReader* reader) {
+                   HashBuckets(batch, reader, hashOutput);
+               });
+    if (settings_.verify_contents) {
+        StartStage(settings_.verify_thread_count, &verify_queue_, nullptr, 0,
+                   [this](std::vector<CandidateBucket>& batch,
+                          common::io::FileReader*) {
+                       for (auto& bucket : batch) {
+                           VerifyBucket(bucket);
+                       }
+                   });
+    }
+
+    // Only buckets with more than one file of the same size go any further.
+    for (auto& shard : size_shards_) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+
+        for (auto& sizeBucket : shard->files) {
+            if (sizeBucket.second.size() > 1 && !IsStopRequested() &&
+                sample_queue_.Push({ sizeBucket.first,
+                                     std::move(sizeBucket.second),
+                                     false, {} })) {
+                CountQueued(&sample_queue_, 1);
+            }
+        }
+
+        shard->files.clear();
+    }
+
+    sample_queue_.Close();
+
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+    threads_.clear();
+
+    std::lock_guard<std::mutex> lock(results_mutex_);
+    return std::move(results_);
+}
+
+DuplicatePipelineStatistics DuplicatePipeline::Statistics() const {
+    DuplicatePipelineStatistics statistics;
+
+    statistics.candidate_files = candidate_files_;
+    statistics.files_sampled = files_sampled_;
+    statistics.files_fully_hashed = files_fully_hashed_;
+    statistics.files_from_cache = files_from_cache_;
+    statistics.files_verified = files_verified_;
+    statistics.files_shared_extents = files_shared_extents_;
+    statistics.bytes_read = bytes_read_;
+    statistics.read_errors = read_errors_;
+
+    return statistics;
+}
+
+/*
+Start the threads for a stage, they run until their input queue is closed
+and drained. The last thread of a stage to finish closes the next queue.
+
+Each thread takes whatever buckets are already queued, up to the number of
+files its reader works best with, so that small buckets are read together.
+Stages that read files (readBlockSize is not 0) get a reader per thread.
+*/
+void DuplicatePipeline::StartStage(size_t threadCount, BucketQueue* input,
+                                   BucketQueue* output, size_t readBlockSize,
+                                   BatchProcessor processor) {
+    threadCount = threadCount ? threadCount : 1;
+    auto running = std::make_shared<std::atomic<size_t>>(threadCount);
+
+    for (size_t i = 0; i < threadCount; i++) {
+        threads_.emplace_back([this, input, output, readBlockSize, processor,
+                               running] {
+            std::unique_ptr<common::io::FileReader> reader;
+            size_t batchFiles = 1;
+
+            if (readBlockSize) {
+                common::io::FileReaderSettings readerSettings =
+                    settings_.reader;
+                readerSettings.block_size = readBlockSize;
+                reader = common::io::CreateFileReader(readerSettings);
+                batchFiles = reader->PreferredBatchSize();
+            }
+
+            std::vector<CandidateBucket> batch;
+
+            while (auto bucket = input->Pop()) {
+                size_t files = bucket->files.size();
+                batch.push_back(std::move(*bucket));
+
+                while (files < batchFiles) {
+                    auto next = input->TryPop();
+                    if (!next) {
+                        break;
+                    }
+
+                    files += next->files.size();
+                    batch.push_back(std::move(*next));
+                }
+
+                CountQueued(input, -static_cast<int64_t>(batch.size()));
+
+                // Once stopped the remaining work is drained and dropped.
+                if (!IsStopRequested()) {
+                    processor(batch, reader.get());
+                }
+                batch.clear();
+            }
+
+            if (--(*running) == 0 && output) {
+                output->Close();
+            }
+        });
+    }
+}
+
+// Stage 2: split size buckets by the hash of a head/tail sample.
+void DuplicatePipeline::SampleBuckets(std::vector<CandidateBucket>& batch,
+                                      common::io::FileReader* reader,
+                                      BucketQueue* output) {
+    uint64_t sampleSize = settings_.sample_size;
+
+    if (settings_.detect_shared_extents) {
+        for (auto& bucket : batch) {
+            CollapseSharedExtents(&bucket);
+        }
+
+        batch.erase(std::remove_if(batch.begin(), batch.end(),
+                                   [](const CandidateBucket& bucket) {
+                                       return bucket.files.size() < 2;
+                                   }),
+                    batch.end());
+    }
+
+    // A file that fits in the sample is hashed in full.
+    for (auto& bucket : batch) {
+        bucket.contents_hashed = bucket.size <= 2 * sampleSize;
+    }
+
+    SplitByDigest(batch, reader,
+        [sampleSize](const CandidateBucket& bucket) {
+            if (bucket.contents_hashed) {
+                return std::vector<common::io::FileRange> {
+                    { 0, bucket.size } };
+            }
+
+            return std::vector<common::io::FileRange> {
+                { 0, sampleSize },
+                { bucket.size - sampleSize, sampleSize } };
+        },
+        &files_sampled_, output);
+}
+
+// Stage 3: split buckets by the hash of the full file contents.
+void DuplicatePipeline::HashBuckets(std::vector<CandidateBucket>& batch,
+                                    common::io::FileReader* reader,
+                                    BucketQueue* output) {
+    std::vector<CandidateBucket> unhashed;
+
+    for (auto& bucket : batch) {
+        if (bucket.contents_hashed) {
+            Emit(std::move(bucket), output);
+        } else {
+            bucket.contents_hashed = true;
+            unhashed.push_back(std::move(bucket));
+        }
+    }
+
+    SplitByDigest(unhashed, reader,
+        [](const CandidateBucket& bucket) {
+            return std::vector<common::io::FileRange> { { 0, bucket.size } };
+        },
+        &files_fully_hashed_, output);
+}
+
+// Stage 4: split a bucket into sets of files that are identical byte for byte.
+void DuplicatePipeline::VerifyBucket(CandidateBucket& bucket) {
+    std::vector<std::vector<DuplicateCandidate>> identical;
+
+    for (auto& file : bucket.files) {
+        bool matched = false;
+        files_verified_++;
+
+        for (auto& files : identical) {
+            if (ContentsEqual(files.front(), file)) {
+                files.push_back(std::move(file));
+                matched = true;
+                break;
+            }
+        }
+
+        if (!matched) {
+            identical.push_back({ std::move(file) });
+        }
+    }
+
+    for (auto& files : identical) {
+        if (files.size() > 1) {
+            Emit({ bucket.size, std::move(files), true, bucket.digest },
+                 nullptr);
+        }
+    }
+}
+
+/*
+Set aside the files of a bucket that are entirely in the same shared extents
+as another file of it, e.g. copies made with cp --reflink. Their contents are
+known to be the same without reading them, so only the first file of each
+such group stays in the bucket.
+*/
+void DuplicatePipeline::CollapseSharedExtents(CandidateBucket* bucket) {
+    std::unordered_map<std::string, std::vector<DuplicateCandidate>> shared;
+    std::vector<DuplicateCandidate> files;
+    std::string extents;
+
+    for (auto& file : bucket->files) {
+        if (DeviceSharesExtents(file) &&
+            common::io::ReadSharedExtents(file.Path(*settings_.paths),
+                                          &extents)) {
+            // Extent locations are only unique within a filesystem.
+            extents.append(reinterpret_cast<const char*>(&file.device),
+                           sizeof(file.device));
+            shared[extents].push_back(file);
+        } else {
+            files.push_back(file);
+        }
+    }
+
+    for (auto& group : shared) {
+        files.push_back(group.second.front());
+
+        if (group.second.size() > 1) {
+            files_shared_extents_ += group.second.size() - 1;
+
+            std::lock_guard<std::mutex> lock(results_mutex_);
+            shared_extent_groups_.push_back({ bucket->size,
+                                              std::move(group.second), {} });
+        }
+    }
+
+    bucket->files = std::move(files);
+}
+
+bool DuplicatePipeline::DeviceSharesExtents(const DuplicateCandidate& file) {
+    std::lock_guard<std::mutex> lock(devices_mutex_);
+
+    auto found = shared_extent_devices_.find(file.device);
+    if (found == shared_extent_devices_.end()) {
+        found = shared_extent_devices_.emplace(file.device,
+            common::io::FilesystemSharesExtents(
+                file.Path(*settings_.paths))).first;
+    }
+
+    return found->second;
+}
+
+// Pass a bucket to the next stage, or to the results if it is the last stage.
+void DuplicatePipeline::Emit(CandidateBucket&& bucket, BucketQueue* output) {
+    if (output) {
+        if (output->Push(std::move(bucket))) {
+            CountQueued(output, 1);
+        }
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(results_mutex_);
+    results_.push_back({ bucket.size, std::move(bucket.files),
+                         bucket.digest });
+}
+
+// Track the depth of a stage's input queue, if metrics are enabled.
+void DuplicatePipeline::CountQueued(const BucketQueue* queue,
+                                    int64_t change) {
+    const DuplicatePipelineMetrics* metrics = settings_.metrics;
+    if (!metrics) {
+        return;
+    }
+
+    if (queue == &sample_queue_) {
+        metrics->sample_queue_depth->Add(change);
+    } else if (queue == &hash_queue_) {
+        metrics->hash_queue_depth->Add(change);
+    } else {
+        metrics->verify_queue_depth->Add(change);
+    }
+}
+
+/*
+Read the selected ranges of every file in a batch of buckets, then split each
+bucket into groups of files with the same digest. Groups of more than one
+file are passed on, keeping the bucket's contents_hashed flag. Files whose
+digest is in the hash cache are not read, and new digests are added to it.
+*/
+void DuplicatePipeline::SplitByDigest(std::vector<CandidateBucket>& batch,
+                                      common::io::FileReader* reader,
+                                      const RangeSelector& selectRanges,
+                                      std::atomic<uint64_t>* filesHashed,
+                                      BucketQueue* output) {
+    HashCache* cache = settings_.hash_cache;
+    std::vector<common::io::FileReadRequest> requests;
+    std::vector<std::unique_ptr<common::hashing::Hasher>> hashers;
+    std::vector<common::hashing::HashDigest> digests;
+    std::vector<int> errors;
+    std::vector<bool> fromCache;
+
+    // The file (in batch order) that each request reads.
+    std::vector<size_t> requestFiles;
+
+    for (const auto& bucket : batch) {
+        // Once contents_hashed is set the digest covers the whole file.
+        HashCacheDigest kind = bucket.contents_hashed ?
+                               HashCacheDigest::CONTENTS :
+                               HashCacheDigest::SAMPLE;
+        std::vector<common::io::FileRange> ranges = selectRanges(bucket);
+
+        for (const auto& file : bucket.files) {
+            digests.emplace_back();
+            errors.push_back(0);
+            fromCache.push_back(cache && cache->Lookup(file.CacheKey(), kind,
+                                                       &digests.back()));
+
+            if (fromCache.back()) {
+                files_from_cache_++;
+                continue;
+            }
+
+            requestFiles.push_back(digests.size() - 1);
+            requests.push_back({ file.Path(*settings_.paths), file.device,
+                                 ranges });
+            hashers.push_back(
+                common::hashing::CreateHasher(settings_.hash_algorithm));
+        }
+    }
+
+    const DuplicatePipelineMetrics* metrics = settings_.metrics;
+
+    if (!requests.empty()) {
+        auto readStart = std::chrono::steady_clock::now();
+
+        reader->ReadFiles(requests,
+            [this, &hashers, metrics](size_t request, const uint8_t* data,
+                                      size_t length) {
+                hashers[request]->Update(data, length);
+                bytes_read_ += length;
+                if (metrics) {
+                    metrics->bytes_hashed->Add(length);
+                }
+                return !IsStopRequested();
+            },
+            [this, &errors, &requestFiles, &requests](size_t request,
+                                                      int error) {
+                errors[requestFiles[request]] = error;
+                if (error && error != ECANCELED) {
+                    read_errors_++;
+                    LOGGER_DEBUG("Unable to read '{0}': {1}",
+                                 requests[request].path,
+                                 std::strerror(error));
+                }
+            });
+
+        if (metrics) {
+            metrics->batch_read_time->Record(static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - readStart).count()));
+        }
+    }
+
+    for (size_t request = 0; request < requests.size(); request++) {
+        size_t index = requestFiles[request];
+
+        if (!errors[index]) {
+            (*filesHashed)++;
+            digests[index] = hashers[request]->Finalise();
+        }
+    }
+
+    size_t index = 0;
+
+    for (auto& bucket : batch) {
+        HashCacheDigest kind = bucket.contents_hashed ?
+                               HashCacheDigest::CONTENTS :
+                               HashCacheDigest::SAMPLE;
+        DigestGroups groups;
+
+        for (auto& file : bucket.files) {
+            if (!errors[index]) {
+                if (cache && !fromCache[index]) {
+                    cache->Store(file.CacheKey(), kind, digests[index]);
+                }
+                groups[digests[index]].push_back(std::move(file));
+            }
+            index++;
+        }
+
+        for (auto& group : groups) {
+            if (group.second.size() > 1) {
+                Emit({ bucket.size, std::move(group.second),
+                       bucket.contents_hashed, group.first }, output);
+            }
+        }
+    }
+}
+
+bool DuplicatePipeline::ContentsEqual(const DuplicateCandidate& left,
+                                      const DuplicateCandidate& right) {
+    ScopedFile leftHandle(left.Path(*settings_.paths));
+    ScopedFile rightHandle(right.Path(*settings_.paths));
+
+    if (!leftHandle.Get() || !rightHandle.Get()) {
+        read_errors_++;
+        LOGGER_DEBUG("Unable to open '{0}' or '{1}' to compare them",
+                     left.Path(*settings_.paths),
+                     right.Path(*settings_.paths));
+        return false;
+    }
+
+    std::vector<char> leftBuffer(PIPELINE_READ_BUFFER_SIZE);
+    std::vector<char> rightBuffer(PIPELINE_READ_BUFFER_SIZE);
+
+    while (true) {
+        size_t leftRead = std::fread(leftBuffer.data(), 1, leftBuffer.size(),
+                                     leftHandle.Get());
+        size_t rightRead = std::fread(rightBuffer.data(), 1,
+                                      rightBuffer.size(), rightHandle.Get());
+        bytes_read_ += leftRead + rightRead;
+
+        if (leftRead != rightRead ||
+            std::memcmp(leftBuffer.data(), rightBuffer.data(), leftRead)) {
+            return false;
+        }
+
+        if (leftRead == 0) {
+            return true;
+        }
+    }
+}
+
+bool DuplicatePipeline::IsStopRequested() {
+    return *stop_requested_ && (*stop_requested_)();
+}
+
+}   // namespace indexer
+}   // namespace duplitrace
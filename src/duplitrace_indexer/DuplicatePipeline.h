@@ -0,0 +1,250 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#ifndef DUPLICATEPIPELINE_H_
+#define DUPLICATEPIPELINE_H_
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "BoundedQueue.h"
+#include "Crawler.h"
+#include "HashCache.h"
+#include "Metrics.h"
+#include "PathStore.h"
+#include "hashing/Hasher.h"
+#include "io/FileReader.h"
+
+namespace duplitrace { namespace indexer {
+
+// A file that may have duplicates, the directory and name are ids in the
+// scan's path store and its path is only built when it is read.
+struct DuplicateCandidate {
+    uint32_t directory;
+    uint32_t name;
+    uint64_t size;
+    uint64_t device;
+    uint64_t inode;
+    int64_t modified_time_ns;
+    int64_t changed_time_ns;
+
+    // Id of the file in the scan's index.
+    uint64_t index_file;
+
+    std::string Path(const common::PathStore& paths) const;
+
+    HashCacheKey CacheKey() const;
+};
+
+struct DuplicateGroup {
+    uint64_t size;
+    std::vector<DuplicateCandidate> files;
+
+    // Digest of the full contents shared by every file in the group.
+    common::hashing::HashDigest digest;
+};
+
+// Metrics recorded while the pipeline runs, pipelines running at the same
+// time can share them.
+struct DuplicatePipelineMetrics {
+    common::MetricCounter* bytes_hashed;
+
+    // Nanoseconds taken to read and hash each batch of files.
+    common::MetricHistogram* batch_read_time;
+
+    // Buckets waiting for each stage.
+    common::MetricGauge* sample_queue_depth;
+    common::MetricGauge* hash_queue_depth;
+    common::MetricGauge* verify_queue_depth;
+};
+
+struct DuplicatePipelineSettings {
+    // Store the candidates' directories and names were interned in.
+    const common::PathStore* paths = nullptr;
+
+    size_t sample_thread_count = 2;
+    size_t hash_thread_count = 4;
+    size_t verify_thread_count = 2;
+    size_t queue_capacity = 256;
+
+    // Number of bytes hashed from both the head and the tail of a file.
+    size_t sample_size = 4096;
+
+    // Algorithm used for both the samples and the full contents.
+    common::hashing::HashAlgorithm hash_algorithm =
+        common::hashing::HashAlgorithm::BLAKE3;
+
+    bool verify_contents = false;
+
+    // Reader used by the sample and hash stages, each of their threads has
+    // its own.
+    common::io::FileReaderSettings reader;
+
+    // Digests of files that have not changed since an earlier scan are
+    // taken from the cache instead of being read, null disables it.
+    HashCache* hash_cache = nullptr;
+
+    // On filesystems that can share extents between files (btrfs, XFS),
+    // look up each candidate's extents so that reflinked copies are grouped
+    // without being read.
+    bool detect_shared_extents = true;
+
+    // Null disables metrics.
+    const DuplicatePipelineMetrics* metrics = nullptr;
+};
+
+struct DuplicatePipelineStatistics {
+    uint64_t candidate_files = 0;
+    uint64_t files_sampled = 0;
+    uint64_t files_fully_hashed = 0;
+    uint64_t files_from_cache = 0;
+    uint64_t files_verified = 0;
+    uint64_t files_shared_extents = 0;
+    uint64_t bytes_read = 0;
+    uint64_t read_errors = 0;
+};
+
+using DuplicatePipelineStopCheck = std::function<bool()>;
+
+/*
+Staged duplicate file detection, each stage only passes on files that still
+collide so most files are never read in full:
+  1. Files are bucketed by exact size and single file buckets are dropped.
+  2. Files that are in the same shared extents as another file in their
+     bucket are set aside, then a small sample from the head and tail of
+     each file is hashed.
+  3. The full contents of files with matching samples are hashed.
+  4. (Optional) Files with matching hashes are compared byte for byte.
+Stages 2 to 4 each run on their own threads, connected by bounded queues so
+that a slow stage holds back the stages that feed it. The sample and hash
+stages gather several buckets at a time so that their reader can keep many
+files in flight.
+*/
+class DuplicatePipeline {
+ public:
+    explicit DuplicatePipeline(const DuplicatePipelineSettings& settings);
+
+    void AddFile(DuplicateCandidate file);
+
+    std::vector<DuplicateGroup> Run(
+        const DuplicatePipelineStopCheck& stopRequested = nullptr);
+
+    DuplicatePipelineStatistics Statistics() const;
+
+    // Groups of files whose data is in the same shared extents, the first
+    // file of each is the one that was left in the pipeline. Only valid
+    // once Run() has returned.
+    const std::vector<DuplicateGroup>& SharedExtentGroups() const {
+        return shared_extent_groups_;
+    }
+
+ private:
+    struct CandidateBucket {
+        uint64_t size;
+        std::vector<DuplicateCandidate> files;
+
+        // Set when the whole file fitted in the sample, so the sample hash
+        // is already a hash of the full contents.
+        bool contents_hashed;
+
+        // Digest the files were last grouped by.
+        common::hashing::HashDigest digest;
+    };
+
+    using BucketQueue = common::BoundedQueue<CandidateBucket>;
+    using DigestGroups = std::unordered_map<common::hashing::HashDigest,
+                                            std::vector<DuplicateCandidate>,
+                                            common::hashing::HashDigestHasher>;
+    using BatchProcessor = std::function<void(
+        std::vector<CandidateBucket>& batch, common::io::FileReader* reader)>;
+    using RangeSelector = std::function<std::vector<common::io::FileRange>(
+        const CandidateBucket& bucket)>;
+
+    struct SizeShard {
+        std::mutex mutex;
+        std::unordered_map<uint64_t, std::vector<DuplicateCandidate>> files;
+    };
+
+    DuplicatePipelineSettings settings_;
+    std::vector<std::unique_ptr<SizeShard>> size_shards_;
+    BucketQueue sample_queue_;
+    BucketQueue hash_queue_;
+    BucketQueue verify_queue_;
+    std::vector<std::thread> threads_;
+    const DuplicatePipelineStopCheck* stop_requested_;
+
+    std::mutex results_mutex_;
+    std::vector<DuplicateGroup> results_;
+    std::vector<DuplicateGroup> shared_extent_groups_;
+
+    // Whether each device's filesystem can share extents, looked up the
+    // first time one of its files is sampled.
+    std::mutex devices_mutex_;
+    std::unordered_map<uint64_t, bool> shared_extent_devices_;
+
+    std::atomic<uint64_t> candidate_files_;
+    std::atomic<uint64_t> files_sampled_;
+    std::atomic<uint64_t> files_fully_hashed_;
+    std::atomic<uint64_t> files_from_cache_;
+    std::atomic<uint64_t> files_verified_;
+    std::atomic<uint64_t> files_shared_extents_;
+    std::atomic<uint64_t> bytes_read_;
+    std::atomic<uint64_t> read_errors_;
+
+    void StartStage(size_t threadCount, BucketQueue* input,
+                    BucketQueue* output, size_t readBlockSize,
+                    BatchProcessor processor);
+
+    void SampleBuckets(std::vector<CandidateBucket>& batch,
+                       common::io::FileReader* reader, BucketQueue* output);
+
+    void HashBuckets(std::vector<CandidateBucket>& batch,
+                     common::io::FileReader* reader, BucketQueue* output);
+
+    void VerifyBucket(CandidateBucket& bucket);
+
+    void CollapseSharedExtents(CandidateBucket* bucket);
+
+    bool DeviceSharesExtents(const DuplicateCandidate& file);
+
+    void Emit(CandidateBucket&& bucket, BucketQueue* output);
+
+    void CountQueued(const BucketQueue* queue, int64_t change);
+
+    void SplitByDigest(std::vector<CandidateBucket>& batch,
+                       common::io::FileReader* reader,
+                       const RangeSelector& selectRanges,
+                       std::atomic<uint64_t>* filesHashed,
+                       BucketQueue* output);
+
+    bool ContentsEqual(const DuplicateCandidate& left,
+                       const DuplicateCandidate& right);
+
+    bool IsStopRequested();
+};
+
+}   // namespace indexer
+}   // namespace duplitrace
+
+#endif  // DUPLICATEPIPELINE_H_
@@ -0,0 +1,494 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <map>
+#include <system_error>
+#include "HashCache.h"
+
+namespace duplitrace { namespace indexer {
+
+const char HASH_CACHE_MAGIC[4] = { 'D', 'T', 'H', 'C' };
+const uint32_t HASH_CACHE_VERSION = 1;
+
+// Number of shards the entries are spread over, so that hashing threads
+// rarely contend on the same lock.
+const size_t HASH_CACHE_SHARD_COUNT = 64;
+
+// Number of new entries that are collected before they are appended to the
+// cache file.
+const size_t HASH_CACHE_WRITE_BATCH = 4096;
+
+// Number of records read from the cache file at a time.
+const size_t HASH_CACHE_READ_BATCH = 4096;
+
+// Save() compacts the cache file once more than this fraction of its records
+// have been superseded by newer ones.
+const uint64_t HASH_CACHE_GARBAGE_DIVISOR = 4;
+
+// When the cache file reaches the maximum number of entries it is compacted
+// down to this fraction below it, so it is not compacted again straight away.
+const uint64_t HASH_CACHE_HEADROOM_DIVISOR = 8;
+
+const uint8_t HASH_CACHE_HAS_SAMPLE = 0x01;
+const uint8_t HASH_CACHE_HAS_CONTENTS = 0x02;
+
+// The file is written in the machine's native byte order, it is a cache and
+// is simply rebuilt if it is moved to a machine where it does not match.
+struct HashCacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t algorithm;
+    uint32_t reserved;
+    uint64_t sample_size;
+    uint64_t generation;
+};
+
+struct HashCacheRecord {
+    uint64_t device;
+    uint64_t inode;
+    uint64_t size;
+    int64_t modified_time_ns;
+    int64_t changed_time_ns;
+    uint64_t last_used;
+    uint8_t flags;
+    uint8_t digest_size;
+    uint8_t reserved[6];
+    uint8_t sample[common::hashing::HASH_DIGEST_MAXIMUM_SIZE];
+    uint8_t contents[common::hashing::HASH_DIGEST_MAXIMUM_SIZE];
+};
+
+static_assert(sizeof(HashCacheHeader) == 32, "unexpected header padding");
+static_assert(sizeof(HashCacheRecord) == 120, "unexpected record padding");
+
+// Closes the file when it goes out of scope.
+class ScopedCacheFile {
+ public:
+    ScopedCacheFile(const std::string& filename, const char* mode) :
+        file_(std::fopen(filename.c_str(), mode)) {
+    }
+
+    ~ScopedCacheFile() {
+        if (file_) {
+            std::fclose(file_);
+        }
+    }
+
+    std::FILE* Get() const { return file_; }
+
+    // Close the file, reporting any error from writing out buffered data.
+    bool Close() {
+        bool closed = std::fclose(file_) == 0;
+        file_ = nullptr;
+        return closed;
+    }
+
+ private:
+    std::FILE* file_;
+};
+
+HashCache::HashCache(const std::string& filename, uint64_t maxEntries,
+                     common::hashing::HashAlgorithm algorithm,
+                     size_t sampleSize) :
+    filename_(filename),
+    max_entries_(std::max<uint64_t>(maxEntries, 1)),
+    algorithm_(algorithm),
+    sample_size_(sampleSize),
+    generation_(1),
+    pending_entries_(0),
+    file_records_(0),
+    hits_(0),
+    misses_(0) {
+    for (size_t i = 0; i < HASH_CACHE_SHARD_COUNT; i++) {
+        shards_.push_back(std::make_unique<Shard>());
+    }
+}
+
+HashCache::~HashCache() {
+    Flush();
+}
+
+/*
+Read the cache file. Records appended after the file was last compacted are
+replayed in order, so the newest entry for a file wins, and a record cut
+short by a crash is ignored. A missing file, or one built with another
+algorithm or sample size, is replaced by an empty cache. A file holding more
+records than the maximum number of entries is compacted.
+
+returns:
+    False if the cache file cannot be read or created.
+*/
+bool HashCache::Load() {
+    std::lock_guard<std::mutex> lock(file_mutex_);
+    ScopedCacheFile file(filename_, "rb");
+    HashCacheHeader header;
+
+    if (!file.Get() ||
+        std::fread(&header, sizeof(header), 1, file.Get()) != 1 ||
+        std::memcmp(header.magic, HASH_CACHE_MAGIC, sizeof(header.magic)) ||
+        header.version != HASH_CACHE_VERSION ||
+        header.algorithm != static_cast<uint32_t>(algorithm_) ||
+        header.sample_size != sample_size_) {
+        return Compact(max_entries_);
+    }
+
+    generation_ = header.generation;
+
+    std::vector<HashCacheRecord> records(HASH_CACHE_READ_BATCH);
+    uint64_t recordCount = 0;
+    size_t count;
+
+    while ((count = std::fread(records.data(), sizeof(HashCacheRecord),
+                               records.size(), file.Get())) > 0) {
+        for (size_t i = 0; i < count; i++) {
+            const HashCacheRecord& record = records[i];
+            Entry entry;
+
+            entry.size = record.size;
+            entry.modified_time_ns = record.modified_time_ns;
+            entry.changed_time_ns = record.changed_time_ns;
+            entry.last_used = record.last_used;
+            entry.flags = record.flags;
+            entry.sample.size = record.digest_size;
+            entry.contents.size = record.digest_size;
+            std::memcpy(entry.sample.bytes.data(), record.sample,
+                        sizeof(record.sample));
+            std::memcpy(entry.contents.bytes.data(), record.contents,
+                        sizeof(record.contents));
+
+            // Records appended since the header was written may be from a
+            // later generation.
+            generation_ = std::max<uint64_t>(generation_, record.last_used);
+
+            FileId id { record.device, record.inode };
+            ShardFor(id).entries[id] = entry;
+        }
+        recordCount += count;
+    }
+
+    if (std::ferror(file.Get())) {
+        return false;
+    }
+    file_records_ = recordCount;
+
+    if (file_records_ > max_entries_) {
+        return Compact(max_entries_ -
+                       max_entries_ / HASH_CACHE_HEADROOM_DIVISOR);
+    }
+
+    return true;
+}
+
+/*
+Look up a digest of a file.
+
+returns:
+    True if the digest was cached for this version of the file.
+*/
+bool HashCache::Lookup(const HashCacheKey& key, HashCacheDigest kind,
+                       common::hashing::HashDigest* digest) {
+    // Files without an inode number (e.g. on Windows) cannot be cached.
+    if (key.inode == 0) {
+        misses_++;
+        return false;
+    }
+
+    FileId id { key.device, key.inode };
+    Shard& shard = ShardFor(id);
+    uint8_t flag = kind == HashCacheDigest::SAMPLE ? HASH_CACHE_HAS_SAMPLE :
+                                                     HASH_CACHE_HAS_CONTENTS;
+
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto found = shard.entries.find(id);
+
+    if (found == shard.entries.end() ||
+        found->second.size != key.size ||
+        found->second.modified_time_ns != key.modified_time_ns ||
+        found->second.changed_time_ns != key.changed_time_ns ||
+        !(found->second.flags & flag)) {
+        misses_++;
+        return false;
+    }
+
+    found->second.last_used = generation_;
+    *digest = kind == HashCacheDigest::SAMPLE ? found->second.sample :
+                                                found->second.contents;
+    hits_++;
+    return true;
+}
+
+// Add a digest of a file, replacing anything cached for an older version of
+// it. The entry is written to the cache file with the next batch, and if
+// that would take the file over the maximum number of entries it is
+// compacted instead, dropping the least recently used.
+void HashCache::Store(const HashCacheKey& key, HashCacheDigest kind,
+                      const common::hashing::HashDigest& digest) {
+    if (key.inode == 0) {
+        return;
+    }
+
+    FileId id { key.device, key.inode };
+    Shard& shard = ShardFor(id);
+    std::vector<uint8_t> record;
+
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        Entry& entry = shard.entries[id];
+
+        if (entry.size != key.size ||
+            entry.modified_time_ns != key.modified_time_ns ||
+            entry.changed_time_ns != key.changed_time_ns) {
+            entry = Entry();
+            entry.size = key.size;
+            entry.modified_time_ns = key.modified_time_ns;
+            entry.changed_time_ns = key.changed_time_ns;
+        }
+
+        if (kind == HashCacheDigest::SAMPLE) {
+            entry.sample = digest;
+            entry.flags |= HASH_CACHE_HAS_SAMPLE;
+        } else {
+            entry.contents = digest;
+            entry.flags |= HASH_CACHE_HAS_CONTENTS;
+        }
+        entry.last_used = generation_;
+
+        AppendRecord(id, entry, &record);
+    }
+
+    std::lock_guard<std::mutex> lock(file_mutex_);
+    pending_.insert(pending_.end(), record.begin(), record.end());
+    pending_entries_++;
+
+    if (file_records_ + pending_entries_ > max_entries_) {
+        Compact(max_entries_ - max_entries_ / HASH_CACHE_HEADROOM_DIVISOR);
+    } else if (pending_entries_ >= HASH_CACHE_WRITE_BATCH) {
+        WritePending();
+    }
+}
+
+/*
+Append any entries that have not been written yet to the cache file.
+
+returns:
+    False if they could not be written.
+*/
+bool HashCache::Flush() {
+    std::lock_guard<std::mutex> lock(file_mutex_);
+
+    return WritePending();
+}
+
+/*
+Finish a scan: entries used from now on count as more recently used than
+everything so far. Entries not yet written are appended to the cache file,
+unless more than a quarter of its records have been superseded by newer
+ones, in which case it is compacted to one record per file.
+
+returns:
+    False if the cache file could not be written.
+*/
+bool HashCache::Save() {
+    std::lock_guard<std::mutex> lock(file_mutex_);
+    uint64_t records = file_records_ + pending_entries_;
+    uint64_t superseded = records - std::min(records, Statistics().entries);
+    bool saved;
+
+    if (superseded > records / HASH_CACHE_GARBAGE_DIVISOR) {
+        saved = Compact(max_entries_);
+    } else {
+        saved = WritePending();
+    }
+
+    generation_++;
+    return saved;
+}
+
+HashCacheStatistics HashCache::Statistics() const {
+    HashCacheStatistics statistics;
+
+    for (const auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        statistics.entries += shard->entries.size();
+    }
+
+    statistics.hits = hits_;
+    statistics.misses = misses_;
+    statistics.records = file_records_;
+
+    return statistics;
+}
+
+HashCache::Shard& HashCache::ShardFor(const FileId& id) {
+    return *shards_[FileIdHasher()(id) % HASH_CACHE_SHARD_COUNT];
+}
+
+void HashCache::AppendRecord(const FileId& id, const Entry& entry,
+                             std::vector<uint8_t>* records) {
+    HashCacheRecord record;
+    std::memset(&record, 0, sizeof(record));
+
+    record.device = id.device;
+    record.inode = id.inode;
+    record.size = entry.size;
+    record.modified_time_ns = entry.modified_time_ns;
+    record.changed_time_ns = entry.changed_time_ns;
+    record.last_used = entry.last_used;
+    record.flags = entry.flags;
+    record.digest_size = static_cast<uint8_t>(
+        std::max(entry.sample.size, entry.contents.size));
+    std::memcpy(record.sample, entry.sample.bytes.data(),
+                sizeof(record.sample));
+    std::memcpy(record.contents, entry.contents.bytes.data(),
+                sizeof(record.contents));
+
+    auto bytes = reinterpret_cast<const uint8_t*>(&record);
+    records->insert(records->end(), bytes, bytes + sizeof(record));
+}
+
+// Append the pending entries to the cache file, file_mutex_ must be held.
+bool HashCache::WritePending() {
+    if (pending_.empty()) {
+        return true;
+    }
+
+    ScopedCacheFile file(filename_, "ab");
+    bool written = file.Get() &&
+                   std::fwrite(pending_.data(), 1, pending_.size(),
+                               file.Get()) == pending_.size() &&
+                   file.Close();
+
+    if (written) {
+        file_records_ += pending_entries_;
+    }
+    pending_.clear();
+    pending_entries_ = 0;
+
+    return written;
+}
+
+/*
+Rewrite the cache file with one record per file, keeping at most limit
+entries and dropping the least recently used. Records are written a batch at
+a time as the shards are walked, and the new file replaces the old one in a
+single rename, so a crash leaves one or the other. file_mutex_ must be held.
+
+returns:
+    False if the cache file could not be written.
+*/
+bool HashCache::Compact(uint64_t limit) {
+    // Every entry is written from memory, including those still pending.
+    pending_.clear();
+    pending_entries_ = 0;
+
+    // Find the oldest generation that is kept, and how many of the entries
+    // last used in it fit, by counting the entries last used in each.
+    std::map<uint64_t, uint64_t> generations;
+
+    for (auto& shard : shards_) {
+        std::lock_guard<std::mutex> shardLock(shard->mutex);
+
+        for (const auto& item : shard->entries) {
+            generations[item.second.last_used]++;
+        }
+    }
+
+    uint64_t oldestKept = 0;
+    uint64_t oldestAllowance = std::numeric_limits<uint64_t>::max();
+    uint64_t kept = 0;
+
+    for (auto generation = generations.rbegin();
+         generation != generations.rend(); ++generation) {
+        if (kept + generation->second > limit) {
+            oldestKept = generation->first;
+            oldestAllowance = limit - kept;
+            break;
+        }
+        kept += generation->second;
+    }
+
+    HashCacheHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, HASH_CACHE_MAGIC, sizeof(header.magic));
+    header.version = HASH_CACHE_VERSION;
+    header.algorithm = static_cast<uint32_t>(algorithm_);
+    header.sample_size = sample_size_;
+    header.generation = generation_;
+
+    std::string temporaryName = filename_ + ".tmp";
+    ScopedCacheFile file(temporaryName, "wb");
+    bool written = file.Get() &&
+                   std::fwrite(&header, sizeof(header), 1, file.Get()) == 1;
+
+    std::vector<uint8_t> records;
+    records.reserve(HASH_CACHE_WRITE_BATCH * sizeof(HashCacheRecord));
+    uint64_t recordCount = 0;
+
+    for (auto& shard : shards_) {
+        std::lock_guard<std::mutex> shardLock(shard->mutex);
+
+        for (auto item = shard->entries.begin();
+             item != shard->entries.end();) {
+            uint64_t lastUsed = item->second.last_used;
+
+            if (lastUsed < oldestKept ||
+                (lastUsed == oldestKept && oldestAllowance-- == 0)) {
+                item = shard->entries.erase(item);
+                continue;
+            }
+
+            AppendRecord(item->first, item->second, &records);
+            recordCount++;
+            ++item;
+
+            if (records.size() >=
+                HASH_CACHE_WRITE_BATCH * sizeof(HashCacheRecord)) {
+                written = written &&
+                          std::fwrite(records.data(), 1, records.size(),
+                                      file.Get()) == records.size();
+                records.clear();
+            }
+        }
+    }
+
+    written = written &&
+              std::fwrite(records.data(), 1, records.size(), file.Get()) ==
+                  records.size() &&
+              file.Close();
+
+    std::error_code error;
+    if (written) {
+        std::filesystem::rename(temporaryName, filename_, error);
+    }
+
+    if (!written || error) {
+        std::remove(temporaryName.c_str());
+        return false;
+    }
+
+    file_records_ = recordCount;
+    return true;
+}
+
+}   // namespace indexer
+}   // namespace duplitrace
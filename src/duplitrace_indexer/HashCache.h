@@ -0,0 +1,165 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#ifndef HASHCACHE_H_
+#define HASHCACHE_H_
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "hashing/Hasher.h"
+
+namespace duplitrace { namespace indexer {
+
+// Identifies a file and the version of its contents. A file whose size or
+// times have changed since it was cached is treated as a different file.
+struct HashCacheKey {
+    uint64_t device;
+    uint64_t inode;
+    uint64_t size;
+    int64_t modified_time_ns;
+    int64_t changed_time_ns;
+};
+
+enum class HashCacheDigest {
+    // Hash of the head and tail sample, only valid for one sample size.
+    SAMPLE,
+
+    // Hash of the full contents.
+    CONTENTS
+};
+
+struct HashCacheStatistics {
+    uint64_t entries = 0;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+
+    // Records in the cache file, including those since superseded.
+    uint64_t records = 0;
+};
+
+/*
+Persistent cache of file digests, so that files that have not changed since
+an earlier scan are not read again. Entries are found by device and inode and
+are only used if the size, modification and change times still match.
+
+New entries are appended to the cache file in batches as they are stored.
+The file is compacted, rewritten with one record per file, when it would go
+over the maximum number of entries, dropping the least recently used, or by
+Save() once superseded records make up too much of it. The file records the
+hash algorithm and sample size it was built with, and is discarded if either
+changes. Safe to use from multiple threads.
+*/
+class HashCache {
+ public:
+    HashCache(const std::string& filename, uint64_t maxEntries,
+              common::hashing::HashAlgorithm algorithm, size_t sampleSize);
+
+    ~HashCache();
+
+    HashCache(const HashCache&) = delete;
+    HashCache& operator=(const HashCache&) = delete;
+
+    bool Load();
+
+    bool Lookup(const HashCacheKey& key, HashCacheDigest kind,
+                common::hashing::HashDigest* digest);
+
+    void Store(const HashCacheKey& key, HashCacheDigest kind,
+               const common::hashing::HashDigest& digest);
+
+    bool Flush();
+
+    bool Save();
+
+    HashCacheStatistics Statistics() const;
+
+    // Digests are only valid for the algorithm and sample size they were
+    // taken with.
+    common::hashing::HashAlgorithm Algorithm() const { return algorithm_; }
+
+    uint64_t SampleSize() const { return sample_size_; }
+
+ private:
+    struct FileId {
+        uint64_t device;
+        uint64_t inode;
+
+        bool operator==(const FileId& other) const {
+            return device == other.device && inode == other.inode;
+        }
+    };
+
+    struct FileIdHasher {
+        size_t operator()(const FileId& id) const {
+            return static_cast<size_t>(id.inode * 0x9E3779B97F4A7C15ULL ^
+                                       id.device);
+        }
+    };
+
+    struct Entry {
+        uint64_t size = 0;
+        int64_t modified_time_ns = 0;
+        int64_t changed_time_ns = 0;
+        uint64_t last_used = 0;
+        uint8_t flags = 0;
+        common::hashing::HashDigest sample;
+        common::hashing::HashDigest contents;
+    };
+
+    struct Shard {
+        std::mutex mutex;
+        std::unordered_map<FileId, Entry, FileIdHasher> entries;
+    };
+
+    std::string filename_;
+    uint64_t max_entries_;
+    common::hashing::HashAlgorithm algorithm_;
+    uint64_t sample_size_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+
+    // Incremented on every Save(), entries record the generation they were
+    // last used in so the least recently used can be dropped.
+    std::atomic<uint64_t> generation_;
+
+    std::mutex file_mutex_;
+    std::vector<uint8_t> pending_;
+    size_t pending_entries_;
+    std::atomic<uint64_t> file_records_;
+
+    std::atomic<uint64_t> hits_;
+    std::atomic<uint64_t> misses_;
+
+    Shard& ShardFor(const FileId& id);
+
+    static void AppendRecord(const FileId& id, const Entry& entry,
+                             std::vector<uint8_t>* records);
+
+    bool WritePending();
+
+    bool Compact(uint64_t limit);
+};
+
+}   // namespace indexer
+}   // namespace duplitrace
+
+#endif  // HASHCACHE_H_
@@ -0,0 +1,66 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#ifndef HASHCACHESETTINGS_H_
+#define HASHCACHESETTINGS_H_
+#include <string>
+#include "ConfigSetup.h"
+#include "ConfigSetupItem.h"
+
+namespace duplitrace { namespace indexer {
+
+constexpr char HASH_CACHE_SECTION[] = "hash_cache";
+
+// File the cache is kept in, the cache is disabled if this is empty.
+constexpr char HASH_CACHE_FILENAME[] = "filename";
+constexpr char HASH_CACHE_FILENAME_DEFAULT[] = "duplitrace_hash_cache.bin";
+
+// Maximum number of files the cache holds digests for, the least recently
+// used entries are dropped when it is reached. Each entry takes 120 bytes of
+// the cache file, the default covers a tree of 100 million files.
+constexpr char HASH_CACHE_MAX_ENTRIES[] = "max_entries";
+const int HASH_CACHE_MAX_ENTRIES_DEFAULT = 100000000;
+
+const common::SectionList HashCacheSettings = {
+    {
+        HASH_CACHE_FILENAME,
+        common::ConfigSetupItem(HASH_CACHE_FILENAME,
+                                common::CONFIG_ITEM_TYPE_STRING)
+                .RestartRequired(true)
+                .DefaultValue(HASH_CACHE_FILENAME_DEFAULT)
+    },
+    {
+        HASH_CACHE_MAX_ENTRIES,
+        common::ConfigSetupItem(HASH_CACHE_MAX_ENTRIES,
+                                common::CONFIG_ITEM_TYPE_INTEGER)
+                .RestartRequired(true)
+                .DefaultValue(HASH_CACHE_MAX_ENTRIES_DEFAULT)
+    }
+};
+
+#define GET_HASH_CACHE_FILENAME config_manager_.Current().String(\
+            CONFIG_KEY(HASH_CACHE_SECTION, HASH_CACHE_FILENAME))
+
+#define GET_HASH_CACHE_MAX_ENTRIES config_manager_.Current().Int(\
+            CONFIG_KEY(HASH_CACHE_SECTION, HASH_CACHE_MAX_ENTRIES))
+
+}   // namespace indexer
+}   // namespace duplitrace
+
+#endif  // HASHCACHESETTINGS_H_
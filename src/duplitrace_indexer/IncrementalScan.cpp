@@ -0,0 +1,248 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+#include "IncrementalScan.h"
+
+namespace duplitrace { namespace indexer {
+
+using common::PATH_STORE_NO_DIRECTORY;
+
+enum class DirectoryState : uint8_t {
+    UNCHANGED,
+    FILES_CHANGED,
+    TREE_CHANGED
+};
+
+/*
+Plan an incremental scan of a tree from its previous index and the
+directories that have changed since. The previous index's directories are
+copied into the (empty) path store, so its directory ids stay valid, along
+with any dirty directories that are new.
+
+returns:
+    False if the previous index cannot be used, e.g. it is not an index of
+    the tree or was written without change times, or if more than a quarter
+    of its files have been removed by updates, so a full scan is needed.
+*/
+bool PlanIncrementalScan(const common::index::IndexReader& previous,
+                         const std::string& root,
+                         const std::vector<common::io::DirtyDirectory>& dirty,
+                         common::PathStore* paths,
+                         IncrementalScanPlan* plan) {
+    uint32_t directoryCount = static_cast<uint32_t>(previous.DirectoryCount());
+
+    if (paths->DirectoryCount() != 0 ||
+        previous.FileChangedTimes().Size() != previous.FileCount()) {
+        return false;
+    }
+
+    // Removed files are only marked, a full scan writes the index without
+    // them once they take up too much of it.
+    uint64_t removedFiles = 0;
+    for (uint32_t directory : previous.FileDirectories()) {
+        removedFiles += directory == common::index::INDEX_REMOVED_FILE;
+    }
+
+    if (removedFiles > previous.FileCount() / 4) {
+        return false;
+    }
+
+    const auto& parents = previous.DirectoryParents();
+    const auto& names = previous.DirectoryNames();
+    uint32_t rootId = PATH_STORE_NO_DIRECTORY;
+
+    // Check the index before anything is added to the store. Parents are
+    // always written before their children, and the root's name is the path
+    // it was scanned as.
+    for (uint32_t i = 0; i < directoryCount; i++) {
+        if (parents[i] == PATH_STORE_NO_DIRECTORY) {
+            if (previous.String(names[i]) == root) {
+                rootId = i;
+            }
+        } else if (parents[i] >= i) {
+            return false;
+        }
+    }
+
+    if (rootId == PATH_STORE_NO_DIRECTORY) {
+        return false;
+    }
+
+    std::unordered_map<uint64_t, uint32_t>& children =
+        plan->directories_by_name;
+    std::vector<uint32_t>& previousNames = plan->previous_names;
+    plan->previous_directory_count = directoryCount;
+
+    for (uint32_t i = 0; i < directoryCount; i++) {
+        uint32_t id = paths->AddDirectory(parents[i],
+                                          previous.String(names[i]));
+        uint32_t name = paths->DirectoryName(id);
+
+        children.emplace(IncrementalPathKey(parents[i], name), id);
+        if (name >= previousNames.size()) {
+            previousNames.resize(name + 1, INCREMENTAL_NO_NAME);
+        }
+        previousNames[name] = names[i];
+    }
+
+    // Dirty paths are reported without a trailing separator.
+    std::string_view rootName = root;
+    while (rootName.size() > 1 && rootName.back() == '/') {
+        rootName.remove_suffix(1);
+    }
+
+    // Find each dirty directory in the store, adding any that are new. A new
+    // directory has to be crawled in full.
+    std::unordered_map<uint32_t, bool> dirtyIds;
+
+    for (const auto& directory : dirty) {
+        std::string_view path = directory.path;
+        if (path.substr(0, rootName.size()) != rootName ||
+            (path.size() > rootName.size() && rootName != "/" &&
+             path[rootName.size()] != '/')) {
+            continue;
+        }
+        path.remove_prefix(rootName.size());
+
+        uint32_t id = rootId;
+        bool recursive = directory.recursive;
+
+        while (!path.empty()) {
+            size_t end = path.find('/');
+            std::string_view name = path.substr(0, end);
+            path.remove_prefix(end == std::string_view::npos ?
+                               path.size() : end + 1);
+
+            if (name.empty()) {
+                continue;
+            }
+
+            uint64_t key = IncrementalPathKey(id, paths->InternName(name));
+            auto child = children.find(key);
+
+            if (child != children.end()) {
+                id = child->second;
+            } else {
+                id = paths->AddDirectory(id, name);
+                children.emplace(key, id);
+                recursive = true;
+            }
+        }
+
+        dirtyIds[id] |= recursive;
+    }
+
+    // Skip dirty directories that are inside a tree being crawled anyway.
+    for (const auto& directory : dirtyIds) {
+        bool covered = false;
+
+        for (uint32_t parent = paths->DirectoryParent(directory.first);
+             parent != PATH_STORE_NO_DIRECTORY && !covered;
+             parent = paths->DirectoryParent(parent)) {
+            auto found = dirtyIds.find(parent);
+            covered = found != dirtyIds.end() && found->second;
+        }
+
+        if (!covered) {
+            plan->directories.push_back({ directory.first, directory.second });
+        }
+    }
+
+    std::vector<DirectoryState> states(directoryCount,
+                                       DirectoryState::UNCHANGED);
+
+    for (uint32_t i = 0; i < directoryCount; i++) {
+        auto found = dirtyIds.find(i);
+
+        if (parents[i] != PATH_STORE_NO_DIRECTORY &&
+            states[parents[i]] == DirectoryState::TREE_CHANGED) {
+            states[i] = DirectoryState::TREE_CHANGED;
+        } else if (found != dirtyIds.end()) {
+            states[i] = found->second ? DirectoryState::TREE_CHANGED :
+                                        DirectoryState::FILES_CHANGED;
+        }
+    }
+
+    // Files that were hard linked within the tree keep a link count, so the
+    // crawler still spots their other links. Links outside it are not known.
+    std::unordered_map<uint64_t, uint64_t> linkCounts;
+    for (uint64_t group = 0; group < previous.LinkGroupCount(); group++) {
+        auto links = previous.LinkGroup(group);
+        if (links.kind != common::index::IndexLinkKind::HARD_LINK) {
+            continue;
+        }
+
+        for (uint64_t file : links.files) {
+            linkCounts[file] = links.files.Size();
+        }
+    }
+
+    std::vector<uint32_t> nameIds;
+    const auto& fileDirectories = previous.FileDirectories();
+    const auto& fileNames = previous.FileNames();
+
+    for (uint64_t file = 0; file < previous.FileCount(); file++) {
+        uint32_t directory = fileDirectories[file];
+        if (directory >= directoryCount) {
+            continue;
+        }
+
+        uint32_t name = fileNames[file];
+        if (name >= nameIds.size()) {
+            nameIds.resize(name + 1, INCREMENTAL_NO_NAME);
+        }
+        if (nameIds[name] == INCREMENTAL_NO_NAME) {
+            nameIds[name] = paths->InternName(previous.String(name));
+
+            if (nameIds[name] >= previousNames.size()) {
+                previousNames.resize(nameIds[name] + 1, INCREMENTAL_NO_NAME);
+            }
+            previousNames[nameIds[name]] = name;
+        }
+
+        if (states[directory] != DirectoryState::UNCHANGED) {
+            plan->dirty_files.emplace(
+                IncrementalPathKey(directory, nameIds[name]), file);
+            continue;
+        }
+
+        auto links = linkCounts.find(file);
+
+        plan->unchanged_files.push_back({
+            directory,
+            nameIds[name],
+            previous.FileDevices()[file],
+            previous.FileInodes()[file],
+            previous.FileSizes()[file],
+            previous.FileModifiedTimes()[file],
+            previous.FileChangedTimes()[file],
+            links != linkCounts.end() ? links->second : 1,
+            true
+        });
+        plan->unchanged_file_ids.push_back(file);
+    }
+
+    return true;
+}
+
+}   // namespace indexer
+}   // namespace duplitrace
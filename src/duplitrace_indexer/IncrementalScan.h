@@ -0,0 +1,79 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#ifndef INCREMENTALSCAN_H_
+#define INCREMENTALSCAN_H_
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Crawler.h"
+#include "PathStore.h"
+#include "index/IndexReader.h"
+#include "io/ChangeWatcher.h"
+
+namespace duplitrace { namespace indexer {
+
+// Not in the previous index, when mapping path store names to its strings.
+const uint32_t INCREMENTAL_NO_NAME = 0xFFFFFFFF;
+
+// Key of a directory or file in the lookups by parent directory and name.
+inline uint64_t IncrementalPathKey(uint32_t directory, uint32_t name) {
+    return (static_cast<uint64_t>(directory) << 32) | name;
+}
+
+/*
+What an incremental scan has to do to bring an index up to date. The ids of
+the previous index's directories are the same in the path store, so the
+lookups are keyed by path store directory and name ids.
+*/
+struct IncrementalScanPlan {
+    // Dirty directories to crawl again, with their ids in the path store.
+    std::vector<CrawlerDirectory> directories;
+
+    // Files from the previous index that are outside every dirty directory,
+    // so are carried over as they were, and their ids in it.
+    std::vector<CrawlerFileEntry> unchanged_files;
+    std::vector<uint64_t> unchanged_file_ids;
+
+    // Files from the previous index in the dirty directories by directory and
+    // name, each is replaced by the file crawled there or else removed.
+    std::unordered_map<uint64_t, uint64_t> dirty_files;
+
+    // Directories in the path store by parent and name, those from the
+    // previous index and the dirty directories that are new.
+    std::unordered_map<uint64_t, uint32_t> directories_by_name;
+
+    // Id of the previous index's string for each name in the path store.
+    std::vector<uint32_t> previous_names;
+
+    // Number of directories in the previous index.
+    uint32_t previous_directory_count = 0;
+};
+
+bool PlanIncrementalScan(const common::index::IndexReader& previous,
+                         const std::string& root,
+                         const std::vector<common::io::DirtyDirectory>& dirty,
+                         common::PathStore* paths,
+                         IncrementalScanPlan* plan);
+
+}   // namespace indexer
+}   // namespace duplitrace
+
+#endif  // INCREMENTALSCAN_H_
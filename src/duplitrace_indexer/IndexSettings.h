@@ -0,0 +1,50 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#ifndef INDEXSETTINGS_H_
+#define INDEXSETTINGS_H_
+#include <string>
+#include "ConfigSetup.h"
+#include "ConfigSetupItem.h"
+
+namespace duplitrace { namespace indexer {
+
+constexpr char INDEX_SECTION[] = "index";
+
+// Directory the index of each scan path is written to, no index is written
+// if this is empty.
+constexpr char INDEX_DIRECTORY[] = "directory";
+constexpr char INDEX_DIRECTORY_DEFAULT[] = ".";
+
+const common::SectionList IndexSettings = {
+    {
+        INDEX_DIRECTORY,
+        common::ConfigSetupItem(INDEX_DIRECTORY,
+                                common::CONFIG_ITEM_TYPE_STRING)
+                .DefaultValue(INDEX_DIRECTORY_DEFAULT)
+    }
+};
+
+#define GET_INDEX_DIRECTORY config_manager_.Current().String(\
+            CONFIG_KEY(INDEX_SECTION, INDEX_DIRECTORY))
+
+}   // namespace indexer
+}   // namespace duplitrace
+
+#endif  // INDEXSETTINGS_H_
@@ -0,0 +1,105 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#ifndef IOSETTINGS_H_
+#define IOSETTINGS_H_
+#include <string>
+#include "ConfigSetup.h"
+#include "ConfigSetupItem.h"
+
+namespace duplitrace { namespace indexer {
+
+constexpr char IO_SECTION[] = "io";
+
+constexpr char IO_BACKEND[] = "backend";
+constexpr char IO_BACKEND_AUTOMATIC[] = "AUTOMATIC";
+constexpr char IO_BACKEND_IO_URING[] = "IO_URING";
+constexpr char IO_BACKEND_PREAD[] = "PREAD";
+
+// Maximum number of reads in flight on a device, per hashing thread.
+constexpr char IO_QUEUE_DEPTH[] = "queue_depth";
+const int IO_QUEUE_DEPTH_DEFAULT = 128;
+
+// Comma separated list of path:depth entries that override the queue depth
+// for the device each path is on, e.g. "/mnt/nas:16".
+constexpr char IO_DEVICE_QUEUE_DEPTHS[] = "device_queue_depths";
+
+constexpr char IO_BLOCK_SIZE[] = "block_size";
+const int IO_BLOCK_SIZE_DEFAULT = 64 * 1024;
+
+// Threads per hashing thread used by the PREAD back-end.
+constexpr char IO_THREAD_COUNT[] = "thread_count";
+const int IO_THREAD_COUNT_DEFAULT = 4;
+
+const common::SectionList IoSettings = {
+    {
+        IO_BACKEND,
+        common::ConfigSetupItem(IO_BACKEND,
+                                common::CONFIG_ITEM_TYPE_STRING)
+                .DefaultValue(IO_BACKEND_AUTOMATIC)
+                .ValidValues(common::StringList{
+                    IO_BACKEND_AUTOMATIC,
+                    IO_BACKEND_IO_URING,
+                    IO_BACKEND_PREAD })
+    },
+    {
+        IO_QUEUE_DEPTH,
+        common::ConfigSetupItem(IO_QUEUE_DEPTH,
+                                common::CONFIG_ITEM_TYPE_INTEGER)
+                .DefaultValue(IO_QUEUE_DEPTH_DEFAULT)
+    },
+    {
+        IO_DEVICE_QUEUE_DEPTHS,
+        common::ConfigSetupItem(IO_DEVICE_QUEUE_DEPTHS,
+                                common::CONFIG_ITEM_TYPE_STRING)
+                .DefaultValue("")
+    },
+    {
+        IO_BLOCK_SIZE,
+        common::ConfigSetupItem(IO_BLOCK_SIZE,
+                                common::CONFIG_ITEM_TYPE_INTEGER)
+                .DefaultValue(IO_BLOCK_SIZE_DEFAULT)
+    },
+    {
+        IO_THREAD_COUNT,
+        common::ConfigSetupItem(IO_THREAD_COUNT,
+                                common::CONFIG_ITEM_TYPE_INTEGER)
+                .DefaultValue(IO_THREAD_COUNT_DEFAULT)
+    }
+};
+
+#define GET_IO_BACKEND config_manager_.Current().String(\
+            CONFIG_KEY(IO_SECTION, IO_BACKEND))
+
+#define GET_IO_QUEUE_DEPTH config_manager_.Current().Int(\
+            CONFIG_KEY(IO_SECTION, IO_QUEUE_DEPTH))
+
+#define GET_IO_DEVICE_QUEUE_DEPTHS config_manager_.Current().String(\
+            CONFIG_KEY(IO_SECTION, IO_DEVICE_QUEUE_DEPTHS))
+
+#define GET_IO_BLOCK_SIZE config_manager_.Current().Int(\
+            CONFIG_KEY(IO_SECTION, IO_BLOCK_SIZE))
+
+#define GET_IO_THREAD_COUNT config_manager_.Current().Int(\
+            CONFIG_KEY(IO_SECTION, IO_THREAD_COUNT))
+
+}   // namespace indexer
+}   // namespace duplitrace
+
+#endif  // IOSETTINGS_H_
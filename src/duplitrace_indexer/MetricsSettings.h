@@ -0,0 +1,76 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#ifndef METRICSSETTINGS_H_
+#define METRICSSETTINGS_H_
+#include <string>
+#include "ConfigSetup.h"
+#include "ConfigSetupItem.h"
+
+namespace duplitrace { namespace indexer {
+
+constexpr char METRICS_SECTION[] = "metrics";
+
+// Prometheus text file the metrics are written to, e.g. in node_exporter's
+// textfile collector directory. No file is written if this is empty.
+constexpr char METRICS_TEXT_FILE[] = "text_file";
+
+// Seconds between writes of the text file.
+constexpr char METRICS_FLUSH_INTERVAL[] = "flush_interval";
+const int METRICS_FLUSH_INTERVAL_DEFAULT = 15;
+
+// Unix domain socket the metrics can be read from, there is no socket if
+// this is empty.
+constexpr char METRICS_SOCKET_PATH[] = "socket_path";
+
+const common::SectionList MetricsSettings = {
+    {
+        METRICS_TEXT_FILE,
+        common::ConfigSetupItem(METRICS_TEXT_FILE,
+                                common::CONFIG_ITEM_TYPE_STRING)
+                .DefaultValue("")
+    },
+    {
+        METRICS_FLUSH_INTERVAL,
+        common::ConfigSetupItem(METRICS_FLUSH_INTERVAL,
+                                common::CONFIG_ITEM_TYPE_INTEGER)
+                .DefaultValue(METRICS_FLUSH_INTERVAL_DEFAULT)
+    },
+    {
+        METRICS_SOCKET_PATH,
+        common::ConfigSetupItem(METRICS_SOCKET_PATH,
+                                common::CONFIG_ITEM_TYPE_STRING)
+                .RestartRequired(true)
+                .DefaultValue("")
+    }
+};
+
+#define GET_METRICS_TEXT_FILE config_manager_.Current().String(\
+            CONFIG_KEY(METRICS_SECTION, METRICS_TEXT_FILE))
+
+#define GET_METRICS_FLUSH_INTERVAL config_manager_.Current().Int(\
+            CONFIG_KEY(METRICS_SECTION, METRICS_FLUSH_INTERVAL))
+
+#define GET_METRICS_SOCKET_PATH config_manager_.Current().String(\
+            CONFIG_KEY(METRICS_SECTION, METRICS_SOCKET_PATH))
+
+}   // namespace indexer
+}   // namespace duplitrace
+
+#endif  // METRICSSETTINGS_H_
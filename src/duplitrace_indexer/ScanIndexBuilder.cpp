@@ -0,0 +1,136 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#include <tuple>
+#include "ScanIndexBuilder.h"
+
+namespace duplitrace { namespace indexer {
+
+ScanIndexBuilder::ScanIndexBuilder(common::hashing::HashAlgorithm algorithm,
+                                   const common::PathStore& paths) :
+    writer_(algorithm, paths) {
+}
+
+/*
+Add a file found by the crawler, safe to call from multiple threads.
+
+returns:
+    Id of the file in the index.
+*/
+uint64_t ScanIndexBuilder::AddFile(const CrawlerFileEntry& file) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    uint64_t id = writer_.AddFile({ file.directory, file.name,
+                                    file.size, file.modified_time_ns,
+                                    file.device, file.inode,
+                                    file.changed_time_ns });
+
+    if (file.link_count > 1 && file.inode) {
+        linked_files_.push_back({ file.device, file.inode, !file.first_link,
+                                  id });
+    }
+
+    return id;
+}
+
+// Add the groups found by the duplicate pipeline, with their digests.
+void ScanIndexBuilder::AddDuplicateGroups(
+        const std::vector<DuplicateGroup>& groups) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<uint64_t> files;
+
+    for (const auto& group : groups) {
+        files.clear();
+
+        for (const auto& file : group.files) {
+            files.push_back(file.index_file);
+            writer_.SetDigest(file.index_file, group.digest);
+        }
+
+        writer_.AddDuplicateGroup(group.size, files);
+    }
+}
+
+// Add the groups of files the pipeline found in the same shared extents, the
+// first file of each is the one the pipeline kept. Their digests are copied
+// from it, so this must come after AddDuplicateGroups().
+void ScanIndexBuilder::AddSharedExtentGroups(
+        const std::vector<DuplicateGroup>& groups) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<uint64_t> files;
+
+    for (const auto& group : groups) {
+        files.clear();
+
+        for (const auto& file : group.files) {
+            files.push_back(file.index_file);
+        }
+
+        AddLinkGroup(common::index::IndexLinkKind::SHARED_EXTENTS, files);
+    }
+}
+
+/*
+Write the index, after grouping the hard links that were found. A file with
+more than one link whose other links are outside the scan is not grouped.
+*/
+bool ScanIndexBuilder::Write(const std::string& filename) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    std::sort(linked_files_.begin(), linked_files_.end(),
+              [](const LinkedFile& left, const LinkedFile& right) {
+                  return std::tie(left.device, left.inode, left.later_link,
+                                  left.file) <
+                         std::tie(right.device, right.inode,
+                                  right.later_link, right.file);
+              });
+
+    std::vector<uint64_t> files;
+
+    for (size_t start = 0, end = 0; start < linked_files_.size();
+         start = end) {
+        files.clear();
+
+        for (end = start; end < linked_files_.size() &&
+             linked_files_[end].device == linked_files_[start].device &&
+             linked_files_[end].inode == linked_files_[start].inode; end++) {
+            files.push_back(linked_files_[end].file);
+        }
+
+        if (files.size() > 1) {
+            AddLinkGroup(common::index::IndexLinkKind::HARD_LINK, files);
+        }
+    }
+
+    linked_files_.clear();
+
+    return writer_.Write(filename);
+}
+
+void ScanIndexBuilder::AddLinkGroup(common::index::IndexLinkKind kind,
+                                    const std::vector<uint64_t>& files) {
+    for (size_t i = 1; i < files.size(); i++) {
+        writer_.CopyDigest(files[0], files[i]);
+    }
+
+    writer_.AddLinkGroup(kind, files);
+}
+
+}   // namespace indexer
+}   // namespace duplitrace
@@ -0,0 +1,75 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#ifndef SCANINDEXBUILDER_H_
+#define SCANINDEXBUILDER_H_
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "Crawler.h"
+#include "DuplicatePipeline.h"
+#include "PathStore.h"
+#include "index/IndexWriter.h"
+
+namespace duplitrace { namespace indexer {
+
+/*
+Collects the results of a scan into an index: every file the crawler finds,
+then the duplicate groups found among them. Files may be added from the
+crawler threads at the same time. Directories and names are written straight
+from the scan's path store. Hard links found by the crawler, and files the
+pipeline found in shared extents, are written as link groups, and the digest
+of the member that was hashed is given to the rest of its group.
+*/
+class ScanIndexBuilder {
+ public:
+    ScanIndexBuilder(common::hashing::HashAlgorithm algorithm,
+                     const common::PathStore& paths);
+
+    uint64_t AddFile(const CrawlerFileEntry& file);
+
+    void AddDuplicateGroups(const std::vector<DuplicateGroup>& groups);
+
+    void AddSharedExtentGroups(const std::vector<DuplicateGroup>& groups);
+
+    bool Write(const std::string& filename);
+
+ private:
+    struct LinkedFile {
+        uint64_t device;
+        uint64_t inode;
+
+        // Sorts the link that was hashed ahead of the others.
+        bool later_link;
+        uint64_t file;
+    };
+
+    std::mutex mutex_;
+    common::index::IndexWriter writer_;
+    std::vector<LinkedFile> linked_files_;
+
+    void AddLinkGroup(common::index::IndexLinkKind kind,
+                      const std::vector<uint64_t>& files);
+};
+
+}   // namespace indexer
+}   // namespace duplitrace
+
+#endif  // SCANINDEXBUILDER_H_
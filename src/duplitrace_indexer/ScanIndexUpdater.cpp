@@ -0,0 +1,376 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#include <algorithm>
+#include <set>
+#include <tuple>
+#include <utility>
+#include "ScanIndexUpdater.h"
+
+namespace duplitrace { namespace indexer {
+
+using common::index::IndexLinkKind;
+
+ScanIndexUpdater::ScanIndexUpdater(
+        const common::index::IndexReader& previous,
+        const common::PathStore& paths, const IncrementalScanPlan& plan,
+        common::index::IndexUpdater* update) :
+    previous_(previous),
+    paths_(paths),
+    plan_(plan),
+    update_(update),
+    files_added_(0),
+    files_changed_(0),
+    files_removed_(0) {
+}
+
+// Add a file found by the crawler, safe to call from multiple threads.
+void ScanIndexUpdater::AddFile(const CrawlerFileEntry& file) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    crawled_files_.push_back({ file, 0 });
+}
+
+/*
+Once the crawl has finished, update the index's files from what it found
+and work out which sizes have changed.
+
+returns:
+    The files of the sizes that have changed, crawled and carried over, to
+    go through the duplicate pipeline. Only the first link to each inode is
+    included, as when building an index.
+*/
+std::vector<DuplicateCandidate> ScanIndexUpdater::Resolve() {
+    AddDirectories();
+
+    const auto& sizes = previous_.FileSizes();
+
+    for (auto& crawled : crawled_files_) {
+        const CrawlerFileEntry& file = crawled.entry;
+        uint32_t directory = IndexDirectory(file.directory);
+        auto found = plan_.dirty_files.find(
+            IncrementalPathKey(directory, file.name));
+
+        if (directory >= plan_.previous_directory_count ||
+            found == plan_.dirty_files.end() ||
+            !found_files_.insert(found->second).second) {
+            crawled.file = update_->AddFile({ directory, IndexName(file.name),
+                                              file.size,
+                                              file.modified_time_ns,
+                                              file.device, file.inode,
+                                              file.changed_time_ns });
+            changed_sizes_.insert(file.size);
+            files_added_++;
+            continue;
+        }
+
+        uint64_t id = found->second;
+        crawled.file = id;
+
+        if (sizes[id] == file.size &&
+            previous_.FileModifiedTimes()[id] == file.modified_time_ns &&
+            previous_.FileChangedTimes()[id] == file.changed_time_ns &&
+            previous_.FileDevices()[id] == file.device &&
+            previous_.FileInodes()[id] == file.inode) {
+            continue;
+        }
+
+        update_->ReplaceFile(id, { directory, previous_.FileNames()[id],
+                                   file.size, file.modified_time_ns,
+                                   file.device, file.inode,
+                                   file.changed_time_ns });
+        replaced_files_.insert(id);
+        changed_sizes_.insert(sizes[id]);
+        changed_sizes_.insert(file.size);
+        files_changed_++;
+    }
+
+    for (const auto& dirty : plan_.dirty_files) {
+        if (!found_files_.count(dirty.second)) {
+            update_->RemoveFile(dirty.second);
+            changed_sizes_.insert(sizes[dirty.second]);
+            files_removed_++;
+        }
+    }
+
+    std::vector<DuplicateCandidate> candidates;
+    auto addCandidate = [this, &candidates](const CrawlerFileEntry& file,
+                                            uint64_t id) {
+        if (file.first_link && SizeChanged(file.size)) {
+            candidates.push_back({ file.directory, file.name, file.size,
+                                   file.device, file.inode,
+                                   file.modified_time_ns,
+                                   file.changed_time_ns, id });
+        }
+    };
+
+    if (changed_sizes_.empty()) {
+        return candidates;
+    }
+
+    for (const auto& crawled : crawled_files_) {
+        addCandidate(crawled.entry, crawled.file);
+    }
+
+    for (size_t i = 0; i < plan_.unchanged_files.size(); i++) {
+        addCandidate(plan_.unchanged_files[i], plan_.unchanged_file_ids[i]);
+    }
+
+    return candidates;
+}
+
+// Replace the groups of the sizes that have changed with those found by the
+// duplicate pipeline, with their digests.
+void ScanIndexUpdater::AddDuplicateGroups(
+        const std::vector<DuplicateGroup>& groups) {
+    for (uint64_t group = 0; group < previous_.GroupCount(); group++) {
+        uint64_t size = previous_.Group(group).size;
+
+        if (size && SizeChanged(size)) {
+            update_->RemoveGroup(group);
+        }
+    }
+
+    std::vector<uint64_t> files;
+
+    for (const auto& group : groups) {
+        files.clear();
+
+        for (const auto& file : group.files) {
+            files.push_back(file.index_file);
+            update_->SetDigest(file.index_file, group.digest);
+            digests_[file.index_file] = group.digest;
+        }
+
+        update_->AddDuplicateGroup(group.size, files);
+    }
+}
+
+// Replace the shared extent groups of the sizes that have changed, the first
+// file of each is the one the pipeline kept. Their digests are copied from
+// it, so this must come after AddDuplicateGroups().
+void ScanIndexUpdater::AddSharedExtentGroups(
+        const std::vector<DuplicateGroup>& groups) {
+    for (uint64_t group = 0; group < previous_.LinkGroupCount(); group++) {
+        auto links = previous_.LinkGroup(group);
+
+        if (links.kind == IndexLinkKind::SHARED_EXTENTS &&
+            links.files.Size() &&
+            SizeChanged(previous_.FileSizes()[links.files[0]])) {
+            update_->RemoveLinkGroup(group);
+        }
+    }
+
+    std::vector<uint64_t> files;
+
+    for (const auto& group : groups) {
+        files.clear();
+
+        for (const auto& file : group.files) {
+            files.push_back(file.index_file);
+        }
+
+        AddLinkGroup(IndexLinkKind::SHARED_EXTENTS, files);
+    }
+}
+
+/*
+Regroup the hard links to the inodes that links were crawled or removed
+from, with their links that were carried over. A file with more than one
+link whose other links are outside the scan is not grouped. The previous
+index is not read after this.
+*/
+void ScanIndexUpdater::Finish() {
+    const auto& devices = previous_.FileDevices();
+    const auto& inodes = previous_.FileInodes();
+    std::set<std::pair<uint64_t, uint64_t>> regrouped;
+    std::vector<LinkedFile> linkedFiles;
+
+    for (const auto& crawled : crawled_files_) {
+        const CrawlerFileEntry& file = crawled.entry;
+
+        if (file.link_count > 1 && file.inode) {
+            regrouped.insert({ file.device, file.inode });
+            linkedFiles.push_back({ file.device, file.inode, !file.first_link,
+                                    crawled.file });
+        }
+    }
+
+    // The links of a group are all to the same inode, so a group with one
+    // in a dirty directory is made again from the links that are left.
+    std::unordered_set<uint64_t> dirtyFiles;
+    for (const auto& dirty : plan_.dirty_files) {
+        dirtyFiles.insert(dirty.second);
+    }
+
+    for (uint64_t group = 0; group < previous_.LinkGroupCount(); group++) {
+        auto links = previous_.LinkGroup(group);
+        if (links.kind != IndexLinkKind::HARD_LINK || !links.files.Size()) {
+            continue;
+        }
+
+        for (uint64_t file : links.files) {
+            if (dirtyFiles.count(file)) {
+                regrouped.insert({ devices[file], inodes[file] });
+                break;
+            }
+        }
+    }
+
+    if (regrouped.empty()) {
+        return;
+    }
+
+    for (uint64_t group = 0; group < previous_.LinkGroupCount(); group++) {
+        auto links = previous_.LinkGroup(group);
+
+        if (links.kind == IndexLinkKind::HARD_LINK && links.files.Size() &&
+            regrouped.count({ devices[links.files[0]],
+                              inodes[links.files[0]] })) {
+            update_->RemoveLinkGroup(group);
+        }
+    }
+
+    for (size_t i = 0; i < plan_.unchanged_files.size(); i++) {
+        const CrawlerFileEntry& file = plan_.unchanged_files[i];
+
+        if (file.link_count > 1 &&
+            regrouped.count({ file.device, file.inode })) {
+            linkedFiles.push_back({ file.device, file.inode, !file.first_link,
+                                    plan_.unchanged_file_ids[i] });
+        }
+    }
+
+    std::sort(linkedFiles.begin(), linkedFiles.end(),
+              [](const LinkedFile& left, const LinkedFile& right) {
+                  return std::tie(left.device, left.inode, left.later_link,
+                                  left.file) <
+                         std::tie(right.device, right.inode,
+                                  right.later_link, right.file);
+              });
+
+    std::vector<uint64_t> files;
+
+    for (size_t start = 0, end = 0; start < linkedFiles.size();
+         start = end) {
+        files.clear();
+
+        for (end = start; end < linkedFiles.size() &&
+             linkedFiles[end].device == linkedFiles[start].device &&
+             linkedFiles[end].inode == linkedFiles[start].inode; end++) {
+            files.push_back(linkedFiles[end].file);
+        }
+
+        if (files.size() > 1) {
+            AddLinkGroup(IndexLinkKind::HARD_LINK, files);
+        }
+    }
+}
+
+uint32_t ScanIndexUpdater::IndexDirectory(uint32_t directory) const {
+    if (directory < plan_.previous_directory_count ||
+        directory == common::PATH_STORE_NO_DIRECTORY) {
+        return directory;
+    }
+
+    return directories_[directory - plan_.previous_directory_count];
+}
+
+// Find the index's string for a path store name, adding it if the previous
+// index did not have it.
+uint32_t ScanIndexUpdater::IndexName(uint32_t name) {
+    if (name < plan_.previous_names.size() &&
+        plan_.previous_names[name] != INCREMENTAL_NO_NAME) {
+        return plan_.previous_names[name];
+    }
+
+    auto added = added_names_.find(name);
+    if (added != added_names_.end()) {
+        return added->second;
+    }
+
+    uint32_t id = update_->AddString(paths_.Name(name));
+    added_names_.emplace(name, id);
+
+    return id;
+}
+
+/*
+Find the index directory of each directory added to the path store since it
+was planned. The crawler adds a directory again when it crawls its parent,
+which is then the same directory as before, anything else is new.
+*/
+void ScanIndexUpdater::AddDirectories() {
+    uint32_t previousCount = plan_.previous_directory_count;
+
+    for (uint32_t directory = previousCount +
+             static_cast<uint32_t>(directories_.size());
+         directory < paths_.DirectoryCount(); directory++) {
+        uint32_t parent = IndexDirectory(paths_.DirectoryParent(directory));
+        uint32_t name = paths_.DirectoryName(directory);
+        uint64_t key = IncrementalPathKey(parent, name);
+
+        auto known = plan_.directories_by_name.find(key);
+        if (parent < previousCount &&
+            known != plan_.directories_by_name.end() &&
+            known->second < previousCount) {
+            directories_.push_back(known->second);
+            continue;
+        }
+
+        auto added = added_directories_.find(key);
+        if (added != added_directories_.end()) {
+            directories_.push_back(added->second);
+            continue;
+        }
+
+        uint32_t id = update_->AddDirectory(parent, IndexName(name));
+        added_directories_.emplace(key, id);
+        directories_.push_back(id);
+    }
+}
+
+// Digest of a file as it will be in the index, all zeros if it has not been
+// hashed.
+common::hashing::HashDigest ScanIndexUpdater::Digest(uint64_t file) const {
+    auto digest = digests_.find(file);
+    if (digest != digests_.end()) {
+        return digest->second;
+    }
+
+    if (file < previous_.FileCount() && !replaced_files_.count(file)) {
+        return previous_.FileDigest(file);
+    }
+
+    return common::hashing::HashDigest();
+}
+
+void ScanIndexUpdater::AddLinkGroup(IndexLinkKind kind,
+                                    const std::vector<uint64_t>& files) {
+    common::hashing::HashDigest digest = Digest(files[0]);
+
+    for (size_t i = 1; i < files.size(); i++) {
+        update_->SetDigest(files[i], digest);
+        digests_[files[i]] = digest;
+    }
+
+    update_->AddLinkGroup(kind, files);
+}
+
+}   // namespace indexer
+}   // namespace duplitrace
@@ -0,0 +1,139 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#ifndef SCANINDEXUPDATER_H_
+#define SCANINDEXUPDATER_H_
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "Crawler.h"
+#include "DuplicatePipeline.h"
+#include "IncrementalScan.h"
+#include "PathStore.h"
+#include "index/IndexReader.h"
+#include "index/IndexUpdater.h"
+
+namespace duplitrace { namespace indexer {
+
+/*
+Collects the results of an incremental scan into an update of the previous
+index, the counterpart of ScanIndexBuilder for a full scan. The files found
+by crawling the dirty directories are matched against the files the previous
+index had there: a file that is unchanged is left as it was, one that has
+changed is overwritten and one that has gone is removed. Only the sizes of
+the files that were added, changed or removed can have different duplicate
+groups, so only files of those sizes need to go through the pipeline, and
+only the groups of those sizes are replaced.
+
+Files may be added from the crawler threads at the same time, everything
+else is called from the scan's thread. The previous index must stay open
+until Finish() has been called.
+*/
+class ScanIndexUpdater {
+ public:
+    ScanIndexUpdater(const common::index::IndexReader& previous,
+                     const common::PathStore& paths,
+                     const IncrementalScanPlan& plan,
+                     common::index::IndexUpdater* update);
+
+    void AddFile(const CrawlerFileEntry& file);
+
+    std::vector<DuplicateCandidate> Resolve();
+
+    bool Changed() const { return update_->Changed(); }
+
+    uint64_t FilesAdded() const { return files_added_; }
+
+    uint64_t FilesChanged() const { return files_changed_; }
+
+    uint64_t FilesRemoved() const { return files_removed_; }
+
+    void AddDuplicateGroups(const std::vector<DuplicateGroup>& groups);
+
+    void AddSharedExtentGroups(const std::vector<DuplicateGroup>& groups);
+
+    void Finish();
+
+ private:
+    struct CrawledFile {
+        CrawlerFileEntry entry;
+        uint64_t file;
+    };
+
+    struct LinkedFile {
+        uint64_t device;
+        uint64_t inode;
+
+        // Sorts the link that was hashed ahead of the others.
+        bool later_link;
+        uint64_t file;
+    };
+
+    const common::index::IndexReader& previous_;
+    const common::PathStore& paths_;
+    const IncrementalScanPlan& plan_;
+    common::index::IndexUpdater* update_;
+
+    std::mutex mutex_;
+    std::vector<CrawledFile> crawled_files_;
+
+    // Each new path store directory's directory in the index: the previous
+    // index's for one crawled again, else the one added for it.
+    std::vector<uint32_t> directories_;
+    std::unordered_map<uint64_t, uint32_t> added_directories_;
+
+    // Strings added for path store names that were not in the previous index.
+    std::unordered_map<uint32_t, uint32_t> added_names_;
+
+    // Previous files in the dirty directories that were crawled again, and
+    // those of them that had changed.
+    std::unordered_set<uint64_t> found_files_;
+    std::unordered_set<uint64_t> replaced_files_;
+
+    std::unordered_set<uint64_t> changed_sizes_;
+
+    // Digests set by this update, which later links are given.
+    std::unordered_map<uint64_t, common::hashing::HashDigest> digests_;
+
+    uint64_t files_added_;
+    uint64_t files_changed_;
+    uint64_t files_removed_;
+
+    uint32_t IndexDirectory(uint32_t directory) const;
+
+    uint32_t IndexName(uint32_t name);
+
+    void AddDirectories();
+
+    bool SizeChanged(uint64_t size) const {
+        return changed_sizes_.count(size) != 0;
+    }
+
+    common::hashing::HashDigest Digest(uint64_t file) const;
+
+    void AddLinkGroup(common::index::IndexLinkKind kind,
+                      const std::vector<uint64_t>& files);
+};
+
+}   // namespace indexer
+}   // namespace duplitrace
+
+#endif  // SCANINDEXUPDATER_H_
@@ -18,10 +18,12 @@ Copyright 2024 DupliTrace Development Team
     along with this program.If not, see < https://www.gnu.org/licenses/>.
 */
 #include <chrono>
+#include <ctime>
 #include <memory>
 #include <signal.h>
 #include <stdexcept>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include "spdlog/spdlog.h"
 #include "spdlog/async.h"
@@ -29,29 +31,53 @@ Copyright 2024 DupliTrace Development Team
 #include "spdlog/sinks/rotating_file_sink.h"
 #include "spdlog/sinks/stdout_color_sinks.h"
 #include "Service.h"
+#include "Crawler.h"
+#include "CrawlerSettings.h"
+#include "DetectionSettings.h"
+#include "DuplicatePipeline.h"
+#include "HashCacheSettings.h"
+#include "IncrementalScan.h"
+#include "IndexSettings.h"
+#include "InodeSet.h"
+#include "IoSettings.h"
 #include "Logger.h"
 #include "LoggerSettings.h"
+#include "MetricsSettings.h"
+#include "PathStore.h"
 #include "Platform.h"
+#include "ScanIndexBuilder.h"
+#include "ScanIndexUpdater.h"
+#include "Utilities.h"
 #include "Version.h"
+#include "WatchSettings.h"
+#include "../cron_parser/CronExpressionCache.h"
 
-#define LOGGER_THREAD_SIZE  8192
-#define LOGGER_THREAD_COUNT 1
 #define LOGGER_NAME         "logger"
 
+#define SERVICE_WORKER_THREAD_COUNT 4
+
 namespace duplitrace { namespace indexer {
 
 using namespace std::chrono_literals;
 
-static Service* service_instance;
+// Maximum time in-flight work is given to complete when shutting down.
+const auto SERVICE_SHUTDOWN_DRAIN_TIMEOUT = 30s;
 
-static void StopSignalHandler(int signal) {
-    LOGGER->info("Service shutdown signal has been caught...");
-    service_instance->NotifyShutdownRequested();
-}
+// The default schedules are scanned when building, so a bad one cannot ship.
+static_assert(cronparser::ScanCronExpression(
+                  CRAWLER_SCAN_SCHEDULE_DEFAULT).error == nullptr,
+              "Invalid default scan schedule");
+static_assert(cronparser::ScanCronExpression(
+                  WATCH_UPDATE_SCHEDULE_DEFAULT).error == nullptr,
+              "Invalid default update schedule");
 
 Service::Service() : initialised_(false),
                      config_layout_(nullptr),
-                     shutdown_requested_(false) {
+                     shutdown_requested_(false),
+                     pipeline_metrics_(),
+                     files_crawled_metric_(nullptr),
+                     scan_time_metric_(nullptr),
+                     scheduler_lag_metric_(nullptr) {
 }
 
 bool Service::Initialise(common::SectionsMap* layout, std::string file) {
@@ -59,6 +85,15 @@ bool Service::Initialise(common::SectionsMap* layout, std::string file) {
 
     config_file_ = file;
 
+    InitialiseMetrics();
+
+    // The event loop has to be set up first, signals are blocked so that
+    // they are delivered through it and any threads started afterwards
+    // (e.g. logging) inherit the blocked signal mask.
+    if (!InitialiseEventLoop()) {
+        return false;
+    }
+
     if (!ReadConfiguration()) {
         return false;
     }
@@ -75,58 +110,399 @@ bool Service::Initialise(common::SectionsMap* layout, std::string file) {
 
     PrintConfigurationItems();
 
+    if (!InitialiseReaderSettings()) {
+        return false;
+    }
+
+    InitialiseHashCache();
+
+    if (!InitialiseMetricsExport()) {
+        return false;
+    }
+
+    WatchConfigFile();
+
+    if (!ScheduleScans()) {
+        return false;
+    }
+
     initialised_ = true;
 
     return initialised_;
 }
 
 void Service::Execute() {
-    // Windows does not handle SIGINT properly, so disable... see MSDN:
-    // https://learn.microsoft.com/en-us/cpp/c-runtime-library/reference/signal?view=msvc-170
-#if DUPLITRACE_PLATFORM == DUPLITRACE_PLATFORM_LINUX
-    LOGGER->info ("Setting up signal handler...");
-    struct sigaction sigIntHandler;
-    sigIntHandler.sa_handler = StopSignalHandler;
-    sigemptyset (&sigIntHandler.sa_mask);
-    sigIntHandler.sa_flags = 0;
-    sigaction (SIGINT, &sigIntHandler, NULL);
-#endif
+    LOGGER->info("Service is running...");
 
+    // Sleep until a signal, scheduler deadline or worker completion arrives,
+    // the scheduler deadline is re-armed after every wake up as firing a job
+    // or adding/removing one can change it.
     while (!shutdown_requested_) {
-        std::this_thread::sleep_for(1ms);
+        event_loop_.SetDeadline(NextDeadline());
+        event_loop_.WaitForEvents();
     }
 
     Shutdown();
 }
 
+// Request a shutdown, safe to call from any thread.
 void Service::NotifyShutdownRequested() {
+    shutdown_requested_ = true;
+    event_loop_.Wake();
 }
 
 void Service::Shutdown() {
+    LOGGER->info("Waiting up to {0} seconds for in-flight work to finish...",
+                 std::chrono::duration_cast<std::chrono::seconds>(
+                     SERVICE_SHUTDOWN_DRAIN_TIMEOUT).count());
+
+    if (worker_pool_->Shutdown(SERVICE_SHUTDOWN_DRAIN_TIMEOUT)) {
+        LOGGER->info("All in-flight work has completed");
+    } else {
+        LOGGER->warn("In-flight work did not complete in time, queued work "
+                     "has been discarded and running work was asked to stop");
+    }
+
+    ReportLogQueue();
+
+    if (metrics_flush_time_) {
+        FlushMetrics(std::time(nullptr));
+    }
+
+    LOGGER->info("Service has shut down");
+}
+
+/*
+Add the service's metrics. They are always recorded, as that costs next to
+nothing, whether or not they are exported.
+*/
+void Service::InitialiseMetrics() {
+    files_crawled_metric_ = metrics_.AddCounter(
+        "duplitrace_files_crawled_total",
+        "Files found by scans, including those carried over unchanged");
+    scan_time_metric_ = metrics_.AddHistogram(
+        "duplitrace_scan_seconds", "Time taken by each scan", 1e-3);
+    scheduler_lag_metric_ = metrics_.AddHistogram(
+        "duplitrace_scheduler_lag_seconds",
+        "Time from a job being due to it starting", 1e-3);
+
+    pipeline_metrics_.bytes_hashed = metrics_.AddCounter(
+        "duplitrace_bytes_hashed_total", "Bytes read and hashed");
+    pipeline_metrics_.batch_read_time = metrics_.AddHistogram(
+        "duplitrace_batch_read_seconds",
+        "Time taken to read and hash a batch of files", 1e-9);
+    pipeline_metrics_.sample_queue_depth = metrics_.AddGauge(
+        "duplitrace_pipeline_queue_depth",
+        "Buckets of files waiting for a detection stage", "stage=\"sample\"");
+    pipeline_metrics_.hash_queue_depth = metrics_.AddGauge(
+        "duplitrace_pipeline_queue_depth",
+        "Buckets of files waiting for a detection stage", "stage=\"hash\"");
+    pipeline_metrics_.verify_queue_depth = metrics_.AddGauge(
+        "duplitrace_pipeline_queue_depth",
+        "Buckets of files waiting for a detection stage", "stage=\"verify\"");
+
+    // Values that are already counted elsewhere are read when exported.
+    metrics_.AddCallback(
+        "duplitrace_hash_cache_hits_total",
+        "Digests found in the hash cache", common::MetricType::COUNTER,
+        [this] {
+            return hash_cache_ ?
+                static_cast<double>(hash_cache_->Statistics().hits) : 0.0;
+        });
+    metrics_.AddCallback(
+        "duplitrace_hash_cache_misses_total",
+        "Digests not found in the hash cache", common::MetricType::COUNTER,
+        [this] {
+            return hash_cache_ ?
+                static_cast<double>(hash_cache_->Statistics().misses) : 0.0;
+        });
+    metrics_.AddCallback(
+        "duplitrace_worker_pending_tasks",
+        "Jobs waiting for a worker thread", common::MetricType::GAUGE,
+        [this] {
+            return worker_pool_ ?
+                static_cast<double>(worker_pool_->PendingTasks()) : 0.0;
+        });
+    metrics_.AddCallback(
+        "duplitrace_log_messages_dropped_total",
+        "Log messages lost because the log queue was full",
+        common::MetricType::COUNTER,
+        [this] {
+            if (!logger_) {
+                return 0.0;
+            }
+
+            common::LogQueueStatistics statistics = logger_->Statistics();
+            return static_cast<double>(statistics.discarded +
+                                       statistics.overrun);
+        });
+}
+
+/*
+Start exporting the metrics, to a text file that is rewritten on an interval
+and/or a Unix domain socket. The service still runs if the socket cannot be
+created.
+*/
+bool Service::InitialiseMetricsExport() {
+    if (!GET_METRICS_TEXT_FILE.empty()) {
+        if (GET_METRICS_FLUSH_INTERVAL <= 0) {
+            LOGGER->critical("Metrics flush interval must be greater than "
+                             "zero");
+            return false;
+        }
+
+        metrics_flush_time_ = std::time(nullptr);
+        FlushMetrics(*metrics_flush_time_);
+    }
+
+    if (GET_METRICS_SOCKET_PATH.empty()) {
+        return true;
+    }
+
+    auto endpoint = std::make_unique<common::MetricsEndpoint>(&metrics_,
+                                                              &event_loop_);
+
+    if (!endpoint->Listen(std::string(GET_METRICS_SOCKET_PATH))) {
+        LOGGER->warn("Unable to serve metrics on '{0}'",
+                     GET_METRICS_SOCKET_PATH);
+        return true;
+    }
+
+    LOGGER->info("Serving metrics on '{0}'", GET_METRICS_SOCKET_PATH);
+    metrics_endpoint_ = std::move(endpoint);
+
+    return true;
+}
+
+// Write the metrics text file, and set when it is next written.
+void Service::FlushMetrics(std::time_t now) {
+    if (!metrics_.WriteTextFile(std::string(GET_METRICS_TEXT_FILE))) {
+        LOGGER->warn("Unable to write the metrics file '{0}'",
+                     GET_METRICS_TEXT_FILE);
+    }
+
+    metrics_flush_time_ = now + GET_METRICS_FLUSH_INTERVAL;
+}
+
+// Earliest of the next scheduled job and the next metrics flush.
+std::optional<std::time_t> Service::NextDeadline() {
+    std::optional<std::time_t> deadline = scheduler_->NextDeadline();
+
+    if (metrics_flush_time_ &&
+        (!deadline || *metrics_flush_time_ < *deadline)) {
+        deadline = metrics_flush_time_;
+    }
+
+    return deadline;
+}
+
+bool Service::InitialiseEventLoop() {
+    if (!event_loop_.Initialise()) {
+        printf("[FATAL ERROR] Unable to initialise the event loop\n");
+        return false;
+    }
+
+    // Windows does not handle SIGINT properly, so disable... see MSDN:
+    // https://learn.microsoft.com/en-us/cpp/c-runtime-library/reference/signal?view=msvc-170
+#if DUPLITRACE_PLATFORM == DUPLITRACE_PLATFORM_LINUX
+    for (int signalNumber : { SIGINT, SIGTERM }) {
+        bool added = event_loop_.AddSignalHandler(signalNumber,
+            [this](int) {
+                LOGGER->info("Service shutdown signal has been caught...");
+                NotifyShutdownRequested();
+            });
+
+        if (!added) {
+            printf("[FATAL ERROR] Unable to set up signal handling\n");
+            return false;
+        }
+    }
+
+    bool added = event_loop_.AddSignalHandler(SIGHUP, [this](int) {
+        LOGGER->info("Configuration reload signal has been caught...");
+        ReloadConfiguration();
+    });
+
+    if (!added) {
+        printf("[FATAL ERROR] Unable to set up signal handling\n");
+        return false;
+    }
+#endif
+
+    worker_pool_ = std::make_unique<common::WorkerPool>(
+        SERVICE_WORKER_THREAD_COUNT,
+        [this] { event_loop_.Wake(); });
+    scheduler_ = std::make_unique<scheduler::Scheduler>(
+        worker_pool_.get(), scheduler_lag_metric_);
+
+    event_loop_.SetTimerCallback([this] {
+        std::time_t now = std::time(nullptr);
+
+        scheduler_->RunPending(now);
+
+        if (metrics_flush_time_ && *metrics_flush_time_ <= now) {
+            FlushMetrics(now);
+        }
+    });
+
+    return true;
 }
 
 bool Service::ReadConfiguration() {
-    common::ConfigSetup layout = common::ConfigSetup(*config_layout_);
+    // The layout is kept, as the configuration is read again on a reload.
+    config_setup_ = std::make_unique<common::ConfigSetup>(*config_layout_);
 
-    config_manager_.Configure(&layout, config_file_, true);
+    config_manager_.Configure(config_setup_.get(), config_file_, true);
 
     return config_manager_.processConfig();
 }
 
+/*
+Reload the configuration whenever its file is written, as well as on SIGHUP.
+If the file cannot be watched it is only reloaded on SIGHUP.
+*/
+void Service::WatchConfigFile() {
+    auto watcher = std::make_unique<common::io::FileWatcher>(config_file_);
+    common::io::FileWatcher* events = watcher.get();
+
+    if (!watcher->Initialise() ||
+        !event_loop_.AddFileDescriptor(events->FileDescriptor(),
+                                       [this, events] {
+                                           if (events->ProcessEvents()) {
+                                               ReloadConfiguration();
+                                           }
+                                       })) {
+        LOGGER->warn("Unable to watch '{0}' for changes, it is only "
+                     "reloaded on SIGHUP", config_file_);
+        return;
+    }
+
+    config_watcher_ = std::move(watcher);
+}
+
+/*
+Read the configuration file again. The new configuration replaces the
+current one in a single step, so threads reading settings never see a mix of
+the two. If it is not valid, or changes an item that is only read at start
+up, the current one is kept.
+*/
+void Service::ReloadConfiguration() {
+    LOGGER->info("Reloading the configuration from '{0}'", config_file_);
+
+    std::shared_ptr<const common::ConfigSnapshot> previous =
+        config_manager_.Snapshot();
+
+    bool reloaded = config_manager_.processConfig(
+        [this](const common::ConfigSnapshot& config) {
+            return ValidateConfiguration(config);
+        });
+
+    if (!reloaded) {
+        LOGGER->error("Configuration is not valid, the current configuration "
+                      "has been kept");
+        return;
+    }
+
+    ApplyConfiguration(*previous);
+    PrintConfigurationItems();
+}
+
+/*
+Check the values of a reloaded configuration that its layout cannot, those
+checked when the service starts.
+
+returns:
+    True if the configuration can be used.
+*/
+bool Service::ValidateConfiguration(const common::ConfigSnapshot& config) {
+    if (!config.String(CONFIG_KEY(METRICS_SECTION, METRICS_TEXT_FILE))
+             .empty() &&
+        config.Int(CONFIG_KEY(METRICS_SECTION, METRICS_FLUSH_INTERVAL)) <= 0) {
+        LOGGER->error("Metrics flush interval must be greater than zero");
+        return false;
+    }
+
+    std::unordered_map<uint64_t, size_t> depths;
+    std::string badEntry;
+    if (!common::io::ParseDeviceQueueDepths(
+            config.String(CONFIG_KEY(IO_SECTION, IO_DEVICE_QUEUE_DEPTHS)),
+            &depths, &badEntry)) {
+        LOGGER->error("Invalid device queue depth '{0}', expected an "
+                      "existing path and a depth, e.g. /mnt/nas:16",
+                      badEntry);
+        return false;
+    }
+
+    return true;
+}
+
+/*
+Put a reloaded configuration into effect. The log level, format and metrics
+file change at once. Scans that are running carry on with the settings they
+started with, and the next scans use the new ones.
+*/
+void Service::ApplyConfiguration(const common::ConfigSnapshot& previous) {
+    const common::ConfigSnapshot& current = config_manager_.Current();
+
+    logger_->set_level(GET_LOGGING_LOG_LEVEL == LOGGING_LOG_LEVEL_DEBUG ?
+                       spdlog::level::debug : spdlog::level::info);
+
+    if (!current.SameValue(previous,
+                           CONFIG_KEY(LOGGING_SECTION, LOGGING_LOG_FORMAT))) {
+        spdlog::set_pattern(std::string(GET_LOGGING_LOG_FORMAT));
+    }
+
+    if (GET_METRICS_TEXT_FILE.empty()) {
+        metrics_flush_time_.reset();
+    } else if (!metrics_flush_time_) {
+        FlushMetrics(std::time(nullptr));
+    }
+
+    if (hash_cache_ &&
+        (GET_DETECTION_SAMPLE_SIZE !=
+             static_cast<int>(hash_cache_->SampleSize()) ||
+         GET_DETECTION_HASH_ALGORITHM !=
+             common::hashing::HashAlgorithmName(hash_cache_->Algorithm()))) {
+        LOGGER->warn("The hash cache was built with another hash algorithm "
+                     "or sample size, it is not used until a restart");
+    }
+}
+
 bool Service::InitialiseLogger() {
     try {
+        GET_LOGGING_LOG_LEVEL;
         GET_LOGGING_LOG_TO_CONSOLE;
         GET_LOGGING_LOG_FILENAME;
         GET_LOGGING_MAX_FILE_SIZE;
         GET_LOGGING_MAX_FILE_COUNT;
         GET_LOGGING_LOG_FORMAT;
+        GET_LOGGING_QUEUE_SIZE;
+        GET_LOGGING_THREAD_COUNT;
+        GET_LOGGING_OVERFLOW_POLICY;
     }
     catch (const std::invalid_argument& ex) {
         printf("[FATAL ERROR] %s\n", ex.what());
         return false;
     }
 
-    spdlog::init_thread_pool(LOGGER_THREAD_SIZE, LOGGER_THREAD_COUNT);
+    if (GET_LOGGING_QUEUE_SIZE <= 0 || GET_LOGGING_THREAD_COUNT <= 0) {
+        printf("[FATAL ERROR] Logging queue size and thread count must be "
+               "greater than zero\n");
+        return false;
+    }
+
+    common::LogOverflowPolicy overflowPolicy =
+        common::LogOverflowPolicy::DISCARD;
+    if (GET_LOGGING_OVERFLOW_POLICY == LOGGING_OVERFLOW_POLICY_BLOCK) {
+        overflowPolicy = common::LogOverflowPolicy::BLOCK;
+    } else if (GET_LOGGING_OVERFLOW_POLICY ==
+               LOGGING_OVERFLOW_POLICY_OVERRUN_OLDEST) {
+        overflowPolicy = common::LogOverflowPolicy::OVERRUN_OLDEST;
+    }
+
+    size_t queueSize = static_cast<size_t>(GET_LOGGING_QUEUE_SIZE);
+    spdlog::init_thread_pool(queueSize,
+                             static_cast<size_t>(GET_LOGGING_THREAD_COUNT));
 
     std::vector<spdlog::sink_ptr> sinks;
 
@@ -141,7 +517,7 @@ bool Service::InitialiseLogger() {
             try {
                 auto sink = std::make_shared<
                     spdlog::sinks::rotating_file_sink_mt> (
-                        GET_LOGGING_LOG_FILENAME,
+                        std::string(GET_LOGGING_LOG_FILENAME),
                         GET_LOGGING_MAX_FILE_SIZE,
                         GET_LOGGING_MAX_FILE_COUNT);
                 sink->set_level(spdlog::level::debug);
@@ -159,7 +535,7 @@ bool Service::InitialiseLogger() {
                 const bool truncate = true;
                 auto sink = std::make_shared<
                     spdlog::sinks::basic_file_sink_mt> (
-                        GET_LOGGING_LOG_FILENAME.c_str(),
+                        std::string(GET_LOGGING_LOG_FILENAME).c_str(),
                         truncate);
                 sink->set_level(spdlog::level::debug);
                 sinks.push_back(sink);
@@ -174,17 +550,24 @@ bool Service::InitialiseLogger() {
         }
     }
 
-    auto logger = std::make_shared<spdlog::async_logger> (
+    logger_ = std::make_shared<common::CountingAsyncLogger> (
         LOGGER_NAME,
         sinks.begin(),
         sinks.end(),
         spdlog::thread_pool(),
-        spdlog::async_overflow_policy::block);
-    spdlog::register_logger(logger);
+        queueSize,
+        overflowPolicy);
+    logger_->set_level(GET_LOGGING_LOG_LEVEL == LOGGING_LOG_LEVEL_DEBUG ?
+                       spdlog::level::debug : spdlog::level::info);
+    spdlog::register_logger(logger_);
+
+    // LOGGER uses this logger directly from now on, without going through
+    // spdlog's registry.
+    common::LoggerHandle::Set(logger_);
 
     // Set the log format, based on the formatting pattern flags:
     // https://github.com/gabime/spdlog/wiki/3.-Custom-formatting
-    spdlog::set_pattern(GET_LOGGING_LOG_FORMAT);
+    spdlog::set_pattern(std::string(GET_LOGGING_LOG_FORMAT));
 
     return true;
 }
@@ -195,8 +578,7 @@ void Service::PrintConfigurationItems() {
     LOGGER->info("|=====================|");
 
     LOGGER->info("[LOGGING]");
-    LOGGER->info("-> Log Level      : {0}", config_manager_.GetStringEntry(
-                 "logging", "log_level").c_str());
+    LOGGER->info("-> Log Level      : {0}", GET_LOGGING_LOG_LEVEL);
     LOGGER->info("-> Log To Console : {0}", config_manager_.GetStringEntry(
                  "logging", "log_to_console").c_str ());
     LOGGER->info("-> Log Filename   : {0}", config_manager_.GetStringEntry(
@@ -207,6 +589,587 @@ void Service::PrintConfigurationItems() {
                  "logging", "max_file_count"));
     LOGGER->info("-> Log Format     : {0}", config_manager_.GetStringEntry(
                  "logging", "log_format").c_str());
+    LOGGER->info("-> Queue Size     : {0:d}", GET_LOGGING_QUEUE_SIZE);
+    LOGGER->info("-> Thread Count   : {0:d}", GET_LOGGING_THREAD_COUNT);
+    LOGGER->info("-> Overflow       : {0}", GET_LOGGING_OVERFLOW_POLICY);
+
+    LOGGER->info("[CRAWLER]");
+    LOGGER->info("-> Thread Count         : {0:d}",
+                 GET_CRAWLER_THREAD_COUNT);
+    LOGGER->info("-> Max Open Directories : {0:d}",
+                 GET_CRAWLER_MAX_OPEN_DIRECTORIES);
+    LOGGER->info("-> Scan Paths           : {0}", GET_CRAWLER_SCAN_PATHS);
+    LOGGER->info("-> Scan Schedule        : {0}", GET_CRAWLER_SCAN_SCHEDULE);
+
+    LOGGER->info("[DETECTION]");
+    LOGGER->info("-> Hash Thread Count : {0:d}",
+                 GET_DETECTION_HASH_THREAD_COUNT);
+    LOGGER->info("-> Sample Size       : {0:d} bytes",
+                 GET_DETECTION_SAMPLE_SIZE);
+    LOGGER->info("-> Hash Algorithm    : {0} ({1} kernel)",
+                 GET_DETECTION_HASH_ALGORITHM,
+                 common::hashing::HashKernelName(
+                     common::hashing::BestHashKernel()));
+    LOGGER->info("-> Verify Contents   : {0}", GET_DETECTION_VERIFY_CONTENTS);
+    LOGGER->info("-> Shared Extents    : {0}", GET_DETECTION_SHARED_EXTENTS);
+
+    LOGGER->info("[IO]");
+    LOGGER->info("-> Backend             : {0}", GET_IO_BACKEND);
+    LOGGER->info("-> Queue Depth         : {0:d}", GET_IO_QUEUE_DEPTH);
+    LOGGER->info("-> Device Queue Depths : {0}", GET_IO_DEVICE_QUEUE_DEPTHS);
+    LOGGER->info("-> Block Size          : {0:d} bytes", GET_IO_BLOCK_SIZE);
+    LOGGER->info("-> Thread Count        : {0:d}", GET_IO_THREAD_COUNT);
+
+    LOGGER->info("[HASH CACHE]");
+    LOGGER->info("-> Filename    : {0}", GET_HASH_CACHE_FILENAME);
+    LOGGER->info("-> Max Entries : {0:d}", GET_HASH_CACHE_MAX_ENTRIES);
+
+    LOGGER->info("[INDEX]");
+    LOGGER->info("-> Directory : {0}", GET_INDEX_DIRECTORY);
+
+    LOGGER->info("[WATCH]");
+    LOGGER->info("-> Backend         : {0}", GET_WATCH_BACKEND);
+    LOGGER->info("-> Update Schedule : {0}", GET_WATCH_UPDATE_SCHEDULE);
+
+    LOGGER->info("[METRICS]");
+    LOGGER->info("-> Text File      : {0}", GET_METRICS_TEXT_FILE);
+    LOGGER->info("-> Flush Interval : {0:d} seconds",
+                 GET_METRICS_FLUSH_INTERVAL);
+    LOGGER->info("-> Socket Path    : {0}", GET_METRICS_SOCKET_PATH);
+}
+
+/*
+Build the file reader settings used by every scan. The per-device queue
+depths are resolved to device numbers once, at start up and on a reload.
+*/
+bool Service::InitialiseReaderSettings() {
+    common::io::FileReaderSettings settings;
+    std::string badEntry;
+    if (!ReadReaderSettings(config_manager_.Current(), &settings,
+                            &badEntry)) {
+        LOGGER->critical("Invalid device queue depth '{0}', expected an "
+                         "existing path and a depth, e.g. /mnt/nas:16",
+                         badEntry);
+        return false;
+    }
+
+    // Report which back-end is really used, io_uring may be unavailable.
+    auto reader = common::io::CreateFileReader(settings);
+    LOGGER->info("File reads use the {0} back-end",
+                 common::io::FileReaderBackendName(reader->Backend()));
+
+    if (settings.backend == common::io::FileReaderBackend::IO_URING &&
+        reader->Backend() != common::io::FileReaderBackend::IO_URING) {
+        LOGGER->warn("io_uring is not available, falling back to pread");
+    }
+
+    return true;
+}
+
+// Read the file reader settings from a configuration.
+bool Service::ReadReaderSettings(const common::ConfigSnapshot& config,
+                                 common::io::FileReaderSettings* settings,
+                                 std::string* badEntry) {
+    common::io::FileReaderBackendFromName(
+        config.String(CONFIG_KEY(IO_SECTION, IO_BACKEND)),
+        &settings->backend);
+    settings->queue_depth = config.Int(CONFIG_KEY(IO_SECTION, IO_QUEUE_DEPTH));
+    settings->block_size = config.Int(CONFIG_KEY(IO_SECTION, IO_BLOCK_SIZE));
+    settings->thread_count =
+        config.Int(CONFIG_KEY(IO_SECTION, IO_THREAD_COUNT));
+
+    return common::io::ParseDeviceQueueDepths(
+        config.String(CONFIG_KEY(IO_SECTION, IO_DEVICE_QUEUE_DEPTHS)),
+        &settings->device_queue_depths, badEntry);
+}
+
+/*
+Load the hash cache that is shared by every scan. The service still runs
+without it if it cannot be loaded, every file is simply read on each scan.
+*/
+void Service::InitialiseHashCache() {
+    if (GET_HASH_CACHE_FILENAME.empty()) {
+        LOGGER->info("Hash cache is disabled");
+        return;
+    }
+
+    common::hashing::HashAlgorithm algorithm;
+    common::hashing::HashAlgorithmFromName(GET_DETECTION_HASH_ALGORITHM,
+                                           &algorithm);
+
+    auto cache = std::make_unique<HashCache>(
+        std::string(GET_HASH_CACHE_FILENAME),
+        static_cast<uint64_t>(GET_HASH_CACHE_MAX_ENTRIES),
+        algorithm, GET_DETECTION_SAMPLE_SIZE);
+
+    if (!cache->Load()) {
+        LOGGER->warn("Unable to load or create the hash cache '{0}', files "
+                     "will be read on every scan", GET_HASH_CACHE_FILENAME);
+        return;
+    }
+
+    LOGGER->info("Hash cache loaded with {0} entries",
+                 cache->Statistics().entries);
+    hash_cache_ = std::move(cache);
+}
+
+// Add a scheduled scan job for each of the configured scan paths.
+bool Service::ScheduleScans() {
+    std::vector<std::string> scanPaths;
+
+    std::string configuredPaths(GET_CRAWLER_SCAN_PATHS);
+
+    for (std::string_view path :
+         common::StringSplitter(configuredPaths, ',')) {
+        if (!path.empty()) {
+            scanPaths.emplace_back(path);
+        }
+    }
+
+    if (scanPaths.empty()) {
+        LOGGER->warn("No scan paths have been configured");
+        return true;
+    }
+
+    std::shared_ptr<const cronparser::CronTimeZone> timeZone;
+    std::string timeZoneName(GET_CRAWLER_SCHEDULE_TIME_ZONE);
+
+    if (!timeZoneName.empty()) {
+        try {
+            timeZone = cronparser::CronTimeZone::Find(timeZoneName);
+        }
+        catch (const cronparser::BadCronTimeZone& ex) {
+            LOGGER->critical("Invalid schedule time zone: {0}", ex.what());
+            return false;
+        }
+    }
+
+    try {
+        auto schedule = cronparser::CronExpressionCache::Global().Find(
+            GET_CRAWLER_SCAN_SCHEDULE);
+
+        for (const auto& path : scanPaths) {
+            scheduler_->AddJob(schedule,
+                               [this, path] { RunScan(path, false); },
+                               std::time(nullptr), timeZone);
+        }
+    }
+    catch (const cronparser::BadCronExpression& ex) {
+        LOGGER->critical("Invalid scan schedule '{0}': {1}",
+                         GET_CRAWLER_SCAN_SCHEDULE, ex.what());
+        return false;
+    }
+
+    if (GET_WATCH_BACKEND == WATCH_BACKEND_NONE) {
+        return true;
+    }
+
+    return WatchScanPaths(scanPaths, timeZone);
+}
+
+/*
+Watch each scan path for changes, the directories they happen in are scanned
+again on the update schedule and the rest of the index is carried over. The
+scheduled full scans are still run to catch anything that was missed. A path
+that cannot be watched is only scanned on schedule.
+*/
+bool Service::WatchScanPaths(
+        const std::vector<std::string>& scanPaths,
+        std::shared_ptr<const cronparser::CronTimeZone> timeZone) {
+    common::io::ChangeWatcherBackend backend;
+    common::io::ChangeWatcherBackendFromName(GET_WATCH_BACKEND, &backend);
+
+    std::shared_ptr<const cronparser::CompiledCronExpression> schedule;
+    try {
+        schedule = cronparser::CronExpressionCache::Global().Find(
+            GET_WATCH_UPDATE_SCHEDULE);
+    }
+    catch (const cronparser::BadCronExpression& ex) {
+        LOGGER->critical("Invalid update schedule '{0}': {1}",
+                         GET_WATCH_UPDATE_SCHEDULE, ex.what());
+        return false;
+    }
+
+    for (const auto& path : scanPaths) {
+        auto dirty = std::make_unique<common::io::DirtyDirectorySet>();
+        auto watcher = common::io::CreateChangeWatcher(backend, path,
+                                                       dirty.get());
+        if (!watcher) {
+            LOGGER->warn("Unable to watch '{0}' for changes, it will only "
+                         "be scanned on schedule", path);
+            continue;
+        }
+
+        common::io::ChangeWatcher* events = watcher.get();
+        if (!event_loop_.AddFileDescriptor(events->FileDescriptor(),
+                                           [events] {
+                                               events->ProcessEvents();
+                                           })) {
+            LOGGER->warn("Unable to watch '{0}' for changes, it will only "
+                         "be scanned on schedule", path);
+            continue;
+        }
+
+        LOGGER->info("Watching '{0}' for changes using {1}", path,
+                     common::io::ChangeWatcherBackendName(
+                         events->Backend()));
+
+        if (events->UnwatchedDirectories()) {
+            LOGGER->warn("-> {0} directories could not be watched, raise "
+                         "fs.inotify.max_user_watches to watch them",
+                         events->UnwatchedDirectories());
+        }
+
+        dirty_directories_[path] = std::move(dirty);
+        change_watchers_.push_back(std::move(watcher));
+        scheduler_->AddJob(schedule, [this, path] { RunScan(path, true); },
+                           std::time(nullptr), timeZone);
+    }
+
+    return true;
+}
+
+/*
+Removes a path from the active scans when it goes out of scope, so a scan
+that ends with an exception does not block every later scan of the path.
+*/
+class ActiveScanGuard {
+ public:
+    ActiveScanGuard(std::mutex* mutex, std::set<std::string>* scans,
+                    const std::string& path) :
+        mutex_(mutex), scans_(scans), path_(path) {}
+
+    ~ActiveScanGuard() {
+        std::lock_guard<std::mutex> lock(*mutex_);
+        scans_->erase(path_);
+    }
+
+    ActiveScanGuard(const ActiveScanGuard&) = delete;
+    ActiveScanGuard& operator=(const ActiveScanGuard&) = delete;
+
+ private:
+    std::mutex* mutex_;
+    std::set<std::string>* scans_;
+    std::string path_;
+};
+
+/*
+Scan a path and write its index. An incremental scan only crawls the
+directories that have changed since the last scan, carries everything else
+over from the previous index and updates it in place. Only the files whose
+size is shared with a file that was added, changed or removed go through the
+duplicate pipeline again.
+*/
+void Service::RunScan(const std::string& path, bool incremental) {
+    // Every setting is read from the configuration as it is now, so a reload
+    // while the scan runs cannot leave it with a mix of the two.
+    std::shared_ptr<const common::ConfigSnapshot> config =
+        config_manager_.Snapshot();
+
+    common::io::DirtyDirectorySet* dirtySet = nullptr;
+    auto watched = dirty_directories_.find(path);
+    if (watched != dirty_directories_.end()) {
+        dirtySet = watched->second.get();
+    }
+
+    if (incremental && (!dirtySet || dirtySet->Empty())) {
+        LOGGER_DEBUG("Nothing has changed under '{0}' since its last update",
+                     path);
+        return;
+    }
+
+    // A slow scan may still be running when its next trigger time arrives,
+    // changes are left for the next update.
+    {
+        std::lock_guard<std::mutex> lock(active_scans_mutex_);
+        if (!active_scans_.insert(path).second) {
+            if (!incremental) {
+                LOGGER->warn("Scan of '{0}' is still running, skipping",
+                             path);
+            }
+            return;
+        }
+    }
+    ActiveScanGuard activeScan(&active_scans_mutex_, &active_scans_, path);
+
+    // Changes made before now are picked up by this scan, whichever kind.
+    std::vector<common::io::DirtyDirectory> dirty;
+    if (dirtySet) {
+        dirty = dirtySet->Take();
+    }
+
+    if (incremental) {
+        LOGGER->info("Incremental scan of '{0}' has started, {1} "
+                     "directories have changed", path, dirty.size());
+    } else {
+        LOGGER->info("Scan of '{0}' has started", path);
+    }
+
+    auto startTime = std::chrono::steady_clock::now();
+    auto stopRequested = [this] { return worker_pool_->StopRequested(); };
+
+    // Every path found by the scan is interned here, the crawler, pipeline
+    // and index all refer to paths by their ids in the store.
+    common::PathStore paths;
+
+    DuplicatePipelineSettings pipelineSettings;
+    pipelineSettings.paths = &paths;
+    pipelineSettings.hash_thread_count = config->Int(
+        CONFIG_KEY(DETECTION_SECTION, DETECTION_HASH_THREAD_COUNT));
+    pipelineSettings.sample_size = config->Int(
+        CONFIG_KEY(DETECTION_SECTION, DETECTION_SAMPLE_SIZE));
+    common::hashing::HashAlgorithmFromName(
+        config->String(CONFIG_KEY(DETECTION_SECTION,
+                                  DETECTION_HASH_ALGORITHM)),
+        &pipelineSettings.hash_algorithm);
+    pipelineSettings.verify_contents = config->String(
+        CONFIG_KEY(DETECTION_SECTION, DETECTION_VERIFY_CONTENTS)) ==
+        DETECTION_VERIFY_CONTENTS_YES;
+    pipelineSettings.detect_shared_extents = config->String(
+        CONFIG_KEY(DETECTION_SECTION, DETECTION_SHARED_EXTENTS)) ==
+        DETECTION_SHARED_EXTENTS_YES;
+
+    // The device queue depths were checked when the configuration was read,
+    // but a device may have gone since.
+    std::string badEntry;
+    if (!ReadReaderSettings(*config, &pipelineSettings.reader, &badEntry)) {
+        LOGGER->warn("Invalid device queue depth '{0}', device queue depths "
+                     "are not used for this scan", badEntry);
+        pipelineSettings.reader.device_queue_depths.clear();
+    }
+
+    // The hash cache only holds digests taken with the algorithm and sample
+    // size it was loaded with, these may have been changed by a reload.
+    if (hash_cache_ &&
+        hash_cache_->Algorithm() == pipelineSettings.hash_algorithm &&
+        hash_cache_->SampleSize() == pipelineSettings.sample_size) {
+        pipelineSettings.hash_cache = hash_cache_.get();
+    }
+    pipelineSettings.metrics = &pipeline_metrics_;
+    DuplicatePipeline pipeline(pipelineSettings);
+    ScanIndexBuilder index(pipelineSettings.hash_algorithm, paths);
+
+    std::string indexFilename = IndexFilename(*config, path);
+    common::index::IndexReader previous;
+    common::index::IndexUpdater indexUpdate;
+    IncrementalScanPlan plan;
+
+    if (incremental &&
+        (indexFilename.empty() || !previous.Open(indexFilename) ||
+         !indexUpdate.Open(indexFilename) ||
+         !PlanIncrementalScan(previous, path, dirty, &paths, &plan))) {
+        LOGGER->info("-> There is no usable index of '{0}', running a full "
+                     "scan instead", path);
+        incremental = false;
+    }
+
+    ScanIndexUpdater update(previous, paths, plan, &indexUpdate);
+
+    // Every link to a file goes in the index, but only the first one found
+    // is hashed. An incremental scan only knows what to hash once the crawl
+    // has finished.
+    common::InodeSet inodes;
+
+    CrawlerFileVisitor crawlFile =
+        [this, &pipeline, &index, &update, &paths, incremental](
+                const CrawlerFileEntry& file) {
+            files_crawled_metric_->Add();
+            LOGGER_TRACE("Found '{0}'",
+                         paths.FilePath(file.directory, file.name));
+
+            if (incremental) {
+                update.AddFile(file);
+                return;
+            }
+
+            uint64_t indexFile = index.AddFile(file);
+
+            if (!file.first_link) {
+                return;
+            }
+
+            pipeline.AddFile({ file.directory, file.name,
+                               file.size, file.device, file.inode,
+                               file.modified_time_ns,
+                               file.changed_time_ns, indexFile });
+        };
+
+    Crawler crawler(
+        config->Int(CONFIG_KEY(CRAWLER_SECTION, CRAWLER_THREAD_COUNT)),
+        config->Int(CONFIG_KEY(CRAWLER_SECTION, CRAWLER_MAX_OPEN_DIRECTORIES)),
+        &paths, &inodes);
+    CrawlerStatistics statistics;
+
+    LOGGER_DEBUG("Keeping up to {0} directories open while crawling",
+                 crawler.MaxOpenDirectories());
+
+    if (incremental) {
+        for (auto& file : plan.unchanged_files) {
+            if (file.link_count > 1) {
+                file.first_link = inodes.Insert(file.device, file.inode);
+            }
+        }
+
+        LOGGER->info("-> Crawling {0} changed directories, {1} unchanged "
+                     "files carried over", plan.directories.size(),
+                     plan.unchanged_files.size());
+        statistics = crawler.Crawl(plan.directories, crawlFile,
+                                   stopRequested);
+    } else {
+        statistics = crawler.Crawl({ path }, crawlFile, stopRequested);
+    }
+
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - startTime;
+
+    LOGGER->info("Scan of '{0}' crawled in {1:.2f}s: {2} directories, "
+                 "{3} files, {4} bytes, {5} errors", path, elapsed.count(),
+                 statistics.directories, statistics.files, statistics.bytes,
+                 statistics.errors);
+    LOGGER->info("-> {0} files were further hard links, tracked in {1} "
+                 "bytes", statistics.links, inodes.MemoryUsage());
+    LOGGER->info("-> Paths interned as {0} directories and {1} distinct "
+                 "names ({2} bytes), using {3} bytes", paths.DirectoryCount(),
+                 paths.NameCount(), paths.NameBytes(), paths.MemoryUsage());
+
+    if (incremental && !stopRequested()) {
+        for (const auto& candidate : update.Resolve()) {
+            pipeline.AddFile(candidate);
+        }
+
+        LOGGER->info("-> {0} files were added, {1} changed and {2} removed",
+                     update.FilesAdded(), update.FilesChanged(),
+                     update.FilesRemoved());
+
+        if (!update.Changed()) {
+            LOGGER->info("Index of '{0}' is up to date", path);
+            ReportLogQueue();
+            return;
+        }
+    }
+
+    std::vector<DuplicateGroup> duplicates = pipeline.Run(stopRequested);
+    DuplicatePipelineStatistics detection = pipeline.Statistics();
+
+    uint64_t duplicateFiles = 0;
+    uint64_t wastedBytes = 0;
+    for (const auto& group : duplicates) {
+        duplicateFiles += group.files.size() - 1;
+        wastedBytes += group.size * (group.files.size() - 1);
+    }
+
+    elapsed = std::chrono::steady_clock::now() - startTime;
+    scan_time_metric_->Record(static_cast<uint64_t>(elapsed.count() * 1000));
+
+    LOGGER->info("Scan of '{0}' completed in {1:.2f}s: {2} duplicate "
+                 "groups, {3} redundant files, {4} redundant bytes", path,
+                 elapsed.count(), duplicates.size(), duplicateFiles,
+                 wastedBytes);
+    LOGGER->info("-> Sampled {0} and fully hashed {1} of {2} candidate "
+                 "files, {3} bytes read, {4} read errors",
+                 detection.files_sampled, detection.files_fully_hashed,
+                 detection.candidate_files, detection.bytes_read,
+                 detection.read_errors);
+    LOGGER->info("-> {0} digests were taken from the hash cache, {1} "
+                 "files were in shared extents", detection.files_from_cache,
+                 detection.files_shared_extents);
+
+    if (hash_cache_ && detection.candidate_files &&
+        !hash_cache_->Save()) {
+        LOGGER->warn("Unable to save the hash cache '{0}'",
+                     config->String(CONFIG_KEY(HASH_CACHE_SECTION,
+                                               HASH_CACHE_FILENAME)));
+    }
+
+    // A stopped scan is incomplete, so the previous index is kept and the
+    // changes it was picking up are left for the next one.
+    if (stopRequested()) {
+        for (const auto& directory : dirty) {
+            dirtySet->Mark(directory.path, directory.recursive);
+        }
+    } else if (incremental) {
+        update.AddDuplicateGroups(duplicates);
+        update.AddSharedExtentGroups(pipeline.SharedExtentGroups());
+        update.Finish();
+
+        // The update is written to the file the previous index was read
+        // from, which cannot stay mapped while it is written on Windows.
+        previous.Close();
+
+        bool inPlace = false;
+        if (!indexUpdate.Write(&inPlace)) {
+            LOGGER->warn("Unable to update the index '{0}'", indexFilename);
+        } else if (inPlace) {
+            LOGGER->info("-> Index '{0}' updated in place", indexFilename);
+        } else {
+            LOGGER->info("-> Index '{0}' was full, it has been rewritten",
+                         indexFilename);
+        }
+    } else if (!indexFilename.empty()) {
+        index.AddDuplicateGroups(duplicates);
+        index.AddSharedExtentGroups(pipeline.SharedExtentGroups());
+
+        if (index.Write(indexFilename)) {
+            LOGGER->info("-> Index written to '{0}'", indexFilename);
+        } else {
+            LOGGER->warn("Unable to write the index '{0}'", indexFilename);
+        }
+    }
+
+    ReportLogQueue();
+}
+
+/*
+Warn if the log queue has overflowed since start-up, as the log is then
+missing messages or logging has held up the threads doing the work.
+*/
+void Service::ReportLogQueue() {
+    common::LogQueueStatistics statistics = logger_->Statistics();
+
+    if (statistics.discarded || statistics.overrun) {
+        LOGGER->warn("Log queue was full, {0} new messages were discarded "
+                     "and {1} queued messages were overrun since start-up",
+                     statistics.discarded, statistics.overrun);
+    }
+
+    if (statistics.blocked) {
+        LOGGER->warn("Log queue was full, {0} messages waited for room "
+                     "since start-up", statistics.blocked);
+    }
+}
+
+/*
+Get the index filename for a scan path, the path with its separators
+replaced, e.g. /data/photos is indexed in <directory>/data_photos.dtindex.
+
+returns:
+    Filename, or empty if indexes are disabled.
+*/
+std::string Service::IndexFilename(const common::ConfigSnapshot& config,
+                                   const std::string& path) {
+    std::string directory(
+        config.String(CONFIG_KEY(INDEX_SECTION, INDEX_DIRECTORY)));
+    if (directory.empty()) {
+        return "";
+    }
+
+    std::string name;
+    for (char character : path) {
+        bool separator = character == '/' || character == '\\' ||
+                         character == ':';
+
+        if (!separator) {
+            name += character;
+        } else if (!name.empty() && name.back() != '_') {
+            name += '_';
+        }
+    }
+
+    if (!name.empty() && name.back() == '_') {
+        name.pop_back();
+    }
+
+    return directory + "/" + (name.empty() ? "root" : name) + ".dtindex";
 }
 
 }   // namespace indexer
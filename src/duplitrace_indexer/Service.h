@@ -19,10 +19,32 @@ Copyright 2024 DupliTrace Development Team
 */
 #ifndef SERVICE_H_
 #define SERVICE_H_
+#include <atomic>
+#include <ctime>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
 #include <string>
+#include <vector>
 #include "ConfigManager.h"
+#include "DuplicatePipeline.h"
+#include "EventLoop.h"
+#include "HashCache.h"
+#include "Metrics.h"
+#include "MetricsEndpoint.h"
+#include "WorkerPool.h"
+#include "io/ChangeWatcher.h"
+#include "io/FileReader.h"
+#include "io/FileWatcher.h"
+#include "../scheduler/Scheduler.h"
 
-namespace duplitrace { namespace indexer {
+namespace duplitrace {
+
+namespace common { class CountingAsyncLogger; }
+
+namespace indexer {
 
 class Service {
  public:
@@ -38,15 +60,73 @@ class Service {
      bool initialised_;
      std::string config_file_;
      common::SectionsMap *config_layout_;
+     std::unique_ptr<common::ConfigSetup> config_setup_;
      common::ConfigManager config_manager_;
-     bool shutdown_requested_;
+     std::unique_ptr<common::io::FileWatcher> config_watcher_;
+     std::atomic<bool> shutdown_requested_;
+     common::EventLoop event_loop_;
+     std::unique_ptr<common::WorkerPool> worker_pool_;
+     std::unique_ptr<scheduler::Scheduler> scheduler_;
+     std::mutex active_scans_mutex_;
+     std::set<std::string> active_scans_;
+     std::unique_ptr<HashCache> hash_cache_;
+     std::map<std::string, std::unique_ptr<common::io::DirtyDirectorySet>>
+         dirty_directories_;
+     std::vector<std::unique_ptr<common::io::ChangeWatcher>> change_watchers_;
+     std::shared_ptr<common::CountingAsyncLogger> logger_;
+     common::MetricsRegistry metrics_;
+     DuplicatePipelineMetrics pipeline_metrics_;
+     common::MetricCounter* files_crawled_metric_;
+     common::MetricHistogram* scan_time_metric_;
+     common::MetricHistogram* scheduler_lag_metric_;
+     std::unique_ptr<common::MetricsEndpoint> metrics_endpoint_;
+     std::optional<std::time_t> metrics_flush_time_;
+
+     void InitialiseMetrics();
+
+     bool InitialiseEventLoop();
 
      bool ReadConfiguration();
 
+     void WatchConfigFile();
+
+     void ReloadConfiguration();
+
+     bool ValidateConfiguration(const common::ConfigSnapshot& config);
+
+     void ApplyConfiguration(const common::ConfigSnapshot& previous);
+
      bool InitialiseLogger();
 
      void PrintConfigurationItems();
 
+     void ReportLogQueue();
+
+     bool InitialiseReaderSettings();
+
+     bool ReadReaderSettings(const common::ConfigSnapshot& config,
+                             common::io::FileReaderSettings* settings,
+                             std::string* badEntry);
+
+     void InitialiseHashCache();
+
+     bool InitialiseMetricsExport();
+
+     void FlushMetrics(std::time_t now);
+
+     std::optional<std::time_t> NextDeadline();
+
+     bool ScheduleScans();
+
+     bool WatchScanPaths(
+         const std::vector<std::string>& scanPaths,
+         std::shared_ptr<const cronparser::CronTimeZone> timeZone);
+
+     void RunScan(const std::string& path, bool incremental);
+
+     std::string IndexFilename(const common::ConfigSnapshot& config,
+                               const std::string& path);
+
      void Shutdown();
 };
 
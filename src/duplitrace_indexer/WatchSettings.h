@@ -0,0 +1,75 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#ifndef WATCHSETTINGS_H_
+#define WATCHSETTINGS_H_
+#include <string>
+#include "ConfigSetup.h"
+#include "ConfigSetupItem.h"
+
+namespace duplitrace { namespace indexer {
+
+constexpr char WATCH_SECTION[] = "watch";
+
+// How changes to the scan paths are watched for, NONE disables watching so
+// changes are only picked up by the scheduled scans.
+constexpr char WATCH_BACKEND[] = "backend";
+constexpr char WATCH_BACKEND_NONE[] = "NONE";
+constexpr char WATCH_BACKEND_AUTOMATIC[] = "AUTOMATIC";
+constexpr char WATCH_BACKEND_FANOTIFY[] = "FANOTIFY";
+constexpr char WATCH_BACKEND_INOTIFY[] = "INOTIFY";
+
+// Cron expression for when the directories that have changed are scanned
+// and the index is updated, hourly by default. An update with nothing to do
+// costs nothing, but each one that has changes re-hashes whole size groups.
+constexpr char WATCH_UPDATE_SCHEDULE[] = "update_schedule";
+constexpr char WATCH_UPDATE_SCHEDULE_DEFAULT[] = "0 0 * * * *";
+
+const common::SectionList WatchSettings = {
+    {
+        WATCH_BACKEND,
+        common::ConfigSetupItem(WATCH_BACKEND,
+                                common::CONFIG_ITEM_TYPE_STRING)
+                .RestartRequired(true)
+                .DefaultValue(WATCH_BACKEND_NONE)
+                .ValidValues(common::StringList{
+                    WATCH_BACKEND_NONE,
+                    WATCH_BACKEND_AUTOMATIC,
+                    WATCH_BACKEND_FANOTIFY,
+                    WATCH_BACKEND_INOTIFY })
+    },
+    {
+        WATCH_UPDATE_SCHEDULE,
+        common::ConfigSetupItem(WATCH_UPDATE_SCHEDULE,
+                                common::CONFIG_ITEM_TYPE_STRING)
+                .RestartRequired(true)
+                .DefaultValue(WATCH_UPDATE_SCHEDULE_DEFAULT)
+    }
+};
+
+#define GET_WATCH_BACKEND config_manager_.Current().String(\
+            CONFIG_KEY(WATCH_SECTION, WATCH_BACKEND))
+
+#define GET_WATCH_UPDATE_SCHEDULE config_manager_.Current().String(\
+            CONFIG_KEY(WATCH_SECTION, WATCH_UPDATE_SCHEDULE))
+
+}   // namespace indexer
+}   // namespace duplitrace
+
+#endif  // WATCHSETTINGS_H_
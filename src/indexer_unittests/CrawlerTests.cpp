@@ -0,0 +1,195 @@
+#include <sys/resource.h>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+#include "gtest/gtest.h"
+#include "Crawler.h"
+
+using duplitrace::common::InodeSet;
+using duplitrace::common::PATH_STORE_NO_DIRECTORY;
+using duplitrace::common::PathStore;
+using duplitrace::indexer::Crawler;
+using duplitrace::indexer::CrawlerDirectory;
+using duplitrace::indexer::CrawlerFileEntry;
+using duplitrace::indexer::CrawlerStatistics;
+
+class CrawlerTest : public ::testing::Test {
+ protected:
+    void SetUp() override {
+        directory_ = std::filesystem::temp_directory_path() /
+                     "duplitrace_crawler_test";
+        std::filesystem::remove_all(directory_);
+        std::filesystem::create_directories(directory_);
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(directory_);
+    }
+
+    std::string WriteFile(const std::string& name, size_t length) {
+        std::filesystem::path path = directory_ / name;
+        std::filesystem::create_directories(path.parent_path());
+
+        std::ofstream file(path, std::ios::binary);
+        file << std::string(length, 'x');
+
+        return path.string();
+    }
+
+    // Crawls the given roots, returning the size of every file found by
+    // its path.
+    CrawlerStatistics Crawl(const std::vector<std::string>& roots,
+                            std::map<std::string, uint64_t>* found) {
+        Crawler crawler(4, 16, &paths_, &inodes_);
+        std::mutex mutex;
+
+        return crawler.Crawl(roots, [&](const CrawlerFileEntry& file) {
+            std::lock_guard<std::mutex> lock(mutex);
+            (*found)[paths_.FilePath(file.directory, file.name)] = file.size;
+            entries_.push_back(file);
+        });
+    }
+
+    std::filesystem::path directory_;
+    PathStore paths_;
+    InodeSet inodes_;
+    std::vector<CrawlerFileEntry> entries_;
+};
+
+TEST_F(CrawlerTest, FindsEveryFileInTheTree) {
+    std::string top = WriteFile("top.txt", 10);
+    std::string middle = WriteFile("photos/middle.jpg", 20);
+    std::string bottom = WriteFile("photos/2024/march/bottom.jpg", 30);
+    std::filesystem::create_directories(directory_ / "empty");
+
+    // Symbolic links are neither followed nor reported.
+    std::filesystem::create_symlink(top, directory_ / "link.txt");
+    std::filesystem::create_directory_symlink(directory_ / "photos",
+                                              directory_ / "linked_photos");
+
+    std::map<std::string, uint64_t> found;
+    CrawlerStatistics statistics = Crawl({ directory_.string() }, &found);
+
+    std::map<std::string, uint64_t> expected {
+        { top, 10 }, { middle, 20 }, { bottom, 30 }
+    };
+    EXPECT_EQ(found, expected);
+    EXPECT_EQ(statistics.directories, 5u);
+    EXPECT_EQ(statistics.files, 3u);
+    EXPECT_EQ(statistics.bytes, 60u);
+    EXPECT_EQ(statistics.errors, 0u);
+    EXPECT_EQ(statistics.links, 0u);
+}
+
+TEST_F(CrawlerTest, HardLinksAfterTheFirstAreMarked) {
+    std::string original = WriteFile("original.bin", 100);
+    std::filesystem::create_directories(directory_ / "other");
+    std::filesystem::create_hard_link(original,
+                                      directory_ / "other" / "link.bin");
+
+    std::map<std::string, uint64_t> found;
+    CrawlerStatistics statistics = Crawl({ directory_.string() }, &found);
+
+    EXPECT_EQ(found.size(), 2u);
+    EXPECT_EQ(statistics.files, 2u);
+    EXPECT_EQ(statistics.links, 1u);
+
+    // The shared contents are only counted once.
+    EXPECT_EQ(statistics.bytes, 100u);
+
+    ASSERT_EQ(entries_.size(), 2u);
+    EXPECT_NE(entries_[0].first_link, entries_[1].first_link);
+    EXPECT_EQ(entries_[0].inode, entries_[1].inode);
+    EXPECT_EQ(entries_[0].link_count, 2u);
+}
+
+TEST_F(CrawlerTest, MissingRootIsNotAnError) {
+    std::map<std::string, uint64_t> found;
+    CrawlerStatistics statistics =
+        Crawl({ (directory_ / "missing").string() }, &found);
+
+    EXPECT_TRUE(found.empty());
+    EXPECT_EQ(statistics.directories, 0u);
+    EXPECT_EQ(statistics.errors, 0u);
+}
+
+TEST_F(CrawlerTest, NonRecursiveDirectoryOnlyVisitsItsOwnFiles) {
+    std::string top = WriteFile("top.txt", 10);
+    WriteFile("nested/below.txt", 20);
+
+    Crawler crawler(2, 16, &paths_);
+    uint32_t root = paths_.AddDirectory(PATH_STORE_NO_DIRECTORY,
+                                        directory_.string());
+    std::vector<std::string> found;
+
+    CrawlerStatistics statistics = crawler.Crawl(
+        std::vector<CrawlerDirectory> { { root, false } },
+        [&](const CrawlerFileEntry& file) {
+            found.push_back(paths_.FilePath(file.directory, file.name));
+        });
+
+    EXPECT_EQ(found, std::vector<std::string> { top });
+    EXPECT_EQ(statistics.directories, 1u);
+    EXPECT_EQ(statistics.files, 1u);
+}
+
+TEST_F(CrawlerTest, StopRequestLeavesTheTreeUnvisited) {
+    WriteFile("top.txt", 10);
+    WriteFile("nested/below.txt", 20);
+
+    Crawler crawler(2, 16, &paths_);
+    size_t visited = 0;
+
+    CrawlerStatistics statistics = crawler.Crawl(
+        std::vector<std::string> { directory_.string() },
+        [&](const CrawlerFileEntry&) { visited++; },
+        [] { return true; });
+
+    EXPECT_EQ(visited, 0u);
+    EXPECT_EQ(statistics.directories, 0u);
+    EXPECT_EQ(statistics.files, 0u);
+}
+
+TEST_F(CrawlerTest, RunningOutOfDescriptorsFallsBackToPaths) {
+    for (int i = 0; i < 10; i++) {
+        WriteFile("branch" + std::to_string(i) + "/leaf/file.txt", 10);
+    }
+
+    Crawler crawler(1, 0, &paths_);
+    EXPECT_GT(crawler.MaxOpenDirectories(), 0u);
+
+    // Leave two descriptors free, the one used to list the open descriptors
+    // and the next free one, so that opening a leaf relative to its branch
+    // fails while the root and the branch are kept open.
+    std::set<int> openDescriptors;
+    for (const auto& entry :
+         std::filesystem::directory_iterator("/proc/self/fd")) {
+        openDescriptors.insert(std::stoi(entry.path().filename().string()));
+    }
+
+    rlim_t descriptorLimit = 0;
+    while (openDescriptors.count(static_cast<int>(descriptorLimit))) {
+        descriptorLimit++;
+    }
+
+    struct rlimit original;
+    ASSERT_EQ(getrlimit(RLIMIT_NOFILE, &original), 0);
+    struct rlimit lowered = original;
+    lowered.rlim_cur = descriptorLimit + 1;
+    ASSERT_EQ(setrlimit(RLIMIT_NOFILE, &lowered), 0);
+
+    size_t visited = 0;
+    CrawlerStatistics statistics = crawler.Crawl(
+        std::vector<std::string> { directory_.string() },
+        [&](const CrawlerFileEntry&) { visited++; });
+
+    setrlimit(RLIMIT_NOFILE, &original);
+
+    EXPECT_EQ(visited, 10u);
+    EXPECT_EQ(statistics.directories, 21u);
+    EXPECT_EQ(statistics.errors, 0u);
+}
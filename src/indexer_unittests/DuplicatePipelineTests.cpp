@@ -0,0 +1,198 @@
+#include <sys/stat.h>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "gtest/gtest.h"
+#include "DuplicatePipeline.h"
+
+using duplitrace::common::PATH_STORE_NO_DIRECTORY;
+using duplitrace::common::PathStore;
+using duplitrace::indexer::DuplicateCandidate;
+using duplitrace::indexer::DuplicateGroup;
+using duplitrace::indexer::DuplicatePipeline;
+using duplitrace::indexer::DuplicatePipelineSettings;
+using duplitrace::indexer::DuplicatePipelineStatistics;
+
+// Bytes hashed from each end of a file, files up to twice this are hashed
+// in full by the sample stage.
+const size_t PIPELINE_TEST_SAMPLE_SIZE = 1024;
+
+class DuplicatePipelineTest : public ::testing::Test {
+ protected:
+    void SetUp() override {
+        directory_ = std::filesystem::temp_directory_path() /
+                     "duplitrace_duplicate_pipeline_test";
+        std::filesystem::remove_all(directory_);
+        std::filesystem::create_directories(directory_);
+
+        root_ = paths_.AddDirectory(PATH_STORE_NO_DIRECTORY,
+                                    directory_.string());
+
+        settings_.paths = &paths_;
+        settings_.sample_size = PIPELINE_TEST_SAMPLE_SIZE;
+        settings_.detect_shared_extents = false;
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(directory_);
+    }
+
+    // Writes a file and returns it as a candidate, as the crawler would.
+    DuplicateCandidate WriteFile(const std::string& name,
+                                 const std::string& contents) {
+        std::filesystem::path path = directory_ / name;
+        std::ofstream(path, std::ios::binary) << contents;
+
+        struct stat status;
+        stat(path.c_str(), &status);
+
+        return { root_, paths_.InternName(name),
+                 static_cast<uint64_t>(status.st_size),
+                 static_cast<uint64_t>(status.st_dev),
+                 static_cast<uint64_t>(status.st_ino),
+                 status.st_mtim.tv_sec * 1000000000LL +
+                     status.st_mtim.tv_nsec,
+                 status.st_ctim.tv_sec * 1000000000LL +
+                     status.st_ctim.tv_nsec,
+                 0 };
+    }
+
+    // Data of the given length that is the same at both ends for every seed,
+    // but differs in the middle.
+    static std::string Contents(size_t length, char seed) {
+        std::string data(length, 'a');
+        data[length / 2] = seed;
+        return data;
+    }
+
+    // The names in each group, sorted so that groups compare in any order.
+    std::vector<std::vector<std::string>> Names(
+            const std::vector<DuplicateGroup>& groups) {
+        std::vector<std::vector<std::string>> names;
+
+        for (const auto& group : groups) {
+            names.emplace_back();
+            for (const auto& file : group.files) {
+                names.back().emplace_back(paths_.Name(file.name));
+            }
+            std::sort(names.back().begin(), names.back().end());
+        }
+
+        std::sort(names.begin(), names.end());
+        return names;
+    }
+
+    std::filesystem::path directory_;
+    PathStore paths_;
+    uint32_t root_;
+    DuplicatePipelineSettings settings_;
+};
+
+TEST_F(DuplicatePipelineTest, GroupsFilesWithTheSameContents) {
+    DuplicatePipeline pipeline(settings_);
+
+    pipeline.AddFile(WriteFile("first.bin", Contents(10000, 'x')));
+    pipeline.AddFile(WriteFile("second.bin", Contents(10000, 'x')));
+    pipeline.AddFile(WriteFile("third.bin", Contents(10000, 'x')));
+
+    // Same size and sample as the group, but not the same contents.
+    pipeline.AddFile(WriteFile("near_miss.bin", Contents(10000, 'y')));
+
+    pipeline.AddFile(WriteFile("other_size.bin", Contents(9999, 'x')));
+    pipeline.AddFile(WriteFile("empty_1.bin", ""));
+    pipeline.AddFile(WriteFile("empty_2.bin", ""));
+
+    std::vector<DuplicateGroup> groups = pipeline.Run();
+
+    std::vector<std::vector<std::string>> expected {
+        { "first.bin", "second.bin", "third.bin" }
+    };
+    EXPECT_EQ(Names(groups), expected);
+    ASSERT_EQ(groups.size(), 1u);
+    EXPECT_EQ(groups[0].size, 10000u);
+
+    // Empty files are never candidates and a file with a size of its own
+    // is never read.
+    DuplicatePipelineStatistics statistics = pipeline.Statistics();
+    EXPECT_EQ(statistics.candidate_files, 5u);
+    EXPECT_EQ(statistics.files_sampled, 4u);
+    EXPECT_EQ(statistics.files_fully_hashed, 4u);
+    EXPECT_EQ(statistics.read_errors, 0u);
+}
+
+TEST_F(DuplicatePipelineTest, DifferentSamplesAreNotHashedInFull) {
+    DuplicatePipeline pipeline(settings_);
+
+    pipeline.AddFile(WriteFile("first.bin", "x" + std::string(9999, 'a')));
+    pipeline.AddFile(WriteFile("second.bin", "y" + std::string(9999, 'a')));
+
+    EXPECT_TRUE(pipeline.Run().empty());
+
+    DuplicatePipelineStatistics statistics = pipeline.Statistics();
+    EXPECT_EQ(statistics.files_sampled, 2u);
+    EXPECT_EQ(statistics.files_fully_hashed, 0u);
+}
+
+TEST_F(DuplicatePipelineTest, SmallFilesAreOnlyReadOnce) {
+    DuplicatePipeline pipeline(settings_);
+    size_t length = 2 * PIPELINE_TEST_SAMPLE_SIZE;
+
+    pipeline.AddFile(WriteFile("first.bin", Contents(length, 'x')));
+    pipeline.AddFile(WriteFile("second.bin", Contents(length, 'x')));
+    pipeline.AddFile(WriteFile("third.bin", Contents(length, 'y')));
+
+    std::vector<std::vector<std::string>> expected {
+        { "first.bin", "second.bin" }
+    };
+    EXPECT_EQ(Names(pipeline.Run()), expected);
+
+    DuplicatePipelineStatistics statistics = pipeline.Statistics();
+    EXPECT_EQ(statistics.files_sampled, 3u);
+    EXPECT_EQ(statistics.files_fully_hashed, 0u);
+    EXPECT_EQ(statistics.bytes_read, 3 * length);
+}
+
+TEST_F(DuplicatePipelineTest, VerifyingComparesEveryGroupedFile) {
+    settings_.verify_contents = true;
+    DuplicatePipeline pipeline(settings_);
+
+    pipeline.AddFile(WriteFile("first.bin", Contents(10000, 'x')));
+    pipeline.AddFile(WriteFile("second.bin", Contents(10000, 'x')));
+    pipeline.AddFile(WriteFile("third.bin", Contents(10000, 'y')));
+
+    std::vector<std::vector<std::string>> expected {
+        { "first.bin", "second.bin" }
+    };
+    EXPECT_EQ(Names(pipeline.Run()), expected);
+    EXPECT_EQ(pipeline.Statistics().files_verified, 2u);
+}
+
+TEST_F(DuplicatePipelineTest, UnreadableFileIsLeftOut) {
+    DuplicatePipeline pipeline(settings_);
+
+    pipeline.AddFile(WriteFile("first.bin", Contents(10000, 'x')));
+    pipeline.AddFile(WriteFile("second.bin", Contents(10000, 'x')));
+
+    DuplicateCandidate removed = WriteFile("removed.bin",
+                                           Contents(10000, 'x'));
+    std::filesystem::remove(directory_ / "removed.bin");
+    pipeline.AddFile(removed);
+
+    std::vector<std::vector<std::string>> expected {
+        { "first.bin", "second.bin" }
+    };
+    EXPECT_EQ(Names(pipeline.Run()), expected);
+    EXPECT_EQ(pipeline.Statistics().read_errors, 1u);
+}
+
+TEST_F(DuplicatePipelineTest, StopRequestDropsRemainingWork) {
+    DuplicatePipeline pipeline(settings_);
+
+    pipeline.AddFile(WriteFile("first.bin", Contents(10000, 'x')));
+    pipeline.AddFile(WriteFile("second.bin", Contents(10000, 'x')));
+
+    EXPECT_TRUE(pipeline.Run([] { return true; }).empty());
+    EXPECT_EQ(pipeline.Statistics().files_sampled, 0u);
+}
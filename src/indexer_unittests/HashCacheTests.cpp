@@ -0,0 +1,353 @@
+#include <sys/stat.h>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include "gtest/gtest.h"
+#include "DuplicatePipeline.h"
+#include "HashCache.h"
+
+using duplitrace::common::PATH_STORE_NO_DIRECTORY;
+using duplitrace::common::PathStore;
+using duplitrace::common::hashing::HashAlgorithm;
+using duplitrace::common::hashing::HashDigest;
+using duplitrace::indexer::DuplicateCandidate;
+using duplitrace::indexer::DuplicatePipeline;
+using duplitrace::indexer::DuplicatePipelineSettings;
+using duplitrace::indexer::DuplicatePipelineStatistics;
+using duplitrace::indexer::HashCache;
+using duplitrace::indexer::HashCacheDigest;
+using duplitrace::indexer::HashCacheKey;
+
+// Sizes of the cache file's header and of each record in it.
+const uint64_t HASH_CACHE_TEST_HEADER_SIZE = 32;
+const uint64_t HASH_CACHE_TEST_RECORD_SIZE = 120;
+
+const uint64_t HASH_CACHE_TEST_MAXIMUM_ENTRIES = 8192;
+
+const size_t HASH_CACHE_TEST_SAMPLE_SIZE = 1024;
+
+class HashCacheTest : public ::testing::Test {
+ protected:
+    void SetUp() override {
+        directory_ = std::filesystem::temp_directory_path() /
+                     "duplitrace_hash_cache_test";
+        std::filesystem::remove_all(directory_);
+        std::filesystem::create_directories(directory_);
+
+        filename_ = (directory_ / "hashes.cache").string();
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(directory_);
+    }
+
+    static HashDigest Digest(uint8_t value) {
+        HashDigest digest;
+        digest.bytes.fill(value);
+        digest.size = digest.bytes.size();
+        return digest;
+    }
+
+    std::unique_ptr<HashCache> CreateCache(
+            HashAlgorithm algorithm = HashAlgorithm::BLAKE3,
+            size_t sampleSize = HASH_CACHE_TEST_SAMPLE_SIZE,
+            uint64_t maxEntries = HASH_CACHE_TEST_MAXIMUM_ENTRIES) {
+        auto cache = std::make_unique<HashCache>(filename_, maxEntries,
+                                                 algorithm, sampleSize);
+        EXPECT_TRUE(cache->Load());
+        return cache;
+    }
+
+    std::filesystem::path directory_;
+    std::string filename_;
+};
+
+TEST_F(HashCacheTest, OnlyTheSameVersionOfAFileHits) {
+    auto cache = CreateCache();
+    HashCacheKey key { 1, 100, 4096, 1000, 2000 };
+    HashDigest digest;
+
+    cache->Store(key, HashCacheDigest::SAMPLE, Digest(7));
+
+    EXPECT_TRUE(cache->Lookup(key, HashCacheDigest::SAMPLE, &digest));
+    EXPECT_EQ(digest, Digest(7));
+
+    // Only the sample was stored.
+    EXPECT_FALSE(cache->Lookup(key, HashCacheDigest::CONTENTS, &digest));
+
+    HashCacheKey resized = key;
+    resized.size = 4097;
+    EXPECT_FALSE(cache->Lookup(resized, HashCacheDigest::SAMPLE, &digest));
+
+    HashCacheKey modified = key;
+    modified.modified_time_ns = 1001;
+    EXPECT_FALSE(cache->Lookup(modified, HashCacheDigest::SAMPLE, &digest));
+
+    HashCacheKey changed = key;
+    changed.changed_time_ns = 2001;
+    EXPECT_FALSE(cache->Lookup(changed, HashCacheDigest::SAMPLE, &digest));
+
+    HashCacheKey otherDevice = key;
+    otherDevice.device = 2;
+    EXPECT_FALSE(cache->Lookup(otherDevice, HashCacheDigest::SAMPLE,
+                               &digest));
+
+    EXPECT_EQ(cache->Statistics().hits, 1u);
+    EXPECT_EQ(cache->Statistics().misses, 5u);
+}
+
+TEST_F(HashCacheTest, NewVersionReplacesEveryDigestOfTheOld) {
+    auto cache = CreateCache();
+    HashCacheKey original { 1, 100, 4096, 1000, 2000 };
+    HashCacheKey rewritten { 1, 100, 4096, 3000, 4000 };
+    HashDigest digest;
+
+    cache->Store(original, HashCacheDigest::SAMPLE, Digest(1));
+    cache->Store(original, HashCacheDigest::CONTENTS, Digest(2));
+    cache->Store(rewritten, HashCacheDigest::SAMPLE, Digest(3));
+
+    EXPECT_TRUE(cache->Lookup(rewritten, HashCacheDigest::SAMPLE, &digest));
+    EXPECT_EQ(digest, Digest(3));
+    EXPECT_FALSE(cache->Lookup(rewritten, HashCacheDigest::CONTENTS,
+                               &digest));
+    EXPECT_FALSE(cache->Lookup(original, HashCacheDigest::SAMPLE, &digest));
+    EXPECT_EQ(cache->Statistics().entries, 1u);
+}
+
+TEST_F(HashCacheTest, FilesWithoutAnInodeAreNotCached) {
+    auto cache = CreateCache();
+    HashCacheKey key { 1, 0, 4096, 1000, 2000 };
+    HashDigest digest;
+
+    cache->Store(key, HashCacheDigest::SAMPLE, Digest(1));
+
+    EXPECT_FALSE(cache->Lookup(key, HashCacheDigest::SAMPLE, &digest));
+    EXPECT_EQ(cache->Statistics().entries, 0u);
+}
+
+TEST_F(HashCacheTest, SavedEntriesAreLoadedAgain) {
+    HashCacheKey key { 1, 100, 4096, 1000, 2000 };
+    HashDigest digest;
+
+    {
+        auto cache = CreateCache();
+        cache->Store(key, HashCacheDigest::SAMPLE, Digest(1));
+        cache->Store(key, HashCacheDigest::CONTENTS, Digest(2));
+        EXPECT_TRUE(cache->Save());
+    }
+
+    auto cache = CreateCache();
+    EXPECT_EQ(cache->Statistics().entries, 1u);
+    EXPECT_TRUE(cache->Lookup(key, HashCacheDigest::SAMPLE, &digest));
+    EXPECT_EQ(digest, Digest(1));
+    EXPECT_TRUE(cache->Lookup(key, HashCacheDigest::CONTENTS, &digest));
+    EXPECT_EQ(digest, Digest(2));
+}
+
+TEST_F(HashCacheTest, AppendedEntriesAreReplayedInOrder) {
+    HashCacheKey original { 1, 100, 4096, 1000, 2000 };
+    HashCacheKey rewritten { 1, 100, 8192, 3000, 4000 };
+    HashDigest digest;
+
+    {
+        auto cache = CreateCache();
+        cache->Store(original, HashCacheDigest::CONTENTS, Digest(1));
+        EXPECT_TRUE(cache->Flush());
+        cache->Store(rewritten, HashCacheDigest::CONTENTS, Digest(2));
+
+        // Destroying the cache appends whatever has not been flushed.
+    }
+
+    auto cache = CreateCache();
+    EXPECT_FALSE(cache->Lookup(original, HashCacheDigest::CONTENTS,
+                               &digest));
+    EXPECT_TRUE(cache->Lookup(rewritten, HashCacheDigest::CONTENTS,
+                              &digest));
+    EXPECT_EQ(digest, Digest(2));
+}
+
+TEST_F(HashCacheTest, ChangedSettingsDiscardTheCache) {
+    HashCacheKey key { 1, 100, 4096, 1000, 2000 };
+    HashDigest digest;
+
+    {
+        auto cache = CreateCache();
+        cache->Store(key, HashCacheDigest::SAMPLE, Digest(1));
+        EXPECT_TRUE(cache->Save());
+    }
+
+    EXPECT_FALSE(CreateCache(HashAlgorithm::XXH3)->Lookup(
+        key, HashCacheDigest::SAMPLE, &digest));
+
+    // The XXH3 cache replaced the file, so rebuild it before changing the
+    // sample size.
+    {
+        auto cache = CreateCache();
+        cache->Store(key, HashCacheDigest::SAMPLE, Digest(1));
+        EXPECT_TRUE(cache->Save());
+    }
+
+    EXPECT_FALSE(CreateCache(HashAlgorithm::BLAKE3, 2048)->Lookup(
+        key, HashCacheDigest::SAMPLE, &digest));
+}
+
+TEST_F(HashCacheTest, LeastRecentlyUsedEntriesAreDropped) {
+    auto cache = CreateCache(HashAlgorithm::BLAKE3,
+                             HASH_CACHE_TEST_SAMPLE_SIZE, 2);
+    HashCacheKey first { 1, 100, 4096, 1000, 2000 };
+    HashCacheKey second { 1, 101, 4096, 1000, 2000 };
+    HashCacheKey third { 1, 102, 4096, 1000, 2000 };
+    HashDigest digest;
+
+    cache->Store(first, HashCacheDigest::SAMPLE, Digest(1));
+    cache->Store(second, HashCacheDigest::SAMPLE, Digest(2));
+    EXPECT_TRUE(cache->Save());
+
+    EXPECT_TRUE(cache->Lookup(first, HashCacheDigest::SAMPLE, &digest));
+    cache->Store(third, HashCacheDigest::SAMPLE, Digest(3));
+    EXPECT_TRUE(cache->Save());
+
+    EXPECT_EQ(cache->Statistics().entries, 2u);
+    EXPECT_TRUE(cache->Lookup(first, HashCacheDigest::SAMPLE, &digest));
+    EXPECT_FALSE(cache->Lookup(second, HashCacheDigest::SAMPLE, &digest));
+    EXPECT_TRUE(cache->Lookup(third, HashCacheDigest::SAMPLE, &digest));
+}
+
+TEST_F(HashCacheTest, FileStaysWithinTheMaximumEntriesBetweenSaves) {
+    const uint64_t maxEntries = 16;
+    auto cache = CreateCache(HashAlgorithm::BLAKE3,
+                             HASH_CACHE_TEST_SAMPLE_SIZE, maxEntries);
+
+    for (uint64_t inode = 1; inode <= 100; inode++) {
+        cache->Store({ 1, inode, 4096, 1000, 2000 }, HashCacheDigest::SAMPLE,
+                     Digest(1));
+        EXPECT_LE(cache->Statistics().entries, maxEntries);
+    }
+    EXPECT_TRUE(cache->Flush());
+
+    EXPECT_LE(cache->Statistics().records, maxEntries);
+    EXPECT_LE(std::filesystem::file_size(filename_),
+              HASH_CACHE_TEST_HEADER_SIZE +
+                  maxEntries * HASH_CACHE_TEST_RECORD_SIZE);
+}
+
+TEST_F(HashCacheTest, SaveOnlyCompactsOnceRecordsAreSuperseded) {
+    auto cache = CreateCache();
+
+    for (uint64_t inode = 1; inode <= 10; inode++) {
+        cache->Store({ 1, inode, 4096, 1000, 2000 }, HashCacheDigest::SAMPLE,
+                     Digest(1));
+    }
+    EXPECT_TRUE(cache->Save());
+    EXPECT_EQ(cache->Statistics().records, 10u);
+
+    // A single changed file is appended.
+    cache->Store({ 1, 1, 4096, 1000, 3000 }, HashCacheDigest::SAMPLE,
+                 Digest(2));
+    EXPECT_TRUE(cache->Save());
+    EXPECT_EQ(cache->Statistics().records, 11u);
+    EXPECT_EQ(std::filesystem::file_size(filename_),
+              HASH_CACHE_TEST_HEADER_SIZE + 11 * HASH_CACHE_TEST_RECORD_SIZE);
+
+    // Once more than a quarter of the records are stale the file is
+    // compacted to one record per file.
+    for (uint64_t inode = 2; inode <= 5; inode++) {
+        cache->Store({ 1, inode, 4096, 1000, 3000 }, HashCacheDigest::SAMPLE,
+                     Digest(2));
+    }
+    EXPECT_TRUE(cache->Save());
+    EXPECT_EQ(cache->Statistics().records, 10u);
+
+    auto reloaded = CreateCache();
+    HashDigest digest;
+    EXPECT_EQ(reloaded->Statistics().entries, 10u);
+    EXPECT_TRUE(reloaded->Lookup({ 1, 5, 4096, 1000, 3000 },
+                                 HashCacheDigest::SAMPLE, &digest));
+    EXPECT_EQ(digest.bytes[0], 2);
+}
+
+// Runs the duplicate pipeline over files on disk, with the cache in front of
+// it, the way a scan does.
+class HashCachePipelineTest : public HashCacheTest {
+ protected:
+    void SetUp() override {
+        HashCacheTest::SetUp();
+        root_ = paths_.AddDirectory(PATH_STORE_NO_DIRECTORY,
+                                    directory_.string());
+    }
+
+    void WriteFile(const std::string& name, const std::string& contents) {
+        std::ofstream(directory_ / name, std::ios::binary) << contents;
+    }
+
+    DuplicateCandidate Candidate(const std::string& name) {
+        struct stat status;
+        stat((directory_ / name).c_str(), &status);
+
+        return { root_, paths_.InternName(name),
+                 static_cast<uint64_t>(status.st_size),
+                 static_cast<uint64_t>(status.st_dev),
+                 static_cast<uint64_t>(status.st_ino),
+                 status.st_mtim.tv_sec * 1000000000LL +
+                     status.st_mtim.tv_nsec,
+                 status.st_ctim.tv_sec * 1000000000LL +
+                     status.st_ctim.tv_nsec,
+                 0 };
+    }
+
+    // Scans the files, returning the number of duplicate groups found.
+    size_t Scan(HashCache* cache, DuplicatePipelineStatistics* statistics) {
+        DuplicatePipelineSettings settings;
+        settings.paths = &paths_;
+        settings.sample_size = HASH_CACHE_TEST_SAMPLE_SIZE;
+        settings.detect_shared_extents = false;
+        settings.hash_cache = cache;
+
+        DuplicatePipeline pipeline(settings);
+        for (const char* name : { "first.bin", "second.bin" }) {
+            pipeline.AddFile(Candidate(name));
+        }
+
+        size_t groups = pipeline.Run().size();
+        *statistics = pipeline.Statistics();
+        return groups;
+    }
+
+    PathStore paths_;
+    uint32_t root_;
+};
+
+TEST_F(HashCachePipelineTest, ChangedFilesAreReadAgain) {
+    std::string contents(10000, 'a');
+    WriteFile("first.bin", contents);
+    WriteFile("second.bin", contents);
+
+    auto cache = CreateCache();
+    DuplicatePipelineStatistics statistics;
+
+    EXPECT_EQ(Scan(cache.get(), &statistics), 1u);
+    EXPECT_EQ(statistics.files_from_cache, 0u);
+    EXPECT_EQ(statistics.files_fully_hashed, 2u);
+
+    // Nothing has changed, so nothing is read.
+    EXPECT_EQ(Scan(cache.get(), &statistics), 1u);
+    EXPECT_EQ(statistics.files_from_cache, 4u);
+    EXPECT_EQ(statistics.bytes_read, 0u);
+
+    // Rewrite one file in the middle, where the sample does not look, and
+    // move its modification time on so the change cannot go unnoticed on
+    // filesystems with coarse timestamps.
+    contents[5000] = 'b';
+    WriteFile("second.bin", contents);
+    std::filesystem::last_write_time(
+        directory_ / "second.bin",
+        std::filesystem::last_write_time(directory_ / "first.bin") +
+            std::chrono::seconds(10));
+
+    EXPECT_EQ(Scan(cache.get(), &statistics), 0u);
+    EXPECT_EQ(statistics.files_from_cache, 2u);
+    EXPECT_EQ(statistics.files_sampled, 1u);
+    EXPECT_EQ(statistics.files_fully_hashed, 1u);
+}
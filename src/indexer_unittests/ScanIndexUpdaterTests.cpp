@@ -0,0 +1,257 @@
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include "gtest/gtest.h"
+#include "IncrementalScan.h"
+#include "ScanIndexBuilder.h"
+#include "ScanIndexUpdater.h"
+#include "index/IndexReader.h"
+#include "index/IndexUpdater.h"
+
+using duplitrace::common::PATH_STORE_NO_DIRECTORY;
+using duplitrace::common::PathStore;
+using duplitrace::common::hashing::HashAlgorithm;
+using duplitrace::common::hashing::HashDigest;
+using duplitrace::common::index::INDEX_REMOVED_FILE;
+using duplitrace::common::index::IndexLinkKind;
+using duplitrace::common::index::IndexReader;
+using duplitrace::common::index::IndexUpdater;
+using duplitrace::common::io::DirtyDirectory;
+using duplitrace::indexer::CrawlerFileEntry;
+using duplitrace::indexer::DuplicateCandidate;
+using duplitrace::indexer::DuplicateGroup;
+using duplitrace::indexer::IncrementalScanPlan;
+using duplitrace::indexer::PlanIncrementalScan;
+using duplitrace::indexer::ScanIndexBuilder;
+using duplitrace::indexer::ScanIndexUpdater;
+
+/*
+An index of /data with files a/x and a/y, duplicates of 100 bytes, and b/z
+and b/w of 200 and 300 bytes. The incremental scans are given the files a
+crawl would find, rather than crawling a real tree.
+*/
+class ScanIndexUpdaterTest : public ::testing::Test {
+ protected:
+    void SetUp() override {
+        filename_ = (std::filesystem::temp_directory_path() /
+                     "duplitrace_scan_update_test.dtindex").string();
+
+        PathStore paths;
+        ScanIndexBuilder builder(HashAlgorithm::XXH3, paths);
+        uint32_t root = paths.AddDirectory(PATH_STORE_NO_DIRECTORY, "/data");
+        uint32_t a = paths.AddDirectory(root, "a");
+        uint32_t b = paths.AddDirectory(root, "b");
+
+        uint64_t x = builder.AddFile(File(a, paths.InternName("x"), 1, 100));
+        uint64_t y = builder.AddFile(File(a, paths.InternName("y"), 2, 100));
+        builder.AddFile(File(b, paths.InternName("z"), 3, 200));
+        builder.AddFile(File(b, paths.InternName("w"), 4, 300));
+
+        builder.AddDuplicateGroups({ Group(100, TestDigest(0x11),
+                                           { { a, 0, 100, 1, 1, 0, 0, x },
+                                             { a, 0, 100, 1, 2, 0, 0, y } })
+                                   });
+        ASSERT_TRUE(builder.Write(filename_));
+    }
+
+    void TearDown() override {
+        std::remove(filename_.c_str());
+    }
+
+    static CrawlerFileEntry File(uint32_t directory, uint32_t name,
+                                 uint64_t inode, uint64_t size) {
+        return { directory, name, 1, inode, size, 10, 20, 1, true };
+    }
+
+    static HashDigest TestDigest(uint8_t value) {
+        HashDigest digest;
+        digest.size = 8;
+        std::fill(digest.bytes.begin(), digest.bytes.begin() + digest.size,
+                  value);
+        return digest;
+    }
+
+    static DuplicateGroup Group(uint64_t size, const HashDigest& digest,
+                                std::vector<DuplicateCandidate> files) {
+        DuplicateGroup group;
+        group.size = size;
+        group.files = std::move(files);
+        group.digest = digest;
+        return group;
+    }
+
+    // Open the index and plan an update of it for the dirty directories.
+    bool Plan(const std::vector<DirtyDirectory>& dirty) {
+        return previous_.Open(filename_) && update_.Open(filename_) &&
+               PlanIncrementalScan(previous_, "/data", dirty, &paths_,
+                                   &plan_);
+    }
+
+    // Id of a directory below the root in the path store, as the crawler
+    // would add it.
+    uint32_t Directory(const char* name) {
+        return paths_.AddDirectory(0, name);
+    }
+
+    std::string filename_;
+    PathStore paths_;
+    IndexReader previous_;
+    IndexUpdater update_;
+    IncrementalScanPlan plan_;
+};
+
+TEST_F(ScanIndexUpdaterTest, UnchangedFilesLeaveIndexAsItWas) {
+    ASSERT_TRUE(Plan({ { "/data", true } }));
+    EXPECT_EQ(plan_.unchanged_files.size(), 0u);
+    EXPECT_EQ(plan_.dirty_files.size(), 4u);
+
+    // The crawler adds the directories again as it crawls the tree.
+    ScanIndexUpdater scan(previous_, paths_, plan_, &update_);
+    uint32_t a = Directory("a");
+    uint32_t b = Directory("b");
+    scan.AddFile(File(a, paths_.InternName("x"), 1, 100));
+    scan.AddFile(File(a, paths_.InternName("y"), 2, 100));
+    scan.AddFile(File(b, paths_.InternName("z"), 3, 200));
+    scan.AddFile(File(b, paths_.InternName("w"), 4, 300));
+
+    EXPECT_TRUE(scan.Resolve().empty());
+    EXPECT_FALSE(scan.Changed());
+    EXPECT_EQ(scan.FilesAdded() + scan.FilesChanged() + scan.FilesRemoved(),
+              0u);
+}
+
+TEST_F(ScanIndexUpdaterTest, OnlyChangedSizesAreHashedAgain) {
+    ASSERT_TRUE(Plan({ { "/data/a", false } }));
+    ASSERT_EQ(plan_.unchanged_files.size(), 2u);
+
+    // y has grown to 300 bytes and v is new, x is unchanged.
+    ScanIndexUpdater scan(previous_, paths_, plan_, &update_);
+    uint32_t a = plan_.directories[0].id;
+    scan.AddFile(File(a, paths_.InternName("x"), 1, 100));
+    scan.AddFile(File(a, paths_.InternName("y"), 2, 300));
+    scan.AddFile(File(a, paths_.InternName("v"), 5, 200));
+
+    std::vector<DuplicateCandidate> candidates = scan.Resolve();
+    EXPECT_TRUE(scan.Changed());
+    EXPECT_EQ(scan.FilesAdded(), 1u);
+    EXPECT_EQ(scan.FilesChanged(), 1u);
+    EXPECT_EQ(scan.FilesRemoved(), 0u);
+
+    // Every file of 100, 200 or 300 bytes, crawled or carried over.
+    ASSERT_EQ(candidates.size(), 5u);
+
+    uint64_t y = 1;
+    uint64_t z = 2;
+    uint64_t w = 3;
+    uint64_t v = 4;
+    for (const auto& candidate : candidates) {
+        EXPECT_LE(candidate.index_file, v);
+    }
+
+    scan.AddDuplicateGroups({
+        Group(300, TestDigest(0x22), { { a, 0, 300, 1, 2, 0, 0, y },
+                                       { 2, 0, 300, 1, 4, 0, 0, w } }),
+        Group(200, TestDigest(0x33), { { 2, 0, 200, 1, 3, 0, 0, z },
+                                       { a, 0, 200, 1, 5, 0, 0, v } })
+    });
+    scan.AddSharedExtentGroups({});
+    scan.Finish();
+    previous_.Close();
+
+    bool inPlace = false;
+    ASSERT_TRUE(update_.Write(&inPlace));
+    EXPECT_TRUE(inPlace);
+
+    IndexReader reader;
+    ASSERT_TRUE(reader.Open(filename_));
+    ASSERT_EQ(reader.FileCount(), 5u);
+    EXPECT_EQ(reader.DirectoryCount(), 3u);
+    EXPECT_EQ(reader.FilePath(v), "/data/a/v");
+    EXPECT_EQ(reader.FileSizes()[y], 300u);
+    EXPECT_EQ(reader.FileDigest(y), TestDigest(0x22));
+    EXPECT_EQ(reader.FileDigest(v), TestDigest(0x33));
+
+    // The group of 100 byte files has gone, x has no duplicate now.
+    EXPECT_EQ(reader.Group(0).size, 0u);
+    EXPECT_EQ(reader.GroupsOfAtLeast(0), (std::vector<uint64_t> { 1, 2 }));
+}
+
+TEST_F(ScanIndexUpdaterTest, FilesNotFoundAgainAreRemoved) {
+    ASSERT_TRUE(Plan({ { "/data/a", false } }));
+
+    // x is all that is left, and c is a new directory.
+    ScanIndexUpdater scan(previous_, paths_, plan_, &update_);
+    scan.AddFile(File(plan_.directories[0].id, paths_.InternName("x"), 1,
+                      100));
+    scan.AddFile(File(Directory("c"), paths_.InternName("x"), 6, 400));
+
+    std::vector<DuplicateCandidate> candidates = scan.Resolve();
+    EXPECT_EQ(scan.FilesAdded(), 1u);
+    EXPECT_EQ(scan.FilesRemoved(), 1u);
+    ASSERT_EQ(candidates.size(), 2u);
+
+    scan.AddDuplicateGroups({});
+    scan.AddSharedExtentGroups({});
+    scan.Finish();
+    previous_.Close();
+    ASSERT_TRUE(update_.Write());
+
+    IndexReader reader;
+    ASSERT_TRUE(reader.Open(filename_));
+    EXPECT_EQ(reader.FileDirectories()[1], INDEX_REMOVED_FILE);
+    EXPECT_EQ(reader.FilePath(4), "/data/c/x");
+    EXPECT_TRUE(reader.GroupsOfAtLeast(0).empty());
+
+    // The removed file is carried over by no later update.
+    IndexUpdater nextUpdate;
+    PathStore nextPaths;
+    IncrementalScanPlan nextPlan;
+    ASSERT_TRUE(nextUpdate.Open(filename_));
+    ASSERT_TRUE(PlanIncrementalScan(reader, "/data", { { "/data/b", false } },
+                                    &nextPaths, &nextPlan));
+    EXPECT_EQ(nextPlan.unchanged_files.size(), 2u);
+    EXPECT_EQ(nextPlan.dirty_files.size(), 2u);
+}
+
+TEST_F(ScanIndexUpdaterTest, HardLinksAreGrouped) {
+    ASSERT_TRUE(Plan({ { "/data/a", false } }));
+
+    // x has been replaced by a file with a second link, u.
+    ScanIndexUpdater scan(previous_, paths_, plan_, &update_);
+    uint32_t a = plan_.directories[0].id;
+    CrawlerFileEntry x = File(a, paths_.InternName("x"), 7, 100);
+    CrawlerFileEntry u = File(a, paths_.InternName("u"), 7, 100);
+    x.link_count = 2;
+    u.link_count = 2;
+    u.first_link = false;
+
+    scan.AddFile(x);
+    scan.AddFile(File(a, paths_.InternName("y"), 2, 100));
+    scan.AddFile(u);
+
+    // Only the first link is hashed.
+    std::vector<DuplicateCandidate> candidates = scan.Resolve();
+    ASSERT_EQ(candidates.size(), 2u);
+    EXPECT_EQ(scan.FilesChanged(), 1u);
+
+    scan.AddDuplicateGroups({
+        Group(100, TestDigest(0x44), { { a, 0, 100, 1, 7, 0, 0, 0 },
+                                       { a, 0, 100, 1, 2, 0, 0, 1 } })
+    });
+    scan.AddSharedExtentGroups({});
+    scan.Finish();
+    previous_.Close();
+    ASSERT_TRUE(update_.Write());
+
+    IndexReader reader;
+    ASSERT_TRUE(reader.Open(filename_));
+    ASSERT_EQ(reader.LinkGroupCount(), 1u);
+
+    auto links = reader.LinkGroup(0);
+    EXPECT_EQ(links.kind, IndexLinkKind::HARD_LINK);
+    EXPECT_EQ(std::vector<uint64_t>(links.files.begin(), links.files.end()),
+              (std::vector<uint64_t> { 0, 4 }));
+    EXPECT_EQ(reader.FileDigest(4), TestDigest(0x44));
+}
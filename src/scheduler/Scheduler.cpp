@@ -0,0 +1,220 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <utility>
+#include "Scheduler.h"
+#include "Utilities.h"
+
+namespace duplitrace { namespace scheduler {
+
+Scheduler::Scheduler(common::WorkerPool* workerPool,
+                     common::MetricHistogram* lag) :
+    worker_pool_(workerPool),
+    lag_(lag),
+    next_job_id_(1) {
+}
+
+/*
+Register a cron job, its first fire time is the first trigger after 'now'.
+The job is evaluated in the given time zone, or in local time if there isn't
+one. A BadCronExpression exception is thrown if the expression never
+triggers.
+
+returns:
+    Identifier used to remove the job again.
+*/
+ScheduledJobId Scheduler::AddJob(
+        const cronparser::CronExpression& expression,
+        ScheduledJobCallback callback,
+        std::time_t now,
+        std::shared_ptr<const cronparser::CronTimeZone> timeZone) {
+    return AddJob(
+        std::make_shared<const cronparser::CompiledCronExpression>(expression),
+        std::move(callback), now, std::move(timeZone));
+}
+
+// Register a cron job with an expression that may be shared with other jobs,
+// e.g. from a CronExpressionCache.
+ScheduledJobId Scheduler::AddJob(
+        std::shared_ptr<const cronparser::CompiledCronExpression> expression,
+        ScheduledJobCallback callback,
+        std::time_t now,
+        std::shared_ptr<const cronparser::CronTimeZone> timeZone) {
+    std::time_t fireTime = CalculateNextFireTime(*expression, timeZone.get(),
+                                                 now);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    ScheduledJobId jobId = next_job_id_++;
+    jobs_.insert({ jobId, { std::move(expression), std::move(timeZone),
+                            std::move(callback), fireTime } });
+    PushHeapEntry(fireTime, jobId);
+
+    return jobId;
+}
+
+/*
+Remove a job. Its heap entry is left in place and is discarded when it reaches
+the top of the heap, which keeps removal O(1).
+*/
+bool Scheduler::RemoveJob(ScheduledJobId jobId) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (jobs_.erase(jobId) == 0) {
+        return false;
+    }
+
+    // Stop removed jobs from bloating the heap when they are churned.
+    if (heap_.size() > 2 * jobs_.size() + 64) {
+        heap_.erase(std::remove_if(heap_.begin(), heap_.end(),
+                                   [this](const HeapEntry& entry) {
+                                       return IsHeapEntryStale(entry);
+                                   }),
+                    heap_.end());
+        std::make_heap(heap_.begin(), heap_.end(), std::greater<HeapEntry>());
+    }
+
+    return true;
+}
+
+size_t Scheduler::JobCount() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return jobs_.size();
+}
+
+/*
+Get the time the next job is due to fire.
+
+returns:
+    Time of the earliest job, or no value if no jobs are registered.
+*/
+std::optional<std::time_t> Scheduler::NextDeadline() {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    DiscardStaleHeapEntries();
+
+    if (heap_.empty()) {
+        return std::nullopt;
+    }
+
+    return heap_.front().fire_time;
+}
+
+/*
+Fire every job that is due at or before 'now' onto the worker pool. If the
+scheduler has fallen behind (e.g. the host was suspended) a job only fires
+once and its next fire time is calculated from 'now', missed triggers are not
+replayed.
+
+returns:
+    Number of jobs that were fired.
+*/
+size_t Scheduler::RunPending(std::time_t now) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t fired = 0;
+
+    while (true) {
+        DiscardStaleHeapEntries();
+
+        if (heap_.empty() || heap_.front().fire_time > now) {
+            break;
+        }
+
+        std::pop_heap(heap_.begin(), heap_.end(), std::greater<HeapEntry>());
+        HeapEntry entry = heap_.back();
+        heap_.pop_back();
+
+        auto& job = jobs_.at(entry.job_id);
+        if (lag_) {
+            worker_pool_->Submit([lag = lag_, fireTime = entry.fire_time,
+                                  callback = job.callback] {
+                auto started = std::chrono::duration_cast<
+                    std::chrono::milliseconds>(
+                        std::chrono::system_clock::now().time_since_epoch());
+                int64_t late = started.count() -
+                               static_cast<int64_t>(fireTime) * 1000;
+                lag->Record(late > 0 ? static_cast<uint64_t>(late) : 0);
+                callback();
+            });
+        } else {
+            worker_pool_->Submit(job.callback);
+        }
+        fired++;
+
+        try {
+            job.next_fire_time = CalculateNextFireTime(
+                *job.expression, job.time_zone.get(),
+                std::max(entry.fire_time, now));
+            PushHeapEntry(job.next_fire_time, entry.job_id);
+        }
+        catch (const cronparser::BadCronExpression&) {
+            jobs_.erase(entry.job_id);
+        }
+    }
+
+    return fired;
+}
+
+std::time_t Scheduler::CalculateNextFireTime(
+        const cronparser::CompiledCronExpression& expression,
+        const cronparser::CronTimeZone* timeZone, std::time_t after) {
+    if (timeZone != nullptr) {
+        return expression.getNextTriggerTime(after, *timeZone);
+    }
+
+    // A time past what the C library can represent has no trigger time left.
+    std::tm afterTime;
+    if (common::StdTimeToStdTm(&after, &afterTime) == nullptr) {
+        throw cronparser::BadCronExpression(
+            "Cron expression has no future trigger time");
+    }
+
+    std::tm nextTime = expression.getNextTriggerTime(afterTime);
+    std::time_t next = common::StdTmToStdTime(nextTime);
+    if (next == static_cast<std::time_t>(-1)) {
+        throw cronparser::BadCronExpression(
+            "Cron expression has no future trigger time");
+    }
+
+    return next;
+}
+
+void Scheduler::PushHeapEntry(std::time_t fireTime, ScheduledJobId jobId) {
+    heap_.push_back({ fireTime, jobId });
+    std::push_heap(heap_.begin(), heap_.end(), std::greater<HeapEntry>());
+}
+
+// A heap entry is stale once its job is removed or has been rescheduled.
+bool Scheduler::IsHeapEntryStale(const HeapEntry& entry) {
+    auto job = jobs_.find(entry.job_id);
+    return job == jobs_.end() || job->second.next_fire_time != entry.fire_time;
+}
+
+void Scheduler::DiscardStaleHeapEntries() {
+    while (!heap_.empty() && IsHeapEntryStale(heap_.front())) {
+        std::pop_heap(heap_.begin(), heap_.end(), std::greater<HeapEntry>());
+        heap_.pop_back();
+    }
+}
+
+}   // namespace scheduler
+}   // namespace duplitrace
@@ -0,0 +1,117 @@
+/*
+This source file is part of DupliTrace
+For the latest info, see https://github.com/SwatKat1977/DupliTrace
+
+Copyright 2024 DupliTrace Development Team
+
+    This program is free software : you can redistribute it and /or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see < https://www.gnu.org/licenses/>.
+*/
+#ifndef SCHEDULER_H_
+#define SCHEDULER_H_
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+#include "Metrics.h"
+#include "WorkerPool.h"
+#include "../cron_parser/CompiledCronExpression.h"
+
+namespace duplitrace { namespace scheduler {
+
+using ScheduledJobId = uint64_t;
+using ScheduledJobCallback = std::function<void()>;
+
+/*
+Cron driven job scheduler. Jobs are kept in a min-heap keyed on their next
+fire time, so finding and firing the next due job is O(log n) regardless of
+how many schedules are registered. Only the job that has just fired has its
+next trigger time recalculated, from a compiled form of its expression.
+
+The scheduler does not own a thread, the owner asks for the next deadline,
+waits for it (e.g. in an event loop) and then calls RunPending(). Callbacks
+are run on the supplied worker pool. If a lag histogram is given, the
+milliseconds between a job's fire time and its callback starting are
+recorded in it.
+
+A job given a time zone is evaluated in that zone, without going through the
+C library, otherwise it is evaluated in the process' local time.
+*/
+class Scheduler {
+ public:
+    explicit Scheduler(common::WorkerPool* workerPool,
+                       common::MetricHistogram* lag = nullptr);
+
+    ScheduledJobId AddJob(
+        const cronparser::CronExpression& expression,
+        ScheduledJobCallback callback,
+        std::time_t now,
+        std::shared_ptr<const cronparser::CronTimeZone> timeZone = nullptr);
+
+    ScheduledJobId AddJob(
+        std::shared_ptr<const cronparser::CompiledCronExpression> expression,
+        ScheduledJobCallback callback,
+        std::time_t now,
+        std::shared_ptr<const cronparser::CronTimeZone> timeZone = nullptr);
+
+    bool RemoveJob(ScheduledJobId jobId);
+
+    size_t JobCount();
+
+    std::optional<std::time_t> NextDeadline();
+
+    size_t RunPending(std::time_t now);
+
+ private:
+    struct ScheduledJob {
+        std::shared_ptr<const cronparser::CompiledCronExpression> expression;
+        std::shared_ptr<const cronparser::CronTimeZone> time_zone;
+        ScheduledJobCallback callback;
+        std::time_t next_fire_time;
+    };
+
+    struct HeapEntry {
+        std::time_t fire_time;
+        ScheduledJobId job_id;
+
+        bool operator>(const HeapEntry& right) const {
+            return fire_time > right.fire_time;
+        }
+    };
+
+    std::mutex mutex_;
+    common::WorkerPool* worker_pool_;
+    common::MetricHistogram* lag_;
+    std::unordered_map<ScheduledJobId, ScheduledJob> jobs_;
+    std::vector<HeapEntry> heap_;
+    ScheduledJobId next_job_id_;
+
+    std::time_t CalculateNextFireTime(
+        const cronparser::CompiledCronExpression& expression,
+        const cronparser::CronTimeZone* timeZone, std::time_t after);
+
+    void PushHeapEntry(std::time_t fireTime, ScheduledJobId jobId);
+
+    bool IsHeapEntryStale(const HeapEntry& entry);
+
+    void DiscardStaleHeapEntries();
+};
+
+}   // namespace scheduler
+}   // namespace duplitrace
+
+#endif  // SCHEDULER_H_